@@ -0,0 +1,138 @@
+//	Compares parse_text_column against parsing each
+//	value with the C and C++ standard libraries
+//
+//	Usage: asio_pq_bench_parse_text [rows]
+
+#include <asio_pq/parse_text.hpp>
+
+#include <asio_pq/oid.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+namespace {
+
+asio_pq::result make_result (Oid type, const std::vector<std::string> & values) {
+	asio_pq::result r(PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK));
+	if (!r) throw std::bad_alloc();
+	char name [] = "value";
+	PGresAttDesc desc{};
+	desc.name = name;
+	desc.typid = type;
+	desc.typlen = -1;
+	desc.atttypmod = -1;
+	if (PQsetResultAttrs(r, 1, &desc) == 0) throw std::bad_alloc();
+	for (std::size_t i = 0; i < values.size(); ++i) {
+		auto && v = values[i];
+		if (PQsetvalue(r, int(i), 0, const_cast<char *>(v.data()), int(v.size())) == 0) throw std::bad_alloc();
+	}
+	return r;
+}
+
+//	Runs a function several times and reports the
+//	best time per value
+template <typename Function>
+void run (const char * name, std::size_t rows, Function f) {
+	using clock = std::chrono::steady_clock;
+	auto best = clock::duration::max();
+	std::uint64_t sink = 0;
+	for (int i = 0; i < 5; ++i) {
+		auto begin = clock::now();
+		sink += f();
+		auto elapsed = clock::now() - begin;
+		if (elapsed < best) best = elapsed;
+	}
+	double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(best).count()) / double(rows);
+	std::cout << "  " << std::left << std::setw(28) << name
+		<< std::right << std::fixed << std::setprecision(2) << std::setw(8) << ns << " ns/value"
+		<< " (checksum " << sink << ")" << std::endl;
+}
+
+const char * level_name (asio_pq::simd_level level) {
+	switch (level) {
+	case asio_pq::simd_level::avx2:
+		return "avx2";
+	case asio_pq::simd_level::sse42:
+		return "sse4.2";
+	case asio_pq::simd_level::scalar:
+	default:
+		break;
+	}
+	return "scalar";
+}
+
+template <typename T>
+std::uint64_t parse_column (const asio_pq::result & r, std::vector<T> & out, asio_pq::simd_level level) {
+	boost::system::error_code ec;
+	asio_pq::parse_text_column(r, 0, out.data(), nullptr, ec, level);
+	if (ec) throw std::runtime_error(ec.message());
+	return std::uint64_t(out[out.size() / 2]);
+}
+
+}
+
+int main (int argc, char ** argv) {
+	std::size_t rows = 1000000;
+	if (argc > 1) rows = std::size_t(std::strtoull(argv[1], nullptr, 10));
+	if (rows == 0) return EXIT_FAILURE;
+	std::mt19937_64 engine(42);
+	std::cout << "Supported: " << level_name(asio_pq::supported_simd_level()) << std::endl;
+	std::vector<std::string> values;
+	values.reserve(rows);
+	std::uniform_int_distribution<std::int64_t> ints(-1000000000000LL, 1000000000000LL);
+	for (std::size_t i = 0; i < rows; ++i) values.push_back(std::to_string(ints(engine)));
+	auto ints_result = make_result(asio_pq::oid::int8, values);
+	std::vector<std::int64_t> int_out(rows);
+	std::cout << "int8 (" << rows << " values):" << std::endl;
+	run("strtoll", rows, [&] () {
+		for (std::size_t i = 0; i < rows; ++i) int_out[i] = std::strtoll(PQgetvalue(ints_result, int(i), 0), nullptr, 10);
+		return std::uint64_t(int_out[rows / 2]);
+	});
+	#if defined(__cpp_lib_to_chars)
+	run("std::from_chars", rows, [&] () {
+		for (std::size_t i = 0; i < rows; ++i) {
+			const char * p = PQgetvalue(ints_result, int(i), 0);
+			std::from_chars(p, p + PQgetlength(ints_result, int(i), 0), int_out[i]);
+		}
+		return std::uint64_t(int_out[rows / 2]);
+	});
+	#endif
+	for (auto level : {asio_pq::simd_level::scalar, asio_pq::simd_level::sse42, asio_pq::simd_level::avx2}) {
+		if (level > asio_pq::supported_simd_level()) break;
+		std::string name("parse_text_column (");
+		name += level_name(level);
+		name += ")";
+		run(name.c_str(), rows, [&] () {	return parse_column(ints_result, int_out, level);	});
+	}
+	values.clear();
+	std::uniform_real_distribution<double> doubles(-1000.0, 1000.0);
+	for (std::size_t i = 0; i < rows; ++i) {
+		char buffer [32];
+		std::snprintf(buffer, sizeof(buffer), "%.6g", doubles(engine));
+		values.push_back(buffer);
+	}
+	auto doubles_result = make_result(asio_pq::oid::float8, values);
+	std::vector<double> double_out(rows);
+	std::cout << "float8 (" << rows << " values):" << std::endl;
+	run("strtod", rows, [&] () {
+		for (std::size_t i = 0; i < rows; ++i) double_out[i] = std::strtod(PQgetvalue(doubles_result, int(i), 0), nullptr);
+		return std::uint64_t(double_out[rows / 2]);
+	});
+	run("parse_text_column", rows, [&] () {	return parse_column(doubles_result, double_out, asio_pq::supported_simd_level());	});
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,480 @@
+//	Measures the cost of connecting, the latency of
+//	a round trip, throughput versus the number of
+//	connections and threads, and the cost of results
+//	of increasing size, together with the number of
+//	allocations (via operator new) and system calls
+//	each operation performs
+//
+//	Usage: asio_pq_bench_round_trip [conninfo] [iterations] [seconds]
+//
+//	The conninfo string is passed to libpq unchanged
+//	so that when it is omitted the PG* environment
+//	variables (e.g. PGHOST and PGPORT) select the
+//	server, which may be a local PostgreSQL or any
+//	local stand-in which speaks the protocol
+//
+//	System calls are counted by interposing the socket,
+//	polling, and read/write functions used by libpq and
+//	Boost.Asio and therefore are only counted where that
+//	is supported (i.e. glibc)
+//
+//	Throughput is only measured with more than one
+//	thread where handlers may be bound to a strand
+//	executor (i.e. Boost 1.66 or later): The legacy
+//	io_service::strand::wrap deallocates through
+//	different hooks than it allocates through and
+//	therefore cannot be combined with the memory the
+//	library recycles per connection
+
+#include <asio_pq/connect.hpp>
+
+#include <asio_pq/connection.hpp>
+#include <asio_pq/detail/executor.hpp>
+#include <asio_pq/get_result.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/strand.hpp>
+#endif
+
+#ifdef __GLIBC__
+#include <dlfcn.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define ASIO_PQ_BENCH_COUNT_SYSCALLS
+#endif
+
+namespace {
+
+std::atomic<std::size_t> allocations(0);
+std::atomic<std::size_t> syscalls(0);
+
+}
+
+void * operator new (std::size_t size) {
+	++allocations;
+	if (void * ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void * operator new [] (std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete (void * ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete [] (void * ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete (void * ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete [] (void * ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
+
+#ifdef ASIO_PQ_BENCH_COUNT_SYSCALLS
+
+namespace {
+
+template <typename Function>
+Function next_function (Function, const char * name) {
+	auto retr = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+	if (!retr) std::abort();
+	return retr;
+}
+
+}
+
+extern "C" {
+
+ssize_t send (int fd, const void * buf, size_t n, int flags) {
+	static auto f = next_function(&send, "send");
+	++syscalls;
+	return f(fd, buf, n, flags);
+}
+
+ssize_t recv (int fd, void * buf, size_t n, int flags) {
+	static auto f = next_function(&recv, "recv");
+	++syscalls;
+	return f(fd, buf, n, flags);
+}
+
+ssize_t sendmsg (int fd, const struct msghdr * message, int flags) {
+	static auto f = next_function(&sendmsg, "sendmsg");
+	++syscalls;
+	return f(fd, message, flags);
+}
+
+ssize_t recvmsg (int fd, struct msghdr * message, int flags) {
+	static auto f = next_function(&recvmsg, "recvmsg");
+	++syscalls;
+	return f(fd, message, flags);
+}
+
+ssize_t read (int fd, void * buf, size_t n) {
+	static auto f = next_function(&read, "read");
+	++syscalls;
+	return f(fd, buf, n);
+}
+
+ssize_t write (int fd, const void * buf, size_t n) {
+	static auto f = next_function(&write, "write");
+	++syscalls;
+	return f(fd, buf, n);
+}
+
+int poll (struct pollfd * fds, nfds_t n, int timeout) {
+	static auto f = next_function(&poll, "poll");
+	++syscalls;
+	return f(fds, n, timeout);
+}
+
+int epoll_wait (int epfd, struct epoll_event * events, int max, int timeout) {
+	static auto f = next_function(&epoll_wait, "epoll_wait");
+	++syscalls;
+	return f(epfd, events, max, timeout);
+}
+
+}
+
+#endif
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+class counters {
+public:
+	std::size_t allocations;
+	std::size_t syscalls;
+	static counters now () noexcept {
+		return counters{::allocations.load(), ::syscalls.load()};
+	}
+};
+
+double per_op (std::size_t count, std::size_t ops) {
+	return ops ? (double(count) / double(ops)) : 0.0;
+}
+
+double microseconds (clock::duration d) {
+	return double(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()) / 1000.0;
+}
+
+clock::duration percentile (std::vector<clock::duration> & samples, double p) {
+	if (samples.empty()) return clock::duration::zero();
+	std::sort(samples.begin(), samples.end());
+	auto i = std::min(samples.size() - 1, std::size_t(p * double(samples.size())));
+	return samples[i];
+}
+
+void report (const std::string & name, std::vector<clock::duration> & samples, counters begin, counters end) {
+	auto ops = samples.size();
+	std::cout << "  " << std::left << std::setw(36) << name
+		<< std::right << std::fixed << std::setprecision(2)
+		<< " p50 " << std::setw(10) << microseconds(percentile(samples, 0.5)) << " us"
+		<< " p99 " << std::setw(10) << microseconds(percentile(samples, 0.99)) << " us"
+		<< " " << std::setw(8) << per_op(end.allocations - begin.allocations, ops) << " allocs/op";
+	#ifdef ASIO_PQ_BENCH_COUNT_SYSCALLS
+	std::cout << " " << std::setw(8) << per_op(end.syscalls - begin.syscalls, ops) << " syscalls/op";
+	#endif
+	std::cout << std::endl;
+}
+
+//	Retrieves every result of the pending command and
+//	then invokes a handler with the number of rows in
+//	the last result
+template <typename Handler>
+class query_op {
+private:
+	asio_pq::connection & conn_;
+	std::size_t rows_;
+	Handler h_;
+public:
+	query_op (asio_pq::connection & conn, Handler h)
+		:	conn_(conn),
+			rows_(0),
+			h_(std::move(h))
+	{	}
+	void operator () (boost::system::error_code ec, asio_pq::result r) {
+		if (ec) throw boost::system::system_error(ec);
+		if (!r) {
+			h_(rows_);
+			return;
+		}
+		if (PQresultStatus(r) == PGRES_FATAL_ERROR) throw std::runtime_error(PQresultErrorMessage(r));
+		rows_ = std::size_t(PQntuples(r));
+		asio_pq::async_get_result(conn_, std::move(*this));
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return h_;
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, query_op * self) {
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->h_));
+	}
+	friend void * asio_handler_allocate (std::size_t num, query_op * self) {
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->h_));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, query_op * self) {
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->h_));
+	}
+};
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<query_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<query_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<query_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<query_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
+
+namespace {
+
+template <typename Handler>
+void async_query (asio_pq::connection & conn, const char * command, Handler h) {
+	if (PQsendQuery(conn, command) == 0) throw std::runtime_error(PQerrorMessage(conn));
+	asio_pq::async_get_result(conn, query_op<Handler>(conn, std::move(h)));
+}
+
+std::unique_ptr<asio_pq::connection> connect (boost::asio::io_service & ios, const std::string & conninfo) {
+	auto retr = std::make_unique<asio_pq::connection>(ios, conninfo.c_str());
+	if (!*retr) throw std::bad_alloc();
+	boost::system::error_code ec;
+	asio_pq::async_connect(*retr, [&] (auto e) {	ec = e;	});
+	ios.run();
+	ios.reset();
+	if (ec) throw boost::system::system_error(ec, PQerrorMessage(*retr));
+	if (PQsetnonblocking(*retr, 1) != 0) throw std::runtime_error(PQerrorMessage(*retr));
+	return retr;
+}
+
+void bench_connect (const std::string & conninfo, std::size_t iterations) {
+	boost::asio::io_service ios;
+	std::vector<clock::duration> samples;
+	samples.reserve(iterations);
+	auto begin = counters::now();
+	for (std::size_t i = 0; i < iterations; ++i) {
+		auto start = clock::now();
+		connect(ios, conninfo);
+		samples.push_back(clock::now() - start);
+	}
+	auto end = counters::now();
+	std::cout << "Connect (" << iterations << " connections):" << std::endl;
+	report("async_connect", samples, begin, end);
+}
+
+void bench_round_trip (const std::string & conninfo, std::size_t iterations) {
+	std::cout << "Round trip (" << iterations << " x SELECT 1):" << std::endl;
+	std::vector<clock::duration> samples;
+	samples.reserve(iterations);
+	{
+		//	The baseline: Blocking libpq without the library
+		std::unique_ptr<PGconn, decltype(&PQfinish)> conn(PQconnectdb(conninfo.c_str()), &PQfinish);
+		if (PQstatus(conn.get()) != CONNECTION_OK) throw std::runtime_error(PQerrorMessage(conn.get()));
+		auto begin = counters::now();
+		for (std::size_t i = 0; i < iterations; ++i) {
+			auto start = clock::now();
+			asio_pq::result r(PQexec(conn.get(), "SELECT 1"));
+			if (PQresultStatus(r) != PGRES_TUPLES_OK) throw std::runtime_error(PQerrorMessage(conn.get()));
+			samples.push_back(clock::now() - start);
+		}
+		report("PQexec (blocking)", samples, begin, counters::now());
+	}
+	samples.clear();
+	boost::asio::io_service ios;
+	auto conn = connect(ios, conninfo);
+	std::size_t remaining = iterations;
+	clock::time_point start;
+	auto begin = counters::now();
+	//	Not a std::function so that the allocations
+	//	counted are only those of the library
+	class loop {
+	public:
+		std::size_t * remaining;
+		clock::time_point * start;
+		std::vector<clock::duration> * samples;
+		asio_pq::connection * conn;
+		void operator () (std::size_t) const {
+			samples->push_back(clock::now() - *start);
+			if (--*remaining == 0) return;
+			*start = clock::now();
+			async_query(*conn, "SELECT 1", *this);
+		}
+	};
+	start = clock::now();
+	async_query(*conn, "SELECT 1", loop{&remaining, &start, &samples, conn.get()});
+	ios.run();
+	report("async_get_result", samples, begin, counters::now());
+}
+
+//	Repeatedly sends a command on its own connection
+//	until a deadline
+class client {
+private:
+	std::unique_ptr<asio_pq::connection> conn_;
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	boost::asio::strand<boost::asio::io_service::executor_type> strand_;
+	#endif
+	clock::time_point end_;
+	std::size_t completed_;
+	template <typename Function>
+	auto wrap (Function f) {
+		#ifdef ASIO_PQ_HAS_EXECUTORS
+		return boost::asio::bind_executor(strand_, std::move(f));
+		#else
+		return f;
+		#endif
+	}
+public:
+	client (boost::asio::io_service & ios, const std::string & conninfo)
+		:	conn_(connect(ios, conninfo)),
+			#ifdef ASIO_PQ_HAS_EXECUTORS
+			strand_(ios.get_executor()),
+			#endif
+			completed_(0)
+	{	}
+	void start (clock::time_point end) {
+		end_ = end;
+		completed_ = 0;
+		conn_->get_io_service().post(wrap([this] () {	next();	}));
+	}
+	void next () {
+		async_query(*conn_, "SELECT 1", wrap([this] (std::size_t) {
+			++completed_;
+			if (clock::now() < end_) next();
+		}));
+	}
+	std::size_t completed () const noexcept {
+		return completed_;
+	}
+};
+
+void bench_throughput (const std::string & conninfo, double seconds) {
+	std::cout << "Throughput (SELECT 1 for " << seconds << " s):" << std::endl;
+	for (std::size_t connections : {1, 4, 16}) {
+		#ifdef ASIO_PQ_HAS_EXECUTORS
+		for (std::size_t threads : {1, 2, 4}) {
+		#else
+		for (std::size_t threads : {1}) {
+		#endif
+			boost::asio::io_service ios;
+			std::vector<std::unique_ptr<client>> clients;
+			for (std::size_t i = 0; i < connections; ++i) clients.push_back(std::make_unique<client>(ios, conninfo));
+			auto begin = counters::now();
+			auto start = clock::now();
+			auto end = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+			for (auto && c : clients) c->start(end);
+			std::vector<std::thread> ts;
+			for (std::size_t i = 1; i < threads; ++i) ts.emplace_back([&] () {	ios.run();	});
+			ios.run();
+			for (auto && t : ts) t.join();
+			auto elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			auto after = counters::now();
+			std::size_t ops = 0;
+			for (auto && c : clients) ops += c->completed();
+			std::cout << "  " << std::setw(2) << connections << " connections " << threads << " threads"
+				<< std::fixed << std::setprecision(0) << std::setw(12) << (double(ops) / elapsed) << " queries/s"
+				<< std::setprecision(2) << std::setw(8) << per_op(after.allocations - begin.allocations, ops) << " allocs/op";
+			#ifdef ASIO_PQ_BENCH_COUNT_SYSCALLS
+			std::cout << std::setw(8) << per_op(after.syscalls - begin.syscalls, ops) << " syscalls/op";
+			#endif
+			std::cout << std::endl;
+		}
+	}
+}
+
+void bench_result_size (const std::string & conninfo, std::size_t iterations) {
+	std::cout << "Result size (SELECT generate_series(1, N)):" << std::endl;
+	boost::asio::io_service ios;
+	auto conn = connect(ios, conninfo);
+	for (std::size_t rows : {1, 100, 10000, 1000000}) {
+		auto command = "SELECT generate_series(1, " + std::to_string(rows) + ")";
+		auto reps = std::max<std::size_t>(3, std::min(iterations, 1000000 / rows / 10));
+		std::vector<clock::duration> samples;
+		samples.reserve(reps);
+		std::size_t received = 0;
+		auto begin = counters::now();
+		for (std::size_t i = 0; i < reps; ++i) {
+			auto start = clock::now();
+			async_query(*conn, command.c_str(), [&] (std::size_t n) {
+				samples.push_back(clock::now() - start);
+				received = n;
+			});
+			ios.run();
+			ios.reset();
+		}
+		auto end = counters::now();
+		report("N = " + std::to_string(rows) + " (" + std::to_string(received) + " rows received)", samples, begin, end);
+	}
+}
+
+}
+
+int main (int argc, char ** argv) {
+	std::string conninfo;
+	if (argc > 1) conninfo = argv[1];
+	std::size_t iterations = 10000;
+	if (argc > 2) iterations = std::size_t(std::strtoull(argv[2], nullptr, 10));
+	double seconds = 1.0;
+	if (argc > 3) seconds = std::strtod(argv[3], nullptr);
+	if ((iterations == 0) || !(seconds > 0.0)) return EXIT_FAILURE;
+	try {
+		bench_connect(conninfo, std::max<std::size_t>(1, iterations / 100));
+		bench_round_trip(conninfo, iterations);
+		bench_throughput(conninfo, seconds);
+		bench_result_size(conninfo, iterations);
+	} catch (const std::exception & ex) {
+		std::cerr << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,280 @@
+#include <asio_pq/columnar.hpp>
+
+#include <asio_pq/detail/endian.hpp>
+#include <asio_pq/detail/timestamp.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/oid.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <libpq-fe.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+namespace {
+
+column_type get_column_type (Oid type, int format) noexcept {
+	if (format == 0) return column_type::utf8;
+	switch (type) {
+	case oid::boolean:
+		return column_type::boolean;
+	case oid::int2:
+		return column_type::int16;
+	case oid::int4:
+		return column_type::int32;
+	case oid::int8:
+		return column_type::int64;
+	case oid::float4:
+		return column_type::float32;
+	case oid::float8:
+		return column_type::float64;
+	case oid::timestamp:
+	case oid::timestamptz:
+		return column_type::timestamp;
+	case oid::text:
+	case oid::varchar:
+	case oid::bpchar:
+	case oid::json:
+	case oid::jsonb:
+		return column_type::utf8;
+	default:
+		break;
+	}
+	return column_type::binary;
+}
+
+//	Records the size of a column so that it may be
+//	restored if appending fails part way through
+class mark {
+public:
+	explicit mark (const column & c) noexcept
+		:	length(c.length),
+			null_count(c.null_count),
+			values(c.values.size()),
+			offsets(c.offsets.size())
+	{	}
+	std::int64_t length;
+	std::int64_t null_count;
+	std::size_t values;
+	std::size_t offsets;
+};
+
+std::size_t bitmap_size (std::int64_t length) noexcept {
+	return std::size_t((length + 7) / 8);
+}
+
+void truncate_bitmap (aligned_vector<std::uint8_t> & bitmap, std::int64_t length) {
+	bitmap.resize(bitmap_size(length));
+	auto remainder = unsigned(length % 8);
+	if (remainder != 0) bitmap.back() &= std::uint8_t((1U << remainder) - 1U);
+}
+
+void restore (column & c, const mark & m) {
+	c.length = m.length;
+	c.null_count = m.null_count;
+	truncate_bitmap(c.validity, c.length);
+	if (c.type == column_type::boolean) {
+		truncate_bitmap(c.values, c.length);
+	} else {
+		c.values.resize(m.values);
+	}
+	c.offsets.resize(m.offsets);
+}
+
+void set_bit (aligned_vector<std::uint8_t> & bitmap, std::int64_t index, bool value) {
+	if ((index % 8) == 0) bitmap.push_back(0);
+	if (value) bitmap.back() |= std::uint8_t(1U << unsigned(index % 8));
+}
+
+template <typename T, typename Load>
+bool append_fixed (column & c, const PGresult * r, int col, int rows, Load load) {
+	std::size_t offset = c.values.size();
+	c.values.resize(offset + (std::size_t(rows) * sizeof(T)), 0);
+	auto out = c.values.data() + offset;
+	for (int i = 0; i < rows; ++i, out += sizeof(T)) {
+		bool valid = !PQgetisnull(r, i, col);
+		set_bit(c.validity, c.length, valid);
+		++c.length;
+		if (!valid) {
+			++c.null_count;
+			continue;
+		}
+		if (PQgetlength(r, i, col) != int(sizeof(T))) return false;
+		T value = load(PQgetvalue(r, i, col));
+		std::memcpy(out, &value, sizeof(T));
+	}
+	return true;
+}
+
+template <typename T>
+bool append_fixed (column & c, const PGresult * r, int col, int rows) {
+	return append_fixed<T>(c, r, col, rows, [] (const char * in) noexcept {
+		return detail::load_value<T>(in);
+	});
+}
+
+bool append_boolean (column & c, const PGresult * r, int col, int rows) {
+	for (int i = 0; i < rows; ++i) {
+		bool valid = !PQgetisnull(r, i, col);
+		bool value = false;
+		if (valid) {
+			if (PQgetlength(r, i, col) != 1) return false;
+			value = PQgetvalue(r, i, col)[0] != 0;
+		} else {
+			++c.null_count;
+		}
+		set_bit(c.validity, c.length, valid);
+		set_bit(c.values, c.length, value);
+		++c.length;
+	}
+	return true;
+}
+
+bool append_timestamp (column & c, const PGresult * r, int col, int rows) {
+	return append_fixed<std::int64_t>(c, r, col, rows, [] (const char * in) noexcept {
+		auto value = detail::load_value<std::int64_t>(in);
+		if (
+			(value == std::numeric_limits<std::int64_t>::max()) ||
+			(value == std::numeric_limits<std::int64_t>::min())
+		) return value;
+		return value + detail::postgres_epoch_offset;
+	});
+}
+
+bool append_variable (column & c, const PGresult * r, int col, int rows, bool jsonb) {
+	if (c.offsets.empty()) c.offsets.push_back(0);
+	for (int i = 0; i < rows; ++i) {
+		bool valid = !PQgetisnull(r, i, col);
+		set_bit(c.validity, c.length, valid);
+		++c.length;
+		if (valid) {
+			const char * data = PQgetvalue(r, i, col);
+			std::size_t length = std::size_t(PQgetlength(r, i, col));
+			if (jsonb) {
+				if ((length == 0) || (data[0] != 1)) return false;
+				++data;
+				--length;
+			}
+			if ((c.values.size() + length) > std::size_t(std::numeric_limits<std::int32_t>::max())) return false;
+			c.values.insert(c.values.end(), data, data + length);
+		} else {
+			++c.null_count;
+		}
+		c.offsets.push_back(std::int32_t(c.values.size()));
+	}
+	return true;
+}
+
+bool append_column (column & c, const PGresult * r, int col, int rows) {
+	switch (c.type) {
+	case column_type::boolean:
+		return append_boolean(c, r, col, rows);
+	case column_type::int16:
+		return append_fixed<std::int16_t>(c, r, col, rows);
+	case column_type::int32:
+		return append_fixed<std::int32_t>(c, r, col, rows);
+	case column_type::int64:
+		return append_fixed<std::int64_t>(c, r, col, rows);
+	case column_type::float32:
+		return append_fixed<float>(c, r, col, rows);
+	case column_type::float64:
+		return append_fixed<double>(c, r, col, rows);
+	case column_type::timestamp:
+		return append_timestamp(c, r, col, rows);
+	case column_type::binary:
+	case column_type::utf8:
+	default:
+		break;
+	}
+	return append_variable(c, r, col, rows, (c.format == 1) && (c.oid == oid::jsonb));
+}
+
+}
+
+columnar_builder::columnar_builder () noexcept
+	:	rows_(0),
+		initialized_(false)
+{	}
+
+void columnar_builder::append (const PGresult * r, boost::system::error_code & ec) {
+	ec.clear();
+	int fields = PQnfields(r);
+	bool first = !initialized_;
+	//	Results of commands which do not return rows
+	//	do not determine the columns
+	if (first && (fields == 0)) return;
+	if (!first) {
+		bool matches = fields == int(columns_.size());
+		for (int i = 0; matches && (i < fields); ++i) {
+			auto && c = columns_[std::size_t(i)];
+			matches = (PQftype(r, i) == c.oid) && (PQfformat(r, i) == c.format);
+		}
+		if (!matches) {
+			ec = make_error_code(error::type_mismatch);
+			return;
+		}
+	} else {
+		std::vector<column> columns;
+		columns.reserve(std::size_t(fields));
+		for (int i = 0; i < fields; ++i) {
+			column c;
+			c.name = PQfname(r, i);
+			c.oid = PQftype(r, i);
+			c.format = PQfformat(r, i);
+			c.type = get_column_type(c.oid, c.format);
+			c.length = 0;
+			c.null_count = 0;
+			columns.push_back(std::move(c));
+		}
+		columns_ = std::move(columns);
+		initialized_ = true;
+	}
+	int rows = PQntuples(r);
+	if (rows == 0) return;
+	std::vector<mark> marks;
+	marks.reserve(columns_.size());
+	for (auto && c : columns_) marks.emplace_back(c);
+	//	Columns are filled one at a time so that
+	//	each output buffer is written sequentially
+	for (int i = 0; i < fields; ++i) {
+		if (!append_column(columns_[std::size_t(i)], r, i, rows)) {
+			if (first) {
+				finish();
+			} else {
+				for (std::size_t j = 0; j < columns_.size(); ++j) restore(columns_[j], marks[j]);
+			}
+			ec = make_error_code(error::decode_failed);
+			return;
+		}
+	}
+	rows_ += rows;
+}
+
+void columnar_builder::append (const PGresult * r) {
+	boost::system::error_code ec;
+	append(r, ec);
+	if (ec) throw boost::system::system_error(ec);
+}
+
+std::int64_t columnar_builder::size () const noexcept {
+	return rows_;
+}
+
+const std::vector<column> & columnar_builder::columns () const noexcept {
+	return columns_;
+}
+
+std::vector<column> columnar_builder::finish () noexcept {
+	auto retr = std::move(columns_);
+	columns_.clear();
+	rows_ = 0;
+	initialized_ = false;
+	return retr;
+}
+
+}
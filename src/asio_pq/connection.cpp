@@ -11,10 +11,12 @@ namespace asio_pq {
 
 void connection::destroy () noexcept {
 	if (!conn_) return;
+	//	The socket may belong to libpq in which case it
+	//	must be released before PQfinish closes it
+	socket_ = boost::none;
 	PQfinish(conn_);
 	conn_ = nullptr;
 	ios_ = nullptr;
-	socket_ = boost::none;
 }
 
 void connection::check () const {
@@ -24,7 +26,8 @@ void connection::check () const {
 connection::connection (connection && other) noexcept
 	:	conn_(other.conn_),
 		ios_(other.ios_),
-		socket_(std::move(other.socket_))
+		socket_(std::move(other.socket_)),
+		memory_(std::move(other.memory_))
 {
 	other.conn_ = nullptr;
 	other.ios_ = nullptr;
@@ -36,6 +39,7 @@ connection & connection::operator = (connection && rhs) noexcept {
 	swap(conn_, rhs.conn_);
 	swap(ios_, rhs.ios_);
 	swap(socket_, rhs.socket_);
+	memory_ = std::move(rhs.memory_);
 	return *this;
 }
 
@@ -84,6 +88,12 @@ boost::asio::io_service & connection::get_io_service () const noexcept {
 	return *ios_;
 }
 
+#ifdef ASIO_PQ_HAS_EXECUTORS
+connection::executor_type connection::get_executor () const noexcept {
+	return get_io_service().get_executor();
+}
+#endif
+
 boost::system::error_code connection::duplicate_socket () {
 	boost::system::error_code ec;
 	if (socket_) return ec;
@@ -92,10 +102,19 @@ boost::system::error_code connection::duplicate_socket () {
 	return ec;
 }
 
+boost::system::error_code connection::refresh_socket () {
+	socket_ = boost::none;
+	return duplicate_socket();
+}
+
 bool connection::has_socket () const noexcept {
 	return bool(socket_);
 }
 
+detail::handler_memory & connection::memory () noexcept {
+	return memory_;
+}
+
 void connection::cancel (boost::system::error_code & ec) noexcept {
 	ec.clear();
 	socket([&] (auto & socket) noexcept {	socket.cancel(ec);	});
@@ -0,0 +1,43 @@
+#include <asio_pq/copy_binary.hpp>
+
+#include <asio_pq/detail/endian.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace asio_pq {
+
+void copy_binary_writer::append (std::int16_t value) {
+	char buffer [2];
+	detail::store_value(value, buffer);
+	out_.append(buffer, sizeof(buffer));
+}
+
+void copy_binary_writer::append (std::int32_t value) {
+	char buffer [4];
+	detail::store_value(value, buffer);
+	out_.append(buffer, sizeof(buffer));
+}
+
+copy_binary_writer::copy_binary_writer (std::string & out) noexcept
+	:	out_(out)
+{	}
+
+void copy_binary_writer::header () {
+	//	The signature, followed by the flags field
+	//	and the length of the header extension area
+	static const char signature [] = "PGCOPY\n\377\r\n";
+	out_.append(signature, sizeof(signature));
+	append(std::int32_t(0));
+	append(std::int32_t(0));
+}
+
+void copy_binary_writer::trailer () {
+	append(std::int16_t(-1));
+}
+
+std::size_t copy_binary_writer::size () const noexcept {
+	return out_.size();
+}
+
+}
@@ -0,0 +1,84 @@
+#include <asio_pq/copy_data.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+
+namespace asio_pq {
+
+void copy_data::destroy () noexcept {
+	if (!handle_) return;
+	PQfreemem(handle_);
+	handle_ = nullptr;
+	data_ = nullptr;
+	size_ = 0;
+}
+
+copy_data::copy_data () noexcept
+	:	handle_(nullptr),
+		data_(nullptr),
+		size_(0)
+{	}
+
+copy_data::copy_data (copy_data && other) noexcept
+	:	handle_(other.handle_),
+		data_(other.data_),
+		size_(other.size_)
+{
+	other.handle_ = nullptr;
+	other.data_ = nullptr;
+	other.size_ = 0;
+}
+
+copy_data & copy_data::operator = (copy_data && other) noexcept {
+	destroy();
+	using std::swap;
+	swap(handle_, other.handle_);
+	swap(data_, other.data_);
+	swap(size_, other.size_);
+	return *this;
+}
+
+copy_data::copy_data (char * handle, std::size_t size) noexcept
+	:	handle_(handle),
+		data_(handle),
+		size_(size)
+{	}
+
+copy_data::~copy_data () noexcept {
+	destroy();
+}
+
+char * copy_data::release () noexcept {
+	char * retr = handle_;
+	handle_ = nullptr;
+	data_ = nullptr;
+	size_ = 0;
+	return retr;
+}
+
+const char * copy_data::data () const noexcept {
+	return data_;
+}
+
+std::size_t copy_data::size () const noexcept {
+	return size_;
+}
+
+boost::asio::const_buffer copy_data::buffer () const noexcept {
+	return boost::asio::const_buffer(data_, size_);
+}
+
+void copy_data::consume (std::size_t num) noexcept {
+	assert(num <= size_);
+	data_ += num;
+	size_ -= num;
+}
+
+copy_data::operator bool () const noexcept {
+	return bool(handle_);
+}
+
+}
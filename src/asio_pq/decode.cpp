@@ -0,0 +1,156 @@
+#include <asio_pq/decode.hpp>
+
+#include <asio_pq/detail/endian.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/oid.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace asio_pq {
+namespace detail {
+
+Oid array_element_type (Oid type) noexcept {
+	switch (type) {
+	case oid::boolean_array:
+		return oid::boolean;
+	case oid::bytea_array:
+		return oid::bytea;
+	case oid::int2_array:
+		return oid::int2;
+	case oid::int4_array:
+		return oid::int4;
+	case oid::text_array:
+		return oid::text;
+	case oid::varchar_array:
+		return oid::varchar;
+	case oid::int8_array:
+		return oid::int8;
+	case oid::float4_array:
+		return oid::float4;
+	case oid::float8_array:
+		return oid::float8;
+	case oid::timestamp_array:
+		return oid::timestamp;
+	case oid::timestamptz_array:
+		return oid::timestamptz;
+	case oid::numeric_array:
+		return oid::numeric;
+	case oid::uuid_array:
+		return oid::uuid;
+	case oid::jsonb_array:
+		return oid::jsonb;
+	default:
+		break;
+	}
+	return 0;
+}
+
+namespace {
+
+//	The binary format of numeric is a header
+//	followed by base 10000 digits, the first of
+//	which is multiplied by 10000^weight
+class numeric_header {
+public:
+	std::int16_t ndigits;
+	std::int16_t weight;
+	std::uint16_t sign;
+	std::int16_t dscale;
+};
+
+constexpr std::uint16_t numeric_positive = 0x0000;
+constexpr std::uint16_t numeric_negative = 0x4000;
+constexpr std::uint16_t numeric_nan = 0xC000;
+constexpr std::uint16_t numeric_positive_infinity = 0xD000;
+constexpr std::uint16_t numeric_negative_infinity = 0xF000;
+
+bool read_numeric_header (const char * data, std::size_t length, numeric_header & h) noexcept {
+	if (length < 8) return false;
+	h.ndigits = load_value<std::int16_t>(data);
+	h.weight = load_value<std::int16_t>(data + 2);
+	h.sign = load_value<std::uint16_t>(data + 4);
+	h.dscale = load_value<std::int16_t>(data + 6);
+	if ((h.ndigits < 0) || (h.dscale < 0)) return false;
+	return length == (8U + (std::size_t(h.ndigits) * 2U));
+}
+
+std::int16_t numeric_digit (const char * data, const numeric_header & h, int i) noexcept {
+	if ((i < 0) || (i >= h.ndigits)) return 0;
+	return load_value<std::int16_t>(data + 8 + (i * 2));
+}
+
+void append_digit (std::string & out, std::int16_t digit, bool pad) {
+	char buffer [4];
+	for (std::size_t i = 4; i != 0; --i) {
+		buffer[i - 1] = char('0' + (digit % 10));
+		digit = std::int16_t(digit / 10);
+	}
+	std::size_t begin = 0;
+	if (!pad) while ((begin < 3) && (buffer[begin] == '0')) ++begin;
+	out.append(buffer + begin, 4 - begin);
+}
+
+}
+
+std::string numeric_to_string (const char * data, std::size_t length, boost::system::error_code & ec) {
+	numeric_header h;
+	if (!read_numeric_header(data, length, h)) return decode_failed<std::string>(ec);
+	switch (h.sign) {
+	case numeric_nan:
+		return "NaN";
+	case numeric_positive_infinity:
+		return "Infinity";
+	case numeric_negative_infinity:
+		return "-Infinity";
+	case numeric_positive:
+	case numeric_negative:
+		break;
+	default:
+		return decode_failed<std::string>(ec);
+	}
+	std::string retr;
+	if (h.sign == numeric_negative) retr.push_back('-');
+	if (h.weight < 0) {
+		retr.push_back('0');
+	} else {
+		for (int i = 0; i <= h.weight; ++i) append_digit(retr, numeric_digit(data, h, i), i != 0);
+	}
+	if (h.dscale == 0) return retr;
+	retr.push_back('.');
+	std::size_t point = retr.size();
+	for (int i = h.weight + 1; (retr.size() - point) < std::size_t(h.dscale); ++i) {
+		append_digit(retr, numeric_digit(data, h, i), true);
+	}
+	retr.resize(point + std::size_t(h.dscale));
+	return retr;
+}
+
+double numeric_to_double (const char * data, std::size_t length, boost::system::error_code & ec) noexcept {
+	numeric_header h;
+	if (!read_numeric_header(data, length, h)) return decode_failed<double>(ec);
+	switch (h.sign) {
+	case numeric_nan:
+		return std::numeric_limits<double>::quiet_NaN();
+	case numeric_positive_infinity:
+		return std::numeric_limits<double>::infinity();
+	case numeric_negative_infinity:
+		return -std::numeric_limits<double>::infinity();
+	case numeric_positive:
+	case numeric_negative:
+		break;
+	default:
+		return decode_failed<double>(ec);
+	}
+	double retr = 0;
+	for (int i = 0; i < h.ndigits; ++i) retr = (retr * 10000.0) + numeric_digit(data, h, i);
+	retr *= std::pow(10000.0, double(h.weight - h.ndigits + 1));
+	return (h.sign == numeric_negative) ? -retr : retr;
+}
+
+}
+}
@@ -0,0 +1,16 @@
+#include <asio_pq/detail/deadline.hpp>
+
+#include <asio_pq/connection.hpp>
+#include <boost/system/error_code.hpp>
+
+namespace asio_pq {
+namespace detail {
+
+void abandon (connection & conn) noexcept {
+	if (!conn.has_socket()) return;
+	boost::system::error_code ec;
+	conn.cancel(ec);
+}
+
+}
+}
@@ -0,0 +1,114 @@
+#include <asio_pq/detail/handler_memory.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace asio_pq {
+namespace detail {
+
+namespace {
+
+class heap final : public handler_memory::upstream {
+public:
+	virtual void * allocate (std::size_t size) override {
+		return ::operator new(size);
+	}
+	virtual void deallocate (void * ptr, std::size_t) noexcept override {
+		::operator delete(ptr);
+	}
+};
+
+heap default_upstream;
+
+}
+
+constexpr std::size_t handler_memory::slots;
+
+void handler_memory::destroy () noexcept {
+	for (auto && s : slots_) {
+		assert(!s.busy.load());
+		if (s.ptr) upstream_->deallocate(s.ptr, s.size);
+		s.ptr = nullptr;
+		s.size = 0;
+	}
+}
+
+void handler_memory::move (handler_memory & other) noexcept {
+	upstream_ = other.upstream_;
+	for (std::size_t i = 0; i < slots; ++i) {
+		slots_[i].ptr = other.slots_[i].ptr;
+		slots_[i].size = other.slots_[i].size;
+		other.slots_[i].ptr = nullptr;
+		other.slots_[i].size = 0;
+	}
+}
+
+handler_memory::handler_memory () noexcept
+	:	upstream_(&default_upstream)
+{	}
+
+handler_memory::handler_memory (upstream & u) noexcept
+	:	upstream_(&u)
+{	}
+
+handler_memory::handler_memory (handler_memory && other) noexcept {
+	move(other);
+}
+
+handler_memory & handler_memory::operator = (handler_memory && rhs) noexcept {
+	destroy();
+	move(rhs);
+	return *this;
+}
+
+handler_memory::~handler_memory () noexcept {
+	destroy();
+}
+
+void * handler_memory::allocate (std::size_t size) {
+	//	The size of a block is only known to be the size
+	//	it was last deallocated with so take the smallest
+	//	block which fits in order that a larger block is
+	//	not recorded as smaller than it is
+	slot * best = nullptr;
+	for (auto && s : slots_) {
+		if (s.busy.exchange(true, std::memory_order_acquire)) continue;
+		if (s.ptr && (s.size >= size) && (!best || (s.size < best->size))) {
+			if (best) best->busy.store(false, std::memory_order_release);
+			best = &s;
+			continue;
+		}
+		s.busy.store(false, std::memory_order_release);
+	}
+	if (!best) return upstream_->allocate(size);
+	void * ptr = best->ptr;
+	best->ptr = nullptr;
+	best->size = 0;
+	best->busy.store(false, std::memory_order_release);
+	return ptr;
+}
+
+void handler_memory::deallocate (void * ptr, std::size_t size) noexcept {
+	//	Prefer an empty slot, otherwise evict a smaller
+	//	block so that the cached blocks only ever grow
+	//	and in the steady state fit every allocation
+	for (int pass = 0; pass < 2; ++pass) for (auto && s : slots_) {
+		if (s.busy.exchange(true, std::memory_order_acquire)) continue;
+		bool replace = (pass == 0) ? !s.ptr : (s.size < size);
+		if (replace) {
+			std::swap(ptr, s.ptr);
+			std::swap(size, s.size);
+		}
+		s.busy.store(false, std::memory_order_release);
+		if (!replace) continue;
+		if (ptr) upstream_->deallocate(ptr, size);
+		return;
+	}
+	upstream_->deallocate(ptr, size);
+}
+
+}
+}
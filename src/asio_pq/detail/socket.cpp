@@ -2,9 +2,11 @@
 
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/system/error_code.hpp>
 #include <libpq-fe.h>
 #include <cstring>
+#include <utility>
 
 #ifdef _WIN32
 #include <Winsock2.h>
@@ -18,6 +20,63 @@
 namespace asio_pq {
 namespace detail {
 
+#ifdef ASIO_PQ_HAS_BORROWED_DESCRIPTOR
+
+void borrowed_descriptor::release () noexcept {
+	//	Deregisters the descriptor from the reactor (which
+	//	aborts pending operations) without closing it since
+	//	it belongs to libpq
+	if (descriptor_.is_open()) descriptor_.release();
+}
+
+borrowed_descriptor & borrowed_descriptor::operator = (borrowed_descriptor && rhs) noexcept {
+	release();
+	descriptor_ = std::move(rhs.descriptor_);
+	return *this;
+}
+
+borrowed_descriptor::borrowed_descriptor (boost::asio::io_service & ios) noexcept
+	:	descriptor_(ios)
+{	}
+
+borrowed_descriptor::~borrowed_descriptor () noexcept {
+	release();
+}
+
+void borrowed_descriptor::assign (int handle, boost::system::error_code & ec) noexcept {
+	descriptor_.assign(handle, ec);
+}
+
+int borrowed_descriptor::native_handle () noexcept {
+	return descriptor_.native_handle();
+}
+
+void borrowed_descriptor::cancel () {
+	descriptor_.cancel();
+}
+
+void borrowed_descriptor::cancel (boost::system::error_code & ec) noexcept {
+	descriptor_.cancel(ec);
+}
+
+borrowed_descriptor borrowed_socket (
+	boost::asio::io_service & ios,
+	PGconn * conn,
+	boost::system::error_code & ec
+) noexcept {
+	ec.clear();
+	borrowed_descriptor retr(ios);
+	int handle = PQsocket(conn);
+	if (handle == -1) {
+		ec = make_error_code(boost::system::errc::not_a_socket);
+		return retr;
+	}
+	retr.assign(handle, ec);
+	return retr;
+}
+
+#endif
+
 socket_type get_socket_type (PGconn * conn, boost::system::error_code & ec) noexcept {
 	ec.clear();
 	socket_type retr = socket_type::tcp_ip_v4;
@@ -154,6 +213,13 @@ boost::asio::local::stream_protocol::socket local_socket (
 
 socket_variant_type socket (boost::asio::io_service & ios, PGconn * conn, boost::system::error_code & ec) {
 	ec.clear();
+	#ifdef ASIO_PQ_HAS_BORROWED_DESCRIPTOR
+	if (!conn) {
+		ec = make_error_code(boost::system::errc::invalid_argument);
+		return borrowed_descriptor(ios);
+	}
+	return borrowed_socket(ios, conn, ec);
+	#else
 	if (!conn) {
 		ec = make_error_code(boost::system::errc::invalid_argument);
 		return boost::asio::ip::tcp::socket(ios);
@@ -178,6 +244,7 @@ socket_variant_type socket (boost::asio::io_service & ios, PGconn * conn, boost:
 		break;
 	}
 	return boost::asio::ip::tcp::socket(ios);
+	#endif
 }
 
 }
@@ -24,6 +24,30 @@ boost::system::error_code make_error_code (error e) noexcept {
 				return "Failed writing data";
 			case error::consume_failed:
 				return "Failed reading data";
+			case error::set_nonblocking_failed:
+				return "Failed entering non-blocking mode";
+			case error::send_failed:
+				return "Failed sending command";
+			case error::row_mode_failed:
+				return "Failed entering row-by-row mode";
+			case error::unexpected_null:
+				return "Unexpected null value";
+			case error::type_mismatch:
+				return "Column type or format mismatch";
+			case error::decode_failed:
+				return "Failed decoding binary value";
+			case error::no_such_column:
+				return "No such column";
+			case error::copy_failed:
+				return "Failed transferring COPY data";
+			case error::command_failed:
+				return "Command failed";
+			case error::timed_out:
+				return "Operation timed out";
+			case error::cancel_failed:
+				return "Failed sending cancel request";
+			case error::unexpected_copy:
+				return "Command started a COPY (use async_copy_in or async_copy_out)";
 			default:
 				break;
 			}
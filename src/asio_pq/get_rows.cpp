@@ -0,0 +1,32 @@
+#include <asio_pq/get_rows.hpp>
+
+#include <asio_pq/error.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <libpq-fe.h>
+
+namespace asio_pq {
+
+void set_row_mode (connection & conn, int chunk_size, boost::system::error_code & ec) noexcept {
+	ec.clear();
+	int result;
+	#ifdef ASIO_PQ_HAS_CHUNKED_ROWS
+	if (chunk_size > 1) {
+		result = PQsetChunkedRowsMode(conn, chunk_size);
+	} else {
+		result = PQsetSingleRowMode(conn);
+	}
+	#else
+	(void)chunk_size;
+	result = PQsetSingleRowMode(conn);
+	#endif
+	if (result == 0) ec = make_error_code(error::row_mode_failed);
+}
+
+void set_row_mode (connection & conn, int chunk_size) {
+	boost::system::error_code ec;
+	set_row_mode(conn, chunk_size, ec);
+	if (ec) throw boost::system::system_error(ec);
+}
+
+}
@@ -0,0 +1,598 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define ASIO_PQ_HAS_COROUTINES
+#endif
+#endif
+
+#ifdef ASIO_PQ_HAS_COROUTINES
+
+#include "cancel_query.hpp"
+#include "connect.hpp"
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include "detail/handler_memory.hpp"
+#include "exec.hpp"
+#include "get_result.hpp"
+#include "get_rows.hpp"
+#include "notification.hpp"
+#include "params.hpp"
+#include "result.hpp"
+#include "wait_notification.hpp"
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <libpq-fe.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef LIBPQ_HAS_PIPELINING
+#include "pipeline.hpp"
+#include "statement_cache.hpp"
+#endif
+
+namespace asio_pq {
+
+/**
+ *	The type of \ref use_awaitable.
+ */
+class use_awaitable_t {
+public:
+	constexpr use_awaitable_t () noexcept = default;
+};
+
+/**
+ *	Passing this object in place of a completion token
+ *	to one of the operations for which an overload is
+ *	provided (`async_connect`, `async_get_result`,
+ *	`async_exec`, `async_exec_params`, `async_exec_cached`,
+ *	`async_get_rows`, `async_pipeline`,
+ *	`async_wait_notification`, and `async_cancel_query`)
+ *	returns an object which may be `co_await`ed.
+ *	`async_exec_cached` and `async_pipeline` are only
+ *	available if libpq supports pipeline mode.
+ *
+ *	Unlike adapting the operation through a generic
+ *	completion token the operation is not initiated
+ *	until it is awaited and all memory it allocates
+ *	(i.e. its state and the waits it performs) is
+ *	provided by the awaited object and therefore lives
+ *	in the coroutine frame. Consequently all arguments
+ *	must remain valid until the object is awaited
+ *	(which is trivially the case for
+ *	`co_await async_exec(conn, "SELECT 1;", use_awaitable)`).
+ *
+ *	If the operation fails `boost::system::system_error`
+ *	is thrown from the `co_await` expression, otherwise
+ *	it yields whatever the operation would pass to its
+ *	completion handler after the `boost::system::error_code`
+ *	(if anything).
+ */
+constexpr use_awaitable_t use_awaitable {};
+
+namespace detail {
+
+//	Provides memory for the allocations made on behalf of
+//	an operation from a fixed number of blocks stored
+//	inline, allocations which are too large or which are
+//	made while every block is in use come from the heap.
+//
+//	As with handler_memory allocations may be released on
+//	any thread so each block is claimed atomically.
+class frame_memory {
+private:
+	static constexpr std::size_t blocks = 4;
+	static constexpr std::size_t block_size = 192;
+	class block {
+	public:
+		block () noexcept
+			:	busy(false)
+		{	}
+		alignas(std::max_align_t) unsigned char storage [block_size];
+		std::atomic<bool> busy;
+	};
+	std::array<block, blocks> blocks_;
+public:
+	frame_memory () = default;
+	frame_memory (const frame_memory &) = delete;
+	frame_memory & operator = (const frame_memory &) = delete;
+	void * allocate (std::size_t size) {
+		if (size <= block_size) for (auto && b : blocks_) {
+			if (!b.busy.exchange(true, std::memory_order_acquire)) return b.storage;
+		}
+		return ::operator new(size);
+	}
+	void deallocate (void * ptr, std::size_t) noexcept {
+		for (auto && b : blocks_) {
+			if (ptr != b.storage) continue;
+			b.busy.store(false, std::memory_order_release);
+			return;
+		}
+		::operator delete(ptr);
+	}
+};
+
+//	The state of an awaited operation which its
+//	completion handler refers to (this is independent
+//	of how the operation is initiated so that handlers
+//	are only instantiated once per signature)
+template <typename... Args>
+class awaitable_state {
+private:
+	frame_memory memory_;
+	std::coroutine_handle<> handle_;
+	//	Whichever of the initiating coroutine and the
+	//	completion handler sets this second resumes the
+	//	coroutine
+	std::atomic<bool> done_;
+	boost::system::error_code ec_;
+	boost::optional<std::tuple<Args...>> args_;
+protected:
+	template <typename... Ts>
+	void set (boost::system::error_code ec, Ts &&... args) {
+		ec_ = ec;
+		if (!ec) args_.emplace(std::forward<Ts>(args)...);
+	}
+	template <typename Initiate, typename Handler>
+	std::coroutine_handle<> suspend (std::coroutine_handle<> h, Initiate & initiate, Handler handler) {
+		handle_ = h;
+		initiate(std::move(handler));
+		//	If the operation completed before initiation
+		//	returned (e.g. on another thread) the coroutine
+		//	is resumed by symmetric transfer rather than
+		//	by the completion handler
+		if (done_.exchange(true, std::memory_order_acq_rel)) return h;
+		return std::noop_coroutine();
+	}
+public:
+	awaitable_state () noexcept
+		:	done_(false)
+	{	}
+	awaitable_state (const awaitable_state &) = delete;
+	awaitable_state (awaitable_state &&) = delete;
+	awaitable_state & operator = (const awaitable_state &) = delete;
+	awaitable_state & operator = (awaitable_state &&) = delete;
+	frame_memory & memory () noexcept {
+		return memory_;
+	}
+	template <typename... Ts>
+	void complete (boost::system::error_code ec, Ts &&... args) {
+		set(ec, std::forward<Ts>(args)...);
+		if (done_.exchange(true, std::memory_order_acq_rel)) handle_.resume();
+	}
+	auto await_resume () {
+		if (ec_) throw boost::system::system_error(ec_);
+		if constexpr (sizeof...(Args) == 1) {
+			return std::move(std::get<0>(*args_));
+		} else if constexpr (sizeof...(Args) != 0) {
+			return std::move(*args_);
+		}
+	}
+};
+
+template <typename... Args>
+class awaitable_handler {
+private:
+	awaitable_state<Args...> * state_;
+public:
+	explicit awaitable_handler (awaitable_state<Args...> & state) noexcept
+		:	state_(&state)
+	{	}
+	template <typename... Ts>
+	void operator () (boost::system::error_code ec, Ts &&... args) {
+		state_->complete(ec, std::forward<Ts>(args)...);
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	using allocator_type = memory_allocator<void, frame_memory>;
+	allocator_type get_allocator () const noexcept {
+		return allocator_type(state_->memory());
+	}
+	#endif
+	friend void * asio_handler_allocate (std::size_t size, awaitable_handler * self) {
+		return self->state_->memory().allocate(size);
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t size, awaitable_handler * self) {
+		self->state_->memory().deallocate(ptr, size);
+	}
+};
+
+//	Args are the parameters the operation's completion
+//	handler receives after the boost::system::error_code
+template <typename Initiate, typename... Args>
+class awaitable : public awaitable_state<Args...> {
+private:
+	using base = awaitable_state<Args...>;
+	Initiate initiate_;
+public:
+	explicit awaitable (Initiate initiate)
+		:	initiate_(std::move(initiate))
+	{	}
+	bool await_ready () const noexcept {
+		return false;
+	}
+	std::coroutine_handle<> await_suspend (std::coroutine_handle<> h) {
+		return base::suspend(h, initiate_, awaitable_handler<Args...>(*this));
+	}
+};
+
+template <typename... Args, typename Initiate>
+awaitable<Initiate, Args...> make_awaitable (Initiate initiate) {
+	return awaitable<Initiate, Args...>(std::move(initiate));
+}
+
+//	Results which libpq has already received are
+//	retrieved without suspending the coroutine (and
+//	therefore without a round trip through the
+//	boost::asio::io_service)
+template <typename Initiate>
+class get_result_awaitable : public awaitable<Initiate, result> {
+private:
+	using base = awaitable<Initiate, result>;
+	connection & conn_;
+public:
+	get_result_awaitable (connection & conn, Initiate initiate)
+		:	base(std::move(initiate)),
+			conn_(conn)
+	{	}
+	bool await_ready () {
+		int flush;
+		boost::system::error_code ec;
+		result r;
+		if (!detail::get_result_immediate(conn_, flush, ec, r)) return false;
+		base::set(ec, std::move(r));
+		return true;
+	}
+};
+
+template <typename Initiate>
+get_result_awaitable<Initiate> make_get_result_awaitable (connection & conn, Initiate initiate) {
+	return get_result_awaitable<Initiate>(conn, std::move(initiate));
+}
+
+}
+
+/**
+ *	Awaitable form of \ref async_connect.
+ *
+ *	\param [in] conn
+ *		See \ref async_connect.
+ *
+ *	\return
+ *		An object which, when awaited, connects to
+ *		the server.
+ */
+inline auto async_connect (connection & conn, use_awaitable_t) {
+	return detail::make_awaitable<>([&conn] (auto h) {	async_connect(conn, std::move(h));	});
+}
+/**
+ *	Awaitable form of \ref async_connect with a deadline.
+ *
+ *	\param [in] conn
+ *		See \ref async_connect.
+ *	\param [in] deadline
+ *		See \ref async_connect.
+ *
+ *	\return
+ *		An object which, when awaited, connects to
+ *		the server.
+ */
+inline auto async_connect (
+	connection & conn,
+	std::chrono::steady_clock::time_point deadline,
+	use_awaitable_t
+) {
+	return detail::make_awaitable<>([&conn, deadline] (auto h) {	async_connect(conn, deadline, std::move(h));	});
+}
+/**
+ *	Awaitable form of \ref async_connect with a timeout.
+ *
+ *	The timeout begins when the returned object is
+ *	awaited.
+ *
+ *	\param [in] conn
+ *		See \ref async_connect.
+ *	\param [in] timeout
+ *		See \ref async_connect.
+ *
+ *	\return
+ *		An object which, when awaited, connects to
+ *		the server.
+ */
+inline auto async_connect (
+	connection & conn,
+	std::chrono::steady_clock::duration timeout,
+	use_awaitable_t
+) {
+	return detail::make_awaitable<>([&conn, timeout] (auto h) {	async_connect(conn, timeout, std::move(h));	});
+}
+
+/**
+ *	Awaitable form of \ref async_get_result.
+ *
+ *	If libpq has already received the next result it
+ *	is obtained without suspending.
+ *
+ *	\param [in] conn
+ *		See \ref async_get_result.
+ *
+ *	\return
+ *		An object which, when awaited, yields the
+ *		next \ref result.
+ */
+inline auto async_get_result (connection & conn, use_awaitable_t) {
+	return detail::make_get_result_awaitable(
+		conn,
+		[&conn] (auto h) {	async_get_result(conn, std::move(h));	}
+	);
+}
+/**
+ *	Awaitable form of \ref async_get_result with a
+ *	deadline.
+ *
+ *	If libpq has already received the next result it
+ *	is obtained without suspending.
+ *
+ *	\param [in] conn
+ *		See \ref async_get_result.
+ *	\param [in] deadline
+ *		See \ref async_get_result.
+ *
+ *	\return
+ *		An object which, when awaited, yields the
+ *		next \ref result.
+ */
+inline auto async_get_result (
+	connection & conn,
+	std::chrono::steady_clock::time_point deadline,
+	use_awaitable_t
+) {
+	return detail::make_get_result_awaitable(
+		conn,
+		[&conn, deadline] (auto h) {	async_get_result(conn, deadline, std::move(h));	}
+	);
+}
+/**
+ *	Awaitable form of \ref async_get_result with a
+ *	timeout.
+ *
+ *	If libpq has already received the next result it
+ *	is obtained without suspending, otherwise the
+ *	timeout begins when the returned object is awaited.
+ *
+ *	\param [in] conn
+ *		See \ref async_get_result.
+ *	\param [in] timeout
+ *		See \ref async_get_result.
+ *
+ *	\return
+ *		An object which, when awaited, yields the
+ *		next \ref result.
+ */
+inline auto async_get_result (
+	connection & conn,
+	std::chrono::steady_clock::duration timeout,
+	use_awaitable_t
+) {
+	return detail::make_get_result_awaitable(
+		conn,
+		[&conn, timeout] (auto h) {	async_get_result(conn, timeout, std::move(h));	}
+	);
+}
+
+/**
+ *	Awaitable form of \ref async_exec.
+ *
+ *	The command is sent when the returned object is
+ *	awaited.
+ *
+ *	\param [in] conn
+ *		See \ref async_exec.
+ *	\param [in] command
+ *		See \ref async_exec.
+ *
+ *	\return
+ *		An object which, when awaited, yields a
+ *		`std::vector` of \ref result objects.
+ */
+inline auto async_exec (connection & conn, const char * command, use_awaitable_t) {
+	return detail::make_awaitable<std::vector<result>>(
+		[&conn, command] (auto h) {	async_exec(conn, command, std::move(h));	}
+	);
+}
+
+/**
+ *	Awaitable form of \ref async_exec_params.
+ *
+ *	The command is sent when the returned object is
+ *	awaited.
+ *
+ *	\return
+ *		An object which, when awaited, yields a
+ *		`std::vector` of \ref result objects.
+ */
+inline auto async_exec_params (
+	connection & conn,
+	const char * command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format,
+	use_awaitable_t
+) {
+	return detail::make_awaitable<std::vector<result>>(
+		[=, &conn] (auto h) {
+			async_exec_params(
+				conn,
+				command,
+				n_params,
+				param_types,
+				param_values,
+				param_lengths,
+				param_formats,
+				result_format,
+				std::move(h)
+			);
+		}
+	);
+}
+/**
+ *	Awaitable form of \ref async_exec_params which
+ *	accepts \ref params.
+ *
+ *	The command is sent when the returned object is
+ *	awaited.
+ *
+ *	\return
+ *		An object which, when awaited, yields a
+ *		`std::vector` of \ref result objects.
+ */
+template <typename... Args>
+auto async_exec_params (
+	connection & conn,
+	const char * command,
+	const params<Args...> & p,
+	int result_format,
+	use_awaitable_t
+) {
+	return detail::make_awaitable<std::vector<result>>(
+		[&conn, command, &p, result_format] (auto h) {
+			async_exec_params(conn, command, p, result_format, std::move(h));
+		}
+	);
+}
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+/**
+ *	Awaitable form of \ref async_exec_cached.
+ *
+ *	The command is sent when the returned object is
+ *	awaited.
+ *
+ *	\return
+ *		An object which, when awaited, yields the
+ *		\ref result of the command.
+ */
+inline auto async_exec_cached (
+	connection & conn,
+	statement_cache & cache,
+	std::string command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format,
+	use_awaitable_t
+) {
+	return detail::make_awaitable<result>(
+		[=, &conn, &cache, command = std::move(command)] (auto h) mutable {
+			async_exec_cached(
+				conn,
+				cache,
+				std::move(command),
+				n_params,
+				param_types,
+				param_values,
+				param_lengths,
+				param_formats,
+				result_format,
+				std::move(h)
+			);
+		}
+	);
+}
+
+#endif
+
+/**
+ *	Awaitable form of \ref async_get_rows.
+ *
+ *	\param [in] conn
+ *		See \ref async_get_rows.
+ *	\param [in] max_rows
+ *		See \ref async_get_rows.
+ *
+ *	\return
+ *		An object which, when awaited, yields a
+ *		`std::vector` of \ref result objects.
+ */
+inline auto async_get_rows (connection & conn, std::size_t max_rows, use_awaitable_t) {
+	return detail::make_awaitable<std::vector<result>>(
+		[&conn, max_rows] (auto h) {	async_get_rows(conn, max_rows, std::move(h));	}
+	);
+}
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+/**
+ *	Awaitable form of \ref async_pipeline.
+ *
+ *	The commands are sent when the returned object
+ *	is awaited.
+ *
+ *	\param [in] conn
+ *		See \ref async_pipeline.
+ *	\param [in] p
+ *		See \ref async_pipeline.
+ *
+ *	\return
+ *		An object which, when awaited, yields a
+ *		`std::vector` of \ref result objects.
+ */
+inline auto async_pipeline (connection & conn, const pipeline & p, use_awaitable_t) {
+	return detail::make_awaitable<std::vector<result>>(
+		[&conn, &p] (auto h) {	async_pipeline(conn, p, std::move(h));	}
+	);
+}
+
+#endif
+
+/**
+ *	Awaitable form of \ref async_wait_notification.
+ *
+ *	\param [in] conn
+ *		See \ref async_wait_notification.
+ *
+ *	\return
+ *		An object which, when awaited, yields a
+ *		`std::vector` of \ref notification objects.
+ */
+inline auto async_wait_notification (connection & conn, use_awaitable_t) {
+	return detail::make_awaitable<std::vector<notification>>(
+		[&conn] (auto h) {	async_wait_notification(conn, std::move(h));	}
+	);
+}
+
+/**
+ *	Awaitable form of \ref async_cancel_query.
+ *
+ *	\param [in] conn
+ *		See \ref async_cancel_query.
+ *
+ *	\return
+ *		An object which, when awaited, cancels the
+ *		command in progress.
+ */
+inline auto async_cancel_query (connection & conn, use_awaitable_t) {
+	return detail::make_awaitable<>([&conn] (auto h) {	async_cancel_query(conn, std::move(h));	});
+}
+
+}
+
+#endif
@@ -0,0 +1,466 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "copy_binary.hpp"
+#include "copy_in.hpp"
+#include "detail/completion.hpp"
+#include "error.hpp"
+#include "exec.hpp"
+#include "pool.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+/**
+ *	The amount of data a bulk load (see \ref async_bulk_load)
+ *	has sent thus far.
+ */
+class bulk_load_progress {
+public:
+	/**
+	 *	The number of rows.
+	 */
+	std::uint64_t rows = 0;
+	/**
+	 *	The number of bytes (in the binary `COPY` format).
+	 */
+	std::uint64_t bytes = 0;
+	/**
+	 *	The number of chunks.
+	 */
+	std::uint64_t chunks = 0;
+};
+
+/**
+ *	Specifies how a bulk load (see \ref async_bulk_load)
+ *	is performed.
+ */
+class bulk_load_settings {
+public:
+	/**
+	 *	The `COPY ... FROM STDIN (FORMAT binary)` command
+	 *	which each stream shall execute.
+	 */
+	std::string command;
+	/**
+	 *	The number of streams (and therefore connections)
+	 *	which shall be used concurrently. Must not be zero.
+	 */
+	std::size_t streams = 4;
+	/**
+	 *	A command which shall be executed once all streams
+	 *	have succeeded (e.g. to merge a staging table into
+	 *	its destination via `INSERT ... ON CONFLICT`). If
+	 *	this is empty no such command is executed.
+	 */
+	std::string merge;
+	/**
+	 *	A function object which shall be invoked each time
+	 *	a chunk has been sent. May be empty.
+	 */
+	std::function<void (const bulk_load_progress &)> progress;
+};
+
+/**
+ *	A source for \ref async_bulk_load which divides
+ *	the values in a range into chunks of a fixed number
+ *	of rows.
+ *
+ *	\tparam Iterator
+ *		The type of iterator. Since the range is only
+ *		traversed once an input iterator suffices.
+ *	\tparam Encoder
+ *		The type of a function object which accepts a
+ *		\ref copy_binary_writer and a value from the range
+ *		and appends one row.
+ */
+template <typename Iterator, typename Encoder>
+class range_source {
+private:
+	Iterator begin_;
+	Iterator end_;
+	std::size_t rows_;
+	Encoder encoder_;
+public:
+	/**
+	 *	Creates a range_source.
+	 *
+	 *	\param [in] begin
+	 *		An iterator to the first value.
+	 *	\param [in] end
+	 *		An iterator one past the last value.
+	 *	\param [in] rows
+	 *		The number of rows in each chunk.
+	 *	\param [in] encoder
+	 *		The encoder.
+	 */
+	range_source (Iterator begin, Iterator end, std::size_t rows, Encoder encoder)
+		:	begin_(std::move(begin)),
+			end_(std::move(end)),
+			rows_(rows),
+			encoder_(std::move(encoder))
+	{
+		assert(rows_ != 0);
+	}
+	/**
+	 *	Appends the next chunk of rows.
+	 *
+	 *	\param [in] writer
+	 *		The \ref copy_binary_writer.
+	 *
+	 *	\return
+	 *		The number of rows appended which is zero
+	 *		if the range is exhausted.
+	 */
+	std::size_t operator () (copy_binary_writer & writer) {
+		std::size_t retr = 0;
+		for (; (begin_ != end_) && (retr != rows_); ++begin_, ++retr) encoder_(writer, *begin_);
+		return retr;
+	}
+};
+
+namespace detail {
+
+class row_encoder {
+public:
+	template <typename T>
+	void operator () (copy_binary_writer & writer, const T & value) const {
+		writer.row(value);
+	}
+};
+
+}
+
+/**
+ *	Creates a \ref range_source which encodes each
+ *	value by passing it to \ref copy_binary_writer::row
+ *	(so values which are `std::tuple` objects become
+ *	rows of one column per element and all other values
+ *	become rows of one column).
+ *
+ *	\param [in] begin
+ *		An iterator to the first value.
+ *	\param [in] end
+ *		An iterator one past the last value.
+ *	\param [in] rows
+ *		The number of rows in each chunk.
+ *
+ *	\return
+ *		A \ref range_source.
+ */
+template <typename Iterator>
+range_source<Iterator, detail::row_encoder> make_range_source (Iterator begin, Iterator end, std::size_t rows) {
+	return range_source<Iterator, detail::row_encoder>(std::move(begin), std::move(end), rows, detail::row_encoder{});
+}
+
+/**
+ *	Creates a \ref range_source with a custom encoder.
+ *
+ *	\param [in] begin
+ *		An iterator to the first value.
+ *	\param [in] end
+ *		An iterator one past the last value.
+ *	\param [in] rows
+ *		The number of rows in each chunk.
+ *	\param [in] encoder
+ *		A function object which accepts a \ref copy_binary_writer
+ *		and a value from the range and appends one row.
+ *
+ *	\return
+ *		A \ref range_source.
+ */
+template <typename Iterator, typename Encoder>
+range_source<Iterator, Encoder> make_range_source (Iterator begin, Iterator end, std::size_t rows, Encoder encoder) {
+	return range_source<Iterator, Encoder>(std::move(begin), std::move(end), rows, std::move(encoder));
+}
+
+namespace detail {
+
+using async_bulk_load_signature = void (boost::system::error_code, bulk_load_progress, result);
+
+template <typename Source, typename Handler>
+class bulk_load_state : public std::enable_shared_from_this<bulk_load_state<Source, Handler>> {
+public:
+	bulk_load_state (asio_pq::pool & p, bulk_load_settings settings, Source source, Handler h)
+		:	pool(p),
+			settings(std::move(settings)),
+			source(std::move(source)),
+			handler(std::move(h)),
+			running(0),
+			exhausted(false)
+	{	}
+	asio_pq::pool & pool;
+	bulk_load_settings settings;
+	Source source;
+	Handler handler;
+	bulk_load_progress progress;
+	boost::system::error_code error_code;
+	asio_pq::result result;
+	std::size_t running;
+	bool exhausted;
+	lease merge;
+	void begin ();
+	void fail (boost::system::error_code ec, asio_pq::result r = asio_pq::result{}) {
+		if (error_code) return;
+		error_code = ec;
+		result = std::move(r);
+	}
+	void finished () {
+		assert(running != 0);
+		if (--running != 0) return;
+		if (error_code || settings.merge.empty()) {
+			complete();
+			return;
+		}
+		auto self = this->shared_from_this();
+		pool.async_acquire([self] (auto ec, auto l) {
+			if (ec) {
+				self->fail(ec);
+				self->complete();
+				return;
+			}
+			self->merge = std::move(l);
+			async_exec(*self->merge, self->settings.merge.c_str(), [self] (auto ec, auto rs) {
+				if (ec) self->fail(ec);
+				for (auto && r : rs) if (!command_succeeded(r)) {
+					self->fail(make_error_code(error::command_failed), std::move(r));
+					break;
+				}
+				if (!self->error_code && !rs.empty()) self->result = std::move(rs.back());
+				self->complete();
+			});
+		});
+	}
+	void complete () {
+		merge.reset();
+		post_completion(pool.get_io_service(), std::move(handler), error_code, progress, std::move(result));
+	}
+};
+
+//	Each worker holds one connection and streams one
+//	COPY, taking chunks from the shared source until
+//	it is exhausted. Only one chunk is in flight per
+//	connection and writes do not complete until the
+//	chunk has been sent, so a slow stream simply takes
+//	fewer chunks
+template <typename State>
+class bulk_load_worker : public std::enable_shared_from_this<bulk_load_worker<State>> {
+private:
+	std::shared_ptr<State> state_;
+	lease lease_;
+	boost::optional<copy_in_stream> stream_;
+	std::string buffer_;
+	std::size_t rows_;
+	bool header_;
+	bool last_;
+	void done () {
+		stream_ = boost::none;
+		lease_.reset();
+		state_->finished();
+	}
+	void fail (boost::system::error_code ec, result r = result{}) {
+		state_->fail(ec, std::move(r));
+		done();
+	}
+	void acquired (boost::system::error_code ec, lease l) {
+		if (ec) {
+			fail(ec);
+			return;
+		}
+		lease_ = std::move(l);
+		if (state_->error_code || state_->exhausted) {
+			done();
+			return;
+		}
+		auto self = this->shared_from_this();
+		async_copy_in(*lease_, state_->settings.command.c_str(), [self] (auto ec, auto r) {
+			if (ec) {
+				self->fail(ec, std::move(r));
+				return;
+			}
+			self->stream_.emplace(*self->lease_);
+			self->next();
+		});
+	}
+	void next () {
+		auto self = this->shared_from_this();
+		if (state_->error_code) {
+			//	Another stream failed, so whatever this
+			//	stream has sent is discarded
+			stream_->async_abort("Bulk load failed", [self] (auto, auto) {	self->done();	});
+			return;
+		}
+		buffer_.clear();
+		copy_binary_writer writer(buffer_);
+		if (!header_) {
+			writer.header();
+			header_ = true;
+		}
+		rows_ = state_->exhausted ? 0 : state_->source(writer);
+		if (rows_ == 0) {
+			state_->exhausted = true;
+			writer.trailer();
+			last_ = true;
+		}
+		stream_->async_write_some(boost::asio::buffer(buffer_), [self] (auto ec, auto bytes) {
+			self->written(ec, bytes);
+		});
+	}
+	void written (boost::system::error_code ec, std::size_t bytes) {
+		if (ec) {
+			fail(ec);
+			return;
+		}
+		auto && progress = state_->progress;
+		progress.rows += rows_;
+		progress.bytes += bytes;
+		++progress.chunks;
+		if (state_->settings.progress) state_->settings.progress(progress);
+		if (!last_) {
+			next();
+			return;
+		}
+		auto self = this->shared_from_this();
+		stream_->async_end([self] (auto ec, auto r) {
+			if (ec) {
+				self->fail(ec, std::move(r));
+				return;
+			}
+			if (PQresultStatus(r) != PGRES_COMMAND_OK) {
+				self->fail(make_error_code(error::copy_failed), std::move(r));
+				return;
+			}
+			self->done();
+		});
+	}
+public:
+	explicit bulk_load_worker (std::shared_ptr<State> state) noexcept
+		:	state_(std::move(state)),
+			rows_(0),
+			header_(false),
+			last_(false)
+	{	}
+	void begin () {
+		auto self = this->shared_from_this();
+		state_->pool.async_acquire([self] (auto ec, auto l) {
+			self->acquired(ec, std::move(l));
+		});
+	}
+};
+
+template <typename Source, typename Handler>
+void bulk_load_state<Source, Handler>::begin () {
+	if (settings.streams == 0) {
+		fail(make_error_code(boost::asio::error::invalid_argument));
+		complete();
+		return;
+	}
+	running = settings.streams;
+	auto self = this->shared_from_this();
+	for (std::size_t i = 0; i < settings.streams; ++i) {
+		std::make_shared<bulk_load_worker<bulk_load_state>>(self)->begin();
+	}
+}
+
+}
+
+/**
+ *	Loads rows into the server via several concurrent
+ *	`COPY` commands, each on its own \ref connection
+ *	acquired from a \ref pool.
+ *
+ *	Rows are taken from \em source in chunks as each
+ *	stream becomes ready for more, encoded in the
+ *	binary `COPY` format, and sent. Each stream has at
+ *	most one chunk outstanding and does not take another
+ *	until that chunk has been sent (see \ref copy_in_stream)
+ *	so memory use is bounded by the number of streams and the
+ *	size of a chunk, and faster streams carry more of the load.
+ *
+ *	Each stream commits independently. If any stream fails
+ *	the streams which have not yet finished are aborted but
+ *	those which have finished are not rolled back, so rows
+ *	should be loaded into a staging table and moved into
+ *	place by \ref bulk_load_settings::merge (which is only
+ *	executed if all streams succeeded).
+ *
+ *	All operations are performed via the \ref pool and the
+ *	same single threaded restrictions apply.
+ *
+ *	\tparam Source
+ *		The type of a function object which accepts a
+ *		\ref copy_binary_writer, appends zero or more rows,
+ *		and returns the number of rows appended (zero
+ *		indicating there are no more). See \ref range_source.
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] p
+ *		The \ref pool. The reference to this object must
+ *		remain valid for the lifetime of the asynchronous
+ *		operation or the behavior is undefined.
+ *	\param [in] settings
+ *		A \ref bulk_load_settings object.
+ *	\param [in] source
+ *		The source of rows.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Three parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation (\ref error::copy_failed
+ *		if a `COPY` failed on the server, \ref error::command_failed
+ *		if the merge failed, or `boost::asio::error::invalid_argument`
+ *		if \ref bulk_load_settings::streams is zero), a
+ *		\ref bulk_load_progress representing the data which was
+ *		sent, and a \ref result which is the result which indicated
+ *		failure (if any) or the final result of the merge (if any).
+ *		The completion handler is invoked through its hooks and
+ *		associated executor, never from within this function.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename Source, typename CompletionToken>
+auto async_bulk_load (
+	pool & p,
+	bulk_load_settings settings,
+	Source source,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_bulk_load_signature> init(token);
+	using state_type = detail::bulk_load_state<
+		Source,
+		beast::handler_type<CompletionToken, detail::async_bulk_load_signature>
+	>;
+	auto state = std::make_shared<state_type>(
+		p,
+		std::move(settings),
+		std::move(source),
+		std::move(init.completion_handler)
+	);
+	state->begin();
+	return init.result.get();
+}
+
+}
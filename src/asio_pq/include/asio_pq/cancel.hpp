@@ -24,7 +24,9 @@ namespace asio_pq {
  *	be running). For more information on how
  *	to resolve this see the documentation of
  *	`boost::asio::io_service::strand` and
- *	`boost::asio::asio_handler_invoke`.
+ *	`boost::asio::asio_handler_invoke`. To submit
+ *	commands from several threads without a strand
+ *	see \ref submission_queue.
  *
  *	Note that due to inherent race conditions
  *	it is possible this function will complete
@@ -37,7 +39,9 @@ namespace asio_pq {
  *	If a cancellation actually occurs the
  *	underlying connection to the PostgreSQL server
  *	will be in an inconsistent state and should
- *	not be used further.
+ *	not be used further. To cancel a command
+ *	without abandoning the \ref connection see
+ *	\ref async_cancel_query.
  *
  *	In the case that cancellation actually occurs
  *	completion handlers will be invoked with
@@ -80,7 +84,9 @@ void cancel (connection & conn, boost::system::error_code & ec) noexcept;
  *	If a cancellation actually occurs the
  *	underlying connection to the PostgreSQL server
  *	will be in an inconsistent state and should
- *	not be used further.
+ *	not be used further. To cancel a command
+ *	without abandoning the \ref connection see
+ *	\ref async_cancel_query.
  *
  *	In the case that cancellation actually occurs
  *	completion handlers will be invoked with
@@ -0,0 +1,300 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/copy.hpp"
+#include "detail/executor.hpp"
+#include "detail/op.hpp"
+#include "detail/send_cancel.hpp"
+#include "detail/socket.hpp"
+#include "detail/wrapper.hpp"
+#include "error.hpp"
+#include "get_result.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace asio_pq {
+
+namespace detail {
+
+using async_cancel_query_signature = void (boost::system::error_code);
+
+template <typename Handler>
+class async_cancel_query_sent_wrapper : public wrapper<Handler> {
+private:
+	using base = wrapper<Handler>;
+public:
+	using base::base;
+	void operator () (bool sent) {
+		base::handler().sent(sent);
+	}
+};
+
+//	Sends a CancelRequest for the command in progress
+//	on a connection and then retrieves (and discards)
+//	results until there are no more
+template <typename Handler>
+class async_cancel_query_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, asio_pq::connection & conn)
+			:	connection(conn),
+				waited(false)
+		{	}
+		asio_pq::connection & connection;
+		bool waited;
+		boost::system::error_code error_code;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void complete (boost::system::error_code ec) {
+		//	Avoid invoking the handler from within
+		//	the initiating function
+		if (!ptr_->waited) {
+			ptr_->error_code = ec;
+			boost::asio::io_service & ios = ptr_->connection.get_io_service();
+			ios.post(std::move(*this));
+			return;
+		}
+		ptr_.invoke(ec);
+	}
+	void drain () {
+		ptr_->waited = true;
+		connection & conn = ptr_->connection;
+		async_get_result(conn, std::move(*this));
+	}
+	//	Reads and discards COPY data until the server
+	//	ends the COPY
+	void discard () {
+		state & s = *ptr_;
+		for (;;) {
+			char * buffer = nullptr;
+			switch (PQgetCopyData(s.connection, &buffer, 1)) {
+			case 0:
+				break;
+			case -1:
+				drain();
+				return;
+			case -2:
+				complete(make_error_code(error::copy_failed));
+				return;
+			default:
+				PQfreemem(buffer);
+				continue;
+			}
+			break;
+		}
+		if (!s.connection.has_socket()) {
+			complete(make_error_code(boost::asio::error::operation_aborted));
+			return;
+		}
+		s.connection.socket([&] (auto & socket) {
+			detail::async_readable(
+				socket,
+				detail::make_read_wrapper(std::move(*this))
+			);
+		});
+	}
+public:
+	async_cancel_query_op () = delete;
+	async_cancel_query_op (const async_cancel_query_op &) = default;
+	async_cancel_query_op (async_cancel_query_op &&) = default;
+	async_cancel_query_op & operator = (const async_cancel_query_op &) = default;
+	async_cancel_query_op & operator = (async_cancel_query_op &&) = default;
+	template <typename DeducedHandler>
+	async_cancel_query_op (connection & conn, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn)
+	{	}
+	void begin () {
+		state & s = *ptr_;
+		s.waited = true;
+		connection & conn = s.connection;
+		async_send_cancel(conn, async_cancel_query_sent_wrapper<async_cancel_query_op>(std::move(*this)));
+	}
+	void sent (bool sent) {
+		if (!sent) {
+			complete(make_error_code(error::cancel_failed));
+			return;
+		}
+		drain();
+	}
+	void read (boost::system::error_code ec) {
+		if (ec) {
+			complete(ec);
+			return;
+		}
+		state & s = *ptr_;
+		if (PQconsumeInput(s.connection) == 0) {
+			complete(make_error_code(error::consume_failed));
+			return;
+		}
+		discard();
+	}
+	void operator () () {
+		auto ec = ptr_->error_code;
+		ptr_.invoke(ec);
+	}
+	void operator () (boost::system::error_code ec, result r) {
+		if (ec || !r) {
+			complete(ec);
+			return;
+		}
+		switch (PQresultStatus(r)) {
+		case PGRES_COPY_IN:{
+			//	async_copy_end_op retrieves the remaining
+			//	results and completes with the last
+			connection & conn = ptr_->connection;
+			async_copy_end_op<async_cancel_query_op> op(
+				conn,
+				true,
+				std::string("canceled"),
+				std::move(*this)
+			);
+			op.begin();
+			return;
+		}
+		case PGRES_COPY_OUT:
+			discard();
+			return;
+		default:
+			break;
+		}
+		drain();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_cancel_query_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_cancel_query_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_cancel_query_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_cancel_query_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+/**
+ *	Asynchronously asks the server to cancel the command
+ *	in progress on a \ref connection and then retrieves
+ *	and discards the remaining results (ending any `COPY`
+ *	in progress) so that the \ref connection may be used
+ *	for further commands.
+ *
+ *	Unlike \ref cancel this does not abandon the
+ *	\ref connection. The CancelRequest is sent via
+ *	`PQcancelPoll` when libpq provides it and otherwise
+ *	via `PQcancel` on a separate thread so the thread
+ *	running the `boost::asio::io_service` is never
+ *	blocked.
+ *
+ *	Note that whether or not the server actually cancels
+ *	the command (it may already have completed) the
+ *	operation completes once all of its results have
+ *	been retrieved.
+ *
+ *	The \ref connection must not be in pipeline mode
+ *	and no other operation may be pending on it.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection which has a command in progress.
+ *		The reference to this object must remain valid for
+ *		the lifetime of the asynchronous operation or the
+ *		behavior is undefined.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. One parameter is provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_cancel_query (
+	connection & conn,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_cancel_query_signature> init(token);
+	detail::async_cancel_query_op<
+		beast::handler_type<CompletionToken, detail::async_cancel_query_signature>
+	> op(conn, std::move(init.completion_handler));
+	op.begin();
+	return init.result.get();
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_cancel_query_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_cancel_query_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_cancel_query_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_cancel_query_op<Handler>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_cancel_query_sent_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_cancel_query_sent_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_cancel_query_sent_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_cancel_query_sent_wrapper<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
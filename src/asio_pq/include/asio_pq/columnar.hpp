@@ -0,0 +1,215 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <boost/align/aligned_allocator.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace asio_pq {
+
+/**
+ *	A `std::vector` whose storage is aligned to a
+ *	64 byte boundary as recommended by the Apache
+ *	Arrow columnar format.
+ *
+ *	\tparam T
+ *		The element type.
+ */
+template <typename T>
+using aligned_vector = std::vector<T, boost::alignment::aligned_allocator<T, 64>>;
+
+/**
+ *	The Apache Arrow logical types which a \ref column
+ *	may have.
+ */
+enum class column_type {
+	/**
+	 *	Bit packed values (from `bool`).
+	 */
+	boolean,
+	/**
+	 *	Values of type `std::int16_t` (from `int2`).
+	 */
+	int16,
+	/**
+	 *	Values of type `std::int32_t` (from `int4`).
+	 */
+	int32,
+	/**
+	 *	Values of type `std::int64_t` (from `int8`).
+	 */
+	int64,
+	/**
+	 *	Values of type `float` (from `float4`).
+	 */
+	float32,
+	/**
+	 *	Values of type `double` (from `float8`).
+	 */
+	float64,
+	/**
+	 *	Values of type `std::int64_t` representing
+	 *	microseconds since the Unix epoch UTC (from
+	 *	`timestamp` and `timestamptz`). Infinite values
+	 *	are represented by the extreme values of `std::int64_t`.
+	 */
+	timestamp,
+	/**
+	 *	Variable length bytes (from `bytea` and all types
+	 *	not otherwise listed in binary format).
+	 */
+	binary,
+	/**
+	 *	Variable length UTF-8 (from `text`, `varchar`,
+	 *	`bpchar`, `json`, and `jsonb` in binary format and
+	 *	from all types in text format).
+	 */
+	utf8
+};
+
+/**
+ *	A single column in the Apache Arrow columnar
+ *	memory layout.
+ *
+ *	All buffers are in native byte order.
+ */
+class column {
+public:
+	/**
+	 *	The name of the column.
+	 */
+	std::string name;
+	/**
+	 *	The OID of the PostgreSQL type of the column.
+	 */
+	Oid oid;
+	/**
+	 *	The format of the column (zero for text and
+	 *	one for binary).
+	 */
+	int format;
+	/**
+	 *	The Arrow type of the column.
+	 */
+	column_type type;
+	/**
+	 *	The number of values.
+	 */
+	std::int64_t length;
+	/**
+	 *	The number of null values.
+	 */
+	std::int64_t null_count;
+	/**
+	 *	The validity bitmap, wherein the least significant
+	 *	bit of the first byte represents the first value
+	 *	and a set bit represents a non-null value.
+	 */
+	aligned_vector<std::uint8_t> validity;
+	/**
+	 *	For fixed size types the values (with null values
+	 *	zeroed). For \ref column_type::boolean the bit packed
+	 *	values in the same order as \ref validity. For variable
+	 *	length types the concatenated bytes of all values.
+	 */
+	aligned_vector<std::uint8_t> values;
+	/**
+	 *	For variable length types \ref length plus one
+	 *	offsets into \ref values such that the bytes of
+	 *	the value at index `i` are in the range `[offsets[i], offsets[i + 1])`.
+	 *	Empty for fixed size types.
+	 */
+	aligned_vector<std::int32_t> offsets;
+};
+
+/**
+ *	Converts the rows of one or more \ref result objects
+ *	into columns in the Apache Arrow columnar memory layout.
+ *
+ *	The columns are determined by the first \ref result
+ *	appended, all subsequent results must have the same
+ *	number of columns with the same types and formats.
+ *	This makes it possible to accumulate the results of
+ *	\ref async_get_rows as they arrive.
+ *
+ *	Since Arrow's binary and UTF-8 types use 32 bit
+ *	offsets a variable length column may not exceed
+ *	2 GiB.
+ */
+class columnar_builder {
+private:
+	std::vector<column> columns_;
+	std::int64_t rows_;
+	bool initialized_;
+public:
+	columnar_builder (const columnar_builder &) = delete;
+	columnar_builder (columnar_builder &&) = default;
+	columnar_builder & operator = (const columnar_builder &) = delete;
+	columnar_builder & operator = (columnar_builder &&) = default;
+	/**
+	 *	Creates an empty builder.
+	 */
+	columnar_builder () noexcept;
+	/**
+	 *	Appends all rows of a result.
+	 *
+	 *	If the operation fails the builder is left
+	 *	unchanged.
+	 *
+	 *	\param [in] r
+	 *		The result.
+	 *	\param [out] ec
+	 *		A `boost::system::error_code` object which
+	 *		shall be set to the result of the operation.
+	 *		Note that if this object already represents
+	 *		an error it will be cleared. If \em r does not
+	 *		have the same columns as previously appended
+	 *		results this shall be set to \ref error::type_mismatch.
+	 *		If a value in binary format is malformed or a
+	 *		variable length column would exceed 2 GiB this
+	 *		shall be set to \ref error::decode_failed.
+	 */
+	void append (const PGresult * r, boost::system::error_code & ec);
+	/**
+	 *	Appends all rows of a result.
+	 *
+	 *	If the operation fails the builder is left
+	 *	unchanged.
+	 *
+	 *	\param [in] r
+	 *		The result.
+	 */
+	void append (const PGresult * r);
+	/**
+	 *	Retrieves the number of rows appended.
+	 *
+	 *	\return
+	 *		The number of rows.
+	 */
+	std::int64_t size () const noexcept;
+	/**
+	 *	Retrieves the columns built thus far.
+	 *
+	 *	\return
+	 *		A reference to a `std::vector` of \ref column
+	 *		objects.
+	 */
+	const std::vector<column> & columns () const noexcept;
+	/**
+	 *	Retrieves the columns built thus far and resets
+	 *	the builder so that it may be reused (possibly
+	 *	with a different set of columns).
+	 *
+	 *	\return
+	 *		A `std::vector` of \ref column objects.
+	 */
+	std::vector<column> finish () noexcept;
+};
+
+}
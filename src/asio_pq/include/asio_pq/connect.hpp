@@ -5,6 +5,8 @@
 #pragma once
 
 #include "connection.hpp"
+#include "detail/deadline.hpp"
+#include "detail/executor.hpp"
 #include "detail/op.hpp"
 #include "detail/wrapper.hpp"
 #include "error.hpp"
@@ -20,6 +22,7 @@
 #include <boost/utility/in_place_factory.hpp>
 #include <libpq-fe.h>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <memory>
 #include <utility>
@@ -30,6 +33,26 @@ namespace detail {
 
 using async_connect_signature = void (boost::system::error_code);
 
+//	Orders the statuses libpq passes through during a
+//	single attempt to connect to a host or address up
+//	until authentication completes (a new attempt always
+//	begins in CONNECTION_STARTED, or, if the connection
+//	is established immediately, the stage after it)
+inline int connect_stage (ConnStatusType status) noexcept {
+	switch (status) {
+	case CONNECTION_STARTED:
+		return 0;
+	case CONNECTION_MADE:
+	case CONNECTION_SSL_STARTUP:
+		return 1;
+	case CONNECTION_AWAITING_RESPONSE:
+		return 2;
+	default:
+		break;
+	}
+	return 3;
+}
+
 template <typename Handler>
 class async_connect_op {
 //	TODO (?): If simultaneous reads and writes
@@ -52,10 +75,18 @@ private:
 		boost::optional<boost::system::error_code> result;
 		bool read;
 		bool write;
+		//	The socket, host, and stage libpq reported
+		//	after the previous step of the handshake
+		int socket;
+		const char * host;
+		int stage;
 		state (const Handler &, connection & handle)
 			:	handle(handle),
 				read(false),
-				write(false)
+				write(false),
+				socket(-1),
+				host(nullptr),
+				stage(0)
 		{	}
 	};
 	using pointer = beast::handler_ptr<state, Handler>;
@@ -111,6 +142,27 @@ private:
 			);
 		});
 	}
+	//	When trying multiple hosts or addresses (or retrying
+	//	without SSL) libpq closes the socket and opens another
+	//	which may or may not have the same value. Since
+	//	registering the socket anew is not free this is only
+	//	done if a step may have done so: If the value changed,
+	//	if libpq moved to another host, or if the attempt went
+	//	back to an earlier stage
+	bool socket_may_have_changed () noexcept {
+		PGconn * conn = ptr_->handle;
+		int socket = PQsocket(conn);
+		const char * host = PQhost(conn);
+		int stage = connect_stage(PQstatus(conn));
+		bool retr = (socket != ptr_->socket) ||
+			(host != ptr_->host) ||
+			(stage == 0) ||
+			(stage < ptr_->stage);
+		ptr_->socket = socket;
+		ptr_->host = host;
+		ptr_->stage = stage;
+		return retr;
+	}
 	void succeed () {
 		assert(!ptr_->result);
 		ptr_->result = boost::in_place();
@@ -123,6 +175,16 @@ private:
 			return;
 		}
 		PostgresPollingStatusType status = PQconnectPoll(ptr_->handle);
+		if (
+			((status == PGRES_POLLING_READING) || (status == PGRES_POLLING_WRITING)) &&
+			socket_may_have_changed()
+		) {
+			ec = ptr_->handle.refresh_socket();
+			if (ec) {
+				fail(ec);
+				return;
+			}
+		}
 		switch (status) {
 		case PGRES_POLLING_WRITING:
 			write();
@@ -161,13 +223,17 @@ public:
 			begin_fail(make_error_code(error::connection_bad));
 			return;
 		}
-		auto ec = ptr_->handle.duplicate_socket();
+		auto ec = ptr_->handle.refresh_socket();
 		if (ec) {
 			ptr_->result = ec;
 			boost::asio::io_service & ios = ptr_->handle.get_io_service();
 			ios.post(std::move(*this));
 			return;
 		}
+		PGconn * conn = ptr_->handle;
+		ptr_->socket = PQsocket(conn);
+		ptr_->host = PQhost(conn);
+		ptr_->stage = connect_stage(PQstatus(conn));
 		//	If you have yet to call PQconnectPoll, i.e.,
 		//	just after the call to PQconnectStart, behave
 		//	as if it last returned PGRES_POLLING_WRITING.
@@ -176,6 +242,11 @@ public:
 	void operator () () {
 		complete();
 	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
 	template <typename Function>
 	friend void asio_handler_invoke (Function function, async_connect_op * self) {
 		assert(self);
@@ -240,4 +311,118 @@ auto async_connect (
 	return init.result.get();
 }
 
+/**
+ *	Asynchronously connects to a PostgreSQL server,
+ *	abandoning the attempt if it has not completed by
+ *	a certain point in time.
+ *
+ *	If the attempt is abandoned the completion handler
+ *	is invoked with \ref error::timed_out and the
+ *	\ref connection should not be used further.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		A \ref connection object wrapping a libpq connection
+ *		handle. The reference to this object must remain valid
+ *		for the lifetime of the asynchronous operation or the
+ *		behavior is undefined.
+ *	\param [in] deadline
+ *		The point in time at which the attempt shall be
+ *		abandoned.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. One parameter is provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_connect (
+	connection & conn,
+	std::chrono::steady_clock::time_point deadline,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_connect_signature> init(token);
+	detail::async_deadline<>(
+		conn,
+		deadline,
+		[] (connection & conn, auto h) {	async_connect(conn, std::move(h));	},
+		[] (connection & conn, auto h) {
+			detail::abandon(conn);
+			h();
+		},
+		std::move(init.completion_handler)
+	);
+	return init.result.get();
 }
+/**
+ *	Asynchronously connects to a PostgreSQL server,
+ *	abandoning the attempt if it does not complete
+ *	within a certain amount of time.
+ *
+ *	If the attempt is abandoned the completion handler
+ *	is invoked with \ref error::timed_out and the
+ *	\ref connection should not be used further.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		A \ref connection object wrapping a libpq connection
+ *		handle. The reference to this object must remain valid
+ *		for the lifetime of the asynchronous operation or the
+ *		behavior is undefined.
+ *	\param [in] timeout
+ *		The amount of time after which the attempt shall
+ *		be abandoned.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. One parameter is provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_connect (
+	connection & conn,
+	std::chrono::steady_clock::duration timeout,
+	CompletionToken && token
+) {
+	return async_connect(
+		conn,
+		std::chrono::steady_clock::now() + timeout,
+		std::forward<CompletionToken>(token)
+	);
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_connect_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_connect_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_connect_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_connect_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "detail/executor.hpp"
+#include "detail/handler_memory.hpp"
 #include "detail/socket.hpp"
 #include <boost/asio/io_service.hpp>
 #include <boost/optional.hpp>
@@ -23,6 +25,7 @@ private:
 	PGconn * conn_;
 	boost::asio::io_service * ios_;
 	boost::optional<detail::socket_variant_type> socket_;
+	detail::handler_memory memory_;
 	void destroy () noexcept;
 	void check () const;
 public:
@@ -109,16 +112,35 @@ public:
 	 *		A reference to a `boost::asio::io_service`.
 	 */
 	boost::asio::io_service & get_io_service () const noexcept;
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	/**
+	 *	The type of executor associated with this
+	 *	object.
+	 */
+	using executor_type = boost::asio::io_service::executor_type;
+	/**
+	 *	Retrieves the executor associated with this
+	 *	object, the intermediate handlers of operations
+	 *	whose completion handler does not have an
+	 *	associated executor run on it.
+	 *
+	 *	\return
+	 *		An executor.
+	 */
+	executor_type get_executor () const noexcept;
+	#endif
 	/**
 	 *	\cond
 	 */
 	boost::system::error_code duplicate_socket ();
+	boost::system::error_code refresh_socket ();
 	template <typename Handler>
 	decltype(auto) socket (Handler h) {
 		assert(socket_);
 		return mpark::visit(h, *socket_);
 	}
 	bool has_socket () const noexcept;
+	detail::handler_memory & memory () noexcept;
 	void cancel (boost::system::error_code &) noexcept;
 	/**
 	 *	\endcond
@@ -0,0 +1,115 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "params.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace asio_pq {
+
+namespace detail {
+
+template <typename... Args>
+class is_tuple_row : public std::false_type {	};
+template <typename... Args>
+class is_tuple_row<std::tuple<Args...>> : public std::true_type {	};
+
+}
+
+/**
+ *	Encodes rows in the binary format of `COPY`
+ *	(i.e. `COPY ... FROM STDIN (FORMAT binary)`).
+ *
+ *	Values are encoded via \ref param_traits so
+ *	every type which may be sent as a parameter
+ *	may also be sent via `COPY`.
+ */
+class copy_binary_writer {
+private:
+	using swallow = int [];
+	std::string & out_;
+	void append (std::int16_t value);
+	void append (std::int32_t value);
+	template <typename T>
+	void field (const T & value) {
+		using traits = param_traits<T>;
+		typename traits::storage_type storage{};
+		int length = traits::encode(value, storage);
+		append(std::int32_t(length));
+		if (length > 0) out_.append(traits::data(storage), std::size_t(length));
+	}
+	template <typename... Args, std::size_t... Is>
+	void row (const std::tuple<Args...> & t, std::index_sequence<Is...>) {
+		row(std::get<Is>(t)...);
+	}
+public:
+	copy_binary_writer () = delete;
+	copy_binary_writer (const copy_binary_writer &) = delete;
+	copy_binary_writer & operator = (const copy_binary_writer &) = delete;
+	/**
+	 *	Creates a copy_binary_writer which appends
+	 *	to a certain string.
+	 *
+	 *	\param [in] out
+	 *		The string. The reference to this object
+	 *		must remain valid for the lifetime of the
+	 *		copy_binary_writer or the behavior is
+	 *		undefined.
+	 */
+	explicit copy_binary_writer (std::string & out) noexcept;
+	/**
+	 *	Appends the header which must begin the data
+	 *	of each `COPY`.
+	 */
+	void header ();
+	/**
+	 *	Appends the trailer which must end the data
+	 *	of each `COPY`.
+	 */
+	void trailer ();
+	/**
+	 *	Appends a row.
+	 *
+	 *	\tparam Args
+	 *		The types of the values. Arrays of characters
+	 *		(i.e. string literals) are encoded as `const char *`.
+	 *
+	 *	\param [in] args
+	 *		The value of each column.
+	 */
+	template <
+		typename... Args,
+		typename = std::enable_if_t<!detail::is_tuple_row<std::decay_t<Args>...>::value>
+	>
+	void row (Args &&... args) {
+		append(std::int16_t(sizeof...(Args)));
+		(void)swallow{0, (field<std::decay_t<Args>>(args), 0)...};
+	}
+	/**
+	 *	Appends a row whose values are the elements
+	 *	of a `std::tuple`.
+	 *
+	 *	\param [in] t
+	 *		The tuple.
+	 */
+	template <typename... Args>
+	void row (const std::tuple<Args...> & t) {
+		row(t, std::index_sequence_for<Args...>{});
+	}
+	/**
+	 *	Retrieves the number of bytes in the string.
+	 *
+	 *	\return
+	 *		The number of bytes.
+	 */
+	std::size_t size () const noexcept;
+};
+
+}
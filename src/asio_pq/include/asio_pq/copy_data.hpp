@@ -0,0 +1,101 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+#include <cstddef>
+
+namespace asio_pq {
+
+/**
+ *	An RAII wrapper for a buffer allocated by
+ *	`PQgetCopyData` which frees it via `PQfreemem`.
+ *
+ *	The bytes are viewed in place (i.e. they are
+ *	never copied) and the view may be narrowed
+ *	from the front as they are consumed.
+ */
+class copy_data {
+private:
+	char * handle_;
+	const char * data_;
+	std::size_t size_;
+	void destroy () noexcept;
+public:
+	copy_data (const copy_data &) = delete;
+	copy_data & operator = (const copy_data &) = delete;
+	/**
+	 *	Creates a copy_data which does not manage
+	 *	a buffer.
+	 */
+	copy_data () noexcept;
+	copy_data (copy_data &&) noexcept;
+	copy_data & operator = (copy_data &&) noexcept;
+	/**
+	 *	Creates a copy_data which manages a buffer.
+	 *
+	 *	\param [in] handle
+	 *		A buffer returned by `PQgetCopyData`.
+	 *	\param [in] size
+	 *		The number of bytes in the buffer.
+	 */
+	copy_data (char * handle, std::size_t size) noexcept;
+	/**
+	 *	Frees the managed buffer (if any).
+	 */
+	~copy_data () noexcept;
+	/**
+	 *	Retrieves the managed buffer and surrenders
+	 *	ownership thereof.
+	 *
+	 *	\return
+	 *		The managed buffer (if any) which must
+	 *		be freed by `PQfreemem`.
+	 */
+	char * release () noexcept;
+	/**
+	 *	Retrieves a pointer to the bytes which have
+	 *	not been consumed.
+	 *
+	 *	\return
+	 *		A pointer.
+	 */
+	const char * data () const noexcept;
+	/**
+	 *	Retrieves the number of bytes which have not
+	 *	been consumed.
+	 *
+	 *	\return
+	 *		The number of bytes.
+	 */
+	std::size_t size () const noexcept;
+	/**
+	 *	Retrieves the bytes which have not been consumed
+	 *	as a buffer.
+	 *
+	 *	\return
+	 *		A `boost::asio::const_buffer`.
+	 */
+	boost::asio::const_buffer buffer () const noexcept;
+	/**
+	 *	Marks bytes at the beginning of the view as
+	 *	consumed.
+	 *
+	 *	\param [in] num
+	 *		The number of bytes. Must not be greater
+	 *		than \ref size.
+	 */
+	void consume (std::size_t num) noexcept;
+	/**
+	 *	Determines whether this object manages a
+	 *	buffer.
+	 *
+	 *	\return
+	 *		\em true if it does, \em false otherwise.
+	 */
+	explicit operator bool () const noexcept;
+};
+
+}
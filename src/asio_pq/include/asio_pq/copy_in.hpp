@@ -0,0 +1,407 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/buffers.hpp"
+#include "detail/copy.hpp"
+#include "detail/executor.hpp"
+#include "detail/flush.hpp"
+#include "error.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace asio_pq {
+
+namespace detail {
+
+using async_copy_in_write_signature = void (boost::system::error_code, std::size_t);
+
+template <typename Handler, typename ConstBufferSequence>
+class async_copy_in_write_op {
+private:
+	using iterator = buffer_sequence_iterator<ConstBufferSequence>;
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, asio_pq::connection & conn, const ConstBufferSequence & buffers)
+			:	connection(conn),
+				buffers(buffers),
+				begin(buffer_sequence_begin(this->buffers)),
+				end(buffer_sequence_end(this->buffers)),
+				offset(0),
+				bytes(0),
+				done(false)
+		{	}
+		asio_pq::connection & connection;
+		ConstBufferSequence buffers;
+		iterator begin;
+		iterator end;
+		std::size_t offset;
+		std::size_t bytes;
+		bool done;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void complete (boost::system::error_code ec) {
+		auto bytes = ptr_->bytes;
+		ptr_.invoke(ec, bytes);
+	}
+	void flush () {
+		connection & conn = ptr_->connection;
+		async_flush(conn, std::move(*this));
+	}
+	void put () {
+		state & s = *ptr_;
+		for (; s.begin != s.end; ++s.begin, s.offset = 0) {
+			boost::asio::const_buffer buffer(*s.begin);
+			auto size = boost::asio::buffer_size(buffer);
+			auto data = detail::buffer_data(buffer);
+			while (s.offset != size) {
+				auto n = std::min(size - s.offset, std::size_t(std::numeric_limits<int>::max()));
+				switch (PQputCopyData(s.connection, data + s.offset, int(n))) {
+				case -1:
+					s.connection.get_io_service().post(std::move(*this));
+					return;
+				case 0:
+					//	libpq could neither buffer nor send the
+					//	data without blocking
+					flush();
+					return;
+				default:
+					break;
+				}
+				s.offset += n;
+				s.bytes += n;
+			}
+		}
+		//	libpq buffers without bound, so the operation
+		//	does not complete until everything has been
+		//	sent which is what provides backpressure
+		s.done = true;
+		flush();
+	}
+public:
+	async_copy_in_write_op () = delete;
+	async_copy_in_write_op (const async_copy_in_write_op &) = default;
+	async_copy_in_write_op (async_copy_in_write_op &&) = default;
+	async_copy_in_write_op & operator = (const async_copy_in_write_op &) = default;
+	async_copy_in_write_op & operator = (async_copy_in_write_op &&) = default;
+	template <typename DeducedHandler>
+	async_copy_in_write_op (connection & conn, const ConstBufferSequence & buffers, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn, buffers)
+	{	}
+	void begin () {
+		put();
+	}
+	void operator () () {
+		complete(make_error_code(error::copy_failed));
+	}
+	void operator () (boost::system::error_code ec) {
+		if (ec || ptr_->done) {
+			complete(ec);
+			return;
+		}
+		put();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_copy_in_write_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_copy_in_write_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_copy_in_write_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_copy_in_write_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+/**
+ *	Sends a `COPY ... FROM STDIN` command via `PQsendQuery`
+ *	and asynchronously waits for the server to begin
+ *	accepting data.
+ *
+ *	Once this operation completes successfully data
+ *	may be sent via a \ref copy_in_stream.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must not have a pending
+ *		command and should be in nonblocking mode. The
+ *		reference to this object must remain valid for
+ *		the lifetime of the asynchronous operation or the
+ *		behavior is undefined.
+ *	\param [in] command
+ *		The `COPY` command.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and the first \ref result
+ *		of the command. If that \ref result does not have status
+ *		`PGRES_COPY_IN` (e.g. because the command failed) the
+ *		`boost::system::error_code` shall be \ref error::copy_failed
+ *		and any remaining results must be retrieved via
+ *		\ref async_get_result.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_copy_in (
+	connection & conn,
+	const char * command,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_copy_signature> init(token);
+	detail::async_copy_begin_op<
+		beast::handler_type<CompletionToken, detail::async_copy_signature>
+	> op(
+		conn,
+		PGRES_COPY_IN,
+		std::move(init.completion_handler)
+	);
+	op.begin(PQsendQuery(conn, command));
+	return init.result.get();
+}
+
+/**
+ *	Writes data to a \ref connection which is in the
+ *	`COPY IN` state (see \ref async_copy_in).
+ *
+ *	Data is passed to `PQputCopyData` without being copied
+ *	or concatenated beforehand, and whenever libpq cannot
+ *	accept it without blocking the operation waits for the
+ *	socket to become writable and retries. Since libpq
+ *	otherwise buffers without bound each write does not
+ *	complete until libpq has sent everything buffered so a
+ *	producer which waits for each write to complete before
+ *	beginning the next never gets further ahead of the server
+ *	than the size of one write.
+ *
+ *	Only one write may be outstanding at a time and this
+ *	object must outlive all operations thereupon.
+ */
+class copy_in_stream {
+private:
+	connection & conn_;
+public:
+	copy_in_stream () = delete;
+	copy_in_stream (const copy_in_stream &) = delete;
+	copy_in_stream (copy_in_stream &&) = delete;
+	copy_in_stream & operator = (const copy_in_stream &) = delete;
+	copy_in_stream & operator = (copy_in_stream &&) = delete;
+	/**
+	 *	Creates a copy_in_stream which writes to a
+	 *	certain \ref connection.
+	 *
+	 *	\param [in] conn
+	 *		The \ref connection. The reference to this
+	 *		object must remain valid for the lifetime
+	 *		of the copy_in_stream or the behavior is
+	 *		undefined.
+	 */
+	explicit copy_in_stream (connection & conn) noexcept
+		:	conn_(conn)
+	{	}
+	/**
+	 *	Retrieves the `boost::asio::io_service` associated
+	 *	with this object.
+	 *
+	 *	\return
+	 *		A reference to a `boost::asio::io_service`.
+	 */
+	boost::asio::io_service & get_io_service () const noexcept {
+		return conn_.get_io_service();
+	}
+	/**
+	 *	Retrieves the \ref connection associated with
+	 *	this object.
+	 *
+	 *	\return
+	 *		A reference to a \ref connection.
+	 */
+	connection & get_connection () const noexcept {
+		return conn_;
+	}
+	/**
+	 *	Asynchronously writes all bytes of a buffer
+	 *	sequence.
+	 *
+	 *	Unlike most `async_write_some` operations this
+	 *	operation either writes all bytes or fails.
+	 *
+	 *	\tparam ConstBufferSequence
+	 *		A type which models `ConstBufferSequence`.
+	 *	\tparam CompletionToken
+	 *		The type of completion token an instance
+	 *		of which shall be used to notify the caller
+	 *		of completion.
+	 *
+	 *	\param [in] buffers
+	 *		The buffers. A copy of this object is made but
+	 *		the memory it refers to must remain valid until
+	 *		the operation completes.
+	 *	\param [in] token
+	 *		The completion token which shall be used to notify
+	 *		the caller of completion. Two parameters are provided:
+	 *		An instance of `boost::system::error_code` representing
+	 *		the result of the operation (\ref error::copy_failed
+	 *		if `PQputCopyData` fails) and a `std::size_t` which
+	 *		is the number of bytes passed to libpq.
+	 *
+	 *	\return
+	 *		Whatever is appropriate given \em CompletionToken.
+	 */
+	template <typename ConstBufferSequence, typename CompletionToken>
+	auto async_write_some (const ConstBufferSequence & buffers, CompletionToken && token) {
+		beast::async_completion<CompletionToken, detail::async_copy_in_write_signature> init(token);
+		detail::async_copy_in_write_op<
+			beast::handler_type<CompletionToken, detail::async_copy_in_write_signature>,
+			ConstBufferSequence
+		> op(
+			conn_,
+			buffers,
+			std::move(init.completion_handler)
+		);
+		op.begin();
+		return init.result.get();
+	}
+	/**
+	 *	Asynchronously ends the `COPY` by calling `PQputCopyEnd`
+	 *	and retrieves the final result of the command.
+	 *
+	 *	\tparam CompletionToken
+	 *		The type of completion token an instance
+	 *		of which shall be used to notify the caller
+	 *		of completion.
+	 *
+	 *	\param [in] token
+	 *		The completion token which shall be used to notify
+	 *		the caller of completion. Two parameters are provided:
+	 *		An instance of `boost::system::error_code` representing
+	 *		the result of the operation and the final \ref result of
+	 *		the command (which has status `PGRES_COMMAND_OK` if the
+	 *		server accepted all data).
+	 *
+	 *	\return
+	 *		Whatever is appropriate given \em CompletionToken.
+	 */
+	template <typename CompletionToken>
+	auto async_end (CompletionToken && token) {
+		beast::async_completion<CompletionToken, detail::async_copy_signature> init(token);
+		detail::async_copy_end_op<
+			beast::handler_type<CompletionToken, detail::async_copy_signature>
+		> op(
+			conn_,
+			true,
+			boost::none,
+			std::move(init.completion_handler)
+		);
+		op.begin();
+		return init.result.get();
+	}
+	/**
+	 *	Asynchronously aborts the `COPY` by calling `PQputCopyEnd`
+	 *	with an error message and retrieves the final result of the
+	 *	command.
+	 *
+	 *	\tparam CompletionToken
+	 *		The type of completion token an instance
+	 *		of which shall be used to notify the caller
+	 *		of completion.
+	 *
+	 *	\param [in] message
+	 *		The error message which the server shall report.
+	 *	\param [in] token
+	 *		The completion token which shall be used to notify
+	 *		the caller of completion. Two parameters are provided:
+	 *		An instance of `boost::system::error_code` representing
+	 *		the result of the operation and the final \ref result of
+	 *		the command (which has status `PGRES_FATAL_ERROR`).
+	 *
+	 *	\return
+	 *		Whatever is appropriate given \em CompletionToken.
+	 */
+	template <typename CompletionToken>
+	auto async_abort (const char * message, CompletionToken && token) {
+		assert(message);
+		beast::async_completion<CompletionToken, detail::async_copy_signature> init(token);
+		detail::async_copy_end_op<
+			beast::handler_type<CompletionToken, detail::async_copy_signature>
+		> op(
+			conn_,
+			true,
+			std::string(message),
+			std::move(init.completion_handler)
+		);
+		op.begin();
+		return init.result.get();
+	}
+};
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename ConstBufferSequence, typename Executor>
+struct associated_executor<asio_pq::detail::async_copy_in_write_op<Handler, ConstBufferSequence>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_copy_in_write_op<Handler, ConstBufferSequence>, Handler, Executor>
+{	};
+
+template <typename Handler, typename ConstBufferSequence, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_copy_in_write_op<Handler, ConstBufferSequence>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_copy_in_write_op<Handler, ConstBufferSequence>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
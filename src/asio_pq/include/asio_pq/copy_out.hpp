@@ -0,0 +1,536 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "copy_data.hpp"
+#include "detail/buffers.hpp"
+#include "detail/copy.hpp"
+#include "detail/executor.hpp"
+#include "detail/op.hpp"
+#include "detail/wrapper.hpp"
+#include "error.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+namespace asio_pq {
+
+namespace detail {
+
+using async_copy_out_read_chunk_signature = void (boost::system::error_code, copy_data);
+using async_copy_out_read_some_signature = void (boost::system::error_code, std::size_t);
+
+class copy_out_state {
+public:
+	copy_out_state () noexcept
+		:	eof(false)
+	{	}
+	//	What remains of a chunk which did not fit
+	//	in the caller's buffers
+	copy_data pending;
+	//	PQgetCopyData fails if it is called again
+	//	after indicating the end of the data
+	bool eof;
+};
+
+class copy_out_chunk_reader {
+private:
+	copy_data chunk_;
+public:
+	bool full () const noexcept {
+		return bool(chunk_);
+	}
+	bool empty () const noexcept {
+		return !chunk_;
+	}
+	void take (copy_data & pending) noexcept {
+		chunk_ = std::move(pending);
+	}
+	template <typename Pointer>
+	void invoke (Pointer & ptr, boost::system::error_code ec) {
+		auto chunk = std::move(chunk_);
+		ptr.invoke(ec, std::move(chunk));
+	}
+};
+
+template <typename MutableBufferSequence>
+class copy_out_buffer_reader {
+private:
+	using iterator = buffer_sequence_iterator<MutableBufferSequence>;
+	MutableBufferSequence buffers_;
+	iterator begin_;
+	iterator end_;
+	std::size_t offset_;
+	std::size_t bytes_;
+	void skip () noexcept {
+		while (
+			(begin_ != end_) &&
+			(offset_ == boost::asio::buffer_size(boost::asio::mutable_buffer(*begin_)))
+		) {
+			++begin_;
+			offset_ = 0;
+		}
+	}
+public:
+	copy_out_buffer_reader (const copy_out_buffer_reader &) = delete;
+	copy_out_buffer_reader (copy_out_buffer_reader &&) = delete;
+	copy_out_buffer_reader & operator = (const copy_out_buffer_reader &) = delete;
+	copy_out_buffer_reader & operator = (copy_out_buffer_reader &&) = delete;
+	explicit copy_out_buffer_reader (const MutableBufferSequence & buffers)
+		:	buffers_(buffers),
+			begin_(buffer_sequence_begin(buffers_)),
+			end_(buffer_sequence_end(buffers_)),
+			offset_(0),
+			bytes_(0)
+	{
+		skip();
+	}
+	bool full () const noexcept {
+		return begin_ == end_;
+	}
+	bool empty () const noexcept {
+		return bytes_ == 0;
+	}
+	void take (copy_data & pending) noexcept {
+		while (pending.size() != 0) {
+			skip();
+			if (full()) return;
+			boost::asio::mutable_buffer buffer(*begin_);
+			auto n = std::min(boost::asio::buffer_size(buffer) - offset_, pending.size());
+			std::memcpy(detail::buffer_data(buffer) + offset_, pending.data(), n);
+			offset_ += n;
+			bytes_ += n;
+			pending.consume(n);
+		}
+		pending = copy_data{};
+		skip();
+	}
+	template <typename Pointer>
+	void invoke (Pointer & ptr, boost::system::error_code ec) {
+		auto bytes = bytes_;
+		ptr.invoke(ec, bytes);
+	}
+};
+
+template <typename Handler, typename Reader>
+class async_copy_out_read_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		template <typename... Args>
+		state (const Handler &, asio_pq::connection & conn, copy_out_state & copy, Args &&... args)
+			:	connection(conn),
+				copy(copy),
+				reader(std::forward<Args>(args)...),
+				waited(false)
+		{	}
+		asio_pq::connection & connection;
+		copy_out_state & copy;
+		Reader reader;
+		bool waited;
+		boost::system::error_code error_code;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void complete (boost::system::error_code ec) {
+		//	Avoid invoking the handler from within
+		//	the initiating function
+		if (!ptr_->waited) {
+			ptr_->error_code = ec;
+			boost::asio::io_service & ios = ptr_->connection.get_io_service();
+			ios.post(std::move(*this));
+			return;
+		}
+		ptr_->reader.invoke(ptr_, ec);
+	}
+	void wait () {
+		ptr_->waited = true;
+		ptr_->connection.socket([&] (auto & socket) {
+			detail::async_readable(
+				socket,
+				detail::make_read_wrapper(
+					std::move(*this)
+				)
+			);
+		});
+	}
+	void get () {
+		state & s = *ptr_;
+		for (;;) {
+			if (s.copy.pending) {
+				s.reader.take(s.copy.pending);
+				if (s.reader.full()) break;
+				continue;
+			}
+			if (s.copy.eof) {
+				complete(s.reader.empty() ? make_error_code(boost::asio::error::eof) : boost::system::error_code{});
+				return;
+			}
+			char * buffer = nullptr;
+			int n = PQgetCopyData(s.connection, &buffer, 1);
+			if (n > 0) {
+				s.copy.pending = copy_data(buffer, std::size_t(n));
+				continue;
+			}
+			if (n == -1) {
+				s.copy.eof = true;
+				continue;
+			}
+			if (n != 0) {
+				complete(make_error_code(error::copy_failed));
+				return;
+			}
+			//	Only data libpq has already received is
+			//	coalesced, the operation does not wait for
+			//	more once it has something
+			if (!s.reader.empty()) break;
+			wait();
+			return;
+		}
+		complete(boost::system::error_code{});
+	}
+public:
+	async_copy_out_read_op () = delete;
+	async_copy_out_read_op (const async_copy_out_read_op &) = default;
+	async_copy_out_read_op (async_copy_out_read_op &&) = default;
+	async_copy_out_read_op & operator = (const async_copy_out_read_op &) = default;
+	async_copy_out_read_op & operator = (async_copy_out_read_op &&) = default;
+	template <typename DeducedHandler, typename... Args>
+	async_copy_out_read_op (DeducedHandler && h, connection & conn, copy_out_state & copy, Args &&... args)
+		:	ptr_(std::forward<DeducedHandler>(h), conn, copy, std::forward<Args>(args)...)
+	{	}
+	void begin () {
+		auto ec = ptr_->connection.duplicate_socket();
+		if (ec) {
+			complete(ec);
+			return;
+		}
+		get();
+	}
+	void operator () () {
+		ptr_->reader.invoke(ptr_, ptr_->error_code);
+	}
+	void read (boost::system::error_code ec) {
+		if (!ec && !ptr_->connection.has_socket()) ec = make_error_code(boost::asio::error::operation_aborted);
+		if (ec) {
+			complete(ec);
+			return;
+		}
+		if (PQconsumeInput(ptr_->connection) == 0) {
+			complete(make_error_code(error::consume_failed));
+			return;
+		}
+		get();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_copy_out_read_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_copy_out_read_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_copy_out_read_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_copy_out_read_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+/**
+ *	Sends a `COPY ... TO STDOUT` command via `PQsendQuery`
+ *	and asynchronously waits for the server to begin
+ *	sending data.
+ *
+ *	Once this operation completes successfully data
+ *	may be received via a \ref copy_out_stream.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must not have a pending
+ *		command and should be in nonblocking mode. The
+ *		reference to this object must remain valid for
+ *		the lifetime of the asynchronous operation or the
+ *		behavior is undefined.
+ *	\param [in] command
+ *		The `COPY` command.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and the first \ref result
+ *		of the command. If that \ref result does not have status
+ *		`PGRES_COPY_OUT` (e.g. because the command failed) the
+ *		`boost::system::error_code` shall be \ref error::copy_failed
+ *		and any remaining results must be retrieved via
+ *		\ref async_get_result.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_copy_out (
+	connection & conn,
+	const char * command,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_copy_signature> init(token);
+	detail::async_copy_begin_op<
+		beast::handler_type<CompletionToken, detail::async_copy_signature>
+	> op(
+		conn,
+		PGRES_COPY_OUT,
+		std::move(init.completion_handler)
+	);
+	op.begin(PQsendQuery(conn, command));
+	return init.result.get();
+}
+
+/**
+ *	Reads data from a \ref connection which is in the
+ *	`COPY OUT` state (see \ref async_copy_out).
+ *
+ *	Data may be read either one `CopyData` message at
+ *	a time in place in the buffer libpq allocated (see
+ *	\ref async_read_chunk) or by coalescing all messages
+ *	libpq has already received into buffers provided by
+ *	the caller (see \ref async_read_some). The two may be
+ *	mixed freely.
+ *
+ *	When all data has been read reads fail with
+ *	`boost::asio::error::eof` and \ref async_end should
+ *	be used to retrieve the final result of the command.
+ *
+ *	Only one read may be outstanding at a time and this
+ *	object must outlive all operations thereupon.
+ */
+class copy_out_stream {
+private:
+	connection & conn_;
+	detail::copy_out_state state_;
+public:
+	copy_out_stream () = delete;
+	copy_out_stream (const copy_out_stream &) = delete;
+	copy_out_stream (copy_out_stream &&) = delete;
+	copy_out_stream & operator = (const copy_out_stream &) = delete;
+	copy_out_stream & operator = (copy_out_stream &&) = delete;
+	/**
+	 *	Creates a copy_out_stream which reads from a
+	 *	certain \ref connection.
+	 *
+	 *	\param [in] conn
+	 *		The \ref connection. The reference to this
+	 *		object must remain valid for the lifetime
+	 *		of the copy_out_stream or the behavior is
+	 *		undefined.
+	 */
+	explicit copy_out_stream (connection & conn) noexcept
+		:	conn_(conn)
+	{	}
+	/**
+	 *	Retrieves the `boost::asio::io_service` associated
+	 *	with this object.
+	 *
+	 *	\return
+	 *		A reference to a `boost::asio::io_service`.
+	 */
+	boost::asio::io_service & get_io_service () const noexcept {
+		return conn_.get_io_service();
+	}
+	/**
+	 *	Retrieves the \ref connection associated with
+	 *	this object.
+	 *
+	 *	\return
+	 *		A reference to a \ref connection.
+	 */
+	connection & get_connection () const noexcept {
+		return conn_;
+	}
+	/**
+	 *	Asynchronously reads the next `CopyData` message
+	 *	without copying it.
+	 *
+	 *	If a previous \ref async_read_some did not consume
+	 *	an entire message the remainder thereof is read.
+	 *
+	 *	\tparam CompletionToken
+	 *		The type of completion token an instance
+	 *		of which shall be used to notify the caller
+	 *		of completion.
+	 *
+	 *	\param [in] token
+	 *		The completion token which shall be used to notify
+	 *		the caller of completion. Two parameters are provided:
+	 *		An instance of `boost::system::error_code` representing
+	 *		the result of the operation (`boost::asio::error::eof`
+	 *		if there is no more data or \ref error::copy_failed if
+	 *		`PQgetCopyData` fails) and a \ref copy_data which owns
+	 *		the message. The buffer is freed via `PQfreemem` when
+	 *		the \ref copy_data is destroyed.
+	 *
+	 *	\return
+	 *		Whatever is appropriate given \em CompletionToken.
+	 */
+	template <typename CompletionToken>
+	auto async_read_chunk (CompletionToken && token) {
+		beast::async_completion<CompletionToken, detail::async_copy_out_read_chunk_signature> init(token);
+		detail::async_copy_out_read_op<
+			beast::handler_type<CompletionToken, detail::async_copy_out_read_chunk_signature>,
+			detail::copy_out_chunk_reader
+		> op(
+			std::move(init.completion_handler),
+			conn_,
+			state_
+		);
+		op.begin();
+		return init.result.get();
+	}
+	/**
+	 *	Asynchronously reads data into a buffer sequence.
+	 *
+	 *	The operation waits until at least one byte is
+	 *	available and then copies as many of the messages
+	 *	libpq has already received as fit, so many small
+	 *	messages (e.g. one per row) are delivered in one
+	 *	completion. Any part of a message which does not
+	 *	fit is retained for the next read.
+	 *
+	 *	\tparam MutableBufferSequence
+	 *		A type which models `MutableBufferSequence`.
+	 *	\tparam CompletionToken
+	 *		The type of completion token an instance
+	 *		of which shall be used to notify the caller
+	 *		of completion.
+	 *
+	 *	\param [in] buffers
+	 *		The buffers. A copy of this object is made but
+	 *		the memory it refers to must remain valid until
+	 *		the operation completes.
+	 *	\param [in] token
+	 *		The completion token which shall be used to notify
+	 *		the caller of completion. Two parameters are provided:
+	 *		An instance of `boost::system::error_code` representing
+	 *		the result of the operation (`boost::asio::error::eof`
+	 *		if there is no more data or \ref error::copy_failed if
+	 *		`PQgetCopyData` fails) and a `std::size_t` which is the
+	 *		number of bytes read.
+	 *
+	 *	\return
+	 *		Whatever is appropriate given \em CompletionToken.
+	 */
+	template <typename MutableBufferSequence, typename CompletionToken>
+	auto async_read_some (const MutableBufferSequence & buffers, CompletionToken && token) {
+		beast::async_completion<CompletionToken, detail::async_copy_out_read_some_signature> init(token);
+		detail::async_copy_out_read_op<
+			beast::handler_type<CompletionToken, detail::async_copy_out_read_some_signature>,
+			detail::copy_out_buffer_reader<MutableBufferSequence>
+		> op(
+			std::move(init.completion_handler),
+			conn_,
+			state_,
+			buffers
+		);
+		op.begin();
+		return init.result.get();
+	}
+	/**
+	 *	Asynchronously retrieves the final result of the
+	 *	command once all data has been read.
+	 *
+	 *	\tparam CompletionToken
+	 *		The type of completion token an instance
+	 *		of which shall be used to notify the caller
+	 *		of completion.
+	 *
+	 *	\param [in] token
+	 *		The completion token which shall be used to notify
+	 *		the caller of completion. Two parameters are provided:
+	 *		An instance of `boost::system::error_code` representing
+	 *		the result of the operation and the final \ref result of
+	 *		the command (which has status `PGRES_COMMAND_OK` if the
+	 *		server sent all data).
+	 *
+	 *	\return
+	 *		Whatever is appropriate given \em CompletionToken.
+	 */
+	template <typename CompletionToken>
+	auto async_end (CompletionToken && token) {
+		assert(state_.eof);
+		beast::async_completion<CompletionToken, detail::async_copy_signature> init(token);
+		detail::async_copy_end_op<
+			beast::handler_type<CompletionToken, detail::async_copy_signature>
+		> op(
+			conn_,
+			false,
+			boost::none,
+			std::move(init.completion_handler)
+		);
+		op.begin();
+		return init.result.get();
+	}
+};
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Reader, typename Executor>
+struct associated_executor<asio_pq::detail::async_copy_out_read_op<Handler, Reader>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_copy_out_read_op<Handler, Reader>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Reader, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_copy_out_read_op<Handler, Reader>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_copy_out_read_op<Handler, Reader>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,460 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "detail/endian.hpp"
+#include "detail/timestamp.hpp"
+#include "error.hpp"
+#include "oid.hpp"
+#include "result.hpp"
+#include <boost/asio/buffer.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <libpq-fe.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace asio_pq {
+
+/**
+ *	Describes how values of a C++ type are decoded
+ *	from fields of a \ref result in binary format
+ *	(i.e. a result requested with a result format
+ *	of one).
+ *
+ *	Specializations provide:
+ *
+ *	- `static bool accepts (Oid) noexcept`: Determines
+ *	  whether fields of a PostgreSQL type may be decoded
+ *	  into the C++ type
+ *	- `static T decode (Oid, const char *, std::size_t, boost::system::error_code &)`:
+ *	  Decodes a non-null field of an accepted type
+ *
+ *	Specializations are provided for:
+ *
+ *	- `std::int16_t`, `std::int32_t`, and `std::int64_t`
+ *	  (from `int2`, `int4`, and `int8` where the value
+ *	  cannot overflow)
+ *	- `float` (from `float4`) and `double` (from `float4`,
+ *	  `float8`, and `numeric`)
+ *	- `bool`
+ *	- `boost::asio::const_buffer` (from `bytea`), which
+ *	  refers to the memory of the \ref result
+ *	- `boost::string_ref` (from `text`, `varchar`, `bpchar`,
+ *	  `json`, and `jsonb`), which refers to the memory of
+ *	  the \ref result
+ *	- `std::string` (from the above and `numeric`, which is
+ *	  formatted exactly as the server would format it)
+ *	- `std::chrono::system_clock::time_point` (from `timestamp`,
+ *	  which is taken to be UTC, and `timestamptz`) where
+ *	  `infinity` and `-infinity` are the maximum and minimum
+ *	  values. Values the type cannot represent (e.g. outside
+ *	  roughly the years 1678 through 2261 where its ticks are
+ *	  nanoseconds) fail with \ref error::decode_failed
+ *	- `boost::uuids::uuid`
+ *	- `boost::optional` of any supported type, which is
+ *	  disengaged for `NULL`
+ *	- `std::vector` of any supported type (from one
+ *	  dimensional arrays of an accepted type)
+ *
+ *	\tparam T
+ *		The C++ type.
+ */
+template <typename T, typename = void>
+class field_traits;
+
+namespace detail {
+
+//	Returns the OID of the element type of a
+//	known array type or zero otherwise
+Oid array_element_type (Oid type) noexcept;
+
+std::string numeric_to_string (const char * data, std::size_t length, boost::system::error_code & ec);
+double numeric_to_double (const char * data, std::size_t length, boost::system::error_code & ec) noexcept;
+
+template <typename T>
+T decode_failed (boost::system::error_code & ec) {
+	ec = make_error_code(error::decode_failed);
+	return T{};
+}
+
+template <typename T>
+class integer_field_traits {
+public:
+	static bool accepts (Oid type) noexcept {
+		return (type == oid::int2) ||
+			((type == oid::int4) && (sizeof(T) >= 4)) ||
+			((type == oid::int8) && (sizeof(T) >= 8));
+	}
+	static T decode (Oid, const char * data, std::size_t length, boost::system::error_code & ec) {
+		switch (length) {
+		case 2:
+			return T(load_value<std::int16_t>(data));
+		case 4:
+			if (sizeof(T) < 4) break;
+			return T(load_value<std::int32_t>(data));
+		case 8:
+			if (sizeof(T) < 8) break;
+			return T(load_value<std::int64_t>(data));
+		default:
+			break;
+		}
+		return decode_failed<T>(ec);
+	}
+};
+
+class string_ref_field_traits {
+public:
+	static bool accepts (Oid type) noexcept {
+		switch (type) {
+		case oid::text:
+		case oid::varchar:
+		case oid::bpchar:
+		case oid::json:
+		case oid::jsonb:
+			return true;
+		default:
+			break;
+		}
+		return false;
+	}
+	static boost::string_ref decode (Oid type, const char * data, std::size_t length, boost::system::error_code & ec) {
+		if (type == oid::jsonb) {
+			//	The binary format of jsonb is a version
+			//	number followed by the text
+			if ((length == 0) || (data[0] != 1)) return decode_failed<boost::string_ref>(ec);
+			++data;
+			--length;
+		}
+		return boost::string_ref(data, length);
+	}
+};
+
+template <typename T>
+class is_optional : public std::false_type {	};
+template <typename T>
+class is_optional<boost::optional<T>> : public std::true_type {	};
+
+template <typename T>
+T decode_null (boost::system::error_code &, std::true_type) {
+	return T{};
+}
+template <typename T>
+T decode_null (boost::system::error_code & ec, std::false_type) {
+	ec = make_error_code(error::unexpected_null);
+	return T{};
+}
+template <typename T>
+T decode_null (boost::system::error_code & ec) {
+	return decode_null<T>(ec, is_optional<T>{});
+}
+
+}
+
+template <>
+class field_traits<std::int16_t> : public detail::integer_field_traits<std::int16_t> {	};
+template <>
+class field_traits<std::int32_t> : public detail::integer_field_traits<std::int32_t> {	};
+template <>
+class field_traits<std::int64_t> : public detail::integer_field_traits<std::int64_t> {	};
+
+template <>
+class field_traits<float> {
+public:
+	static bool accepts (Oid type) noexcept {
+		return type == oid::float4;
+	}
+	static float decode (Oid, const char * data, std::size_t length, boost::system::error_code & ec) {
+		if (length != 4) return detail::decode_failed<float>(ec);
+		return detail::load_value<float>(data);
+	}
+};
+
+template <>
+class field_traits<double> {
+public:
+	static bool accepts (Oid type) noexcept {
+		return (type == oid::float4) || (type == oid::float8) || (type == oid::numeric);
+	}
+	static double decode (Oid type, const char * data, std::size_t length, boost::system::error_code & ec) {
+		if (type == oid::numeric) return detail::numeric_to_double(data, length, ec);
+		switch (length) {
+		case 4:
+			return detail::load_value<float>(data);
+		case 8:
+			return detail::load_value<double>(data);
+		default:
+			break;
+		}
+		return detail::decode_failed<double>(ec);
+	}
+};
+
+template <>
+class field_traits<bool> {
+public:
+	static bool accepts (Oid type) noexcept {
+		return type == oid::boolean;
+	}
+	static bool decode (Oid, const char * data, std::size_t length, boost::system::error_code & ec) {
+		if (length != 1) return detail::decode_failed<bool>(ec);
+		return data[0] != 0;
+	}
+};
+
+template <>
+class field_traits<boost::asio::const_buffer> {
+public:
+	static bool accepts (Oid type) noexcept {
+		return type == oid::bytea;
+	}
+	static boost::asio::const_buffer decode (Oid, const char * data, std::size_t length, boost::system::error_code &) noexcept {
+		return boost::asio::const_buffer(data, length);
+	}
+};
+
+template <>
+class field_traits<boost::string_ref> : public detail::string_ref_field_traits {	};
+
+template <>
+class field_traits<std::string> {
+public:
+	static bool accepts (Oid type) noexcept {
+		return (type == oid::numeric) || detail::string_ref_field_traits::accepts(type);
+	}
+	static std::string decode (Oid type, const char * data, std::size_t length, boost::system::error_code & ec) {
+		if (type == oid::numeric) return detail::numeric_to_string(data, length, ec);
+		auto str = detail::string_ref_field_traits::decode(type, data, length, ec);
+		return std::string(str.data(), str.size());
+	}
+};
+
+template <>
+class field_traits<detail::timestamp_type> {
+public:
+	static bool accepts (Oid type) noexcept {
+		return (type == oid::timestamp) || (type == oid::timestamptz);
+	}
+	static detail::timestamp_type decode (Oid, const char * data, std::size_t length, boost::system::error_code & ec) {
+		if (length != 8) return detail::decode_failed<detail::timestamp_type>(ec);
+		detail::timestamp_type retr;
+		if (!detail::from_postgres_timestamp(detail::load_value<std::int64_t>(data), retr)) {
+			return detail::decode_failed<detail::timestamp_type>(ec);
+		}
+		return retr;
+	}
+};
+
+template <>
+class field_traits<boost::uuids::uuid> {
+public:
+	static bool accepts (Oid type) noexcept {
+		return type == oid::uuid;
+	}
+	static boost::uuids::uuid decode (Oid, const char * data, std::size_t length, boost::system::error_code & ec) {
+		boost::uuids::uuid retr{};
+		if (length != 16) return detail::decode_failed<boost::uuids::uuid>(ec);
+		std::memcpy(retr.data, data, 16);
+		return retr;
+	}
+};
+
+template <typename T>
+class field_traits<boost::optional<T>> {
+private:
+	using base = field_traits<T>;
+public:
+	static bool accepts (Oid type) noexcept {
+		return base::accepts(type);
+	}
+	static boost::optional<T> decode (Oid type, const char * data, std::size_t length, boost::system::error_code & ec) {
+		auto value = base::decode(type, data, length, ec);
+		if (ec) return boost::none;
+		return boost::optional<T>(std::move(value));
+	}
+};
+
+template <typename T>
+class field_traits<std::vector<T>> {
+private:
+	using element = field_traits<T>;
+	static std::vector<T> fail (boost::system::error_code & ec) {
+		return detail::decode_failed<std::vector<T>>(ec);
+	}
+public:
+	static bool accepts (Oid type) noexcept {
+		Oid e = detail::array_element_type(type);
+		return (e != 0) && element::accepts(e);
+	}
+	static std::vector<T> decode (Oid, const char * data, std::size_t length, boost::system::error_code & ec) {
+		//	Header: Dimensions, flags, and element type
+		//	followed by the size and lower bound of each
+		//	dimension
+		if (length < 12) return fail(ec);
+		auto dimensions = detail::load_value<std::int32_t>(data);
+		auto type = detail::load_value<Oid>(data + 8);
+		data += 12;
+		length -= 12;
+		std::vector<T> retr;
+		if (dimensions == 0) return retr;
+		if ((dimensions != 1) || (length < 8) || !element::accepts(type)) return fail(ec);
+		auto size = detail::load_value<std::int32_t>(data);
+		data += 8;
+		length -= 8;
+		if (size < 0) return fail(ec);
+		retr.reserve(std::size_t(size));
+		for (std::int32_t i = 0; i < size; ++i) {
+			if (length < 4) return fail(ec);
+			auto field_length = detail::load_value<std::int32_t>(data);
+			data += 4;
+			length -= 4;
+			if (field_length < 0) {
+				retr.push_back(detail::decode_null<T>(ec));
+			} else {
+				if (length < std::size_t(field_length)) return fail(ec);
+				retr.push_back(element::decode(type, data, std::size_t(field_length), ec));
+				data += field_length;
+				length -= std::size_t(field_length);
+			}
+			if (ec) return std::vector<T>{};
+		}
+		return retr;
+	}
+};
+
+/**
+ *	Checks that a column of a \ref result may be
+ *	decoded into a C++ type.
+ *
+ *	\tparam T
+ *		The C++ type. \ref field_traits must be
+ *		specialized for this type.
+ *
+ *	\param [in] r
+ *		The \ref result.
+ *	\param [in] column
+ *		The zero-relative index of the column.
+ *	\param [out] ec
+ *		A `boost::system::error_code` object which
+ *		shall be set to the result of the operation.
+ *		Note that if this object already represents
+ *		an error it will be cleared. If the column
+ *		does not exist, is not in binary format, or
+ *		has a type \em T does not accept this shall
+ *		be set to \ref error::type_mismatch.
+ */
+template <typename T>
+void check_column (const PGresult * r, int column, boost::system::error_code & ec) noexcept {
+	ec.clear();
+	if (
+		(column < 0) ||
+		(column >= PQnfields(r)) ||
+		(PQfformat(r, column) != 1) ||
+		!field_traits<T>::accepts(PQftype(r, column))
+	) ec = make_error_code(error::type_mismatch);
+}
+
+/**
+ *	Decodes a field of a \ref result whose column
+ *	has already been checked by \ref check_column.
+ *
+ *	\tparam T
+ *		The C++ type.
+ *
+ *	\param [in] r
+ *		The \ref result.
+ *	\param [in] row
+ *		The zero-relative index of the row.
+ *	\param [in] column
+ *		The zero-relative index of the column.
+ *	\param [out] ec
+ *		A `boost::system::error_code` object which
+ *		shall be set to the result of the operation.
+ *		Note that if this object already represents
+ *		an error it will be cleared. If the field is
+ *		null and \em T is not a `boost::optional` this
+ *		shall be set to \ref error::unexpected_null.
+ *
+ *	\return
+ *		The value. Note that views (i.e. `boost::string_ref`
+ *		and `boost::asio::const_buffer`) are only valid for
+ *		the lifetime of \em r.
+ */
+template <typename T>
+T decode_field (const PGresult * r, int row, int column, boost::system::error_code & ec) {
+	ec.clear();
+	if (PQgetisnull(r, row, column)) return detail::decode_null<T>(ec);
+	return field_traits<T>::decode(
+		PQftype(r, column),
+		PQgetvalue(r, row, column),
+		std::size_t(PQgetlength(r, row, column)),
+		ec
+	);
+}
+
+/**
+ *	Checks and decodes a field of a \ref result.
+ *
+ *	When decoding many rows prefer invoking
+ *	\ref check_column once and then \ref decode_field
+ *	for each row.
+ *
+ *	\tparam T
+ *		The C++ type.
+ *
+ *	\param [in] r
+ *		The \ref result.
+ *	\param [in] row
+ *		The zero-relative index of the row.
+ *	\param [in] column
+ *		The zero-relative index of the column.
+ *	\param [out] ec
+ *		A `boost::system::error_code` object which
+ *		shall be set to the result of the operation.
+ *		Note that if this object already represents
+ *		an error it will be cleared.
+ *
+ *	\return
+ *		The value.
+ */
+template <typename T>
+T get_field (const PGresult * r, int row, int column, boost::system::error_code & ec) {
+	check_column<T>(r, column, ec);
+	if (ec) return T{};
+	return decode_field<T>(r, row, column, ec);
+}
+
+/**
+ *	Checks and decodes a field of a \ref result.
+ *
+ *	\tparam T
+ *		The C++ type.
+ *
+ *	\param [in] r
+ *		The \ref result.
+ *	\param [in] row
+ *		The zero-relative index of the row.
+ *	\param [in] column
+ *		The zero-relative index of the column.
+ *
+ *	\return
+ *		The value.
+ */
+template <typename T>
+T get_field (const PGresult * r, int row, int column) {
+	boost::system::error_code ec;
+	auto retr = get_field<T>(r, row, column, ec);
+	if (ec) throw boost::system::system_error(ec);
+	return retr;
+}
+
+}
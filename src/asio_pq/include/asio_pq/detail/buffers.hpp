@@ -0,0 +1,44 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+#include <boost/version.hpp>
+#include <cstddef>
+#include <utility>
+
+namespace asio_pq {
+namespace detail {
+
+//	Older versions of Asio require buffer sequences
+//	to have begin and end members, newer versions
+//	also accept a single buffer
+#if BOOST_VERSION >= 106600
+using boost::asio::buffer_sequence_begin;
+using boost::asio::buffer_sequence_end;
+#else
+template <typename BufferSequence>
+auto buffer_sequence_begin (const BufferSequence & buffers) {
+	return buffers.begin();
+}
+template <typename BufferSequence>
+auto buffer_sequence_end (const BufferSequence & buffers) {
+	return buffers.end();
+}
+#endif
+
+template <typename BufferSequence>
+using buffer_sequence_iterator = decltype(buffer_sequence_begin(std::declval<const BufferSequence &>()));
+
+inline const char * buffer_data (boost::asio::const_buffer buffer) noexcept {
+	return boost::asio::buffer_cast<const char *>(buffer);
+}
+
+inline char * buffer_data (boost::asio::mutable_buffer buffer) noexcept {
+	return boost::asio::buffer_cast<char *>(buffer);
+}
+
+}
+}
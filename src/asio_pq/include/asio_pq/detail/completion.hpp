@@ -0,0 +1,113 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "executor.hpp"
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace asio_pq {
+namespace detail {
+
+//	Invokes a completion handler with arguments which
+//	were determined elsewhere (e.g. by an operation
+//	whose state is shared between several connections)
+//	through the handler's hooks and associated executor
+template <typename Handler, typename... Args>
+class completion_wrapper {
+private:
+	class state {
+	public:
+		template <typename... Ts>
+		state (const Handler &, Ts &&... args)
+			:	args(std::forward<Ts>(args)...)
+		{	}
+		std::tuple<Args...> args;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	template <std::size_t... Is>
+	void invoke (std::tuple<Args...> & args, std::index_sequence<Is...>) {
+		ptr_.invoke(std::move(std::get<Is>(args))...);
+	}
+public:
+	completion_wrapper () = delete;
+	completion_wrapper (const completion_wrapper &) = default;
+	completion_wrapper (completion_wrapper &&) = default;
+	completion_wrapper & operator = (const completion_wrapper &) = default;
+	completion_wrapper & operator = (completion_wrapper &&) = default;
+	template <typename DeducedHandler, typename... Ts>
+	explicit completion_wrapper (DeducedHandler && h, Ts &&... args)
+		:	ptr_(std::forward<DeducedHandler>(h), std::forward<Ts>(args)...)
+	{	}
+	void operator () () {
+		//	The state is destroyed before the handler
+		//	is invoked
+		auto args = std::move(ptr_->args);
+		invoke(args, std::index_sequence_for<Args...>{});
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, completion_wrapper * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (completion_wrapper * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, completion_wrapper * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, completion_wrapper * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+template <typename Handler, typename... Args>
+void post_completion (boost::asio::io_service & ios, Handler h, Args... args) {
+	ios.post(completion_wrapper<Handler, Args...>(std::move(h), std::move(args)...));
+}
+
+}
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename... Args, typename Executor>
+struct associated_executor<asio_pq::detail::completion_wrapper<Handler, Args...>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::completion_wrapper<Handler, Args...>, Handler, Executor>
+{	};
+
+template <typename Handler, typename... Args, typename Allocator>
+struct associated_allocator<asio_pq::detail::completion_wrapper<Handler, Args...>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::completion_wrapper<Handler, Args...>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,256 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "../connection.hpp"
+#include "../error.hpp"
+#include "../get_result.hpp"
+#include "../result.hpp"
+#include "executor.hpp"
+#include "flush.hpp"
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace asio_pq {
+namespace detail {
+
+using async_copy_signature = void (boost::system::error_code, result);
+
+//	Sends a COPY command and waits for the first
+//	result which must have a certain status
+template <typename Handler>
+class async_copy_begin_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, asio_pq::connection & conn, ExecStatusType status)
+			:	connection(conn),
+				status(status)
+		{	}
+		asio_pq::connection & connection;
+		ExecStatusType status;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+public:
+	async_copy_begin_op () = delete;
+	async_copy_begin_op (const async_copy_begin_op &) = default;
+	async_copy_begin_op (async_copy_begin_op &&) = default;
+	async_copy_begin_op & operator = (const async_copy_begin_op &) = default;
+	async_copy_begin_op & operator = (async_copy_begin_op &&) = default;
+	template <typename DeducedHandler>
+	async_copy_begin_op (connection & conn, ExecStatusType status, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn, status)
+	{	}
+	void begin (int sent) {
+		if (sent == 0) {
+			boost::asio::io_service & ios = ptr_->connection.get_io_service();
+			ios.post(std::move(*this));
+			return;
+		}
+		connection & conn = ptr_->connection;
+		async_get_result(conn, std::move(*this));
+	}
+	void operator () () {
+		ptr_.invoke(make_error_code(error::send_failed), result{});
+	}
+	void operator () (boost::system::error_code ec, result r) {
+		if (!ec && (PQresultStatus(r) != ptr_->status)) ec = make_error_code(error::copy_failed);
+		ptr_.invoke(ec, std::move(r));
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_copy_begin_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_copy_begin_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_copy_begin_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_copy_begin_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+//	Optionally calls PQputCopyEnd and then retrieves
+//	results until there are no more, completing with
+//	the last
+template <typename Handler>
+class async_copy_end_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, asio_pq::connection & conn, bool end, boost::optional<std::string> message)
+			:	connection(conn),
+				end(end),
+				message(std::move(message))
+		{	}
+		asio_pq::connection & connection;
+		bool end;
+		boost::optional<std::string> message;
+		asio_pq::result result;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void complete (boost::system::error_code ec) {
+		auto result = std::move(ptr_->result);
+		ptr_.invoke(ec, std::move(result));
+	}
+	void next () {
+		connection & conn = ptr_->connection;
+		async_get_result(conn, std::move(*this));
+	}
+public:
+	async_copy_end_op () = delete;
+	async_copy_end_op (const async_copy_end_op &) = default;
+	async_copy_end_op (async_copy_end_op &&) = default;
+	async_copy_end_op & operator = (const async_copy_end_op &) = default;
+	async_copy_end_op & operator = (async_copy_end_op &&) = default;
+	template <typename DeducedHandler>
+	async_copy_end_op (connection & conn, bool end, boost::optional<std::string> message, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn, end, std::move(message))
+	{	}
+	void begin () {
+		state & s = *ptr_;
+		if (!s.end) {
+			next();
+			return;
+		}
+		switch (PQputCopyEnd(s.connection, s.message ? s.message->c_str() : nullptr)) {
+		case -1:
+			s.connection.get_io_service().post(std::move(*this));
+			return;
+		case 0:{
+			connection & conn = s.connection;
+			async_flush(conn, std::move(*this));
+			return;
+		}
+		default:
+			break;
+		}
+		next();
+	}
+	void operator () () {
+		complete(make_error_code(error::copy_failed));
+	}
+	void operator () (boost::system::error_code ec) {
+		if (ec) {
+			complete(ec);
+			return;
+		}
+		begin();
+	}
+	void operator () (boost::system::error_code ec, result r) {
+		if (ec || !r) {
+			complete(ec);
+			return;
+		}
+		ptr_->result = std::move(r);
+		connection & conn = ptr_->connection;
+		while (PQisBusy(conn) == 0) {
+			result next(PQgetResult(conn));
+			if (!next) {
+				complete(ec);
+				return;
+			}
+			ptr_->result = std::move(next);
+		}
+		this->next();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_copy_end_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_copy_end_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_copy_end_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_copy_end_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_copy_begin_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_copy_begin_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_copy_begin_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_copy_begin_op<Handler>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_copy_end_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_copy_end_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_copy_end_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_copy_end_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,377 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "../connection.hpp"
+#include "../error.hpp"
+#include "executor.hpp"
+#include "wrapper.hpp"
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/error.hpp>
+#ifdef ASIO_PQ_HAS_EXECUTORS
+#include <boost/asio/dispatch.hpp>
+#endif
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/system/error_code.hpp>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace asio_pq {
+namespace detail {
+
+using deadline_type = std::chrono::steady_clock::time_point;
+
+//	Cancels the pending operations on a connection
+//	(if any)
+void abandon (connection & conn) noexcept;
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+using deadline_strand = boost::asio::strand<boost::asio::io_service::executor_type>;
+#else
+using deadline_strand = boost::asio::io_service::strand;
+#endif
+
+inline deadline_strand make_deadline_strand (boost::asio::io_service & ios) {
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	return deadline_strand(ios.get_executor());
+	#else
+	return deadline_strand(ios);
+	#endif
+}
+
+//	Memory for the dispatch is obtained via the
+//	function's associated allocator (or hooks)
+template <typename Function>
+void deadline_dispatch (deadline_strand & strand, Function f) {
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	auto a = boost::asio::get_associated_allocator(f);
+	strand.dispatch(std::move(f), a);
+	#else
+	strand.dispatch(std::move(f));
+	#endif
+}
+
+template <typename Handler>
+class deadline_start_wrapper : public wrapper<Handler> {
+private:
+	using base = wrapper<Handler>;
+public:
+	using base::base;
+	void operator () () {
+		base::handler().start();
+	}
+};
+
+//	Invokes a function via the hooks of the handler
+//	whose hook dispatched it through the strand (i.e.
+//	without dispatching it through the strand again)
+template <typename Function, typename Handler>
+class deadline_dispatch_wrapper : public wrapper<Handler> {
+private:
+	using base = wrapper<Handler>;
+	Function f_;
+public:
+	deadline_dispatch_wrapper (Function f, Handler h)
+		:	base(std::move(h)),
+			f_(std::move(f))
+	{	}
+	void operator () () {
+		f_();
+	}
+};
+
+template <typename Handler>
+class deadline_strand_wrapper : public wrapper<Handler> {
+private:
+	using base = wrapper<Handler>;
+public:
+	using base::base;
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, deadline_strand_wrapper * self) {
+		assert(self);
+		Handler & h = self->handler();
+		deadline_dispatch(
+			h.strand(),
+			deadline_dispatch_wrapper<Function, Handler>(std::move(function), h)
+		);
+	}
+};
+
+template <typename Handler>
+class deadline_complete_wrapper : public deadline_strand_wrapper<Handler> {
+private:
+	using base = deadline_strand_wrapper<Handler>;
+public:
+	using base::base;
+	template <typename... Args>
+	void operator () (boost::system::error_code ec, Args &&... args) {
+		base::handler().complete(ec, std::forward<Args>(args)...);
+	}
+};
+
+template <typename Handler>
+class deadline_expired_wrapper : public deadline_strand_wrapper<Handler> {
+private:
+	using base = deadline_strand_wrapper<Handler>;
+public:
+	using base::base;
+	void operator () () {
+		base::handler().expired();
+	}
+};
+
+template <typename Handler>
+class deadline_finish_wrapper : public wrapper<Handler> {
+private:
+	using base = wrapper<Handler>;
+public:
+	using base::base;
+	void operator () () {
+		base::handler().finish();
+	}
+};
+
+template <typename Handler>
+class deadline_expire_wrapper : public deadline_strand_wrapper<Handler> {
+private:
+	using base = deadline_strand_wrapper<Handler>;
+public:
+	using base::base;
+	void operator () (boost::system::error_code ec) {
+		base::handler().expire(ec);
+	}
+};
+
+//	Races an operation against a timer, the operation's
+//	intermediate handlers and the timer's handler are all
+//	dispatched through a strand (by way of their
+//	asio_handler_invoke hooks so that the operation may
+//	pass move only values to its completion handler)
+//	so that whichever happens first may act on the
+//	connection.
+//
+//	Expire is invoked with the connection and a handler
+//	which it must invoke without arguments once it has
+//	acted on the connection (e.g. once a CancelRequest
+//	has been sent without blocking), the operation does
+//	not complete before then.
+template <typename Handler, typename Initiate, typename Expire, typename... Args>
+class deadline_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (
+			const Handler &,
+			asio_pq::connection & conn,
+			deadline_type deadline,
+			Initiate initiate,
+			Expire expire
+		)	:	strand(make_deadline_strand(conn.get_io_service())),
+				timer(conn.get_io_service()),
+				connection(conn),
+				deadline(deadline),
+				initiate(std::move(initiate)),
+				expire(std::move(expire)),
+				pending(2),
+				expired(false),
+				completed(false)
+		{	}
+		deadline_strand strand;
+		boost::asio::steady_timer timer;
+		asio_pq::connection & connection;
+		deadline_type deadline;
+		Initiate initiate;
+		Expire expire;
+		//	The operation, the timer, and (once the
+		//	deadline passes) the expiry
+		int pending;
+		bool expired;
+		bool completed;
+		boost::system::error_code error_code;
+		std::tuple<Args...> args;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	template <std::size_t... Is>
+	void invoke (boost::system::error_code ec, std::tuple<Args...> & args, std::index_sequence<Is...>) {
+		ptr_.invoke(ec, std::move(std::get<Is>(args))...);
+	}
+	void upcall () {
+		if (--ptr_->pending != 0) return;
+		#ifdef ASIO_PQ_HAS_EXECUTORS
+		//	The strand is internal to this operation, the
+		//	completion handler is invoked on its associated
+		//	executor (which runs it immediately unless it is
+		//	e.g. a strand the caller is not running in)
+		auto ex = boost::asio::get_associated_executor(ptr_.handler(), ptr_->connection.get_executor());
+		boost::asio::dispatch(
+			ex,
+			deadline_finish_wrapper<deadline_op>(std::move(*this))
+		);
+		#else
+		finish();
+		#endif
+	}
+public:
+	deadline_op () = delete;
+	deadline_op (const deadline_op &) = default;
+	deadline_op (deadline_op &&) = default;
+	deadline_op & operator = (const deadline_op &) = default;
+	deadline_op & operator = (deadline_op &&) = default;
+	deadline_op (
+		Handler h,
+		connection & conn,
+		deadline_type deadline,
+		Initiate initiate,
+		Expire expire
+	)	:	ptr_(std::move(h), conn, deadline, std::move(initiate), std::move(expire))
+	{	}
+	void begin () {
+		//	The timer must not expire on another thread
+		//	while the operation is being initiated
+		state & s = *ptr_;
+		deadline_dispatch(s.strand, deadline_start_wrapper<deadline_op>(std::move(*this)));
+	}
+	deadline_strand & strand () const noexcept {
+		return ptr_->strand;
+	}
+	void start () {
+		state & s = *ptr_;
+		s.initiate(
+			s.connection,
+			deadline_complete_wrapper<deadline_op>(*this)
+		);
+		s.timer.expires_at(s.deadline);
+		s.timer.async_wait(deadline_expire_wrapper<deadline_op>(std::move(*this)));
+	}
+	template <typename... Ts>
+	void complete (boost::system::error_code ec, Ts &&... args) {
+		state & s = *ptr_;
+		assert(!s.completed);
+		s.completed = true;
+		s.error_code = ec;
+		s.args = std::tuple<Args...>(std::forward<Ts>(args)...);
+		if (!s.expired) {
+			boost::system::error_code ignored;
+			s.timer.cancel(ignored);
+		}
+		upcall();
+	}
+	void finish () {
+		auto ec = ptr_->expired ? make_error_code(error::timed_out) : ptr_->error_code;
+		auto args = std::move(ptr_->args);
+		invoke(ec, args, std::index_sequence_for<Args...>{});
+	}
+	void expire (boost::system::error_code ec) {
+		state & s = *ptr_;
+		if (!ec && !s.completed) {
+			s.expired = true;
+			++s.pending;
+			s.expire(s.connection, deadline_expired_wrapper<deadline_op>(*this));
+		}
+		upcall();
+	}
+	void expired () {
+		upcall();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, deadline_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (deadline_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, deadline_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, deadline_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+//	Args are the parameters the operation's completion
+//	handler receives after the boost::system::error_code
+template <typename... Args, typename Handler, typename Initiate, typename Expire>
+void async_deadline (
+	connection & conn,
+	deadline_type deadline,
+	Initiate initiate,
+	Expire expire,
+	Handler h
+) {
+	deadline_op<Handler, Initiate, Expire, Args...> op(
+		std::move(h),
+		conn,
+		deadline,
+		std::move(initiate),
+		std::move(expire)
+	);
+	op.begin();
+}
+
+}
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Initiate, typename Expire, typename... Args, typename Executor>
+struct associated_executor<asio_pq::detail::deadline_op<Handler, Initiate, Expire, Args...>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::deadline_op<Handler, Initiate, Expire, Args...>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Initiate, typename Expire, typename... Args, typename Allocator>
+struct associated_allocator<asio_pq::detail::deadline_op<Handler, Initiate, Expire, Args...>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::deadline_op<Handler, Initiate, Expire, Args...>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::deadline_start_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::deadline_start_wrapper<Handler>, Handler, Allocator>
+{	};
+
+template <typename Function, typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::deadline_dispatch_wrapper<Function, Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::deadline_dispatch_wrapper<Function, Handler>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::deadline_finish_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::deadline_finish_wrapper<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace asio_pq {
+namespace detail {
+
+//	PostgreSQL's binary formats are big endian
+//	regardless of the platform
+
+template <typename T>
+void store_big_endian (T value, char * out) noexcept {
+	static_assert(std::is_unsigned<T>::value, "Only unsigned integers may be stored");
+	for (std::size_t i = sizeof(T); i != 0; --i) {
+		out[i - 1] = char(static_cast<unsigned char>(value & 0xFFU));
+		value = T(value >> 8U);
+	}
+}
+
+template <typename T>
+T load_big_endian (const char * in) noexcept {
+	static_assert(std::is_unsigned<T>::value, "Only unsigned integers may be loaded");
+	T retr = 0;
+	for (std::size_t i = 0; i < sizeof(T); ++i) {
+		retr = T(retr << 8U) | T(static_cast<unsigned char>(in[i]));
+	}
+	return retr;
+}
+
+template <std::size_t Size>
+class unsigned_of_size;
+template <>
+class unsigned_of_size<1> {
+public:
+	using type = std::uint8_t;
+};
+template <>
+class unsigned_of_size<2> {
+public:
+	using type = std::uint16_t;
+};
+template <>
+class unsigned_of_size<4> {
+public:
+	using type = std::uint32_t;
+};
+template <>
+class unsigned_of_size<8> {
+public:
+	using type = std::uint64_t;
+};
+
+//	Stores any integer or floating point type by
+//	reinterpreting its bytes as an unsigned integer
+//	of the same size
+template <typename T>
+void store_value (T value, char * out) noexcept {
+	using unsigned_type = typename unsigned_of_size<sizeof(T)>::type;
+	unsigned_type u;
+	std::memcpy(&u, &value, sizeof(T));
+	store_big_endian(u, out);
+}
+
+template <typename T>
+T load_value (const char * in) noexcept {
+	using unsigned_type = typename unsigned_of_size<sizeof(T)>::type;
+	auto u = load_big_endian<unsigned_type>(in);
+	T retr;
+	std::memcpy(&retr, &u, sizeof(T));
+	return retr;
+}
+
+}
+}
@@ -0,0 +1,55 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <boost/version.hpp>
+
+#if BOOST_VERSION >= 106600
+#define ASIO_PQ_HAS_EXECUTORS
+#endif
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+namespace asio_pq {
+namespace detail {
+
+//	Operations and the wrappers of their intermediate
+//	handlers forward the candidate supplied by the caller
+//	when their associated executor and allocator are
+//	retrieved (as Boost.Asio's own composed operations
+//	do) rather than providing nested types so that if
+//	the completion handler has neither the intermediate
+//	handlers are invoked directly by the io_service (and
+//	through the handler's asio_handler_invoke hook)
+template <typename Wrapper, typename Handler, typename Executor>
+class forward_associated_executor
+#if BOOST_VERSION >= 107400
+	:	public boost::asio::detail::associated_executor_forwarding_base<Handler, Executor>
+#endif
+{
+public:
+	using type = boost::asio::associated_executor_t<Handler, Executor>;
+	static type get (const Wrapper & w, const Executor & ex = Executor()) noexcept {
+		return boost::asio::get_associated_executor(w.handler(), ex);
+	}
+};
+
+template <typename Wrapper, typename Handler, typename Allocator>
+class forward_associated_allocator {
+public:
+	using type = boost::asio::associated_allocator_t<Handler, Allocator>;
+	static type get (const Wrapper & w, const Allocator & a = Allocator()) noexcept {
+		return boost::asio::get_associated_allocator(w.handler(), a);
+	}
+};
+
+}
+}
+
+#endif
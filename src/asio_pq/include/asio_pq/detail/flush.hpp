@@ -0,0 +1,297 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "../connection.hpp"
+#include "../error.hpp"
+#include "executor.hpp"
+#include "op.hpp"
+#include "wrapper.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <utility>
+
+namespace asio_pq {
+namespace detail {
+
+using async_flush_signature = void (boost::system::error_code);
+
+template <typename Handler>
+class async_flush_complete_wrapper : public wrapper<Handler> {
+private:
+	using base = wrapper<Handler>;
+	boost::system::error_code ec_;
+public:
+	async_flush_complete_wrapper (Handler h, boost::system::error_code ec)
+		:	base(std::move(h)),
+			ec_(ec)
+	{	}
+	void operator () () {
+		base::handler()(ec_);
+	}
+};
+
+//	Calls PQflush until all output libpq has queued
+//	has been sent, consuming input as it arrives so
+//	that the server cannot block writing to us while
+//	we block writing to it.
+//
+//	As in async_get_result_op the read and write waits
+//	are not serialized through a strand: each completion
+//	publishes its readiness to an atomic mask and
+//	whichever completion finds the operation idle
+//	services every readiness published.
+template <typename Handler>
+class async_flush_op {
+private:
+	enum : unsigned {
+		readable = 1,
+		writable = 2,
+		running = 4
+	};
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		explicit state (const Handler &, asio_pq::connection & conn)
+			:	connection(conn),
+				read(false),
+				write(false),
+				events(running)
+		{	}
+		asio_pq::connection & connection;
+		bool read;
+		bool write;
+		boost::optional<boost::system::error_code> error_code;
+		//	Readiness published by completed waits together
+		//	with whether some completion is servicing the
+		//	operation, only the servicing completion may
+		//	access the other members
+		std::atomic<unsigned> events;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void fail (boost::system::error_code ec) {
+		if (!ptr_->error_code) ptr_->error_code = ec;
+	}
+	void read () {
+		if (ptr_->read) return;
+		ptr_->read = true;
+		ptr_->connection.socket([&] (auto & socket) {
+			detail::async_readable(
+				socket,
+				detail::make_read_wrapper(*this)
+			);
+		});
+	}
+	void write () {
+		if (ptr_->write) return;
+		ptr_->write = true;
+		ptr_->connection.socket([&] (auto & socket) {
+			detail::async_writable(
+				socket,
+				detail::make_write_wrapper(*this)
+			);
+		});
+	}
+	//	Returns true if output remains to be flushed in
+	//	which case the waits have been armed
+	bool flush () {
+		switch (PQflush(ptr_->connection)) {
+		case -1:
+			fail(make_error_code(error::flush_failed));
+			return false;
+		case 0:
+			ptr_->error_code = boost::system::error_code{};
+			return false;
+		default:
+			break;
+		}
+		write();
+		read();
+		return true;
+	}
+	bool consume () {
+		if (PQconsumeInput(ptr_->connection) == 0) {
+			fail(make_error_code(error::consume_failed));
+			return false;
+		}
+		return true;
+	}
+	//	Returns true if the operation completed in which
+	//	case this object no longer refers to it
+	bool service (unsigned events) {
+		state & s = *ptr_;
+		if (events & readable) s.read = false;
+		if (events & writable) s.write = false;
+		if (!s.error_code) {
+			if (!s.connection.has_socket()) {
+				fail(make_error_code(boost::asio::error::operation_aborted));
+			} else if ((!(events & readable) || consume()) && flush()) {
+				return false;
+			}
+		}
+		if (s.read || s.write) {
+			//	The outstanding wait will complete with
+			//	operation_aborted and complete the operation
+			if (s.connection.has_socket()) s.connection.socket([&] (auto & socket) {	socket.cancel();	});
+			return false;
+		}
+		auto ec = *s.error_code;
+		ptr_.invoke(ec);
+		return true;
+	}
+	void idle () {
+		for (;;) {
+			unsigned expected = running;
+			if (ptr_->events.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) return;
+			unsigned events = ptr_->events.exchange(running, std::memory_order_acq_rel);
+			if (service(events & ~running)) return;
+		}
+	}
+	void signal (unsigned event) {
+		unsigned prev = ptr_->events.fetch_or(event | running, std::memory_order_acq_rel);
+		//	The completion which is servicing the operation
+		//	will observe this readiness before it idles
+		if (prev & running) return;
+		unsigned events = ptr_->events.exchange(running, std::memory_order_acq_rel);
+		if (service(events & ~running)) return;
+		idle();
+	}
+public:
+	async_flush_op () = delete;
+	async_flush_op (const async_flush_op &) = default;
+	async_flush_op (async_flush_op &&) = default;
+	async_flush_op & operator = (const async_flush_op &) = default;
+	async_flush_op & operator = (async_flush_op &&) = default;
+	template <typename DeducedHandler>
+	async_flush_op (connection & conn, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn)
+	{	}
+	void begin () {
+		assert(!ptr_->read);
+		assert(!ptr_->write);
+		assert(!ptr_->error_code);
+		//	The operation is created running so waits
+		//	which complete before both are armed cannot
+		//	service it concurrently
+		write();
+		read();
+		idle();
+	}
+	void read (boost::system::error_code) {
+		signal(readable);
+	}
+	void write (boost::system::error_code) {
+		signal(writable);
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_flush_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_flush_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_flush_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_flush_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+//	Completes once PQflush returns zero, immediately
+//	(via the io_service) if that is already the case
+template <typename CompletionToken>
+auto async_flush (
+	connection & conn,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, async_flush_signature> init(token);
+	auto ec = conn.duplicate_socket();
+	if (!ec) {
+		int flush = PQflush(conn);
+		if (flush == 1) {
+			async_flush_op<
+				beast::handler_type<CompletionToken, async_flush_signature>
+			> op(
+				conn,
+				std::move(init.completion_handler)
+			);
+			op.begin();
+			return init.result.get();
+		}
+		if (flush == -1) ec = make_error_code(error::flush_failed);
+	}
+	conn.get_io_service().post(
+		async_flush_complete_wrapper<
+			beast::handler_type<CompletionToken, async_flush_signature>
+		>(
+			std::move(init.completion_handler),
+			ec
+		)
+	);
+	return init.result.get();
+}
+
+}
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_flush_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_flush_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_flush_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_flush_op<Handler>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_flush_complete_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_flush_complete_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_flush_complete_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_flush_complete_wrapper<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,282 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "executor.hpp"
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/optional.hpp>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace asio_pq {
+namespace detail {
+
+//	Caches the memory for a small number of handler
+//	allocations so that once the blocks have grown to
+//	fit the operations which are repeatedly performed
+//	on a connection they never need to be allocated
+//	again.
+//
+//	A block which is handed out belongs to the caller
+//	and is only cached again when it is deallocated.
+//	Since a cached block is an ordinary block from the
+//	upstream (i.e. the heap) it does not matter if a
+//	block is released via some other means, nor if a
+//	block obtained elsewhere is released here. This
+//	happens when hooks are mismatched: The rewrapped
+//	handler of io_service::strand::wrap allocates via
+//	the hooks of the handler it wraps but deallocates
+//	via the hooks of the strand's inner handler.
+//
+//	Allocations may be released on any thread (e.g. a
+//	read and a write wait may complete concurrently)
+//	so each slot is claimed atomically.
+class handler_memory {
+public:
+	//	The source of the blocks which are cached. Since
+	//	blocks may be released via the default hooks (see
+	//	above) they must be obtained from ::operator new,
+	//	the upstream is a means of observing the blocks
+	//	which could not be served from the cache.
+	class upstream {
+	protected:
+		~upstream () = default;
+	public:
+		virtual void * allocate (std::size_t size) = 0;
+		virtual void deallocate (void * ptr, std::size_t size) noexcept = 0;
+	};
+private:
+	class slot {
+	public:
+		slot () noexcept
+			:	busy(false),
+				ptr(nullptr),
+				size(0)
+		{	}
+		std::atomic<bool> busy;
+		void * ptr;
+		std::size_t size;
+	};
+	static constexpr std::size_t slots = 8;
+	std::array<slot, slots> slots_;
+	upstream * upstream_;
+	void destroy () noexcept;
+	void move (handler_memory & other) noexcept;
+public:
+	handler_memory () noexcept;
+	explicit handler_memory (upstream & u) noexcept;
+	handler_memory (const handler_memory &) = delete;
+	handler_memory & operator = (const handler_memory &) = delete;
+	handler_memory (handler_memory &&) noexcept;
+	handler_memory & operator = (handler_memory &&) noexcept;
+	~handler_memory () noexcept;
+	void * allocate (std::size_t size);
+	void deallocate (void * ptr, std::size_t size) noexcept;
+};
+
+//	A standard allocator which obtains memory from an
+//	object with allocate and deallocate members (i.e.
+//	a handler_memory) so that it may be supplied as
+//	the associated allocator of a handler
+template <typename T, typename Memory>
+class memory_allocator {
+private:
+	template <typename, typename>
+	friend class memory_allocator;
+	Memory * memory_;
+public:
+	using value_type = T;
+	explicit memory_allocator (Memory & memory) noexcept
+		:	memory_(&memory)
+	{	}
+	template <typename U>
+	memory_allocator (const memory_allocator<U, Memory> & other) noexcept
+		:	memory_(other.memory_)
+	{	}
+	T * allocate (std::size_t n) {
+		return static_cast<T *>(memory_->allocate(n * sizeof(T)));
+	}
+	void deallocate (T * ptr, std::size_t n) noexcept {
+		memory_->deallocate(static_cast<void *>(ptr), n * sizeof(T));
+	}
+	template <typename U>
+	bool operator == (const memory_allocator<U, Memory> & rhs) const noexcept {
+		return memory_ == rhs.memory_;
+	}
+	template <typename U>
+	bool operator != (const memory_allocator<U, Memory> & rhs) const noexcept {
+		return memory_ != rhs.memory_;
+	}
+};
+
+//	Wraps a completion handler so that all memory
+//	allocated on its behalf comes from a handler_memory
+template <typename Handler>
+class recycling_handler {
+private:
+	Handler h_;
+	handler_memory * memory_;
+public:
+	recycling_handler () = delete;
+	recycling_handler (const recycling_handler &) = default;
+	recycling_handler (recycling_handler &&) = default;
+	recycling_handler & operator = (const recycling_handler &) = default;
+	recycling_handler & operator = (recycling_handler &&) = default;
+	recycling_handler (Handler h, handler_memory & memory) noexcept(
+		std::is_nothrow_move_constructible<Handler>::value
+	)	:	h_(std::move(h)),
+			memory_(&memory)
+	{	}
+	template <typename... Args>
+	void operator () (Args &&... args) {
+		h_(std::forward<Args>(args)...);
+	}
+	const Handler & handler () const noexcept {
+		return h_;
+	}
+	//	Allocations made through the associated allocator
+	//	come from the same memory as those made through
+	//	the hooks
+	using allocator_type = memory_allocator<void, handler_memory>;
+	allocator_type get_allocator () const noexcept {
+		return allocator_type(*memory_);
+	}
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, recycling_handler * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->h_));
+	}
+	friend bool asio_handler_is_continuation (recycling_handler * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->h_));
+	}
+	friend void * asio_handler_allocate (std::size_t num, recycling_handler * self) {
+		assert(self);
+		return self->memory_->allocate(num);
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, recycling_handler * self) {
+		assert(self);
+		self->memory_->deallocate(ptr, num);
+	}
+};
+
+//	Like beast::handler_ptr except that the handler,
+//	the reference count, and the state are a single
+//	block allocated through the hooks of the handler
+//	and that block is freed before the handler is
+//	invoked so that an operation initiated from within
+//	the handler may reuse it
+template <typename T, typename Handler>
+class recycling_ptr {
+private:
+	class block {
+	public:
+		template <typename DeducedHandler>
+		explicit block (DeducedHandler && h)
+			:	count(1),
+				handler(std::forward<DeducedHandler>(h))
+		{	}
+		std::atomic<std::size_t> count;
+		Handler handler;
+		boost::optional<T> t;
+	};
+	block * p_;
+	static void release (block * p) noexcept {
+		if (--p->count != 0) return;
+		Handler h(std::move(p->handler));
+		p->~block();
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(static_cast<void *>(p), sizeof(block), std::addressof(h));
+	}
+public:
+	recycling_ptr () = delete;
+	recycling_ptr (const recycling_ptr & other) noexcept
+		:	p_(other.p_)
+	{
+		if (p_) ++p_->count;
+	}
+	recycling_ptr (recycling_ptr && other) noexcept
+		:	p_(other.p_)
+	{
+		other.p_ = nullptr;
+	}
+	recycling_ptr & operator = (const recycling_ptr &) = delete;
+	recycling_ptr & operator = (recycling_ptr &&) = delete;
+	template <typename DeducedHandler, typename... Args>
+	explicit recycling_ptr (DeducedHandler && h, Args &&... args) {
+		Handler tmp(std::forward<DeducedHandler>(h));
+		using boost::asio::asio_handler_allocate;
+		void * ptr = asio_handler_allocate(sizeof(block), std::addressof(tmp));
+		p_ = new (ptr) block(std::move(tmp));
+		try {
+			p_->t.emplace(p_->handler, std::forward<Args>(args)...);
+		} catch (...) {
+			release(p_);
+			throw;
+		}
+	}
+	~recycling_ptr () noexcept {
+		if (p_) release(p_);
+	}
+	Handler & handler () const noexcept {
+		assert(p_);
+		return p_->handler;
+	}
+	T * get () const noexcept {
+		assert(p_);
+		return p_->t.get_ptr();
+	}
+	T * operator -> () const noexcept {
+		return get();
+	}
+	T & operator * () const noexcept {
+		return *get();
+	}
+	template <typename... Args>
+	void invoke (Args &&... args) {
+		assert(p_);
+		block * p = p_;
+		p_ = nullptr;
+		p->t = boost::none;
+		Handler h(std::move(p->handler));
+		release(p);
+		h(std::forward<Args>(args)...);
+	}
+};
+
+template <typename Handler>
+recycling_handler<Handler> make_recycling_handler (Handler h, handler_memory & memory) noexcept(
+	std::is_nothrow_move_constructible<Handler>::value
+) {
+	return recycling_handler<Handler>(std::move(h), memory);
+}
+
+}
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::recycling_handler<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::recycling_handler<Handler>, Handler, Executor>
+{	};
+
+}
+}
+
+#endif
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "executor.hpp"
 #include "wrapper.hpp"
 #include <beast/core/async_result.hpp>
 #include <boost/asio/buffer.hpp>
@@ -68,3 +69,23 @@ beast::async_return_type<CompletionToken, async_writable_signature> async_writab
 
 }
 }
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::readable_writable_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::readable_writable_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::readable_writable_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::readable_writable_wrapper<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,293 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "../connection.hpp"
+#include "deadline.hpp"
+#include "executor.hpp"
+#include "op.hpp"
+#include "socket.hpp"
+#include "wrapper.hpp"
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#if defined(LIBPQ_HAS_ASYNC_CANCEL) && defined(ASIO_PQ_HAS_BORROWED_DESCRIPTOR)
+#define ASIO_PQ_HAS_ASYNC_CANCEL
+#endif
+
+namespace asio_pq {
+namespace detail {
+
+//	The parameter is true if the CancelRequest was
+//	delivered (which does not mean the server will
+//	cancel the command)
+using async_send_cancel_signature = void (bool);
+
+//	Sends a CancelRequest for the command in progress
+//	on a connection without blocking the thread running
+//	the io_service: Via PQcancelPoll when libpq provides
+//	it and otherwise via PQcancel on a thread of its own
+//	(PQcancel blocks and the key it requires is not
+//	exposed).
+//
+//	The connection is only used while the operation is
+//	initiated, the io_service must outlive it.
+template <typename Handler>
+class async_send_cancel_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, boost::asio::io_service & ios)
+			:	io_service(ios),
+				waited(false),
+				sent(false)
+				#ifdef ASIO_PQ_HAS_ASYNC_CANCEL
+				, cancel(nullptr)
+				#endif
+		{	}
+		#ifdef ASIO_PQ_HAS_ASYNC_CANCEL
+		~state () noexcept {
+			//	The socket belongs to libpq
+			socket = boost::none;
+			if (cancel) PQcancelFinish(cancel);
+		}
+		#endif
+		boost::asio::io_service & io_service;
+		bool waited;
+		bool sent;
+		#ifdef ASIO_PQ_HAS_ASYNC_CANCEL
+		PGcancelConn * cancel;
+		boost::optional<borrowed_descriptor> socket;
+		#endif
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void complete (bool sent) {
+		//	Avoid invoking the handler from within
+		//	the initiating function
+		if (!ptr_->waited) {
+			ptr_->sent = sent;
+			boost::asio::io_service & ios = ptr_->io_service;
+			ios.post(std::move(*this));
+			return;
+		}
+		ptr_.invoke(sent);
+	}
+	#ifdef ASIO_PQ_HAS_ASYNC_CANCEL
+	void wait (bool write) {
+		state & s = *ptr_;
+		//	libpq may replace the socket between calls to
+		//	PQcancelPoll (and a new socket may reuse the
+		//	old descriptor) so it is registered anew each
+		//	time
+		s.socket = boost::none;
+		s.socket.emplace(s.io_service);
+		boost::system::error_code ec;
+		s.socket->assign(PQcancelSocket(s.cancel), ec);
+		if (ec) {
+			complete(false);
+			return;
+		}
+		s.waited = true;
+		if (write) {
+			detail::async_writable(*s.socket, detail::make_write_wrapper(std::move(*this)));
+			return;
+		}
+		detail::async_readable(*s.socket, detail::make_read_wrapper(std::move(*this)));
+	}
+	void poll () {
+		switch (PQcancelPoll(ptr_->cancel)) {
+		case PGRES_POLLING_OK:
+			complete(true);
+			break;
+		case PGRES_POLLING_READING:
+			wait(false);
+			break;
+		case PGRES_POLLING_WRITING:
+			wait(true);
+			break;
+		case PGRES_POLLING_FAILED:
+		default:
+			complete(false);
+			break;
+		}
+	}
+	#endif
+public:
+	async_send_cancel_op () = delete;
+	async_send_cancel_op (const async_send_cancel_op &) = default;
+	async_send_cancel_op (async_send_cancel_op &&) = default;
+	async_send_cancel_op & operator = (const async_send_cancel_op &) = default;
+	async_send_cancel_op & operator = (async_send_cancel_op &&) = default;
+	template <typename DeducedHandler>
+	async_send_cancel_op (connection & conn, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn.get_io_service())
+	{	}
+	void begin (connection & conn) {
+		#ifdef ASIO_PQ_HAS_ASYNC_CANCEL
+		state & s = *ptr_;
+		s.cancel = PQcancelCreate(conn);
+		if (
+			!s.cancel ||
+			(PQcancelStatus(s.cancel) == CONNECTION_BAD) ||
+			(PQcancelStart(s.cancel) == 0)
+		) {
+			complete(false);
+			return;
+		}
+		//	Behave as if PQcancelPoll last returned
+		//	PGRES_POLLING_WRITING
+		wait(true);
+		#else
+		PGcancel * cancel = PQgetCancel(conn);
+		if (!cancel) {
+			complete(false);
+			return;
+		}
+		state & s = *ptr_;
+		s.waited = true;
+		boost::asio::io_service & ios = s.io_service;
+		boost::asio::io_service::work work(ios);
+		std::thread t([cancel, &ios, work, op = std::move(*this)] () mutable {
+			char errbuf [256];
+			op.ptr_->sent = PQcancel(cancel, errbuf, sizeof(errbuf)) == 1;
+			PQfreeCancel(cancel);
+			ios.post(std::move(op));
+		});
+		t.detach();
+		#endif
+	}
+	#ifdef ASIO_PQ_HAS_ASYNC_CANCEL
+	void read (boost::system::error_code ec) {
+		if (ec) {
+			complete(false);
+			return;
+		}
+		poll();
+	}
+	void write (boost::system::error_code ec) {
+		if (ec) {
+			complete(false);
+			return;
+		}
+		poll();
+	}
+	#endif
+	void operator () () {
+		bool sent = ptr_->sent;
+		ptr_.invoke(sent);
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_send_cancel_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_send_cancel_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_send_cancel_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_send_cancel_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+template <typename Handler>
+void async_send_cancel (connection & conn, Handler h) {
+	async_send_cancel_op<Handler> op(conn, std::move(h));
+	op.begin(conn);
+}
+
+//	Cancels the pending operations on the connection
+//	if the CancelRequest could not be delivered so that
+//	they complete regardless
+template <typename Handler>
+class cancel_command_wrapper : public wrapper<Handler> {
+private:
+	using base = wrapper<Handler>;
+	connection * conn_;
+public:
+	cancel_command_wrapper (Handler h, connection & conn)
+		:	base(std::move(h)),
+			conn_(&conn)
+	{	}
+	void operator () (bool sent) {
+		if (!sent) abandon(*conn_);
+		base::handler()();
+	}
+};
+
+//	Asks the server to abandon the command in progress
+//	on a connection so that pending operations complete
+//	with the server's error and the connection remains
+//	usable, if the request cannot be delivered the
+//	pending operations are cancelled instead. The handler
+//	is invoked without arguments once either has happened.
+template <typename Handler>
+void async_cancel_command (connection & conn, Handler h) {
+	async_send_cancel(conn, cancel_command_wrapper<Handler>(std::move(h), conn));
+}
+
+}
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_send_cancel_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_send_cancel_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_send_cancel_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_send_cancel_op<Handler>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::cancel_command_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::cancel_command_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::cancel_command_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::cancel_command_wrapper<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
 #include <boost/system/error_code.hpp>
 #include <libpq-fe.h>
 #include <mpark/variant.hpp>
@@ -16,9 +17,56 @@
 #define ASIO_PQ_HAS_LOCAL_SOCKETS
 #endif
 
+#if !defined(_WIN32) && defined(BOOST_ASIO_HAS_POSIX_STREAM_DESCRIPTOR)
+#define ASIO_PQ_HAS_BORROWED_DESCRIPTOR
+#endif
+
 namespace asio_pq {
 namespace detail {
 
+#ifdef ASIO_PQ_HAS_BORROWED_DESCRIPTOR
+
+//	Registers the socket libpq owns with the reactor
+//	without duplicating it and releases it (rather than
+//	closing it) when destroyed. Since only readiness is
+//	ever awaited the protocol and address family of the
+//	socket are irrelevant.
+class borrowed_descriptor {
+private:
+	boost::asio::posix::stream_descriptor descriptor_;
+	void release () noexcept;
+public:
+	borrowed_descriptor () = delete;
+	borrowed_descriptor (const borrowed_descriptor &) = delete;
+	borrowed_descriptor & operator = (const borrowed_descriptor &) = delete;
+	borrowed_descriptor (borrowed_descriptor &&) = default;
+	borrowed_descriptor & operator = (borrowed_descriptor &&) noexcept;
+	explicit borrowed_descriptor (boost::asio::io_service & ios) noexcept;
+	~borrowed_descriptor () noexcept;
+	void assign (int handle, boost::system::error_code & ec) noexcept;
+	int native_handle () noexcept;
+	void cancel ();
+	void cancel (boost::system::error_code & ec) noexcept;
+	template <typename Buffers, typename Handler>
+	void async_read_some (const Buffers & buffers, Handler && h) {
+		descriptor_.async_read_some(buffers, std::forward<Handler>(h));
+	}
+	template <typename Buffers, typename Handler>
+	void async_write_some (const Buffers & buffers, Handler && h) {
+		descriptor_.async_write_some(buffers, std::forward<Handler>(h));
+	}
+};
+
+using socket_variant_type = mpark::variant<borrowed_descriptor>;
+
+borrowed_descriptor borrowed_socket (
+	boost::asio::io_service & ios,
+	PGconn * conn,
+	boost::system::error_code & ec
+) noexcept;
+
+#else
+
 using socket_variant_type = mpark::variant<
 	boost::asio::ip::tcp::socket
 	#ifdef ASIO_PQ_HAS_LOCAL_SOCKETS
@@ -26,6 +74,8 @@ using socket_variant_type = mpark::variant<
 	#endif
 >;
 
+#endif
+
 enum class socket_type {
 	tcp_ip_v4,
 	tcp_ip_v6,
@@ -0,0 +1,68 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace asio_pq {
+namespace detail {
+
+using timestamp_type = std::chrono::system_clock::time_point;
+
+//	PostgreSQL timestamps are microseconds since
+//	2000-01-01 00:00:00 UTC whereas the system clock
+//	counts from the Unix epoch
+constexpr std::int64_t postgres_epoch_offset = 946684800LL * 1000000LL;
+
+//	The range of microseconds since the Unix epoch
+//	which timestamp_type can represent (where its
+//	ticks are nanoseconds this is roughly the years
+//	1678 through 2261)
+constexpr std::int64_t max_timestamp_micros = std::chrono::duration_cast<std::chrono::microseconds>(
+	timestamp_type::duration::max()
+).count();
+constexpr std::int64_t min_timestamp_micros = std::chrono::duration_cast<std::chrono::microseconds>(
+	timestamp_type::duration::min()
+).count();
+
+inline std::int64_t to_postgres_timestamp (timestamp_type tp) noexcept {
+	//	The extreme values represent infinity and
+	//	-infinity as they do when decoding
+	if (tp == timestamp_type::max()) return std::numeric_limits<std::int64_t>::max();
+	if (tp == timestamp_type::min()) return std::numeric_limits<std::int64_t>::min();
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch());
+	return std::int64_t(us.count()) - postgres_epoch_offset;
+}
+
+//	Returns false if the value is outside the range
+//	of timestamp_type
+inline bool from_unix_micros (std::int64_t value, timestamp_type & out) noexcept {
+	if ((value > max_timestamp_micros) || (value < min_timestamp_micros)) return false;
+	std::chrono::microseconds us(value);
+	out = timestamp_type(std::chrono::duration_cast<timestamp_type::duration>(us));
+	return true;
+}
+
+//	Returns false if the value is outside the range
+//	of timestamp_type. The server represents infinity
+//	and -infinity with the extreme values which are
+//	mapped to the extreme values of timestamp_type
+inline bool from_postgres_timestamp (std::int64_t value, timestamp_type & out) noexcept {
+	if (value == std::numeric_limits<std::int64_t>::max()) {
+		out = timestamp_type::max();
+		return true;
+	}
+	if (value == std::numeric_limits<std::int64_t>::min()) {
+		out = timestamp_type::min();
+		return true;
+	}
+	if (value > (std::numeric_limits<std::int64_t>::max() - postgres_epoch_offset)) return false;
+	return from_unix_micros(value + postgres_epoch_offset, out);
+}
+
+}
+}
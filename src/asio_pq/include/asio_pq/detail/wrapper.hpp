@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "executor.hpp"
 #include <boost/asio/handler_alloc_hook.hpp>
 #include <boost/asio/handler_continuation_hook.hpp>
 #include <boost/asio/handler_invoke_hook.hpp>
@@ -26,6 +27,9 @@ protected:
 	}
 public:
 	wrapper () = delete;
+	const Handler & handler () const noexcept {
+		return h_;
+	}
 	explicit wrapper (Handler h) noexcept(
 		std::is_nothrow_move_constructible<Handler>::value
 	)	:	h_(std::move(h))
@@ -87,3 +91,33 @@ write_wrapper<Handler> make_write_wrapper (Handler h) noexcept(std::is_nothrow_m
 
 }
 }
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::read_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::read_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::read_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::read_wrapper<Handler>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::write_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::write_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::write_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::write_wrapper<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
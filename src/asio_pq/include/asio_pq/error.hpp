@@ -18,7 +18,19 @@ enum class error {
 	connection_bad,
 	polling_failed,
 	flush_failed,
-	consume_failed
+	consume_failed,
+	set_nonblocking_failed,
+	send_failed,
+	row_mode_failed,
+	unexpected_null,
+	type_mismatch,
+	decode_failed,
+	no_such_column,
+	copy_failed,
+	command_failed,
+	timed_out,
+	cancel_failed,
+	unexpected_copy
 };
 
 boost::system::error_code make_error_code (error e) noexcept;
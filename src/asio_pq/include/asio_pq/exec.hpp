@@ -0,0 +1,510 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include "error.hpp"
+#include "get_result.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+namespace detail {
+
+using async_exec_signature = void (boost::system::error_code, std::vector<result>);
+using async_exec_visit_signature = void (boost::system::error_code);
+
+inline bool command_succeeded (const result & r) noexcept {
+	switch (PQresultStatus(r)) {
+	case PGRES_COMMAND_OK:
+	case PGRES_TUPLES_OK:
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+inline bool starts_copy (const result & r) noexcept {
+	switch (PQresultStatus(r)) {
+	case PGRES_COPY_IN:
+	case PGRES_COPY_OUT:
+	case PGRES_COPY_BOTH:
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+class exec_vector_sink {
+private:
+	std::vector<result> results_;
+public:
+	void operator () (result r) {
+		results_.push_back(std::move(r));
+	}
+	template <typename Pointer>
+	void invoke (Pointer & ptr, boost::system::error_code ec) {
+		auto results = std::move(results_);
+		ptr.invoke(ec, std::move(results));
+	}
+};
+
+template <typename Visitor>
+class exec_visitor_sink {
+private:
+	Visitor v_;
+public:
+	explicit exec_visitor_sink (Visitor v)
+		:	v_(std::move(v))
+	{	}
+	void operator () (result r) {
+		v_(std::move(r));
+	}
+	template <typename Pointer>
+	void invoke (Pointer & ptr, boost::system::error_code ec) {
+		ptr.invoke(ec);
+	}
+};
+
+template <typename Handler, typename Sink>
+class async_exec_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, asio_pq::connection & conn, Sink sink)
+			:	connection(conn),
+				sink(std::move(sink))
+		{	}
+		asio_pq::connection & connection;
+		Sink sink;
+		boost::system::error_code error_code;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void complete (boost::system::error_code ec) {
+		ptr_->sink.invoke(ptr_, ec);
+	}
+	//	Returns false (having completed the operation)
+	//	if the result begins a COPY: libpq returns such
+	//	a result from every call to PQgetResult until the
+	//	COPY is ended so no further results can be
+	//	collected
+	bool add (result r) {
+		bool copy = starts_copy(r);
+		ptr_->sink(std::move(r));
+		if (copy) complete(make_error_code(error::unexpected_copy));
+		return !copy;
+	}
+	void next () {
+		connection & conn = ptr_->connection;
+		async_get_result(conn, std::move(*this));
+	}
+public:
+	async_exec_op () = delete;
+	async_exec_op (const async_exec_op &) = default;
+	async_exec_op (async_exec_op &&) = default;
+	async_exec_op & operator = (const async_exec_op &) = default;
+	async_exec_op & operator = (async_exec_op &&) = default;
+	template <typename DeducedHandler>
+	async_exec_op (connection & conn, Sink sink, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn, std::move(sink))
+	{	}
+	void begin (int sent) {
+		if (sent == 0) {
+			ptr_->error_code = make_error_code(error::send_failed);
+			boost::asio::io_service & ios = ptr_->connection.get_io_service();
+			ios.post(std::move(*this));
+			return;
+		}
+		next();
+	}
+	void operator () () {
+		complete(ptr_->error_code);
+	}
+	void operator () (boost::system::error_code ec, result r) {
+		if (ec || !r) {
+			complete(ec);
+			return;
+		}
+		if (!add(std::move(r))) return;
+		//	Results which libpq has already read are
+		//	collected without going back through the
+		//	io_service (PQgetResult does not block once
+		//	PQisBusy returns zero, whether or not the
+		//	connection is in non-blocking mode)
+		connection & conn = ptr_->connection;
+		while (PQisBusy(conn) == 0) {
+			result next(PQgetResult(conn));
+			if (!next) {
+				complete(ec);
+				return;
+			}
+			if (!add(std::move(next))) return;
+		}
+		this->next();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_exec_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_exec_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_exec_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_exec_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+template <typename Signature, typename CompletionToken, typename Sink>
+auto async_exec (
+	connection & conn,
+	int sent,
+	Sink sink,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, Signature> init(token);
+	async_exec_op<
+		beast::handler_type<CompletionToken, Signature>,
+		Sink
+	> op(
+		conn,
+		std::move(sink),
+		std::move(init.completion_handler)
+	);
+	op.begin(sent);
+	return init.result.get();
+}
+
+}
+
+/**
+ *	Sends a command via `PQsendQuery` and asynchronously
+ *	retrieves all results thereof.
+ *
+ *	Results which libpq has already received are
+ *	collected without a round trip through the
+ *	`boost::asio::io_service` so the cost of the
+ *	operation does not grow with the number of
+ *	results.
+ *
+ *	If the command starts a `COPY` the operation
+ *	completes with \ref error::unexpected_copy once
+ *	the `PGRES_COPY_IN`, `PGRES_COPY_OUT`, or
+ *	`PGRES_COPY_BOTH` \ref result has been collected,
+ *	leaving the connection in the `COPY` state. Use
+ *	\ref async_copy_in or \ref async_copy_out for such
+ *	commands.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must not have a pending
+ *		command. It should be in non-blocking mode (see
+ *		`PQsetnonblocking`): Otherwise libpq sends the
+ *		command before this function returns, blocking
+ *		the calling thread until the server has accepted
+ *		all of it. The reference to this object must remain
+ *		valid for the lifetime of the asynchronous operation
+ *		or the behavior is undefined.
+ *	\param [in] command
+ *		See the libpq manual entry for `PQsendQuery`.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a `std::vector` of
+ *		\ref result objects containing the results in the
+ *		order they were returned by the server.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_exec (
+	connection & conn,
+	const char * command,
+	CompletionToken && token
+) {
+	return detail::async_exec<detail::async_exec_signature>(
+		conn,
+		PQsendQuery(conn, command),
+		detail::exec_vector_sink{},
+		std::forward<CompletionToken>(token)
+	);
+}
+
+/**
+ *	Sends a command via `PQsendQuery` and asynchronously
+ *	passes each result thereof to a visitor.
+ *
+ *	Results which libpq has already received are
+ *	visited without a round trip through the
+ *	`boost::asio::io_service`.
+ *
+ *	If the command starts a `COPY` the operation
+ *	completes with \ref error::unexpected_copy once
+ *	the `PGRES_COPY_IN`, `PGRES_COPY_OUT`, or
+ *	`PGRES_COPY_BOTH` \ref result has been collected,
+ *	leaving the connection in the `COPY` state. Use
+ *	\ref async_copy_in or \ref async_copy_out for such
+ *	commands.
+ *
+ *	\tparam Visitor
+ *		The type of a function object which accepts
+ *		a \ref result.
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must not have a pending
+ *		command. It should be in non-blocking mode (see
+ *		`PQsetnonblocking`): Otherwise libpq sends the
+ *		command before this function returns, blocking
+ *		the calling thread until the server has accepted
+ *		all of it. The reference to this object must remain
+ *		valid for the lifetime of the asynchronous operation
+ *		or the behavior is undefined.
+ *	\param [in] command
+ *		See the libpq manual entry for `PQsendQuery`.
+ *	\param [in] visitor
+ *		A function object which shall be invoked with each
+ *		\ref result in the order they were returned by the
+ *		server.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. One parameter is provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename Visitor, typename CompletionToken>
+auto async_exec (
+	connection & conn,
+	const char * command,
+	Visitor visitor,
+	CompletionToken && token
+) {
+	return detail::async_exec<detail::async_exec_visit_signature>(
+		conn,
+		PQsendQuery(conn, command),
+		detail::exec_visitor_sink<Visitor>(std::move(visitor)),
+		std::forward<CompletionToken>(token)
+	);
+}
+
+/**
+ *	Sends a command via `PQsendQueryParams` and
+ *	asynchronously retrieves all results thereof.
+ *
+ *	All parameters not documented have the same
+ *	meaning as the parameters of the same name to
+ *	`PQsendQueryParams`. Parameters need only remain
+ *	valid until this function returns.
+ *
+ *	If the command starts a `COPY` the operation
+ *	completes with \ref error::unexpected_copy once
+ *	the `PGRES_COPY_IN`, `PGRES_COPY_OUT`, or
+ *	`PGRES_COPY_BOTH` \ref result has been collected,
+ *	leaving the connection in the `COPY` state. Use
+ *	\ref async_copy_in or \ref async_copy_out for such
+ *	commands.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must not have a pending
+ *		command. It should be in non-blocking mode (see
+ *		`PQsetnonblocking`): Otherwise libpq sends the
+ *		command before this function returns, blocking
+ *		the calling thread until the server has accepted
+ *		all of it. The reference to this object must remain
+ *		valid for the lifetime of the asynchronous operation
+ *		or the behavior is undefined.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a `std::vector` of
+ *		\ref result objects containing the results in the
+ *		order they were returned by the server.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_exec_params (
+	connection & conn,
+	const char * command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format,
+	CompletionToken && token
+) {
+	return detail::async_exec<detail::async_exec_signature>(
+		conn,
+		PQsendQueryParams(
+			conn,
+			command,
+			n_params,
+			param_types,
+			param_values,
+			param_lengths,
+			param_formats,
+			result_format
+		),
+		detail::exec_vector_sink{},
+		std::forward<CompletionToken>(token)
+	);
+}
+
+/**
+ *	Sends a command via `PQsendQueryParams` and
+ *	asynchronously passes each result thereof to a
+ *	visitor.
+ *
+ *	All parameters not documented have the same
+ *	meaning as the parameters of the same name to
+ *	`PQsendQueryParams`. Parameters need only remain
+ *	valid until this function returns.
+ *
+ *	If the command starts a `COPY` the operation
+ *	completes with \ref error::unexpected_copy once
+ *	the `PGRES_COPY_IN`, `PGRES_COPY_OUT`, or
+ *	`PGRES_COPY_BOTH` \ref result has been collected,
+ *	leaving the connection in the `COPY` state. Use
+ *	\ref async_copy_in or \ref async_copy_out for such
+ *	commands.
+ *
+ *	\tparam Visitor
+ *		The type of a function object which accepts
+ *		a \ref result.
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must not have a pending
+ *		command. It should be in non-blocking mode (see
+ *		`PQsetnonblocking`): Otherwise libpq sends the
+ *		command before this function returns, blocking
+ *		the calling thread until the server has accepted
+ *		all of it. The reference to this object must remain
+ *		valid for the lifetime of the asynchronous operation
+ *		or the behavior is undefined.
+ *	\param [in] visitor
+ *		A function object which shall be invoked with each
+ *		\ref result in the order they were returned by the
+ *		server.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. One parameter is provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename Visitor, typename CompletionToken>
+auto async_exec_params (
+	connection & conn,
+	const char * command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format,
+	Visitor visitor,
+	CompletionToken && token
+) {
+	return detail::async_exec<detail::async_exec_visit_signature>(
+		conn,
+		PQsendQueryParams(
+			conn,
+			command,
+			n_params,
+			param_types,
+			param_values,
+			param_lengths,
+			param_formats,
+			result_format
+		),
+		detail::exec_visitor_sink<Visitor>(std::move(visitor)),
+		std::forward<CompletionToken>(token)
+	);
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Sink, typename Executor>
+struct associated_executor<asio_pq::detail::async_exec_op<Handler, Sink>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_exec_op<Handler, Sink>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Sink, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_exec_op<Handler, Sink>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_exec_op<Handler, Sink>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -5,23 +5,27 @@
 #pragma once
 
 #include "connection.hpp"
+#include "detail/deadline.hpp"
+#include "detail/executor.hpp"
+#include "detail/handler_memory.hpp"
 #include "detail/op.hpp"
+#include "detail/send_cancel.hpp"
 #include "detail/wrapper.hpp"
 #include "error.hpp"
 #include "result.hpp"
 #include <beast/core/async_result.hpp>
-#include <beast/core/handler_ptr.hpp>
 #include <boost/asio/error.hpp>
 #include <boost/asio/handler_alloc_hook.hpp>
 #include <boost/asio/handler_continuation_hook.hpp>
 #include <boost/asio/handler_invoke_hook.hpp>
 #include <boost/asio/io_service.hpp>
-#include <boost/asio/strand.hpp>
 #include <boost/optional.hpp>
 #include <boost/system/error_code.hpp>
 #include <boost/utility/in_place_factory.hpp>
 #include <libpq-fe.h>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <memory>
 #include <utility>
 
@@ -55,7 +59,7 @@ private:
 			:	result(std::move(r))
 		{	}
 	};
-	using pointer = beast::handler_ptr<state, Handler>;
+	using pointer = recycling_ptr<state, Handler>;
 	pointer ptr_;
 public:
 	async_get_result_success_wrapper () = delete;
@@ -71,6 +75,11 @@ public:
 		result r(std::move(*ptr_));
 		ptr_.invoke(boost::system::error_code{}, std::move(r));
 	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
 	template <typename Function>
 	friend void asio_handler_invoke (Function function, async_get_result_success_wrapper * self) {
 		assert(self);
@@ -94,9 +103,25 @@ public:
 	}
 };
 
+//	Waits for the connection's socket to become readable
+//	(and writable while libpq has unsent output) and
+//	services whichever readiness is reported.
+//
+//	The read and write waits are not serialized through
+//	a strand: each completion only publishes its readiness
+//	to an atomic mask and whichever completion finds the
+//	operation idle services every readiness published
+//	until it can return the operation to idle.  The read
+//	wait remains armed across write readiness so each
+//	readiness event arms at most one wait with the reactor.
 template <typename Handler>
 class async_get_result_op {
 private:
+	enum : unsigned {
+		readable = 1,
+		writable = 2,
+		running = 4
+	};
 	class state {
 	public:
 		state () = delete;
@@ -105,21 +130,25 @@ private:
 		state & operator = (const state &) = delete;
 		state & operator = (state &&) = delete;
 		explicit state (const Handler &, asio_pq::connection & conn, int flush)
-			:	strand(conn.get_io_service()),
-				connection(conn),
+			:	connection(conn),
 				read(false),
 				write(false),
-				flush(flush)
+				flush(flush),
+				events(running)
 		{	}
-		boost::asio::io_service::strand strand;
 		asio_pq::connection & connection;
 		bool read;
 		bool write;
 		int flush;
 		boost::optional<boost::system::error_code> error_code;
 		asio_pq::result result;
+		//	Readiness published by completed waits together
+		//	with whether some completion is servicing the
+		//	operation, only the servicing completion may
+		//	access the other members
+		std::atomic<unsigned> events;
 	};
-	using pointer = beast::handler_ptr<state, Handler>;
+	using pointer = recycling_ptr<state, Handler>;
 	pointer ptr_;
 	void complete () {
 		assert(!ptr_->read);
@@ -129,43 +158,20 @@ private:
 		auto result = std::move(ptr_->result);
 		ptr_.invoke(ec, std::move(result));
 	}
-	bool complete_if () {
-		if (!ptr_->connection.has_socket()) {
-			fail(make_error_code(boost::asio::error::operation_aborted));
-			return true;
-		}
-		if (!ptr_->error_code) return false;
-		complete();
-		return true;
-	}
-	void upcall () {
-		if (ptr_->read || ptr_->write) {
-			ptr_->connection.socket([&] (auto & socket) {	socket.cancel();	});
-			return;
-		}
-		complete();
-	}
 	void fail (boost::system::error_code ec) {
 		if (!ptr_->error_code) ptr_->error_code = ec;
-		upcall();
 	}
 	void success (result r) {
 		ptr_->error_code = boost::in_place();
 		ptr_->result = std::move(r);
-		upcall();
 	}
 	void read () {
 		if (ptr_->read) return;
 		ptr_->read = true;
 		ptr_->connection.socket([&] (auto & socket) {
-			state & s = *ptr_;
 			detail::async_readable(
 				socket,
-				s.strand.wrap(
-					detail::make_read_wrapper(
-						std::move(*this)
-					)
-				)
+				detail::make_read_wrapper(*this)
 			);
 		});
 	}
@@ -173,14 +179,9 @@ private:
 		if (ptr_->write) return;
 		ptr_->write = true;
 		ptr_->connection.socket([&] (auto & socket) {
-			state & s = *ptr_;
 			detail::async_writable(
 				socket,
-				s.strand.wrap(
-					detail::make_write_wrapper(
-						std::move(*this)
-					)
-				)
+				detail::make_write_wrapper(*this)
 			);
 		});
 	}
@@ -209,6 +210,49 @@ private:
 		}
 		return true;
 	}
+	//	Returns true if the operation completed in which
+	//	case this object no longer refers to it
+	bool service (unsigned events) {
+		state & s = *ptr_;
+		if (events & readable) s.read = false;
+		if (events & writable) s.write = false;
+		//	If it becomes read-ready, call PQconsumeInput,
+		//	then call PQflush again.  If it becomes
+		//	write-ready, call PQflush again.
+		if (!s.error_code) {
+			if (!s.connection.has_socket()) {
+				fail(make_error_code(boost::asio::error::operation_aborted));
+			} else if ((!(events & readable) || consume()) && flush()) {
+				dispatch();
+				return false;
+			}
+		}
+		if (s.read || s.write) {
+			//	The outstanding wait will complete with
+			//	operation_aborted and complete the operation
+			if (s.connection.has_socket()) s.connection.socket([&] (auto & socket) {	socket.cancel();	});
+			return false;
+		}
+		complete();
+		return true;
+	}
+	void idle () {
+		for (;;) {
+			unsigned expected = running;
+			if (ptr_->events.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) return;
+			unsigned events = ptr_->events.exchange(running, std::memory_order_acq_rel);
+			if (service(events & ~running)) return;
+		}
+	}
+	void signal (unsigned event) {
+		unsigned prev = ptr_->events.fetch_or(event | running, std::memory_order_acq_rel);
+		//	The completion which is servicing the operation
+		//	will observe this readiness before it idles
+		if (prev & running) return;
+		unsigned events = ptr_->events.exchange(running, std::memory_order_acq_rel);
+		if (service(events & ~running)) return;
+		idle();
+	}
 public:
 	async_get_result_op () = delete;
 	async_get_result_op (const async_get_result_op &) = default;
@@ -226,21 +270,23 @@ public:
 		assert(ptr_->flush != -1);
 		assert(!ptr_->error_code);
 		assert(!ptr_->result);
+		//	The operation is created running so waits
+		//	which complete before both are armed cannot
+		//	service it concurrently
 		dispatch();
+		idle();
 	}
-	void read (boost::system::error_code ec) {
-		ptr_->read = false;
-		if (complete_if()) return;
-		//	If it becomes read-ready, call PQconsumeInput,
-		//	then call PQflush again.
-		if (consume() && flush()) dispatch();
+	void read (boost::system::error_code) {
+		signal(readable);
 	}
-	void write (boost::system::error_code ec) {
-		ptr_->write = false;
-		if (complete_if()) return;
-		//	If it becomes write-ready, call PQflush again.
-		if (flush()) dispatch();
+	void write (boost::system::error_code) {
+		signal(writable);
 	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
 	template <typename Function>
 	friend void asio_handler_invoke (Function function, async_get_result_op * self) {
 		assert(self);
@@ -264,6 +310,38 @@ public:
 	}
 };
 
+//	Obtains the next result without waiting if libpq
+//	has already received it, returns true if it did so
+//	(or failed in which case ec is set) otherwise flush
+//	is set to the return value of PQflush
+inline bool get_result_immediate (
+	connection & conn,
+	int & flush,
+	boost::system::error_code & ec,
+	result & r
+) {
+	flush = PQflush(conn);
+	switch (flush) {
+	case -1:
+		ec = make_error_code(error::flush_failed);
+		return true;
+	case 1:
+	default:
+		break;
+	case 0:
+		if (PQconsumeInput(conn) == 0) {
+			ec = make_error_code(error::consume_failed);
+			return true;
+		}
+		if (PQisBusy(conn) == 0) {
+			r = result(PQgetResult(conn));
+			return true;
+		}
+		break;
+	}
+	return false;
+}
+
 template <typename Handler>
 void async_get_result_fail (
 	boost::asio::io_service & ios,
@@ -326,56 +404,191 @@ auto async_get_result (
 	CompletionToken && token
 ) {
 	beast::async_completion<CompletionToken, detail::async_get_result_signature> init(token);
+	//	All memory allocated on behalf of the operation
+	//	(i.e. its state and the waits it performs) is
+	//	recycled through the connection so repeated
+	//	operations do not allocate
+	auto h = detail::make_recycling_handler(
+		std::move(init.completion_handler),
+		conn.memory()
+	);
 	auto ec = conn.duplicate_socket();
 	if (ec) {
 		detail::async_get_result_fail(
 			conn.get_io_service(),
 			ec,
-			std::move(init.completion_handler)
+			std::move(h)
 		);
 		return init.result.get();
 	}
-	int flush = PQflush(conn);
-	switch (flush) {
-	case -1:
-		detail::async_get_result_fail(
-			conn.get_io_service(),
-			make_error_code(error::flush_failed),
-			std::move(init.completion_handler)
-		);
-		return init.result.get();
-	case 1:
-	default:
-		break;
-	case 0:
-		if (PQconsumeInput(conn) == 0) {
+	int flush;
+	result r;
+	if (detail::get_result_immediate(conn, flush, ec, r)) {
+		if (ec) {
 			detail::async_get_result_fail(
 				conn.get_io_service(),
-				make_error_code(error::consume_failed),
-				std::move(init.completion_handler)
+				ec,
+				std::move(h)
 			);
 			return init.result.get();
 		}
-		if (PQisBusy(conn) == 0) {
-			result r(PQgetResult(conn));
-			detail::async_get_result_success(
-				conn.get_io_service(),
-				std::move(r),
-				std::move(init.completion_handler)
-			);
-			return init.result.get();
-		}
-		break;
+		detail::async_get_result_success(
+			conn.get_io_service(),
+			std::move(r),
+			std::move(h)
+		);
+		return init.result.get();
 	}
-	detail::async_get_result_op<
-		beast::handler_type<CompletionToken, detail::async_get_result_signature>
-	> op(
+	detail::async_get_result_op<decltype(h)> op(
 		conn,
 		flush,
-		std::move(init.completion_handler)
+		std::move(h)
 	);
 	op.begin();
 	return init.result.get();
 }
 
+/**
+ *	Asynchronously obtains the next result of the command
+ *	pending on a \ref connection as \ref async_get_result
+ *	does, asking the server to cancel the command if no
+ *	result is available by a certain point in time.
+ *
+ *	Once the deadline passes a cancel request is sent
+ *	to the server and the operation continues to wait
+ *	for the server to respond so that the \ref connection
+ *	remains usable, the completion handler is then invoked
+ *	with \ref error::timed_out and whatever \ref result
+ *	was obtained (typically one reporting that the command
+ *	was cancelled). Remaining results must be retrieved
+ *	as usual before issuing another command. If the cancel
+ *	request cannot be sent the operation is cancelled
+ *	as if by \ref cancel and the \ref connection should
+ *	not be used further.
+ *
+ *	The cancel request is sent as by \ref async_cancel_query
+ *	so the thread running the `boost::asio::io_service` is
+ *	never blocked.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection which has a pending command.
+ *		It must be the case that `!!conn` is \em true or
+ *		the behavior is undefined.
+ *	\param [in] deadline
+ *		The point in time after which the command shall
+ *		be cancelled.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a \ref result containing
+ *		the `PGresult *` representing the result (if applicable).
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_get_result (
+	connection & conn,
+	std::chrono::steady_clock::time_point deadline,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_get_result_signature> init(token);
+	detail::async_deadline<result>(
+		conn,
+		deadline,
+		[] (connection & conn, auto h) {	async_get_result(conn, std::move(h));	},
+		[] (connection & conn, auto h) {	detail::async_cancel_command(conn, std::move(h));	},
+		std::move(init.completion_handler)
+	);
+	return init.result.get();
+}
+/**
+ *	Asynchronously obtains the next result of the command
+ *	pending on a \ref connection as \ref async_get_result
+ *	does, asking the server to cancel the command if no
+ *	result is available within a certain amount of time.
+ *
+ *	See the overload which accepts a deadline for details.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection which has a pending command.
+ *		It must be the case that `!!conn` is \em true or
+ *		the behavior is undefined.
+ *	\param [in] timeout
+ *		The amount of time after which the command shall
+ *		be cancelled.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a \ref result containing
+ *		the `PGresult *` representing the result (if applicable).
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_get_result (
+	connection & conn,
+	std::chrono::steady_clock::duration timeout,
+	CompletionToken && token
+) {
+	return async_get_result(
+		conn,
+		std::chrono::steady_clock::now() + timeout,
+		std::forward<CompletionToken>(token)
+	);
+}
+
 }
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_get_result_fail_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_get_result_fail_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_get_result_fail_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_get_result_fail_wrapper<Handler>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_get_result_success_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_get_result_success_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_get_result_success_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_get_result_success_wrapper<Handler>, Handler, Allocator>
+{	};
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_get_result_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_get_result_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_get_result_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_get_result_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,278 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include "get_result.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+#define ASIO_PQ_HAS_CHUNKED_ROWS
+#endif
+
+namespace asio_pq {
+
+/**
+ *	Places a \ref connection in row-by-row mode for
+ *	the command which was most recently sent.
+ *
+ *	This must be called immediately after the command
+ *	is sent (i.e. before any call to \ref async_get_result
+ *	or \ref async_get_rows).
+ *
+ *	If libpq supports chunked rows mode (libpq 17+)
+ *	and \em chunk_size is greater than one `PQsetChunkedRowsMode`
+ *	is used so that each \ref result contains up to
+ *	\em chunk_size rows, otherwise `PQsetSingleRowMode`
+ *	is used so that each \ref result contains one row.
+ *
+ *	\param [in] conn
+ *		The \ref connection.
+ *	\param [in] chunk_size
+ *		The maximum number of rows in each \ref result.
+ *	\param [out] ec
+ *		A `boost::system::error_code` object which
+ *		shall be set to the result of the operation.
+ *		Note that if this object already represents
+ *		an error it will be cleared.
+ */
+void set_row_mode (connection & conn, int chunk_size, boost::system::error_code & ec) noexcept;
+/**
+ *	Places a \ref connection in row-by-row mode for
+ *	the command which was most recently sent.
+ *
+ *	This must be called immediately after the command
+ *	is sent (i.e. before any call to \ref async_get_result
+ *	or \ref async_get_rows).
+ *
+ *	If libpq supports chunked rows mode (libpq 17+)
+ *	and \em chunk_size is greater than one `PQsetChunkedRowsMode`
+ *	is used so that each \ref result contains up to
+ *	\em chunk_size rows, otherwise `PQsetSingleRowMode`
+ *	is used so that each \ref result contains one row.
+ *
+ *	\param [in] conn
+ *		The \ref connection.
+ *	\param [in] chunk_size
+ *		The maximum number of rows in each \ref result.
+ *		Defaults to one.
+ */
+void set_row_mode (connection & conn, int chunk_size = 1);
+
+namespace detail {
+
+using async_get_rows_signature = void (boost::system::error_code, std::vector<result>);
+
+inline bool is_row_batch (const result & r) noexcept {
+	switch (PQresultStatus(r)) {
+	case PGRES_SINGLE_TUPLE:
+	#ifdef ASIO_PQ_HAS_CHUNKED_ROWS
+	case PGRES_TUPLES_CHUNK:
+	#endif
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+template <typename Handler>
+class async_get_rows_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, asio_pq::connection & conn, std::size_t max_rows)
+			:	connection(conn),
+				max_rows(max_rows),
+				rows(0)
+		{	}
+		asio_pq::connection & connection;
+		std::size_t max_rows;
+		std::size_t rows;
+		std::vector<result> results;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void complete (boost::system::error_code ec) {
+		auto results = std::move(ptr_->results);
+		ptr_.invoke(ec, std::move(results));
+	}
+	//	Returns true if more results may be
+	//	added to the batch
+	bool add (result r) {
+		assert(r);
+		bool more = is_row_batch(r);
+		ptr_->rows += std::size_t(PQntuples(r));
+		ptr_->results.push_back(std::move(r));
+		return more && (ptr_->rows < ptr_->max_rows);
+	}
+public:
+	async_get_rows_op () = delete;
+	async_get_rows_op (const async_get_rows_op &) = default;
+	async_get_rows_op (async_get_rows_op &&) = default;
+	async_get_rows_op & operator = (const async_get_rows_op &) = default;
+	async_get_rows_op & operator = (async_get_rows_op &&) = default;
+	template <typename DeducedHandler>
+	async_get_rows_op (connection & conn, std::size_t max_rows, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn, max_rows)
+	{	}
+	void begin () {
+		connection & conn = ptr_->connection;
+		async_get_result(conn, std::move(*this));
+	}
+	void operator () (boost::system::error_code ec, result r) {
+		if (ec || !r) {
+			complete(ec);
+			return;
+		}
+		if (!add(std::move(r))) {
+			complete(ec);
+			return;
+		}
+		//	Only rows which libpq has already read
+		//	are added: Input is not consumed from
+		//	the socket until the consumer asks for
+		//	the next batch
+		connection & conn = ptr_->connection;
+		while (PQisBusy(conn) == 0) {
+			result next(PQgetResult(conn));
+			if (!next || !add(std::move(next))) break;
+		}
+		complete(ec);
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_get_rows_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_get_rows_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_get_rows_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_get_rows_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+/**
+ *	Asynchronously retrieves the next batch of rows
+ *	from a command whose results are being returned
+ *	row-by-row (see \ref set_row_mode).
+ *
+ *	The operation waits until at least one \ref result
+ *	is available and then adds further results to the
+ *	batch only while libpq has already received them
+ *	and the batch contains fewer than \em max_rows rows.
+ *	No further input is read from the server until
+ *	this function is called again, so a slow consumer
+ *	exerts backpressure on the server rather than
+ *	causing results to accumulate in memory.
+ *
+ *	Each \ref result in the batch has status `PGRES_SINGLE_TUPLE`
+ *	(or `PGRES_TUPLES_CHUNK`) except possibly the last: If the
+ *	last \ref result has any other status (i.e. `PGRES_TUPLES_OK`
+ *	with zero rows or an error) the command's rows have been
+ *	exhausted and \ref async_get_result should be used to
+ *	retrieve the remaining results (if any) as usual. An empty
+ *	batch indicates there are no further results.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection which has a pending command.
+ *		The reference to this object must remain valid
+ *		for the lifetime of the asynchronous operation or
+ *		the behavior is undefined.
+ *	\param [in] max_rows
+ *		The maximum number of rows in the batch. Note
+ *		that in chunked rows mode the batch may exceed
+ *		this by up to one less than the chunk size.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a `std::vector` of
+ *		\ref result objects containing the batch.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_get_rows (
+	connection & conn,
+	std::size_t max_rows,
+	CompletionToken && token
+) {
+	assert(max_rows != 0);
+	beast::async_completion<CompletionToken, detail::async_get_rows_signature> init(token);
+	detail::async_get_rows_op<
+		beast::handler_type<CompletionToken, detail::async_get_rows_signature>
+	> op(
+		conn,
+		max_rows,
+		std::move(init.completion_handler)
+	);
+	op.begin();
+	return init.result.get();
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_get_rows_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_get_rows_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_get_rows_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_get_rows_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
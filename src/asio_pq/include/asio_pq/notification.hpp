@@ -0,0 +1,99 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <libpq-fe.h>
+
+namespace asio_pq {
+
+/**
+ *	An RAII wrapper for a pointer to a `PGnotify`
+ *	returned by `PQnotifies` which frees it via
+ *	`PQfreemem`.
+ *
+ *	The channel name and payload are viewed in place
+ *	(i.e. they are never copied).
+ */
+class notification {
+private:
+	PGnotify * handle_;
+	void destroy () noexcept;
+public:
+	notification (const notification &) = delete;
+	notification & operator = (const notification &) = delete;
+	/**
+	 *	Creates a notification which does not manage
+	 *	a `PGnotify`.
+	 */
+	notification () noexcept;
+	notification (notification &&) noexcept;
+	notification & operator = (notification &&) noexcept;
+	/**
+	 *	Creates a notification which manages a
+	 *	`PGnotify`.
+	 *
+	 *	\param [in] handle
+	 *		A pointer returned by `PQnotifies`.
+	 */
+	explicit notification (PGnotify * handle) noexcept;
+	/**
+	 *	Frees the managed `PGnotify` (if any).
+	 */
+	~notification () noexcept;
+	/**
+	 *	Retrieves the managed handle and surrenders
+	 *	ownership thereof.
+	 *
+	 *	\return
+	 *		The managed handle (if any) which must
+	 *		be freed by `PQfreemem`.
+	 */
+	PGnotify * release () noexcept;
+	/**
+	 *	Retrieves the managed handle.
+	 *
+	 *	\return
+	 *		The managed handle (if any).
+	 */
+	PGnotify * get () const noexcept;
+	/**
+	 *	Retrieves the name of the channel on which
+	 *	the notification was raised. This object must
+	 *	manage a `PGnotify` or the behavior is undefined.
+	 *
+	 *	\return
+	 *		A null terminated string.
+	 */
+	const char * channel () const noexcept;
+	/**
+	 *	Retrieves the payload of the notification.
+	 *	This object must manage a `PGnotify` or the
+	 *	behavior is undefined.
+	 *
+	 *	\return
+	 *		A null terminated string which is empty
+	 *		if no payload was given.
+	 */
+	const char * payload () const noexcept;
+	/**
+	 *	Retrieves the process ID of the server process
+	 *	which raised the notification. This object must
+	 *	manage a `PGnotify` or the behavior is undefined.
+	 *
+	 *	\return
+	 *		The process ID.
+	 */
+	int pid () const noexcept;
+	/**
+	 *	Determines whether this object manages a
+	 *	`PGnotify`.
+	 *
+	 *	\return
+	 *		\em true if it does, \em false otherwise.
+	 */
+	explicit operator bool () const noexcept;
+};
+
+}
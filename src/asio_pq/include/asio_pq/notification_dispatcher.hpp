@@ -0,0 +1,321 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include "notification.hpp"
+#include "wait_notification.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+/**
+ *	Multiplexes the notifications received on a single
+ *	listening \ref connection to any number of in-process
+ *	subscribers keyed by channel.
+ *
+ *	Each notification is delivered to every subscriber
+ *	to its channel as the same `std::shared_ptr` (i.e.
+ *	the payload is never copied, not even once per
+ *	subscriber). Subscribers which wish to retain a
+ *	notification may simply retain the `std::shared_ptr`.
+ *
+ *	Subscribing to a channel does not send `LISTEN`: The
+ *	consumer is responsible for issuing `LISTEN` (e.g. via
+ *	\ref async_exec) before calling \ref async_run since
+ *	no command may be sent while \ref async_run is pending.
+ *	Note that the server folds unquoted channel names to
+ *	lower case and subscribers are matched against the
+ *	name the server reports.
+ *
+ *	Subscribers are invoked synchronously from within
+ *	\ref dispatch and may subscribe and unsubscribe
+ *	(including unsubscribing themselves) while being
+ *	invoked. Subscribers added to a channel while a
+ *	notification on that channel is being dispatched
+ *	do not receive that notification.
+ */
+class notification_dispatcher {
+public:
+	/**
+	 *	The type of a subscriber.
+	 */
+	using subscriber_type = std::function<void (const std::shared_ptr<const notification> &)>;
+	/**
+	 *	The type of the token which identifies a
+	 *	subscription.
+	 */
+	using subscription = unsigned long long;
+private:
+	class entry {
+	public:
+		//	Zero if the subscriber unsubscribed while
+		//	it was being dispatched to
+		subscription id;
+		subscriber_type function;
+	};
+	using entries_type = std::vector<entry>;
+	connection & conn_;
+	std::unordered_map<std::string, entries_type> channels_;
+	std::unordered_map<subscription, std::string> subscriptions_;
+	subscription next_;
+	//	The entries currently being iterated by
+	//	dispatch (if any), these must not be
+	//	reallocated or have elements removed
+	entries_type * dispatching_;
+	entries_type added_;
+	bool removed_;
+	bool stopped_;
+	void end_dispatch (const char * channel);
+public:
+	notification_dispatcher () = delete;
+	notification_dispatcher (const notification_dispatcher &) = delete;
+	notification_dispatcher (notification_dispatcher &&) = delete;
+	notification_dispatcher & operator = (const notification_dispatcher &) = delete;
+	notification_dispatcher & operator = (notification_dispatcher &&) = delete;
+	/**
+	 *	Creates a notification_dispatcher which has no
+	 *	subscribers.
+	 *
+	 *	\param [in] conn
+	 *		The listening \ref connection. The reference
+	 *		to this object must remain valid for the lifetime
+	 *		of the notification_dispatcher or the behavior is
+	 *		undefined.
+	 */
+	explicit notification_dispatcher (connection & conn) noexcept;
+	/**
+	 *	Retrieves the `boost::asio::io_service` associated
+	 *	with this object.
+	 *
+	 *	\return
+	 *		A reference to a `boost::asio::io_service`.
+	 */
+	boost::asio::io_service & get_io_service () const noexcept;
+	/**
+	 *	Retrieves the \ref connection associated with
+	 *	this object.
+	 *
+	 *	\return
+	 *		A reference to a \ref connection.
+	 */
+	connection & get_connection () const noexcept;
+	/**
+	 *	Adds a subscriber to a channel.
+	 *
+	 *	\param [in] channel
+	 *		The name of the channel.
+	 *	\param [in] subscriber
+	 *		The subscriber. Must not be empty.
+	 *
+	 *	\return
+	 *		A token which may be passed to \ref unsubscribe.
+	 */
+	subscription subscribe (std::string channel, subscriber_type subscriber);
+	/**
+	 *	Removes a subscriber. If the subscriber has already
+	 *	been removed this function does nothing.
+	 *
+	 *	\param [in] s
+	 *		The token returned by \ref subscribe.
+	 */
+	void unsubscribe (subscription s);
+	/**
+	 *	Determines the number of subscribers to a channel.
+	 *
+	 *	\param [in] channel
+	 *		The name of the channel.
+	 *
+	 *	\return
+	 *		The number of subscribers.
+	 */
+	std::size_t subscribers (const std::string & channel) const;
+	/**
+	 *	Delivers a notification to every subscriber to
+	 *	its channel. If there are no such subscribers the
+	 *	notification is discarded.
+	 *
+	 *	Must not be called from within a subscriber.
+	 *
+	 *	\param [in] n
+	 *		The notification. Must manage a `PGnotify`.
+	 *
+	 *	\return
+	 *		The number of subscribers to which the
+	 *		notification was delivered.
+	 */
+	std::size_t dispatch (notification n);
+	/**
+	 *	Repeatedly waits for notifications via
+	 *	\ref async_wait_notification and delivers them
+	 *	via \ref dispatch until an error occurs.
+	 *
+	 *	The operation may be stopped via \ref stop, in
+	 *	which case it completes with
+	 *	`boost::asio::error::operation_aborted`.
+	 *
+	 *	\tparam CompletionToken
+	 *		The type of completion token an instance
+	 *		of which shall be used to notify the caller
+	 *		of completion.
+	 *
+	 *	\param [in] token
+	 *		The completion token which shall be used to notify
+	 *		the caller of completion. One parameter is provided:
+	 *		An instance of `boost::system::error_code` representing
+	 *		the error which ended the operation.
+	 *
+	 *	\return
+	 *		Whatever is appropriate given \em CompletionToken.
+	 */
+	template <typename CompletionToken>
+	auto async_run (CompletionToken && token);
+	/**
+	 *	Stops a pending \ref async_run. May be called
+	 *	from within a subscriber in which case no further
+	 *	notifications are dispatched.
+	 */
+	void stop () noexcept;
+	/**
+	 *	\cond
+	 */
+	bool stopped () const noexcept;
+	/**
+	 *	\endcond
+	 */
+};
+
+namespace detail {
+
+using async_run_notifications_signature = void (boost::system::error_code);
+
+template <typename Handler>
+class async_run_notifications_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, notification_dispatcher & dispatcher) noexcept
+			:	dispatcher(dispatcher)
+		{	}
+		notification_dispatcher & dispatcher;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+public:
+	async_run_notifications_op () = delete;
+	async_run_notifications_op (const async_run_notifications_op &) = default;
+	async_run_notifications_op (async_run_notifications_op &&) = default;
+	async_run_notifications_op & operator = (const async_run_notifications_op &) = default;
+	async_run_notifications_op & operator = (async_run_notifications_op &&) = default;
+	template <typename DeducedHandler>
+	async_run_notifications_op (notification_dispatcher & dispatcher, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), dispatcher)
+	{	}
+	void begin () {
+		connection & conn = ptr_->dispatcher.get_connection();
+		async_wait_notification(conn, std::move(*this));
+	}
+	void operator () (boost::system::error_code ec, std::vector<notification> notifications) {
+		if (ec) {
+			ptr_.invoke(ec);
+			return;
+		}
+		notification_dispatcher & dispatcher = ptr_->dispatcher;
+		for (auto && n : notifications) {
+			if (dispatcher.stopped()) break;
+			dispatcher.dispatch(std::move(n));
+		}
+		if (dispatcher.stopped()) {
+			ptr_.invoke(make_error_code(boost::asio::error::operation_aborted));
+			return;
+		}
+		begin();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_run_notifications_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_run_notifications_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_run_notifications_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_run_notifications_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+template <typename CompletionToken>
+auto notification_dispatcher::async_run (CompletionToken && token) {
+	beast::async_completion<CompletionToken, detail::async_run_notifications_signature> init(token);
+	stopped_ = false;
+	detail::async_run_notifications_op<
+		beast::handler_type<CompletionToken, detail::async_run_notifications_signature>
+	> op(
+		*this,
+		std::move(init.completion_handler)
+	);
+	op.begin();
+	return init.result.get();
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_run_notifications_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_run_notifications_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_run_notifications_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_run_notifications_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,56 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <libpq-fe.h>
+
+namespace asio_pq {
+
+/**
+ *	Contains the OIDs of the built in PostgreSQL
+ *	types which this library encodes and decodes.
+ *
+ *	These values are fixed by the server (see
+ *	`pg_type.dat`) and are not expected to change.
+ */
+namespace oid {
+
+constexpr Oid unspecified = 0;
+constexpr Oid boolean = 16;
+constexpr Oid bytea = 17;
+constexpr Oid int8 = 20;
+constexpr Oid int2 = 21;
+constexpr Oid int4 = 23;
+constexpr Oid text = 25;
+constexpr Oid json = 114;
+constexpr Oid float4 = 700;
+constexpr Oid float8 = 701;
+constexpr Oid bpchar = 1042;
+constexpr Oid varchar = 1043;
+constexpr Oid date = 1082;
+constexpr Oid timestamp = 1114;
+constexpr Oid timestamptz = 1184;
+constexpr Oid numeric = 1700;
+constexpr Oid uuid = 2950;
+constexpr Oid jsonb = 3802;
+
+constexpr Oid boolean_array = 1000;
+constexpr Oid bytea_array = 1001;
+constexpr Oid int2_array = 1005;
+constexpr Oid int4_array = 1007;
+constexpr Oid text_array = 1009;
+constexpr Oid varchar_array = 1015;
+constexpr Oid int8_array = 1016;
+constexpr Oid float4_array = 1021;
+constexpr Oid float8_array = 1022;
+constexpr Oid timestamp_array = 1115;
+constexpr Oid timestamptz_array = 1185;
+constexpr Oid numeric_array = 1231;
+constexpr Oid uuid_array = 2951;
+constexpr Oid jsonb_array = 3807;
+
+}
+
+}
@@ -0,0 +1,542 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "copy_data.hpp"
+#include "copy_out.hpp"
+#include "detail/completion.hpp"
+#include "error.hpp"
+#include "exec.hpp"
+#include "pool.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+/**
+ *	The amount of data a parallel export (see
+ *	\ref async_parallel_export) has received thus
+ *	far.
+ */
+class parallel_export_progress {
+public:
+	/**
+	 *	The number of rows in partitions which have
+	 *	been completely received.
+	 */
+	std::uint64_t rows = 0;
+	/**
+	 *	The number of bytes.
+	 */
+	std::uint64_t bytes = 0;
+	/**
+	 *	The number of chunks (i.e. `CopyData` messages).
+	 */
+	std::uint64_t chunks = 0;
+	/**
+	 *	The number of partitions which have been
+	 *	completely received.
+	 */
+	std::size_t partitions = 0;
+};
+
+/**
+ *	Specifies how a parallel export (see \ref async_parallel_export)
+ *	is performed.
+ */
+class parallel_export_settings {
+public:
+	/**
+	 *	The name of the schema which contains the table.
+	 *	If this is empty the table is found via the
+	 *	`search_path`.
+	 */
+	std::string schema;
+	/**
+	 *	The name of the table. Must not be empty.
+	 *
+	 *	This and all other names are quoted via
+	 *	`PQescapeIdentifier` and must therefore not
+	 *	be quoted (i.e. they are case sensitive).
+	 */
+	std::string table;
+	/**
+	 *	The names of the columns which shall be exported.
+	 *	If this is empty all columns are exported.
+	 */
+	std::vector<std::string> columns;
+	/**
+	 *	Options which shall follow `TO STDOUT` in each
+	 *	`COPY` command as pairs of a name and a value (e.g.
+	 *	`{"format", "binary"}`). Values are quoted via
+	 *	`PQescapeLiteral` unless they are empty in which
+	 *	case only the name is specified. May be empty.
+	 */
+	std::vector<std::pair<std::string, std::string>> options;
+	/**
+	 *	The number of worker connections which shall be
+	 *	used concurrently (in addition to the coordinator).
+	 *	Must not be zero.
+	 */
+	std::size_t workers = 4;
+	/**
+	 *	The number of ranges of pages into which the table
+	 *	shall be divided. Zero means four per worker. Ignored
+	 *	if \ref predicates is not empty.
+	 */
+	std::size_t partitions = 0;
+	/**
+	 *	Conditions which divide the table into disjoint
+	 *	partitions (e.g. ranges of a key). These are SQL
+	 *	and are not quoted. If this is empty the table is
+	 *	divided into ranges of `ctid`.
+	 */
+	std::vector<std::string> predicates;
+};
+
+namespace detail {
+
+using async_parallel_export_signature = void (boost::system::error_code, parallel_export_progress, result);
+
+//	Divides the pages of a table into ranges of ctid,
+//	the last of which is unbounded so that pages added
+//	after the size was determined are not missed
+inline std::vector<std::string> ctid_predicates (std::uint64_t pages, std::size_t partitions) {
+	std::vector<std::string> retr;
+	partitions = std::max(std::size_t(1), std::min(partitions, std::size_t(pages)));
+	std::uint64_t size = (pages + partitions - 1) / partitions;
+	for (std::size_t i = 0; i < partitions; ++i) {
+		std::string str;
+		if (i != 0) {
+			str += "ctid >= '(";
+			str += std::to_string(size * i);
+			str += ",0)'::tid";
+		}
+		if ((i + 1) != partitions) {
+			if (i != 0) str += " AND ";
+			str += "ctid < '(";
+			str += std::to_string(size * (i + 1));
+			str += ",0)'::tid";
+		}
+		if (str.empty()) str = "TRUE";
+		retr.push_back(std::move(str));
+	}
+	return retr;
+}
+
+//	Appends str quoted via PQescapeIdentifier or
+//	PQescapeLiteral, false is returned if libpq could
+//	not quote it (e.g. because it is not valid in the
+//	client encoding)
+inline bool append_identifier (connection & conn, std::string & out, const std::string & str) {
+	char * quoted = PQescapeIdentifier(conn, str.data(), str.size());
+	if (!quoted) return false;
+	out += quoted;
+	PQfreemem(quoted);
+	return true;
+}
+
+inline bool append_literal (connection & conn, std::string & out, const std::string & str) {
+	char * quoted = PQescapeLiteral(conn, str.data(), str.size());
+	if (!quoted) return false;
+	out += quoted;
+	PQfreemem(quoted);
+	return true;
+}
+
+template <typename Sink, typename Handler>
+class parallel_export_state : public std::enable_shared_from_this<parallel_export_state<Sink, Handler>> {
+private:
+	void start ();
+	//	Builds everything in the COPY commands other
+	//	than the predicates
+	bool quote (connection & conn) {
+		std::string relation;
+		if (!settings.schema.empty()) {
+			if (!append_identifier(conn, relation, settings.schema)) return false;
+			relation += '.';
+		}
+		if (!append_identifier(conn, relation, settings.table)) return false;
+		prefix = "COPY (SELECT ";
+		if (settings.columns.empty()) prefix += '*';
+		for (auto && column : settings.columns) {
+			if (&column != &settings.columns.front()) prefix += ", ";
+			if (!append_identifier(conn, prefix, column)) return false;
+		}
+		prefix += " FROM ";
+		prefix += relation;
+		prefix += " WHERE ";
+		suffix = ") TO STDOUT";
+		if (!settings.options.empty()) {
+			suffix += " (";
+			for (auto && option : settings.options) {
+				if (&option != &settings.options.front()) suffix += ", ";
+				if (!append_identifier(conn, suffix, option.first)) return false;
+				if (option.second.empty()) continue;
+				suffix += ' ';
+				if (!append_literal(conn, suffix, option.second)) return false;
+			}
+			suffix += ')';
+		}
+		if (predicates.empty()) {
+			size = ", pg_relation_size(";
+			if (!append_literal(conn, size, relation)) return false;
+			size += "::regclass) / current_setting('block_size')::bigint";
+		}
+		return true;
+	}
+	void snapshot (std::vector<result> rs) {
+		for (auto && r : rs) if (!command_succeeded(r)) {
+			fail(make_error_code(error::command_failed), std::move(r));
+			complete();
+			return;
+		}
+		if (
+			rs.empty() ||
+			(PQntuples(rs.back()) != 1) ||
+			(PQnfields(rs.back()) != (predicates.empty() ? 2 : 1))
+		) {
+			fail(make_error_code(error::command_failed));
+			complete();
+			return;
+		}
+		auto && r = rs.back();
+		id = PQgetvalue(r, 0, 0);
+		if (predicates.empty()) {
+			auto pages = std::strtoull(PQgetvalue(r, 0, 1), nullptr, 10);
+			auto partitions = settings.partitions;
+			if (partitions == 0) partitions = settings.workers * 4;
+			predicates = ctid_predicates(pages, partitions);
+		}
+		start();
+	}
+public:
+	parallel_export_state (asio_pq::pool & p, parallel_export_settings settings, Sink sink, Handler h)
+		:	pool(p),
+			settings(std::move(settings)),
+			sink(std::move(sink)),
+			handler(std::move(h)),
+			predicates(this->settings.predicates),
+			next(0),
+			running(0)
+	{	}
+	asio_pq::pool & pool;
+	parallel_export_settings settings;
+	Sink sink;
+	Handler handler;
+	parallel_export_progress progress;
+	boost::system::error_code error_code;
+	asio_pq::result result;
+	lease coordinator;
+	std::string id;
+	std::string prefix;
+	std::string suffix;
+	std::string size;
+	std::vector<std::string> predicates;
+	std::size_t next;
+	std::size_t running;
+	void begin () {
+		if (settings.table.empty() || (settings.workers == 0)) {
+			fail(make_error_code(boost::asio::error::invalid_argument));
+			complete();
+			return;
+		}
+		auto self = this->shared_from_this();
+		pool.async_acquire([self] (auto ec, auto l) {
+			if (ec) {
+				self->fail(ec);
+				self->complete();
+				return;
+			}
+			self->coordinator = std::move(l);
+			//	The transaction which exported the snapshot
+			//	must remain open until the workers have
+			//	imported it
+			if (!self->quote(*self->coordinator)) {
+				self->fail(make_error_code(error::command_failed));
+				self->complete();
+				return;
+			}
+			std::string command(
+				"BEGIN ISOLATION LEVEL REPEATABLE READ, READ ONLY;"
+				"SELECT pg_export_snapshot()"
+			);
+			command += self->size;
+			async_exec(*self->coordinator, command.c_str(), [self] (auto ec, auto rs) {
+				if (ec) {
+					self->fail(ec);
+					self->complete();
+					return;
+				}
+				self->snapshot(std::move(rs));
+			});
+		});
+	}
+	std::string command (std::size_t partition) const {
+		std::string retr(prefix);
+		retr += predicates[partition];
+		retr += suffix;
+		return retr;
+	}
+	void fail (boost::system::error_code ec, asio_pq::result r = asio_pq::result{}) {
+		if (error_code) return;
+		error_code = ec;
+		result = std::move(r);
+	}
+	void finished () {
+		assert(running != 0);
+		if (--running != 0) return;
+		if (error_code) {
+			complete();
+			return;
+		}
+		auto self = this->shared_from_this();
+		async_exec(*coordinator, "COMMIT", [self] (auto ec, auto) {
+			if (ec) self->fail(ec);
+			self->complete();
+		});
+	}
+	void complete () {
+		coordinator.reset();
+		post_completion(pool.get_io_service(), std::move(handler), error_code, progress, std::move(result));
+	}
+};
+
+//	Each worker imports the snapshot once and then
+//	exports partitions until there are none left
+template <typename State>
+class parallel_export_worker : public std::enable_shared_from_this<parallel_export_worker<State>> {
+private:
+	std::shared_ptr<State> state_;
+	lease lease_;
+	boost::optional<copy_out_stream> stream_;
+	std::size_t partition_;
+	void done () {
+		stream_ = boost::none;
+		lease_.reset();
+		state_->finished();
+	}
+	void fail (boost::system::error_code ec, result r = result{}) {
+		state_->fail(ec, std::move(r));
+		done();
+	}
+	void acquired (boost::system::error_code ec, lease l) {
+		if (ec) {
+			fail(ec);
+			return;
+		}
+		lease_ = std::move(l);
+		std::string command(
+			"BEGIN ISOLATION LEVEL REPEATABLE READ, READ ONLY;"
+			"SET TRANSACTION SNAPSHOT '"
+		);
+		command += state_->id;
+		command += '\'';
+		auto self = this->shared_from_this();
+		async_exec(*lease_, command.c_str(), [self] (auto ec, auto rs) {
+			if (ec) {
+				self->fail(ec);
+				return;
+			}
+			for (auto && r : rs) if (!command_succeeded(r)) {
+				self->fail(make_error_code(error::command_failed), std::move(r));
+				return;
+			}
+			self->next();
+		});
+	}
+	void next () {
+		auto self = this->shared_from_this();
+		if (state_->error_code) {
+			done();
+			return;
+		}
+		if (state_->next == state_->predicates.size()) {
+			async_exec(*lease_, "COMMIT", [self] (auto ec, auto) {
+				if (ec) {
+					self->fail(ec);
+					return;
+				}
+				self->done();
+			});
+			return;
+		}
+		partition_ = state_->next++;
+		async_copy_out(*lease_, state_->command(partition_).c_str(), [self] (auto ec, auto r) {
+			if (ec) {
+				self->fail(ec, std::move(r));
+				return;
+			}
+			self->stream_.emplace(*self->lease_);
+			self->read();
+		});
+	}
+	void read () {
+		auto self = this->shared_from_this();
+		stream_->async_read_chunk([self] (auto ec, auto chunk) {
+			self->chunk(ec, std::move(chunk));
+		});
+	}
+	void chunk (boost::system::error_code ec, copy_data chunk) {
+		if (ec == boost::asio::error::eof) {
+			end();
+			return;
+		}
+		if (ec) {
+			fail(ec);
+			return;
+		}
+		if (state_->error_code) {
+			//	Another worker failed, discarding the
+			//	connection abandons the COPY
+			done();
+			return;
+		}
+		auto && progress = state_->progress;
+		progress.bytes += chunk.size();
+		++progress.chunks;
+		state_->sink(partition_, std::move(chunk));
+		read();
+	}
+	void end () {
+		auto self = this->shared_from_this();
+		stream_->async_end([self] (auto ec, auto r) {
+			if (ec) {
+				self->fail(ec, std::move(r));
+				return;
+			}
+			if (PQresultStatus(r) != PGRES_COMMAND_OK) {
+				self->fail(make_error_code(error::copy_failed), std::move(r));
+				return;
+			}
+			auto && progress = self->state_->progress;
+			progress.rows += std::strtoull(PQcmdTuples(r), nullptr, 10);
+			++progress.partitions;
+			self->next();
+		});
+	}
+public:
+	explicit parallel_export_worker (std::shared_ptr<State> state) noexcept
+		:	state_(std::move(state)),
+			partition_(0)
+	{	}
+	void begin () {
+		auto self = this->shared_from_this();
+		state_->pool.async_acquire([self] (auto ec, auto l) {
+			self->acquired(ec, std::move(l));
+		});
+	}
+};
+
+template <typename Sink, typename Handler>
+void parallel_export_state<Sink, Handler>::start () {
+	running = std::min(settings.workers, predicates.size());
+	auto self = this->shared_from_this();
+	for (std::size_t i = 0; i < running; ++i) {
+		std::make_shared<parallel_export_worker<parallel_export_state>>(self)->begin();
+	}
+}
+
+}
+
+/**
+ *	Exports the contents of a table as they were at a
+ *	single point in time via several concurrent `COPY ... TO STDOUT`
+ *	commands, each on its own \ref connection acquired from
+ *	a \ref pool.
+ *
+ *	A coordinator connection begins a `REPEATABLE READ`
+ *	transaction and calls `pg_export_snapshot`. Each worker
+ *	connection then begins a transaction which uses the same
+ *	snapshot via `SET TRANSACTION SNAPSHOT` so that all workers
+ *	see exactly the same data (this is how `pg_dump` exports
+ *	in parallel). The table is divided into disjoint partitions
+ *	(ranges of `ctid`, which PostgreSQL 14+ scans efficiently, or
+ *	the conditions in \ref parallel_export_settings::predicates)
+ *	and each worker exports partitions until none remain.
+ *
+ *	Each chunk of data is passed to \em sink as it is received
+ *	without being copied. Chunks of different partitions are
+ *	interleaved but the chunks of each partition are passed in
+ *	order.
+ *
+ *	All operations are performed via the \ref pool and the
+ *	same single threaded restrictions apply. The \ref pool
+ *	must be able to provide one more connection than the
+ *	number of workers.
+ *
+ *	\tparam Sink
+ *		The type of a function object which accepts the
+ *		zero-relative index of a partition (a `std::size_t`)
+ *		and a \ref copy_data.
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] p
+ *		The \ref pool. The reference to this object must
+ *		remain valid for the lifetime of the asynchronous
+ *		operation or the behavior is undefined.
+ *	\param [in] settings
+ *		A \ref parallel_export_settings object.
+ *	\param [in] sink
+ *		The sink.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Three parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation (\ref error::command_failed
+ *		if establishing the snapshot failed or a name could not
+ *		be quoted, \ref error::copy_failed if a `COPY` failed on
+ *		the server, or `boost::asio::error::invalid_argument` if
+ *		\ref parallel_export_settings::table is empty or
+ *		\ref parallel_export_settings::workers is zero), a
+ *		\ref parallel_export_progress representing the data which
+ *		was received, and a \ref result which is the result which
+ *		indicated failure (if any). The completion handler is
+ *		invoked through its hooks and associated executor, never
+ *		from within this function.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename Sink, typename CompletionToken>
+auto async_parallel_export (
+	pool & p,
+	parallel_export_settings settings,
+	Sink sink,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_parallel_export_signature> init(token);
+	using state_type = detail::parallel_export_state<
+		Sink,
+		beast::handler_type<CompletionToken, detail::async_parallel_export_signature>
+	>;
+	auto state = std::make_shared<state_type>(
+		p,
+		std::move(settings),
+		std::move(sink),
+		std::move(init.completion_handler)
+	);
+	state->begin();
+	return init.result.get();
+}
+
+}
@@ -0,0 +1,524 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/endian.hpp"
+#include "detail/timestamp.hpp"
+#include "exec.hpp"
+#include "oid.hpp"
+#include <boost/asio/buffer.hpp>
+#include <boost/optional.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <libpq-fe.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+/**
+ *	Describes how values of a C++ type are sent to
+ *	the server as parameters in binary format.
+ *
+ *	Specializations provide:
+ *
+ *	- `storage_type`: A default constructible type
+ *	  which holds the encoded value (or refers to the
+ *	  caller's memory)
+ *	- `type`: The OID of the PostgreSQL type
+ *	- `array_type`: The OID of the corresponding
+ *	  PostgreSQL array type
+ *	- `static int encode (const T &, storage_type &)`:
+ *	  Encodes a value and returns its length in bytes
+ *	  or -1 for `NULL`
+ *	- `static const char * data (const storage_type &)`:
+ *	  Retrieves the encoded bytes
+ *
+ *	Specializations are provided for signed integers
+ *	of two, four, and eight bytes, `bool`, `float`,
+ *	`double`, `std::chrono::system_clock::time_point`
+ *	(as `timestamptz`), `boost::uuids::uuid`, `std::string`,
+ *	`boost::string_ref`, and `const char *` (as `text`),
+ *	`boost::asio::const_buffer` (as `bytea`), `std::nullptr_t`,
+ *	`boost::optional` of any supported type, and `std::vector`
+ *	of any supported type (as a one dimensional array).
+ *
+ *	\tparam T
+ *		The C++ type.
+ */
+template <typename T, typename = void>
+class param_traits;
+
+namespace detail {
+
+template <typename T, Oid Type, Oid ArrayType>
+class fixed_param_traits {
+public:
+	using storage_type = std::array<char, sizeof(T)>;
+	static constexpr Oid type = Type;
+	static constexpr Oid array_type = ArrayType;
+	static int encode (T value, storage_type & storage) noexcept {
+		store_value(value, storage.data());
+		return int(sizeof(T));
+	}
+	static const char * data (const storage_type & storage) noexcept {
+		return storage.data();
+	}
+};
+
+template <typename T, std::size_t Size = sizeof(T)>
+class integer_param_traits;
+template <typename T>
+class integer_param_traits<T, 2> : public fixed_param_traits<T, oid::int2, oid::int2_array> {	};
+template <typename T>
+class integer_param_traits<T, 4> : public fixed_param_traits<T, oid::int4, oid::int4_array> {	};
+template <typename T>
+class integer_param_traits<T, 8> : public fixed_param_traits<T, oid::int8, oid::int8_array> {	};
+
+class text_param_traits {
+public:
+	using storage_type = const char *;
+	static constexpr Oid type = oid::text;
+	static constexpr Oid array_type = oid::text_array;
+	static int encode (boost::string_ref value, storage_type & storage) noexcept {
+		storage = value.data();
+		return int(value.size());
+	}
+	static const char * data (storage_type storage) noexcept {
+		return storage;
+	}
+};
+
+//	Parameters of these types refer to the memory of
+//	the object they are encoded from (rather than to
+//	memory that object merely refers to) and therefore
+//	must not be encoded from temporaries
+template <typename T>
+class refers_to_value : public std::false_type {	};
+template <>
+class refers_to_value<std::string> : public std::true_type {	};
+template <typename T>
+class refers_to_value<boost::optional<T>> : public refers_to_value<T> {	};
+
+template <bool... Bs>
+class bool_pack;
+template <bool... Bs>
+using all_true = std::is_same<bool_pack<true, Bs...>, bool_pack<Bs..., true>>;
+
+//	An argument of type Arg may be encoded as a parameter
+//	of type T if it converts to T, it is not a temporary
+//	whose memory the parameter could refer to (e.g. a
+//	std::string encoded as a boost::string_ref), and, if
+//	T refers to the object it is encoded from, it is of
+//	type T (so that no temporary T is created)
+template <typename T, typename Arg>
+using encodable_from = std::integral_constant<
+	bool,
+	std::is_convertible<Arg, const T &>::value &&
+	(std::is_lvalue_reference<Arg>::value || !refers_to_value<std::decay_t<Arg>>::value) &&
+	(!refers_to_value<T>::value || std::is_same<std::decay_t<Arg>, T>::value)
+>;
+
+}
+
+template <typename T>
+class param_traits<
+	T,
+	std::enable_if_t<
+		std::is_integral<T>::value &&
+		std::is_signed<T>::value &&
+		(sizeof(T) > 1)
+	>
+> : public detail::integer_param_traits<T> {	};
+
+template <>
+class param_traits<float> : public detail::fixed_param_traits<float, oid::float4, oid::float4_array> {	};
+
+template <>
+class param_traits<double> : public detail::fixed_param_traits<double, oid::float8, oid::float8_array> {	};
+
+template <>
+class param_traits<bool> {
+public:
+	using storage_type = std::array<char, 1>;
+	static constexpr Oid type = oid::boolean;
+	static constexpr Oid array_type = oid::boolean_array;
+	static int encode (bool value, storage_type & storage) noexcept {
+		storage[0] = value ? 1 : 0;
+		return 1;
+	}
+	static const char * data (const storage_type & storage) noexcept {
+		return storage.data();
+	}
+};
+
+template <>
+class param_traits<detail::timestamp_type> {
+public:
+	using storage_type = std::array<char, 8>;
+	static constexpr Oid type = oid::timestamptz;
+	static constexpr Oid array_type = oid::timestamptz_array;
+	static int encode (detail::timestamp_type value, storage_type & storage) noexcept {
+		detail::store_value(detail::to_postgres_timestamp(value), storage.data());
+		return 8;
+	}
+	static const char * data (const storage_type & storage) noexcept {
+		return storage.data();
+	}
+};
+
+template <>
+class param_traits<boost::uuids::uuid> {
+public:
+	using storage_type = std::array<char, 16>;
+	static constexpr Oid type = oid::uuid;
+	static constexpr Oid array_type = oid::uuid_array;
+	static int encode (const boost::uuids::uuid & value, storage_type & storage) noexcept {
+		static_assert(sizeof(value.data) == 16, "UUIDs must be 16 bytes");
+		std::memcpy(storage.data(), value.data, 16);
+		return 16;
+	}
+	static const char * data (const storage_type & storage) noexcept {
+		return storage.data();
+	}
+};
+
+template <>
+class param_traits<std::string> : public detail::text_param_traits {	};
+
+template <>
+class param_traits<boost::string_ref> : public detail::text_param_traits {	};
+
+template <>
+class param_traits<const char *> {
+public:
+	using storage_type = const char *;
+	static constexpr Oid type = oid::text;
+	static constexpr Oid array_type = oid::text_array;
+	static int encode (const char * value, storage_type & storage) noexcept {
+		storage = value;
+		if (!value) return -1;
+		return int(std::strlen(value));
+	}
+	static const char * data (storage_type storage) noexcept {
+		return storage;
+	}
+};
+
+template <>
+class param_traits<boost::asio::const_buffer> {
+public:
+	using storage_type = const char *;
+	static constexpr Oid type = oid::bytea;
+	static constexpr Oid array_type = oid::bytea_array;
+	static int encode (const boost::asio::const_buffer & value, storage_type & storage) noexcept {
+		storage = boost::asio::buffer_cast<const char *>(value);
+		return int(boost::asio::buffer_size(value));
+	}
+	static const char * data (storage_type storage) noexcept {
+		return storage;
+	}
+};
+
+template <>
+class param_traits<std::nullptr_t> {
+public:
+	using storage_type = char;
+	static constexpr Oid type = oid::unspecified;
+	static int encode (std::nullptr_t, storage_type &) noexcept {
+		return -1;
+	}
+	static const char * data (storage_type) noexcept {
+		return nullptr;
+	}
+};
+
+template <typename T>
+class param_traits<boost::optional<T>> {
+private:
+	using base = param_traits<T>;
+public:
+	using storage_type = typename base::storage_type;
+	static constexpr Oid type = base::type;
+	static constexpr Oid array_type = base::array_type;
+	static int encode (const boost::optional<T> & value, storage_type & storage) {
+		if (!value) return -1;
+		return base::encode(*value, storage);
+	}
+	static const char * data (const storage_type & storage) noexcept {
+		return base::data(storage);
+	}
+};
+
+template <typename T>
+class param_traits<std::vector<T>> {
+private:
+	using element = param_traits<T>;
+	static void append (std::string & out, std::int32_t value) {
+		char buffer [4];
+		detail::store_value(value, buffer);
+		out.append(buffer, sizeof(buffer));
+	}
+public:
+	using storage_type = std::string;
+	static constexpr Oid type = element::array_type;
+	static int encode (const std::vector<T> & value, storage_type & storage) {
+		storage.clear();
+		append(storage, value.empty() ? 0 : 1);
+		//	The "has nulls" flag is patched below
+		append(storage, 0);
+		append(storage, std::int32_t(element::type));
+		if (!value.empty()) {
+			append(storage, std::int32_t(value.size()));
+			append(storage, 1);
+		}
+		bool has_null = false;
+		typename element::storage_type s{};
+		for (auto && v : value) {
+			int length = element::encode(v, s);
+			append(storage, length);
+			if (length < 0) {
+				has_null = true;
+				continue;
+			}
+			storage.append(element::data(s), std::size_t(length));
+		}
+		if (has_null) detail::store_value(std::int32_t(1), &storage[4]);
+		return int(storage.size());
+	}
+	static const char * data (const storage_type & storage) noexcept {
+		return storage.data();
+	}
+};
+
+/**
+ *	A set of parameters encoded in binary format
+ *	whose types and OIDs are determined at compile
+ *	time.
+ *
+ *	Values of fixed size types are encoded into
+ *	storage within this object and values of
+ *	variable size types (strings and buffers) refer
+ *	to the caller's memory, so no memory is allocated
+ *	unless a parameter is an array. Accordingly the
+ *	memory referred to by string and buffer parameters
+ *	must remain valid for the lifetime of this object
+ *	and parameters may not be encoded from temporary
+ *	`std::string` objects (including within a
+ *	`boost::optional`).
+ *
+ *	\tparam Args
+ *		The types of the parameters. \ref param_traits
+ *		must be specialized for each.
+ */
+template <typename... Args>
+class params {
+private:
+	using swallow = int [];
+	std::tuple<typename param_traits<Args>::storage_type...> storage_;
+	std::array<Oid, sizeof...(Args)> types_;
+	std::array<int, sizeof...(Args)> lengths_;
+	std::array<int, sizeof...(Args)> formats_;
+	template <std::size_t... Is>
+	void encode (std::index_sequence<Is...>, const Args &... args) {
+		(void)swallow{0, (lengths_[Is] = param_traits<Args>::encode(args, std::get<Is>(storage_)), 0)...};
+	}
+	template <std::size_t... Is>
+	void values (std::index_sequence<Is...>, const char ** out) const noexcept {
+		(void)swallow{0, (
+			out[Is] = (lengths_[Is] < 0) ? nullptr : param_traits<Args>::data(std::get<Is>(storage_)),
+			0
+		)...};
+	}
+public:
+	/**
+	 *	Encodes parameters.
+	 *
+	 *	\tparam Ts
+	 *		The types of the values. Each must be convertible
+	 *		to the corresponding type in \em Args. Values
+	 *		of type `std::string` (or a `boost::optional`
+	 *		thereof) must be lvalues and where the type in
+	 *		\em Args is `std::string` (or a `boost::optional`
+	 *		thereof) the value must be of that type.
+	 *
+	 *	\param [in] args
+	 *		The values of the parameters.
+	 */
+	template <
+		typename... Ts,
+		typename = std::enable_if_t<
+			(sizeof...(Ts) == sizeof...(Args)) &&
+			detail::all_true<detail::encodable_from<Args, Ts>::value...>::value
+		>
+	>
+	explicit params (Ts &&... args)
+		:	types_{{param_traits<Args>::type...}}
+	{
+		formats_.fill(1);
+		encode(std::index_sequence_for<Args...>{}, args...);
+	}
+	/**
+	 *	Retrieves the number of parameters.
+	 *
+	 *	\return
+	 *		The number of parameters.
+	 */
+	static constexpr std::size_t size () noexcept {
+		return sizeof...(Args);
+	}
+	/**
+	 *	Retrieves the OID of the type of each parameter
+	 *	suitable for passing to `PQsendQueryParams` et al.
+	 *
+	 *	\return
+	 *		A pointer to an array of size \ref size.
+	 */
+	const Oid * types () const noexcept {
+		return types_.data();
+	}
+	/**
+	 *	Retrieves the length in bytes of each parameter
+	 *	suitable for passing to `PQsendQueryParams` et al.
+	 *
+	 *	\return
+	 *		A pointer to an array of size \ref size.
+	 */
+	const int * lengths () const noexcept {
+		return lengths_.data();
+	}
+	/**
+	 *	Retrieves the format of each parameter (which is
+	 *	always binary) suitable for passing to `PQsendQueryParams`
+	 *	et al.
+	 *
+	 *	\return
+	 *		A pointer to an array of size \ref size.
+	 */
+	const int * formats () const noexcept {
+		return formats_.data();
+	}
+	/**
+	 *	Retrieves a pointer to the encoded value of each
+	 *	parameter suitable for passing to `PQsendQueryParams`
+	 *	et al.
+	 *
+	 *	Since pointers may refer to storage within this
+	 *	object they are only valid until this object is
+	 *	moved or destroyed.
+	 *
+	 *	\param [out] out
+	 *		A pointer to an array of size \ref size which
+	 *		shall receive the pointers. Null parameters are
+	 *		represented by null pointers.
+	 */
+	void values (const char ** out) const noexcept {
+		values(std::index_sequence_for<Args...>{}, out);
+	}
+};
+
+/**
+ *	Encodes parameters in binary format.
+ *
+ *	Arrays of characters (i.e. string literals) are
+ *	encoded as `const char *`.
+ *
+ *	`std::string` arguments (including within a
+ *	`boost::optional`) are referred to rather than
+ *	copied and therefore must be lvalues.
+ *
+ *	\param [in] args
+ *		The values of the parameters.
+ *
+ *	\return
+ *		A \ref params object.
+ */
+template <typename... Args>
+params<std::decay_t<Args>...> make_params (Args &&... args) {
+	static_assert(
+		detail::all_true<!(
+			std::is_rvalue_reference<Args &&>::value &&
+			detail::refers_to_value<std::decay_t<Args>>::value
+		)...>::value,
+		"std::string parameters refer to their argument which must therefore not be a temporary"
+	);
+	return params<std::decay_t<Args>...>(std::forward<Args>(args)...);
+}
+
+/**
+ *	Sends a command via `PQsendQueryParams` with
+ *	parameters encoded in binary format and
+ *	asynchronously retrieves all results thereof.
+ *
+ *	The parameters are passed as a \ref params object
+ *	(see \ref make_params) rather than as a parameter
+ *	pack: The completion token cannot be deduced after
+ *	a pack, and a pack followed by the token would
+ *	also match calls to the `PQsendQueryParams` form
+ *	of `async_exec_params` (e.g. where the parameter
+ *	count is `0` and the arrays are `nullptr`).
+ *
+ *	\tparam Args
+ *		The types of the parameters.
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must not have a pending
+ *		command. The reference to this object must remain
+ *		valid for the lifetime of the asynchronous operation
+ *		or the behavior is undefined.
+ *	\param [in] command
+ *		See the libpq manual entry for `PQsendQueryParams`.
+ *	\param [in] p
+ *		The parameters. This object need only remain valid
+ *		until this function returns.
+ *	\param [in] result_format
+ *		See the libpq manual entry for `PQsendQueryParams`.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a `std::vector` of
+ *		\ref result objects containing the results in the
+ *		order they were returned by the server.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename... Args, typename CompletionToken>
+auto async_exec_params (
+	connection & conn,
+	const char * command,
+	const params<Args...> & p,
+	int result_format,
+	CompletionToken && token
+) {
+	std::array<const char *, sizeof...(Args)> values;
+	p.values(values.data());
+	return async_exec_params(
+		conn,
+		command,
+		int(p.size()),
+		p.types(),
+		values.data(),
+		p.lengths(),
+		p.formats(),
+		result_format,
+		std::forward<CompletionToken>(token)
+	);
+}
+
+}
@@ -0,0 +1,170 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <chrono>
+#include <cstdint>
+
+namespace asio_pq {
+
+/**
+ *	The sets of vector instructions which may be
+ *	used to parse text.
+ */
+enum class simd_level {
+	/**
+	 *	No vector instructions.
+	 */
+	scalar,
+	/**
+	 *	SSE4.2 (and the earlier SSE extensions).
+	 */
+	sse42,
+	/**
+	 *	AVX2.
+	 */
+	avx2
+};
+
+/**
+ *	Determines the most capable \ref simd_level
+ *	supported by the processor.
+ *
+ *	This is determined only once.
+ *
+ *	\return
+ *		A \ref simd_level.
+ */
+simd_level supported_simd_level () noexcept;
+
+/**
+ *	Converts all values of a column of a \ref result
+ *	in text format in a single pass.
+ *
+ *	Integers (`std::int16_t`, `std::int32_t`, and `std::int64_t`)
+ *	are parsed with vector instructions where available.
+ *	Floating point values (`float` and `double`) are parsed
+ *	exactly, with a fast path for values with few significant
+ *	digits. Booleans (`bool`) are parsed from the `t` and `f`
+ *	the server produces. Timestamps (`std::chrono::system_clock::time_point`)
+ *	are parsed from the ISO format the server produces by default
+ *	(i.e. `DateStyle` of `ISO`) and if they have no UTC offset (i.e.
+ *	they are of type `timestamp`) they are taken to be UTC. Timestamps
+ *	in any other format, or which `std::chrono::system_clock::time_point`
+ *	cannot represent (e.g. outside roughly the years 1678 through
+ *	2261 where its ticks are nanoseconds), fail with
+ *	\ref error::decode_failed. `infinity` and `-infinity` are the
+ *	maximum and minimum values.
+ *
+ *	\param [in] r
+ *		The result.
+ *	\param [in] column
+ *		The zero-relative index of the column. This
+ *		column must be in text format.
+ *	\param [out] out
+ *		A pointer to an array of `PQntuples(r)` objects
+ *		which shall receive the values. Null values
+ *		are value initialized.
+ *	\param [out] validity
+ *		Either a null pointer or a pointer to `(PQntuples(r) + 7) / 8`
+ *		bytes which shall receive a bitmap wherein the least
+ *		significant bit of the first byte represents the first
+ *		row and a set bit represents a non-null value (i.e. an
+ *		Apache Arrow validity bitmap). If this is a null pointer
+ *		null values are errors.
+ *	\param [out] ec
+ *		A `boost::system::error_code` object which
+ *		shall be set to the result of the operation.
+ *		Note that if this object already represents
+ *		an error it will be cleared. If the column does
+ *		not exist or is not in text format this shall be
+ *		set to \ref error::type_mismatch. If a value is
+ *		null and \em validity is a null pointer this shall
+ *		be set to \ref error::unexpected_null. If a value
+ *		is malformed or out of range this shall be set to
+ *		\ref error::decode_failed.
+ *	\param [in] level
+ *		The \ref simd_level to use. If this is greater than
+ *		\ref supported_simd_level the latter is used instead.
+ *		Defaults to \ref supported_simd_level.
+ */
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	std::int16_t * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level = supported_simd_level()
+);
+/**
+ *	\copydoc parse_text_column(const PGresult *, int, std::int16_t *, std::uint8_t *, boost::system::error_code &, simd_level)
+ */
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	std::int32_t * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level = supported_simd_level()
+);
+/**
+ *	\copydoc parse_text_column(const PGresult *, int, std::int16_t *, std::uint8_t *, boost::system::error_code &, simd_level)
+ */
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	std::int64_t * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level = supported_simd_level()
+);
+/**
+ *	\copydoc parse_text_column(const PGresult *, int, std::int16_t *, std::uint8_t *, boost::system::error_code &, simd_level)
+ */
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	float * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level = supported_simd_level()
+);
+/**
+ *	\copydoc parse_text_column(const PGresult *, int, std::int16_t *, std::uint8_t *, boost::system::error_code &, simd_level)
+ */
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	double * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level = supported_simd_level()
+);
+/**
+ *	\copydoc parse_text_column(const PGresult *, int, std::int16_t *, std::uint8_t *, boost::system::error_code &, simd_level)
+ */
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	bool * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level = supported_simd_level()
+);
+/**
+ *	\copydoc parse_text_column(const PGresult *, int, std::int16_t *, std::uint8_t *, boost::system::error_code &, simd_level)
+ */
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	std::chrono::system_clock::time_point * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level = supported_simd_level()
+);
+
+}
@@ -0,0 +1,399 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include "error.hpp"
+#include "get_result.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef LIBPQ_HAS_PIPELINING
+#define ASIO_PQ_HAS_PIPELINE
+#endif
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+namespace asio_pq {
+
+/**
+ *	A sequence of commands which shall be sent
+ *	to the server together in libpq pipeline mode
+ *	by \ref async_pipeline.
+ *
+ *	All strings and parameter values are copied
+ *	so buffers passed to the member functions of
+ *	this class need not remain valid after the
+ *	call returns.
+ */
+class pipeline {
+private:
+	enum class command_type {
+		query,
+		prepare,
+		query_prepared,
+		describe_prepared
+	};
+	class entry {
+	public:
+		command_type type;
+		std::string name;
+		std::string text;
+		std::vector<Oid> types;
+		std::vector<boost::optional<std::string>> values;
+		std::vector<int> formats;
+		int result_format;
+	};
+	std::vector<entry> commands_;
+	static void copy_values (
+		entry & cmd,
+		int n_params,
+		const char * const * values,
+		const int * lengths,
+		const int * formats
+	);
+public:
+	/**
+	 *	Appends a command without parameters.
+	 *
+	 *	\param [in] command
+	 *		The text of the command. Only one SQL
+	 *		statement may be provided.
+	 *	\param [in] result_format
+	 *		See the libpq manual entry for `PQsendQueryParams`.
+	 *		Defaults to zero.
+	 */
+	void query (std::string command, int result_format = 0);
+	/**
+	 *	Appends a command with parameters.
+	 *
+	 *	All parameters have the same meaning as the
+	 *	parameters of the same name to `PQsendQueryParams`.
+	 */
+	void query (
+		std::string command,
+		int n_params,
+		const Oid * param_types,
+		const char * const * param_values,
+		const int * param_lengths,
+		const int * param_formats,
+		int result_format
+	);
+	/**
+	 *	Appends a request to create a prepared statement.
+	 *
+	 *	All parameters have the same meaning as the
+	 *	parameters of the same name to `PQsendPrepare`.
+	 */
+	void prepare (
+		std::string stmt_name,
+		std::string query,
+		int n_params = 0,
+		const Oid * param_types = nullptr
+	);
+	/**
+	 *	Appends a request to execute a prepared statement.
+	 *
+	 *	All parameters have the same meaning as the
+	 *	parameters of the same name to `PQsendQueryPrepared`.
+	 */
+	void query_prepared (
+		std::string stmt_name,
+		int n_params,
+		const char * const * param_values,
+		const int * param_lengths,
+		const int * param_formats,
+		int result_format
+	);
+	/**
+	 *	Appends a request for information about a
+	 *	prepared statement.
+	 *
+	 *	\param [in] stmt_name
+	 *		See the libpq manual entry for `PQsendDescribePrepared`.
+	 */
+	void describe_prepared (std::string stmt_name);
+	/**
+	 *	Retrieves the number of commands.
+	 *
+	 *	\return
+	 *		The number of commands.
+	 */
+	std::size_t size () const noexcept;
+	/**
+	 *	Determines whether there are any commands.
+	 *
+	 *	\return
+	 *		\em true if there are no commands, \em false
+	 *		otherwise.
+	 */
+	bool empty () const noexcept;
+	/**
+	 *	Removes all commands.
+	 */
+	void clear () noexcept;
+	/**
+	 *	\cond
+	 */
+	std::size_t send (PGconn * conn) const;
+	/**
+	 *	\endcond
+	 */
+};
+
+namespace detail {
+
+using async_pipeline_signature = void (boost::system::error_code, std::vector<result>);
+
+template <typename Handler>
+class async_pipeline_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, asio_pq::connection & conn, std::size_t size)
+			:	connection(conn),
+				sent(0),
+				index(0),
+				results(size)
+		{	}
+		asio_pq::connection & connection;
+		std::size_t sent;
+		std::size_t index;
+		boost::system::error_code error_code;
+		std::vector<result> results;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void begin_fail (boost::system::error_code ec) {
+		ptr_->error_code = ec;
+		boost::asio::io_service & ios = ptr_->connection.get_io_service();
+		ios.post(std::move(*this));
+	}
+	void complete (boost::system::error_code ec) {
+		auto results = std::move(ptr_->results);
+		ptr_.invoke(ec, std::move(results));
+	}
+	//	Results which were not retrieved cannot be drained
+	//	once the connection has failed or the operation was
+	//	cancelled so pipeline mode is only left if nothing
+	//	remains queued, otherwise the connection is left in
+	//	pipeline mode and cannot be used further
+	void fail (boost::system::error_code ec) {
+		PQexitPipelineMode(ptr_->connection);
+		complete(ec);
+	}
+	void next () {
+		connection & conn = ptr_->connection;
+		async_get_result(conn, std::move(*this));
+	}
+public:
+	async_pipeline_op () = delete;
+	async_pipeline_op (const async_pipeline_op &) = default;
+	async_pipeline_op (async_pipeline_op &&) = default;
+	async_pipeline_op & operator = (const async_pipeline_op &) = default;
+	async_pipeline_op & operator = (async_pipeline_op &&) = default;
+	template <typename DeducedHandler>
+	async_pipeline_op (connection & conn, std::size_t size, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn, size)
+	{	}
+	void begin (const pipeline & p) {
+		connection & conn = ptr_->connection;
+		if (p.empty()) {
+			begin_fail(boost::system::error_code{});
+			return;
+		}
+		if (PQenterPipelineMode(conn) == 0) {
+			begin_fail(make_error_code(error::send_failed));
+			return;
+		}
+		ptr_->sent = p.send(conn);
+		//	Commands which were successfully queued
+		//	must still be synchronized and drained
+		//	so the failure is only reported once
+		//	that has happened
+		if (ptr_->sent != p.size()) ptr_->error_code = make_error_code(error::send_failed);
+		if (PQpipelineSync(conn) == 0) {
+			//	Without a synchronization point the commands
+			//	which were queued cannot be drained
+			PQexitPipelineMode(conn);
+			begin_fail(make_error_code(error::send_failed));
+			return;
+		}
+		next();
+	}
+	void operator () () {
+		complete(ptr_->error_code);
+	}
+	void operator () (boost::system::error_code ec, result r) {
+		if (ec) {
+			fail(ec);
+			return;
+		}
+		//	Each command's results are terminated by
+		//	a null PGresult *
+		if (!r) {
+			++ptr_->index;
+			next();
+			return;
+		}
+		if (PQresultStatus(r) == PGRES_PIPELINE_SYNC) {
+			assert(ptr_->index == ptr_->sent);
+			if ((PQexitPipelineMode(ptr_->connection) == 0) && !ptr_->error_code) {
+				ptr_->error_code = make_error_code(error::send_failed);
+			}
+			complete(ptr_->error_code);
+			return;
+		}
+		//	If a command yields more than one result
+		//	(i.e. in single row mode) only the last is
+		//	retained
+		if (ptr_->index < ptr_->results.size()) ptr_->results[ptr_->index] = std::move(r);
+		next();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_pipeline_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_pipeline_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_pipeline_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_pipeline_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+/**
+ *	Asynchronously sends all commands in a \ref pipeline
+ *	to the server in a single batch using libpq pipeline
+ *	mode and retrieves the result of each.
+ *
+ *	The connection enters pipeline mode, all commands
+ *	are queued followed by a single synchronization point,
+ *	and the connection leaves pipeline mode once the
+ *	synchronization point has been reached. Therefore all
+ *	commands together cost a single round trip.
+ *
+ *	Per the semantics of pipeline mode once a command
+ *	fails all subsequent commands are not executed and
+ *	their results have status `PGRES_PIPELINE_ABORTED`.
+ *	This is not considered a failure of the operation.
+ *
+ *	If the operation itself fails after commands were
+ *	queued (i.e. because the connection failed or the
+ *	operation was cancelled via \ref cancel) the results
+ *	which were not yet retrieved cannot be drained so the
+ *	\ref connection is left in pipeline mode (see
+ *	`PQpipelineStatus`) and must be discarded. Commands
+ *	which could not be queued do not cause this: Those
+ *	which were queued are drained and the \ref connection
+ *	leaves pipeline mode before the operation completes
+ *	with \ref error::send_failed. A \ref pool does not
+ *	reuse connections which are in pipeline mode.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must be in non-blocking
+ *		mode and must not have a pending command or the
+ *		behavior is undefined. The reference to this
+ *		object must remain valid for the lifetime of the
+ *		asynchronous operation or the behavior is undefined.
+ *	\param [in] p
+ *		The \ref pipeline. This object is not referenced
+ *		once this function returns.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a `std::vector` of
+ *		\ref result objects containing the result of each
+ *		command in the order the commands were added to
+ *		\em p.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_pipeline (
+	connection & conn,
+	const pipeline & p,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_pipeline_signature> init(token);
+	detail::async_pipeline_op<
+		beast::handler_type<CompletionToken, detail::async_pipeline_signature>
+	> op(
+		conn,
+		p.size(),
+		std::move(init.completion_handler)
+	);
+	op.begin(p);
+	return init.result.get();
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_pipeline_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_pipeline_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_pipeline_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_pipeline_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
+
+#endif
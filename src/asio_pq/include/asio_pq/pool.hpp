@@ -0,0 +1,454 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#ifdef ASIO_PQ_HAS_EXECUTORS
+#include <boost/asio/post.hpp>
+#endif
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+/**
+ *	Specifies the limits within which a \ref pool
+ *	operates.
+ */
+class pool_settings {
+public:
+	/**
+	 *	The number of connections the \ref pool
+	 *	shall attempt to keep established (whether
+	 *	idle or leased) at all times.
+	 */
+	std::size_t min_size = 0;
+	/**
+	 *	The maximum number of connections (idle,
+	 *	leased, or connecting) the \ref pool may
+	 *	manage at once.
+	 */
+	std::size_t max_size = 16;
+	/**
+	 *	The maximum number of connection attempts
+	 *	the \ref pool may have pending at once.
+	 */
+	std::size_t max_connecting = 4;
+};
+
+class pool;
+
+/**
+ *	An RAII object which represents exclusive use
+ *	of a \ref connection acquired from a \ref pool.
+ *
+ *	When this object is destroyed the \ref connection
+ *	is returned to the \ref pool from which it was
+ *	acquired. Connections which are no longer usable
+ *	(i.e. those which are not in state `CONNECTION_OK`,
+ *	those with a transaction in progress, and those
+ *	upon which \ref cancel was invoked) are not reused.
+ */
+class lease {
+private:
+	pool * pool_;
+	boost::optional<connection> conn_;
+public:
+	lease (const lease &) = delete;
+	lease & operator = (const lease &) = delete;
+	/**
+	 *	Creates a lease which does not represent
+	 *	a \ref connection.
+	 */
+	lease () noexcept;
+	lease (lease &&) noexcept;
+	lease & operator = (lease &&) noexcept;
+	/**
+	 *	Returns the \ref connection (if any) to the
+	 *	\ref pool.
+	 */
+	~lease () noexcept;
+	/**
+	 *	Returns the \ref connection (if any) to the
+	 *	\ref pool before this object is destroyed.
+	 */
+	void reset () noexcept;
+	/**
+	 *	Retrieves the leased \ref connection.
+	 *
+	 *	It must be the case that `!!*this` is \em true
+	 *	or the behavior is undefined.
+	 *
+	 *	\return
+	 *		A reference to a \ref connection.
+	 */
+	connection & get () noexcept;
+	/**
+	 *	Retrieves the leased \ref connection.
+	 *
+	 *	It must be the case that `!!*this` is \em true
+	 *	or the behavior is undefined.
+	 *
+	 *	\return
+	 *		A reference to a \ref connection.
+	 */
+	connection & operator * () noexcept;
+	/**
+	 *	Retrieves the leased \ref connection.
+	 *
+	 *	It must be the case that `!!*this` is \em true
+	 *	or the behavior is undefined.
+	 *
+	 *	\return
+	 *		A pointer to a \ref connection.
+	 */
+	connection * operator -> () noexcept;
+	/**
+	 *	Determines whether or not this object
+	 *	represents a \ref connection.
+	 *
+	 *	\return
+	 *		\em true if this object represents a
+	 *		\ref connection, \em false otherwise.
+	 */
+	explicit operator bool () const noexcept;
+	/**
+	 *	\cond
+	 */
+	lease (pool & p, connection conn) noexcept;
+	/**
+	 *	\endcond
+	 */
+};
+
+namespace detail {
+
+using async_acquire_signature = void (boost::system::error_code, lease);
+
+template <typename Handler>
+class async_acquire_wrapper {
+private:
+	class state {
+	public:
+		state (const Handler &, boost::system::error_code ec, lease l)
+			:	ec(ec),
+				l(std::move(l))
+		{	}
+		boost::system::error_code ec;
+		lease l;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+public:
+	async_acquire_wrapper () = delete;
+	async_acquire_wrapper (const async_acquire_wrapper &) = default;
+	async_acquire_wrapper (async_acquire_wrapper &&) = default;
+	async_acquire_wrapper & operator = (const async_acquire_wrapper &) = default;
+	async_acquire_wrapper & operator = (async_acquire_wrapper &&) = default;
+	template <typename DeducedHandler>
+	async_acquire_wrapper (DeducedHandler && h, boost::system::error_code ec, lease l)
+		:	ptr_(std::forward<DeducedHandler>(h), ec, std::move(l))
+	{	}
+	void operator () () {
+		auto ec = ptr_->ec;
+		lease l(std::move(ptr_->l));
+		ptr_.invoke(ec, std::move(l));
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_acquire_wrapper * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_acquire_wrapper * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_acquire_wrapper * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_acquire_wrapper * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+//	Both a connection which was idle and one for which
+//	the handler waited are delivered this way so that
+//	the handler is always invoked on its own executor
+template <typename Handler>
+void post_acquire (boost::asio::io_service & ios, async_acquire_wrapper<Handler> wrapper) {
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	auto ex = boost::asio::get_associated_executor(wrapper, ios.get_executor());
+	boost::asio::post(ex, std::move(wrapper));
+	#else
+	ios.post(std::move(wrapper));
+	#endif
+}
+
+class pool_waiter_base {
+public:
+	pool_waiter_base () = default;
+	pool_waiter_base (const pool_waiter_base &) = delete;
+	pool_waiter_base & operator = (const pool_waiter_base &) = delete;
+	virtual ~pool_waiter_base () noexcept;
+	virtual void complete (boost::asio::io_service & ios, boost::system::error_code ec, lease l) = 0;
+};
+
+template <typename Handler>
+class pool_waiter : public pool_waiter_base {
+private:
+	Handler h_;
+public:
+	explicit pool_waiter (Handler h)
+		:	h_(std::move(h))
+	{	}
+	virtual void complete (boost::asio::io_service & ios, boost::system::error_code ec, lease l) override {
+		//	Waiters are completed from within whichever
+		//	operation made a connection available
+		post_acquire(ios, async_acquire_wrapper<Handler>(std::move(h_), ec, std::move(l)));
+	}
+};
+
+}
+
+/**
+ *	Maintains a set of \ref connection objects
+ *	connected to a PostgreSQL server and leases
+ *	them out on demand.
+ *
+ *	Connections handed out by this object have
+ *	already been connected via \ref async_connect
+ *	and placed in non-blocking mode via
+ *	`PQsetnonblocking`.
+ *
+ *	This object performs no synchronization. Its
+ *	member functions, the destruction and \ref lease::reset
+ *	of \ref lease objects obtained from it, and the
+ *	completion of the connection attempts it begins
+ *	(which are not bound to a strand) must not occur
+ *	concurrently. Therefore the `boost::asio::io_service`
+ *	must be run by a single thread and the \ref pool
+ *	and its \ref lease objects must only be used from
+ *	that thread (or while it is not running). The
+ *	\ref pool must outlive all \ref lease objects
+ *	obtained from it and all pending asynchronous
+ *	operations against it or the behavior is undefined.
+ */
+class pool {
+public:
+	/**
+	 *	The type of a function object which may be
+	 *	used to create new connections.
+	 */
+	using factory_type = std::function<connection (boost::asio::io_service &)>;
+private:
+	friend class lease;
+	using list_type = std::list<connection>;
+	class connect_handler {
+	private:
+		pool * self_;
+		list_type::iterator iter_;
+	public:
+		connect_handler (pool & self, list_type::iterator iter) noexcept;
+		void operator () (boost::system::error_code ec);
+	};
+	boost::asio::io_service & ios_;
+	factory_type factory_;
+	pool_settings settings_;
+	std::vector<connection> idle_;
+	list_type connecting_;
+	std::size_t leased_;
+	std::deque<std::unique_ptr<detail::pool_waiter_base>> waiters_;
+	std::size_t total () const noexcept;
+	void replenish (bool fill);
+	void connected (list_type::iterator iter, boost::system::error_code ec);
+	void put (connection conn);
+	void release (connection conn) noexcept;
+	boost::optional<connection> take ();
+public:
+	pool () = delete;
+	pool (const pool &) = delete;
+	pool (pool &&) = delete;
+	pool & operator = (const pool &) = delete;
+	pool & operator = (pool &&) = delete;
+	/**
+	 *	Creates a new pool which creates connections
+	 *	by invoking a function object.
+	 *
+	 *	If \em settings specifies a non-zero minimum
+	 *	size connection attempts are begun immediately.
+	 *
+	 *	\param [in] ios
+	 *		The `boost::asio::io_service` which shall be
+	 *		used to dispatch asynchronous operations.
+	 *	\param [in] factory
+	 *		A function object which shall be invoked
+	 *		with \em ios to create each new \ref connection.
+	 *	\param [in] settings
+	 *		The limits within which the pool shall
+	 *		operate.
+	 */
+	pool (boost::asio::io_service & ios, factory_type factory, pool_settings settings = pool_settings{});
+	/**
+	 *	Creates a new pool which creates connections
+	 *	from a connection info string.
+	 *
+	 *	If \em settings specifies a non-zero minimum
+	 *	size connection attempts are begun immediately.
+	 *
+	 *	\param [in] ios
+	 *		The `boost::asio::io_service` which shall be
+	 *		used to dispatch asynchronous operations.
+	 *	\param [in] conninfo
+	 *		See the libpq manual entry for `PGconnectStart`.
+	 *	\param [in] settings
+	 *		The limits within which the pool shall
+	 *		operate.
+	 */
+	pool (boost::asio::io_service & ios, std::string conninfo, pool_settings settings = pool_settings{});
+	/**
+	 *	Retrieves the `boost::asio::io_service` associated
+	 *	with this object.
+	 *
+	 *	\return
+	 *		A reference to a `boost::asio::io_service`.
+	 */
+	boost::asio::io_service & get_io_service () const noexcept;
+	/**
+	 *	Retrieves the number of idle connections.
+	 *
+	 *	\return
+	 *		The number of idle connections.
+	 */
+	std::size_t idle () const noexcept;
+	/**
+	 *	Retrieves the number of connections which
+	 *	are currently leased.
+	 *
+	 *	\return
+	 *		The number of leased connections.
+	 */
+	std::size_t leased () const noexcept;
+	/**
+	 *	Retrieves the number of pending connection
+	 *	attempts.
+	 *
+	 *	\return
+	 *		The number of pending connection attempts.
+	 */
+	std::size_t connecting () const noexcept;
+	/**
+	 *	Retrieves the number of pending calls to
+	 *	\ref async_acquire.
+	 *
+	 *	\return
+	 *		The number of pending acquisitions.
+	 */
+	std::size_t waiting () const noexcept;
+	/**
+	 *	Asynchronously acquires a \ref connection.
+	 *
+	 *	If an idle \ref connection is available it is
+	 *	handed out without connecting or waiting (the
+	 *	completion handler is nonetheless posted rather
+	 *	than invoked from within this function). Idle
+	 *	connections which are no longer usable (e.g.
+	 *	because the server closed them) are discarded
+	 *	rather than handed out. Otherwise the request is
+	 *	queued and satisfied in first in, first out order
+	 *	as connections are established or returned.
+	 *
+	 *	The completion handler is invoked on its
+	 *	associated executor.
+	 *
+	 *	\tparam CompletionToken
+	 *		The type of completion token an instance
+	 *		of which shall be used to notify the caller
+	 *		of completion.
+	 *
+	 *	\param [in] token
+	 *		The completion token which shall be used to notify
+	 *		the caller of completion. Two parameters are provided:
+	 *		An instance of `boost::system::error_code` representing
+	 *		the result of the operation and a \ref lease representing
+	 *		the acquired \ref connection (if applicable).
+	 *
+	 *	\return
+	 *		Whatever is appropriate given \em CompletionToken.
+	 */
+	template <typename CompletionToken>
+	auto async_acquire (CompletionToken && token) {
+		beast::async_completion<CompletionToken, detail::async_acquire_signature> init(token);
+		using handler_type = beast::handler_type<CompletionToken, detail::async_acquire_signature>;
+		if (auto conn = take()) {
+			++leased_;
+			detail::post_acquire(
+				ios_,
+				detail::async_acquire_wrapper<handler_type>(
+					std::move(init.completion_handler),
+					boost::system::error_code{},
+					lease(*this, std::move(*conn))
+				)
+			);
+			replenish(true);
+			return init.result.get();
+		}
+		waiters_.push_back(
+			std::make_unique<detail::pool_waiter<handler_type>>(
+				std::move(init.completion_handler)
+			)
+		);
+		replenish(true);
+		return init.result.get();
+	}
+};
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_acquire_wrapper<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_acquire_wrapper<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_acquire_wrapper<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_acquire_wrapper<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,574 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include "exec.hpp"
+#include "notification_dispatcher.hpp"
+#include "params.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+/**
+ *	Specifies the limits within which a
+ *	\ref result_cache operates.
+ */
+class result_cache_settings {
+public:
+	/**
+	 *	The amount of time for which a \ref result
+	 *	may be served from the cache after it was
+	 *	retrieved from the server.
+	 */
+	std::chrono::steady_clock::duration ttl = std::chrono::seconds(60);
+	/**
+	 *	The maximum number of bytes of \ref result
+	 *	objects the cache may hold. When this would be
+	 *	exceeded the least recently used entries are
+	 *	evicted. Results larger than this are never
+	 *	cached.
+	 */
+	std::size_t max_bytes = 64 * 1024 * 1024;
+};
+
+/**
+ *	A least recently used cache which maps the text
+ *	of SQL commands together with the bytes of their
+ *	parameters to the \ref result thereof.
+ *
+ *	Results are shared and immutable: A cache hit
+ *	yields the same `std::shared_ptr` every time and
+ *	the `PGresult` is never copied.
+ *
+ *	Each entry may carry any number of tags (e.g. the
+ *	names of the tables it was read from) and all
+ *	entries with a certain tag may be invalidated at
+ *	once, either directly via \ref invalidate or when
+ *	a notification arrives on a channel the cache
+ *	listens to (see \ref listen).
+ *
+ *	Caching is opt in: Only commands executed via
+ *	\ref async_exec_result_cached are cached.
+ *
+ *	Keys computed from a \ref connection distinguish
+ *	the server, database, and role the \ref connection
+ *	was established with but not the state of its session
+ *	(e.g. `search_path` or `SET ROLE`). Only connections
+ *	whose sessions are configured identically may share a
+ *	cache.
+ */
+class result_cache {
+public:
+	/**
+	 *	The type of a cached \ref result.
+	 */
+	using value_type = std::shared_ptr<const result>;
+	/**
+	 *	The clock against which entries expire.
+	 */
+	using clock_type = std::chrono::steady_clock;
+private:
+	class entry {
+	public:
+		std::string key;
+		value_type value;
+		std::size_t bytes;
+		clock_type::time_point expires;
+		std::vector<std::string> tags;
+	};
+	using list_type = std::list<entry>;
+	list_type lru_;
+	std::unordered_map<std::string, list_type::iterator> map_;
+	std::unordered_map<std::string, std::vector<list_type::iterator>> tags_;
+	result_cache_settings settings_;
+	std::size_t bytes_;
+	std::size_t hits_;
+	std::size_t misses_;
+	void erase (list_type::iterator iter);
+public:
+	//	Subscriptions created by listen refer to
+	//	this object
+	result_cache (const result_cache &) = delete;
+	result_cache (result_cache &&) = delete;
+	result_cache & operator = (const result_cache &) = delete;
+	result_cache & operator = (result_cache &&) = delete;
+	/**
+	 *	Creates an empty result_cache.
+	 *
+	 *	\param [in] settings
+	 *		The limits within which the cache shall
+	 *		operate.
+	 */
+	explicit result_cache (result_cache_settings settings = result_cache_settings{});
+	/**
+	 *	Computes the key under which the result of a
+	 *	command is cached.
+	 *
+	 *	All parameters not documented have the same
+	 *	meaning as the parameters of the same name to
+	 *	`PQsendQueryParams`.
+	 *
+	 *	\return
+	 *		A string which contains the command, the
+	 *		result format, and the type, format, and
+	 *		bytes of each parameter.
+	 */
+	static std::string make_key (
+		const std::string & command,
+		int n_params,
+		const Oid * param_types,
+		const char * const * param_values,
+		const int * param_lengths,
+		const int * param_formats,
+		int result_format
+	);
+	/**
+	 *	Computes the key under which the result of a
+	 *	command executed on a certain \ref connection is
+	 *	cached.
+	 *
+	 *	\param [in] conn
+	 *		The \ref connection. Its host, port, database,
+	 *		and user become part of the key.
+	 *
+	 *	All other parameters have the same meaning as in
+	 *	the overload which does not accept a \ref connection.
+	 *
+	 *	\return
+	 *		A string which contains the identity of the
+	 *		\ref connection followed by everything the
+	 *		other overload includes.
+	 */
+	static std::string make_key (
+		const connection & conn,
+		const std::string & command,
+		int n_params,
+		const Oid * param_types,
+		const char * const * param_values,
+		const int * param_lengths,
+		const int * param_formats,
+		int result_format
+	);
+	/**
+	 *	Looks up an entry, removing it if it has expired.
+	 *
+	 *	\param [in] key
+	 *		The key (see \ref make_key).
+	 *	\param [in] now
+	 *		The current time.
+	 *
+	 *	\return
+	 *		The cached \ref result, or a null pointer if
+	 *		there is no such entry.
+	 */
+	value_type find (const std::string & key, clock_type::time_point now = clock_type::now());
+	/**
+	 *	Adds or replaces an entry and evicts least recently
+	 *	used entries as necessary to honor
+	 *	\ref result_cache_settings::max_bytes.
+	 *
+	 *	\param [in] key
+	 *		The key (see \ref make_key).
+	 *	\param [in] value
+	 *		The \ref result. Must not be null.
+	 *	\param [in] tags
+	 *		The tags with which the entry may later be
+	 *		invalidated. Duplicates are ignored.
+	 *	\param [in] now
+	 *		The current time.
+	 *
+	 *	\return
+	 *		\em true if the entry was added, \em false if
+	 *		it is too large to be cached.
+	 */
+	bool insert (
+		std::string key,
+		value_type value,
+		std::vector<std::string> tags,
+		clock_type::time_point now = clock_type::now()
+	);
+	/**
+	 *	Removes every entry with a certain tag.
+	 *
+	 *	\param [in] tag
+	 *		The tag.
+	 *
+	 *	\return
+	 *		The number of entries removed.
+	 */
+	std::size_t invalidate (const std::string & tag);
+	/**
+	 *	Removes every entry.
+	 */
+	void clear () noexcept;
+	/**
+	 *	Arranges for entries to be invalidated when a
+	 *	notification arrives on a certain channel: The
+	 *	payload of the notification is the tag to
+	 *	invalidate, an empty payload invalidates every
+	 *	entry.
+	 *
+	 *	The consumer remains responsible for issuing
+	 *	`LISTEN` (see \ref notification_dispatcher).
+	 *	This object must outlive the subscription (for
+	 *	which reason it may not be moved).
+	 *
+	 *	\param [in] dispatcher
+	 *		The \ref notification_dispatcher.
+	 *	\param [in] channel
+	 *		The name of the channel.
+	 *
+	 *	\return
+	 *		A token which may be passed to
+	 *		\ref notification_dispatcher::unsubscribe.
+	 */
+	notification_dispatcher::subscription listen (notification_dispatcher & dispatcher, std::string channel);
+	/**
+	 *	Retrieves the number of entries.
+	 *
+	 *	\return
+	 *		The number of entries.
+	 */
+	std::size_t size () const noexcept;
+	/**
+	 *	Retrieves the number of bytes of \ref result
+	 *	objects held.
+	 *
+	 *	\return
+	 *		The number of bytes.
+	 */
+	std::size_t bytes () const noexcept;
+	/**
+	 *	Retrieves the number of lookups via \ref find
+	 *	which found an entry.
+	 *
+	 *	\return
+	 *		The number of hits.
+	 */
+	std::size_t hits () const noexcept;
+	/**
+	 *	Retrieves the number of lookups via \ref find
+	 *	which did not find an entry.
+	 *
+	 *	\return
+	 *		The number of misses.
+	 */
+	std::size_t misses () const noexcept;
+};
+
+namespace detail {
+
+using async_exec_result_cached_signature = void (boost::system::error_code, result_cache::value_type);
+
+template <typename Handler>
+class async_exec_result_cached_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, result_cache & cache, std::string key, std::vector<std::string> tags)
+			:	cache(cache),
+				key(std::move(key)),
+				tags(std::move(tags))
+		{	}
+		result_cache & cache;
+		std::string key;
+		std::vector<std::string> tags;
+		result_cache::value_type value;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+public:
+	async_exec_result_cached_op () = delete;
+	async_exec_result_cached_op (const async_exec_result_cached_op &) = default;
+	async_exec_result_cached_op (async_exec_result_cached_op &&) = default;
+	async_exec_result_cached_op & operator = (const async_exec_result_cached_op &) = default;
+	async_exec_result_cached_op & operator = (async_exec_result_cached_op &&) = default;
+	template <typename DeducedHandler>
+	async_exec_result_cached_op (result_cache & cache, std::string key, std::vector<std::string> tags, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), cache, std::move(key), std::move(tags))
+	{	}
+	void begin (
+		connection & conn,
+		const char * command,
+		int n_params,
+		const Oid * param_types,
+		const char * const * param_values,
+		const int * param_lengths,
+		const int * param_formats,
+		int result_format
+	) {
+		ptr_->value = ptr_->cache.find(ptr_->key);
+		if (ptr_->value) {
+			boost::asio::io_service & ios = conn.get_io_service();
+			ios.post(std::move(*this));
+			return;
+		}
+		async_exec_params(
+			conn,
+			command,
+			n_params,
+			param_types,
+			param_values,
+			param_lengths,
+			param_formats,
+			result_format,
+			std::move(*this)
+		);
+	}
+	void operator () () {
+		auto value = std::move(ptr_->value);
+		ptr_.invoke(boost::system::error_code{}, std::move(value));
+	}
+	void operator () (boost::system::error_code ec, std::vector<result> rs) {
+		result_cache::value_type value;
+		if (!rs.empty()) value = std::make_shared<const result>(std::move(rs.back()));
+		//	Only the result of a single SELECT is cached:
+		//	INSERT, UPDATE, and DELETE with RETURNING also
+		//	yield PGRES_TUPLES_OK but their command tag
+		//	differs. Whether a SELECT is free of side effects
+		//	(e.g. calls nextval) cannot be determined here,
+		//	the caller opts in by using this operation.
+		if (
+			!ec &&
+			(rs.size() == 1) &&
+			(PQresultStatus(*value) == PGRES_TUPLES_OK) &&
+			(std::strncmp(PQcmdStatus(*value), "SELECT ", 7) == 0)
+		) {
+			state & s = *ptr_;
+			s.cache.insert(std::move(s.key), value, std::move(s.tags));
+		}
+		ptr_.invoke(ec, std::move(value));
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_exec_result_cached_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_exec_result_cached_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_exec_result_cached_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_exec_result_cached_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+/**
+ *	Asynchronously executes a command through a
+ *	\ref result_cache.
+ *
+ *	If an unexpired entry exists for the command and
+ *	its parameters the cached \ref result is delivered
+ *	without a round trip to the server. Otherwise the
+ *	command is sent via `PQsendQueryParams` and, if it
+ *	is a single `SELECT` which succeeds with status
+ *	`PGRES_TUPLES_OK`, its result is cached. Data modifying
+ *	commands (even with `RETURNING`) are never cached but
+ *	a `SELECT` with side effects or whose result is not a
+ *	function of its text and parameters (e.g. one which
+ *	calls `nextval` or `random`) must not be executed via
+ *	this function.
+ *
+ *	All parameters not documented have the same
+ *	meaning as the parameters of the same name to
+ *	`PQsendQueryParams`. Parameters need only remain
+ *	valid until this function returns.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must not have a pending
+ *		command. The reference to this object must remain
+ *		valid for the lifetime of the asynchronous operation
+ *		or the behavior is undefined.
+ *	\param [in] cache
+ *		The \ref result_cache. Unlike a \ref statement_cache
+ *		it may be shared by any number of connections whose
+ *		sessions are configured identically (see
+ *		\ref result_cache). The reference to this object must
+ *		remain valid for the lifetime of the asynchronous
+ *		operation or the behavior is undefined.
+ *	\param [in] tags
+ *		The tags with which the cached result may later be
+ *		invalidated (see \ref result_cache::invalidate).
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a `std::shared_ptr` to
+ *		the \ref result of the command (which must not be
+ *		modified).
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_exec_result_cached (
+	connection & conn,
+	result_cache & cache,
+	const std::string & command,
+	std::vector<std::string> tags,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_exec_result_cached_signature> init(token);
+	detail::async_exec_result_cached_op<
+		beast::handler_type<CompletionToken, detail::async_exec_result_cached_signature>
+	> op(
+		cache,
+		result_cache::make_key(
+			conn,
+			command,
+			n_params,
+			param_types,
+			param_values,
+			param_lengths,
+			param_formats,
+			result_format
+		),
+		std::move(tags),
+		std::move(init.completion_handler)
+	);
+	op.begin(
+		conn,
+		command.c_str(),
+		n_params,
+		param_types,
+		param_values,
+		param_lengths,
+		param_formats,
+		result_format
+	);
+	return init.result.get();
+}
+
+/**
+ *	Asynchronously executes a command with parameters
+ *	encoded in binary format through a \ref result_cache.
+ *
+ *	\tparam Args
+ *		The types of the parameters.
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		See \ref async_exec_result_cached.
+ *	\param [in] cache
+ *		See \ref async_exec_result_cached.
+ *	\param [in] command
+ *		See the libpq manual entry for `PQsendQueryParams`.
+ *	\param [in] tags
+ *		See \ref async_exec_result_cached.
+ *	\param [in] p
+ *		The parameters. This object need only remain valid
+ *		until this function returns.
+ *	\param [in] result_format
+ *		See the libpq manual entry for `PQsendQueryParams`.
+ *	\param [in] token
+ *		See \ref async_exec_result_cached.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename... Args, typename CompletionToken>
+auto async_exec_result_cached (
+	connection & conn,
+	result_cache & cache,
+	const std::string & command,
+	std::vector<std::string> tags,
+	const params<Args...> & p,
+	int result_format,
+	CompletionToken && token
+) {
+	std::array<const char *, sizeof...(Args)> values;
+	p.values(values.data());
+	return async_exec_result_cached(
+		conn,
+		cache,
+		command,
+		std::move(tags),
+		int(p.size()),
+		p.types(),
+		values.data(),
+		p.lengths(),
+		p.formats(),
+		result_format,
+		std::forward<CompletionToken>(token)
+	);
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_exec_result_cached_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_exec_result_cached_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_exec_result_cached_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_exec_result_cached_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,387 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "decode.hpp"
+#include "error.hpp"
+#include "result.hpp"
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <libpq-fe.h>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <utility>
+
+namespace asio_pq {
+
+/**
+ *	A typed view of the rows of a \ref result in
+ *	binary format.
+ *
+ *	The number, types, and formats of the columns
+ *	are validated (and column names are resolved)
+ *	once when the view is created so that accessing
+ *	fields requires neither lookups nor checks beyond
+ *	those needed to decode each value.
+ *
+ *	The view does not own the \ref result and must not
+ *	outlive it.
+ *
+ *	\tparam Ts
+ *		The C++ type of each column. \ref field_traits
+ *		must be specialized for each. Use `boost::optional`
+ *		for columns which may contain `NULL`.
+ */
+template <typename... Ts>
+class result_view {
+public:
+	/**
+	 *	The C++ type of the column with a certain index.
+	 */
+	template <std::size_t I>
+	using element_type = std::tuple_element_t<I, std::tuple<Ts...>>;
+	/**
+	 *	A single row of a \ref result_view.
+	 */
+	class row {
+	private:
+		const result_view * view_;
+		int index_;
+		template <typename T, std::size_t... Is>
+		T as (std::index_sequence<Is...>) const {
+			return T{get<Is>()...};
+		}
+	public:
+		row () = delete;
+		row (const row &) = default;
+		row & operator = (const row &) = default;
+		/**
+		 *	\cond
+		 */
+		row (const result_view & view, int index) noexcept
+			:	view_(&view),
+				index_(index)
+		{	}
+		/**
+		 *	\endcond
+		 */
+		/**
+		 *	Retrieves the zero-relative index of
+		 *	this row within the \ref result.
+		 *
+		 *	\return
+		 *		The index.
+		 */
+		int index () const noexcept {
+			return index_;
+		}
+		/**
+		 *	Decodes a field of this row.
+		 *
+		 *	\tparam I
+		 *		The zero-relative index of the column
+		 *		within the view.
+		 *
+		 *	\param [out] ec
+		 *		A `boost::system::error_code` object which
+		 *		shall be set to the result of the operation.
+		 *		Note that if this object already represents
+		 *		an error it will be cleared.
+		 *
+		 *	\return
+		 *		The value.
+		 */
+		template <std::size_t I>
+		element_type<I> get (boost::system::error_code & ec) const {
+			return view_->template decode<I>(index_, ec);
+		}
+		/**
+		 *	Decodes a field of this row.
+		 *
+		 *	\tparam I
+		 *		The zero-relative index of the column
+		 *		within the view.
+		 *
+		 *	\return
+		 *		The value.
+		 */
+		template <std::size_t I>
+		element_type<I> get () const {
+			boost::system::error_code ec;
+			auto retr = get<I>(ec);
+			if (ec) throw boost::system::system_error(ec);
+			return retr;
+		}
+		/**
+		 *	Decodes all fields of this row.
+		 *
+		 *	\return
+		 *		A `std::tuple` of the values.
+		 */
+		std::tuple<Ts...> as_tuple () const {
+			return as<std::tuple<Ts...>>(std::index_sequence_for<Ts...>{});
+		}
+		/**
+		 *	Decodes all fields of this row into an
+		 *	aggregate (or any type which may be
+		 *	list initialized from the values in
+		 *	order).
+		 *
+		 *	\tparam T
+		 *		The type.
+		 *
+		 *	\return
+		 *		The object.
+		 */
+		template <typename T>
+		T as () const {
+			return as<T>(std::index_sequence_for<Ts...>{});
+		}
+	};
+	/**
+	 *	Iterates the rows of a \ref result_view.
+	 */
+	class iterator {
+	private:
+		const result_view * view_;
+		int index_;
+	public:
+		using difference_type = std::ptrdiff_t;
+		using value_type = row;
+		using pointer = const row *;
+		using reference = row;
+		using iterator_category = std::input_iterator_tag;
+		/**
+		 *	\cond
+		 */
+		iterator (const result_view & view, int index) noexcept
+			:	view_(&view),
+				index_(index)
+		{	}
+		/**
+		 *	\endcond
+		 */
+		row operator * () const noexcept {
+			return row(*view_, index_);
+		}
+		iterator & operator ++ () noexcept {
+			++index_;
+			return *this;
+		}
+		iterator operator ++ (int) noexcept {
+			auto retr = *this;
+			++index_;
+			return retr;
+		}
+		bool operator == (const iterator & rhs) const noexcept {
+			return index_ == rhs.index_;
+		}
+		bool operator != (const iterator & rhs) const noexcept {
+			return index_ != rhs.index_;
+		}
+	};
+private:
+	using swallow = int [];
+	const PGresult * handle_;
+	int rows_;
+	std::array<int, sizeof...(Ts)> columns_;
+	std::array<Oid, sizeof...(Ts)> types_;
+	template <std::size_t... Is>
+	void check (std::index_sequence<Is...>, boost::system::error_code & ec) noexcept {
+		ec.clear();
+		(void)swallow{0, (ec ? 0 : (check_column<Ts>(handle_, columns_[Is], ec), 0))...};
+		if (ec) {
+			fail(ec, error::type_mismatch);
+			return;
+		}
+		(void)swallow{0, (types_[Is] = PQftype(handle_, columns_[Is]), 0)...};
+	}
+	void fail (boost::system::error_code & ec, error e) noexcept {
+		ec = make_error_code(e);
+		handle_ = nullptr;
+		rows_ = 0;
+	}
+	void create (const result & r, boost::system::error_code & ec) noexcept {
+		handle_ = r.get();
+		rows_ = PQntuples(handle_);
+		types_.fill(0);
+		for (std::size_t i = 0; i < columns_.size(); ++i) columns_[i] = int(i);
+		if (PQnfields(handle_) != int(sizeof...(Ts))) {
+			fail(ec, error::type_mismatch);
+			return;
+		}
+		check(std::index_sequence_for<Ts...>{}, ec);
+	}
+	void create (
+		const result & r,
+		const std::array<const char *, sizeof...(Ts)> & names,
+		boost::system::error_code & ec
+	) noexcept {
+		handle_ = r.get();
+		rows_ = PQntuples(handle_);
+		types_.fill(0);
+		for (std::size_t i = 0; i < columns_.size(); ++i) {
+			columns_[i] = PQfnumber(handle_, names[i]);
+			if (columns_[i] < 0) {
+				fail(ec, error::no_such_column);
+				return;
+			}
+		}
+		check(std::index_sequence_for<Ts...>{}, ec);
+	}
+	template <std::size_t I>
+	element_type<I> decode (int row, boost::system::error_code & ec) const {
+		assert(row >= 0);
+		assert(row < rows_);
+		using type = element_type<I>;
+		ec.clear();
+		int column = columns_[I];
+		if (PQgetisnull(handle_, row, column)) return detail::decode_null<type>(ec);
+		return field_traits<type>::decode(
+			types_[I],
+			PQgetvalue(handle_, row, column),
+			std::size_t(PQgetlength(handle_, row, column)),
+			ec
+		);
+	}
+public:
+	result_view () = delete;
+	result_view (const result_view &) = default;
+	result_view & operator = (const result_view &) = default;
+	/**
+	 *	Creates a view of a \ref result whose columns
+	 *	correspond to \em Ts by position.
+	 *
+	 *	\param [in] r
+	 *		The \ref result.
+	 *	\param [out] ec
+	 *		A `boost::system::error_code` object which
+	 *		shall be set to the result of the operation.
+	 *		Note that if this object already represents
+	 *		an error it will be cleared. If the number of
+	 *		columns is not the same as the number of types
+	 *		or a column may not be decoded as the corresponding
+	 *		type this shall be set to \ref error::type_mismatch
+	 *		and the view shall be empty.
+	 */
+	result_view (const result & r, boost::system::error_code & ec) noexcept {
+		create(r, ec);
+	}
+	/**
+	 *	Creates a view of a \ref result whose columns
+	 *	correspond to \em Ts by position.
+	 *
+	 *	\param [in] r
+	 *		The \ref result.
+	 */
+	explicit result_view (const result & r) {
+		boost::system::error_code ec;
+		create(r, ec);
+		if (ec) throw boost::system::system_error(ec);
+	}
+	/**
+	 *	Creates a view of a \ref result whose columns
+	 *	correspond to \em Ts by name.
+	 *
+	 *	\param [in] r
+	 *		The \ref result.
+	 *	\param [in] names
+	 *		The name of the column which corresponds to
+	 *		each of \em Ts. Names are resolved as by
+	 *		`PQfnumber`.
+	 *	\param [out] ec
+	 *		A `boost::system::error_code` object which
+	 *		shall be set to the result of the operation.
+	 *		Note that if this object already represents
+	 *		an error it will be cleared. If a column does
+	 *		not exist this shall be set to \ref error::no_such_column
+	 *		and if a column may not be decoded as the
+	 *		corresponding type this shall be set to
+	 *		\ref error::type_mismatch. In either case
+	 *		the view shall be empty.
+	 */
+	result_view (
+		const result & r,
+		const std::array<const char *, sizeof...(Ts)> & names,
+		boost::system::error_code & ec
+	) noexcept {
+		create(r, names, ec);
+	}
+	/**
+	 *	Creates a view of a \ref result whose columns
+	 *	correspond to \em Ts by name.
+	 *
+	 *	\param [in] r
+	 *		The \ref result.
+	 *	\param [in] names
+	 *		The name of the column which corresponds to
+	 *		each of \em Ts. Names are resolved as by
+	 *		`PQfnumber`.
+	 */
+	result_view (const result & r, const std::array<const char *, sizeof...(Ts)> & names) {
+		boost::system::error_code ec;
+		create(r, names, ec);
+		if (ec) throw boost::system::system_error(ec);
+	}
+	/**
+	 *	Retrieves the number of rows.
+	 *
+	 *	\return
+	 *		The number of rows.
+	 */
+	int size () const noexcept {
+		return rows_;
+	}
+	/**
+	 *	Determines whether there are no rows.
+	 *
+	 *	\return
+	 *		\em true if there are no rows, \em false
+	 *		otherwise.
+	 */
+	bool empty () const noexcept {
+		return rows_ == 0;
+	}
+	/**
+	 *	Retrieves the index of the column in the
+	 *	\ref result which corresponds to a certain
+	 *	type.
+	 *
+	 *	\tparam I
+	 *		The zero-relative index of the type.
+	 *
+	 *	\return
+	 *		The zero-relative index of the column.
+	 */
+	template <std::size_t I>
+	int column () const noexcept {
+		return columns_[I];
+	}
+	/**
+	 *	Retrieves a row.
+	 *
+	 *	\param [in] index
+	 *		The zero-relative index of the row.
+	 *
+	 *	\return
+	 *		The row.
+	 */
+	row operator [] (int index) const noexcept {
+		assert(index >= 0);
+		assert(index < rows_);
+		return row(*this, index);
+	}
+	iterator begin () const noexcept {
+		return iterator(*this, 0);
+	}
+	iterator end () const noexcept {
+		return iterator(*this, rows_);
+	}
+};
+
+}
@@ -0,0 +1,426 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include "pipeline.hpp"
+#include "result.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+namespace asio_pq {
+
+/**
+ *	A least recently used cache which maps the text
+ *	of SQL commands to server-side prepared statements.
+ *
+ *	Since prepared statements exist only within a
+ *	single session an instance of this class must
+ *	only ever be used with a single \ref connection.
+ *	If that connection is reset \ref clear must be
+ *	called. Prepared statements are named uniquely
+ *	within the process so a \ref connection may be
+ *	used with several caches, and a cache may be
+ *	replaced without deallocating the statements of
+ *	its predecessor.
+ *
+ *	Commands are tracked from their first execution
+ *	and are promoted to prepared statements once they
+ *	have been executed a configurable number of times.
+ *	When a prepared statement is evicted the corresponding
+ *	`DEALLOCATE` is not sent immediately but is instead
+ *	pipelined with the next command executed through
+ *	\ref async_exec_cached.
+ */
+class statement_cache {
+public:
+	/**
+	 *	Information about a cached command.
+	 */
+	class entry {
+	public:
+		/**
+		 *	The text of the command.
+		 */
+		std::string command;
+		/**
+		 *	The name of the prepared statement, or
+		 *	the empty string if the command has not
+		 *	been prepared.
+		 */
+		std::string name;
+		/**
+		 *	The number of times the command has been
+		 *	executed since it was added to the cache.
+		 */
+		std::size_t uses;
+		/**
+		 *	The result of `PQdescribePrepared` for
+		 *	the prepared statement (if the command
+		 *	has been prepared).
+		 */
+		result description;
+		/**
+		 *	\em true if the server refused to prepare
+		 *	the command in which case it is not prepared
+		 *	again (until it is evicted).
+		 */
+		bool failed;
+	};
+private:
+	using list_type = std::list<entry>;
+	list_type lru_;
+	std::unordered_map<std::string, list_type::iterator> map_;
+	std::vector<std::string> deallocate_;
+	std::size_t capacity_;
+	std::size_t promote_after_;
+	//	Distinguishes the names of the prepared
+	//	statements of different caches so that they
+	//	do not collide if several caches (or several
+	//	caches in succession) are used with the same
+	//	connection
+	unsigned long long id_;
+	unsigned long long next_;
+public:
+	statement_cache () = delete;
+	statement_cache (const statement_cache &) = delete;
+	statement_cache (statement_cache &&) = default;
+	statement_cache & operator = (const statement_cache &) = delete;
+	statement_cache & operator = (statement_cache &&) = default;
+	/**
+	 *	Creates an empty cache.
+	 *
+	 *	\param [in] capacity
+	 *		The maximum number of commands (whether
+	 *		prepared or not) which shall be tracked.
+	 *	\param [in] promote_after
+	 *		The number of executions after which a
+	 *		command shall be prepared. If this is one
+	 *		commands are prepared when they are first
+	 *		executed. If this is zero commands are
+	 *		never prepared. Defaults to one.
+	 */
+	explicit statement_cache (std::size_t capacity, std::size_t promote_after = 1);
+	/**
+	 *	Finds the entry for a command.
+	 *
+	 *	Does not affect the order in which commands
+	 *	will be evicted.
+	 *
+	 *	\param [in] command
+	 *		The text of the command.
+	 *
+	 *	\return
+	 *		A pointer to the entry if \em command is
+	 *		cached, a null pointer otherwise.
+	 */
+	const entry * find (const std::string & command) const;
+	/**
+	 *	Retrieves the number of cached commands.
+	 *
+	 *	\return
+	 *		The number of cached commands.
+	 */
+	std::size_t size () const noexcept;
+	/**
+	 *	Retrieves the maximum number of cached commands.
+	 *
+	 *	\return
+	 *		The capacity.
+	 */
+	std::size_t capacity () const noexcept;
+	/**
+	 *	Retrieves the number of prepared statements
+	 *	which are waiting to be deallocated.
+	 *
+	 *	\return
+	 *		The number of pending deallocations.
+	 */
+	std::size_t pending_deallocations () const noexcept;
+	/**
+	 *	Forgets all commands and pending deallocations
+	 *	without deallocating anything on the server.
+	 *
+	 *	This should be invoked if the session the
+	 *	prepared statements belonged to has ended.
+	 */
+	void clear () noexcept;
+	/**
+	 *	\cond
+	 */
+	entry & use (const std::string & command);
+	bool should_promote (const entry & e) const noexcept;
+	std::string make_name ();
+	void prepared (const std::string & command, std::string name, result description);
+	void prepare_failed (const std::string & command);
+	std::vector<std::string> take_deallocations ();
+	void deallocate (std::string name);
+	/**
+	 *	\endcond
+	 */
+};
+
+namespace detail {
+
+using async_exec_cached_signature = void (boost::system::error_code, result);
+
+bool should_retry_deallocate (const result & r) noexcept;
+
+template <typename Handler>
+class async_exec_cached_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, statement_cache & cache, std::string command)
+			:	cache(cache),
+				command(std::move(command)),
+				promote(false)
+		{	}
+		statement_cache & cache;
+		std::string command;
+		std::string name;
+		bool promote;
+		std::vector<std::string> deallocate;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+public:
+	async_exec_cached_op () = delete;
+	async_exec_cached_op (const async_exec_cached_op &) = default;
+	async_exec_cached_op (async_exec_cached_op &&) = default;
+	async_exec_cached_op & operator = (const async_exec_cached_op &) = default;
+	async_exec_cached_op & operator = (async_exec_cached_op &&) = default;
+	template <typename DeducedHandler>
+	async_exec_cached_op (statement_cache & cache, std::string command, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), cache, std::move(command))
+	{	}
+	void begin (
+		connection & conn,
+		int n_params,
+		const Oid * param_types,
+		const char * const * param_values,
+		const int * param_lengths,
+		const int * param_formats,
+		int result_format
+	) {
+		state & s = *ptr_;
+		auto & e = s.cache.use(s.command);
+		pipeline p;
+		s.promote = s.cache.should_promote(e);
+		if (s.promote) {
+			s.name = s.cache.make_name();
+			p.prepare(s.name, s.command, n_params, param_types);
+			p.describe_prepared(s.name);
+		}
+		const std::string & name = s.promote ? s.name : e.name;
+		if (name.empty()) {
+			p.query(
+				s.command,
+				n_params,
+				param_types,
+				param_values,
+				param_lengths,
+				param_formats,
+				result_format
+			);
+		} else {
+			p.query_prepared(
+				name,
+				n_params,
+				param_values,
+				param_lengths,
+				param_formats,
+				result_format
+			);
+		}
+		//	Deallocations follow the command so that
+		//	if one fails (because the statement is
+		//	unexpectedly missing) the command is not
+		//	aborted
+		s.deallocate = s.cache.take_deallocations();
+		for (auto && stmt : s.deallocate) {
+			p.query("DEALLOCATE \"" + stmt + "\"");
+		}
+		async_pipeline(conn, p, std::move(*this));
+	}
+	void operator () (boost::system::error_code ec, std::vector<result> rs) {
+		state & s = *ptr_;
+		std::size_t index = 0;
+		result r;
+		if (s.promote && !ec && (rs.size() > 2)) {
+			if (PQresultStatus(rs[0]) == PGRES_COMMAND_OK) {
+				s.cache.prepared(s.command, std::move(s.name), std::move(rs[1]));
+				r = std::move(rs[2]);
+			} else {
+				//	The command is aborted so the reason
+				//	preparing it failed is more useful
+				s.cache.prepare_failed(s.command);
+				r = std::move(rs[0]);
+			}
+			index = 3;
+		} else if (!s.promote && !rs.empty()) {
+			r = std::move(rs[0]);
+			index = 1;
+		}
+		for (auto && stmt : s.deallocate) {
+			bool retry = ec || (index >= rs.size()) || should_retry_deallocate(rs[index]);
+			++index;
+			if (retry) s.cache.deallocate(std::move(stmt));
+		}
+		ptr_.invoke(ec, std::move(r));
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_exec_cached_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_exec_cached_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_exec_cached_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_exec_cached_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+/**
+ *	Asynchronously executes a command through a
+ *	\ref statement_cache.
+ *
+ *	If the command has been prepared the prepared
+ *	statement is executed. If the command has now
+ *	been executed often enough to be promoted it is
+ *	prepared, described, and executed. Otherwise it
+ *	is executed via the extended query protocol as
+ *	by `PQsendQueryParams`. In all cases any pending
+ *	deallocations are sent along with the command so
+ *	that everything costs a single round trip.
+ *
+ *	All parameters not documented have the same
+ *	meaning as the parameters of the same name to
+ *	`PQsendQueryParams`. Parameters need only remain
+ *	valid until this function returns. Note that the
+ *	parameter types are only consulted when the command
+ *	is prepared.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It must be in non-blocking
+ *		mode and must not have a pending command. The
+ *		reference to this object must remain valid for
+ *		the lifetime of the asynchronous operation or the
+ *		behavior is undefined.
+ *	\param [in] cache
+ *		The \ref statement_cache associated with \em conn.
+ *		The reference to this object must remain valid for
+ *		the lifetime of the asynchronous operation or the
+ *		behavior is undefined.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and the \ref result of the
+ *		command.
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_exec_cached (
+	connection & conn,
+	statement_cache & cache,
+	std::string command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_exec_cached_signature> init(token);
+	detail::async_exec_cached_op<
+		beast::handler_type<CompletionToken, detail::async_exec_cached_signature>
+	> op(
+		cache,
+		std::move(command),
+		std::move(init.completion_handler)
+	);
+	op.begin(
+		conn,
+		n_params,
+		param_types,
+		param_values,
+		param_lengths,
+		param_formats,
+		result_format
+	);
+	return init.result.get();
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_exec_cached_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_exec_cached_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_exec_cached_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_exec_cached_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
+
+#endif
@@ -0,0 +1,179 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "pipeline.hpp"
+#include "result.hpp"
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+namespace asio_pq {
+
+/**
+ *	Allows commands to be submitted to a single
+ *	\ref connection from any thread.
+ *
+ *	Submissions are pushed onto a lock free queue and
+ *	the thread running the `boost::asio::io_service`
+ *	of the \ref connection drains that queue in
+ *	batches. All commands in a batch are sent in libpq
+ *	pipeline mode so that they are written to the server
+ *	together and cost a single round trip. Therefore
+ *	submitters need neither a strand nor any other form
+ *	of mutual exclusion and the more commands are
+ *	submitted concurrently the more are sent per batch.
+ *
+ *	Each command is followed by its own synchronization
+ *	point and therefore runs in its own implicit
+ *	transaction: A command which fails neither rolls
+ *	back nor prevents the execution of any other
+ *	command in the same batch. With libpq 17 or later
+ *	the synchronization points are queued without
+ *	flushing so that each batch is written with a
+ *	single flush, earlier versions of libpq flush at
+ *	every synchronization point.
+ *
+ *	No other operation may be performed on the
+ *	\ref connection while a submission_queue is bound
+ *	to it. Once the \ref connection fails every
+ *	outstanding and subsequent command completes with
+ *	the error.
+ */
+class submission_queue {
+public:
+	/**
+	 *	The type of the callback which is invoked with
+	 *	the outcome of a submitted command.
+	 *
+	 *	Callbacks are invoked on a thread running the
+	 *	`boost::asio::io_service` of the \ref connection
+	 *	and may submit further commands. Two parameters
+	 *	are provided: An instance of `boost::system::error_code`
+	 *	and the final \ref result of the command (which may
+	 *	be empty if the error code represents an error). A
+	 *	command which the server rejects does not set the
+	 *	error code: Inspect the status of the \ref result.
+	 *	Callbacks must not throw.
+	 */
+	using callback_type = std::function<void (boost::system::error_code, result)>;
+private:
+	class submission;
+	class state;
+	//	Shared with the handlers of the operations
+	//	the queue performs so that they may outlive
+	//	it
+	std::shared_ptr<state> state_;
+public:
+	submission_queue () = delete;
+	submission_queue (const submission_queue &) = delete;
+	submission_queue (submission_queue &&) = delete;
+	submission_queue & operator = (const submission_queue &) = delete;
+	submission_queue & operator = (submission_queue &&) = delete;
+	/**
+	 *	Creates a submission_queue.
+	 *
+	 *	\param [in] conn
+	 *		The \ref connection. It must be connected and
+	 *		in non-blocking mode. The reference to this
+	 *		object must remain valid until the operations
+	 *		begun by the submission_queue have completed
+	 *		(which may be after the submission_queue is
+	 *		destroyed) or the behavior is undefined.
+	 *	\param [in] max_batch
+	 *		The maximum number of commands which shall be
+	 *		sent in a single batch. Must not be zero.
+	 *		Defaults to 256.
+	 */
+	explicit submission_queue (connection & conn, std::size_t max_batch = 256);
+	/**
+	 *	Invokes the callback of every command whose outcome
+	 *	is not yet known with `boost::asio::error::operation_aborted`.
+	 *	Commands which have already been sent may nonetheless
+	 *	be executed by the server, their results are retrieved
+	 *	and discarded so that the \ref connection remains
+	 *	usable.
+	 *
+	 *	Must only be called from a thread running the
+	 *	`boost::asio::io_service` associated with this object
+	 *	or while it is not running, and not concurrently with
+	 *	\ref submit.
+	 */
+	~submission_queue () noexcept;
+	/**
+	 *	Retrieves the `boost::asio::io_service` associated
+	 *	with this object.
+	 *
+	 *	\return
+	 *		A reference to a `boost::asio::io_service`.
+	 */
+	boost::asio::io_service & get_io_service () const noexcept;
+	/**
+	 *	Retrieves the \ref connection associated with
+	 *	this object.
+	 *
+	 *	\return
+	 *		A reference to a \ref connection.
+	 */
+	connection & get_connection () const noexcept;
+	/**
+	 *	Submits a command without parameters. May be
+	 *	called from any thread.
+	 *
+	 *	\param [in] command
+	 *		The text of the command. Only one SQL
+	 *		statement may be provided.
+	 *	\param [in] callback
+	 *		The \ref callback_type which shall be invoked
+	 *		with the outcome of the command. Must not be
+	 *		empty.
+	 */
+	void submit (std::string command, callback_type callback);
+	/**
+	 *	Submits a command with parameters. May be called
+	 *	from any thread.
+	 *
+	 *	All parameters other than \em callback have the
+	 *	same meaning as the parameters of the same name to
+	 *	`PQsendQueryParams` and are copied so they need not
+	 *	remain valid after the call returns.
+	 *
+	 *	\param [in] callback
+	 *		The \ref callback_type which shall be invoked
+	 *		with the outcome of the command. Must not be
+	 *		empty.
+	 */
+	void submit (
+		std::string command,
+		int n_params,
+		const Oid * param_types,
+		const char * const * param_values,
+		const int * param_lengths,
+		const int * param_formats,
+		int result_format,
+		callback_type callback
+	);
+	/**
+	 *	Retrieves the number of batches which have been
+	 *	sent to the server. Must only be called from a
+	 *	thread running the `boost::asio::io_service`
+	 *	associated with this object or while it is not
+	 *	running.
+	 *
+	 *	\return
+	 *		The number of batches.
+	 */
+	std::size_t batches () const noexcept;
+};
+
+}
+
+#endif
@@ -0,0 +1,235 @@
+/**
+ *	\file
+ */
+
+#pragma once
+
+#include "connection.hpp"
+#include "detail/executor.hpp"
+#include "detail/op.hpp"
+#include "detail/wrapper.hpp"
+#include "error.hpp"
+#include "notification.hpp"
+#include <beast/core/async_result.hpp>
+#include <beast/core/handler_ptr.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_continuation_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+namespace detail {
+
+using async_wait_notification_signature = void (boost::system::error_code, std::vector<notification>);
+
+template <typename Handler>
+class async_wait_notification_op {
+private:
+	class state {
+	public:
+		state () = delete;
+		state (const state &) = delete;
+		state (state &&) = delete;
+		state & operator = (const state &) = delete;
+		state & operator = (state &&) = delete;
+		state (const Handler &, asio_pq::connection & conn)
+			:	connection(conn),
+				waited(false)
+		{	}
+		asio_pq::connection & connection;
+		std::vector<notification> notifications;
+		bool waited;
+		boost::system::error_code error_code;
+	};
+	using pointer = beast::handler_ptr<state, Handler>;
+	pointer ptr_;
+	void invoke () {
+		auto ec = ptr_->error_code;
+		auto notifications = std::move(ptr_->notifications);
+		ptr_.invoke(ec, std::move(notifications));
+	}
+	void complete (boost::system::error_code ec) {
+		ptr_->error_code = ec;
+		//	Avoid invoking the handler from within
+		//	the initiating function
+		if (!ptr_->waited) {
+			boost::asio::io_service & ios = ptr_->connection.get_io_service();
+			ios.post(std::move(*this));
+			return;
+		}
+		invoke();
+	}
+	void wait () {
+		ptr_->waited = true;
+		ptr_->connection.socket([&] (auto & socket) {
+			detail::async_readable(
+				socket,
+				detail::make_read_wrapper(
+					std::move(*this)
+				)
+			);
+		});
+	}
+	bool drain () {
+		state & s = *ptr_;
+		while (PGnotify * n = PQnotifies(s.connection)) {
+			s.notifications.emplace_back(n);
+		}
+		return !s.notifications.empty();
+	}
+	void get () {
+		if (PQconsumeInput(ptr_->connection) == 0) {
+			complete(make_error_code(error::consume_failed));
+			return;
+		}
+		if (drain()) {
+			complete(boost::system::error_code{});
+			return;
+		}
+		wait();
+	}
+public:
+	async_wait_notification_op () = delete;
+	async_wait_notification_op (const async_wait_notification_op &) = default;
+	async_wait_notification_op (async_wait_notification_op &&) = default;
+	async_wait_notification_op & operator = (const async_wait_notification_op &) = default;
+	async_wait_notification_op & operator = (async_wait_notification_op &&) = default;
+	template <typename DeducedHandler>
+	async_wait_notification_op (connection & conn, DeducedHandler && h)
+		:	ptr_(std::forward<DeducedHandler>(h), conn)
+	{	}
+	void begin () {
+		auto ec = ptr_->connection.duplicate_socket();
+		if (ec) {
+			complete(ec);
+			return;
+		}
+		//	Notifications may have been received while
+		//	some other operation was consuming input
+		if (drain()) {
+			complete(boost::system::error_code{});
+			return;
+		}
+		get();
+	}
+	void operator () () {
+		invoke();
+	}
+	void read (boost::system::error_code ec) {
+		if (!ec && !ptr_->connection.has_socket()) ec = make_error_code(boost::asio::error::operation_aborted);
+		if (ec) {
+			complete(ec);
+			return;
+		}
+		get();
+	}
+	#ifdef ASIO_PQ_HAS_EXECUTORS
+	const Handler & handler () const noexcept {
+		return ptr_.handler();
+	}
+	#endif
+	template <typename Function>
+	friend void asio_handler_invoke (Function function, async_wait_notification_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_invoke;
+		asio_handler_invoke(std::move(function), std::addressof(self->ptr_.handler()));
+	}
+	friend bool asio_handler_is_continuation (async_wait_notification_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_is_continuation;
+		return asio_handler_is_continuation(std::addressof(self->ptr_.handler()));
+	}
+	friend void * asio_handler_allocate (std::size_t num, async_wait_notification_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_allocate;
+		return asio_handler_allocate(num, std::addressof(self->ptr_.handler()));
+	}
+	friend void asio_handler_deallocate (void * ptr, std::size_t num, async_wait_notification_op * self) {
+		assert(self);
+		using boost::asio::asio_handler_deallocate;
+		asio_handler_deallocate(ptr, num, std::addressof(self->ptr_.handler()));
+	}
+};
+
+}
+
+/**
+ *	Asynchronously waits for the server to deliver at
+ *	least one notification (see `LISTEN` and `NOTIFY`)
+ *	and then retrieves every notification libpq has
+ *	received via `PQnotifies`.
+ *
+ *	The operation waits for the socket to become
+ *	readable and calls `PQconsumeInput`, it never
+ *	submits a command. Notifications received while
+ *	some other operation was consuming input (e.g.
+ *	\ref async_get_result) are delivered immediately.
+ *
+ *	\tparam CompletionToken
+ *		The type of completion token an instance
+ *		of which shall be used to notify the caller
+ *		of completion.
+ *
+ *	\param [in] conn
+ *		The \ref connection. It should not have a pending
+ *		command. The reference to this object must remain
+ *		valid for the lifetime of the asynchronous operation
+ *		or the behavior is undefined.
+ *	\param [in] token
+ *		The completion token which shall be used to notify
+ *		the caller of completion. Two parameters are provided:
+ *		An instance of `boost::system::error_code` representing
+ *		the result of the operation and a `std::vector` of
+ *		\ref notification objects in the order they were
+ *		received (which is empty if and only if the operation
+ *		failed).
+ *
+ *	\return
+ *		Whatever is appropriate given \em CompletionToken.
+ */
+template <typename CompletionToken>
+auto async_wait_notification (
+	connection & conn,
+	CompletionToken && token
+) {
+	beast::async_completion<CompletionToken, detail::async_wait_notification_signature> init(token);
+	detail::async_wait_notification_op<
+		beast::handler_type<CompletionToken, detail::async_wait_notification_signature>
+	> op(
+		conn,
+		std::move(init.completion_handler)
+	);
+	op.begin();
+	return init.result.get();
+}
+
+}
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+namespace boost {
+namespace asio {
+
+template <typename Handler, typename Executor>
+struct associated_executor<asio_pq::detail::async_wait_notification_op<Handler>, Executor>
+	:	public asio_pq::detail::forward_associated_executor<asio_pq::detail::async_wait_notification_op<Handler>, Handler, Executor>
+{	};
+
+template <typename Handler, typename Allocator>
+struct associated_allocator<asio_pq::detail::async_wait_notification_op<Handler>, Allocator>
+	:	public asio_pq::detail::forward_associated_allocator<asio_pq::detail::async_wait_notification_op<Handler>, Handler, Allocator>
+{	};
+
+}
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include <asio_pq/notification.hpp>
+
+#include <libpq-fe.h>
+#include <cassert>
+#include <utility>
+
+namespace asio_pq {
+
+void notification::destroy () noexcept {
+	if (!handle_) return;
+	PQfreemem(handle_);
+	handle_ = nullptr;
+}
+
+notification::notification () noexcept
+	:	handle_(nullptr)
+{	}
+
+notification::notification (notification && other) noexcept
+	:	handle_(other.handle_)
+{
+	other.handle_ = nullptr;
+}
+
+notification & notification::operator = (notification && other) noexcept {
+	destroy();
+	using std::swap;
+	swap(handle_, other.handle_);
+	return *this;
+}
+
+notification::notification (PGnotify * handle) noexcept
+	:	handle_(handle)
+{	}
+
+notification::~notification () noexcept {
+	destroy();
+}
+
+PGnotify * notification::release () noexcept {
+	PGnotify * retr = handle_;
+	handle_ = nullptr;
+	return retr;
+}
+
+PGnotify * notification::get () const noexcept {
+	return handle_;
+}
+
+const char * notification::channel () const noexcept {
+	assert(handle_);
+	return handle_->relname;
+}
+
+const char * notification::payload () const noexcept {
+	assert(handle_);
+	return handle_->extra;
+}
+
+int notification::pid () const noexcept {
+	assert(handle_);
+	return handle_->be_pid;
+}
+
+notification::operator bool () const noexcept {
+	return bool(handle_);
+}
+
+}
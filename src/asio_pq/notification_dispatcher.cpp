@@ -0,0 +1,142 @@
+#include <asio_pq/notification_dispatcher.hpp>
+
+#include <asio_pq/connection.hpp>
+#include <asio_pq/notification.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace asio_pq {
+
+notification_dispatcher::notification_dispatcher (connection & conn) noexcept
+	:	conn_(conn),
+		next_(0),
+		dispatching_(nullptr),
+		removed_(false),
+		stopped_(false)
+{	}
+
+boost::asio::io_service & notification_dispatcher::get_io_service () const noexcept {
+	return conn_.get_io_service();
+}
+
+connection & notification_dispatcher::get_connection () const noexcept {
+	return conn_;
+}
+
+notification_dispatcher::subscription notification_dispatcher::subscribe (std::string channel, subscriber_type subscriber) {
+	assert(subscriber);
+	auto id = ++next_;
+	auto & entries = channels_[channel];
+	//	Appending to the entries being iterated could
+	//	move the subscriber which is being invoked
+	auto & target = (&entries == dispatching_) ? added_ : entries;
+	target.push_back(entry{id, std::move(subscriber)});
+	try {
+		subscriptions_.emplace(id, std::move(channel));
+	} catch (...) {
+		target.pop_back();
+		throw;
+	}
+	return id;
+}
+
+void notification_dispatcher::unsubscribe (subscription s) {
+	auto iter = subscriptions_.find(s);
+	if (iter == subscriptions_.end()) return;
+	auto channel = channels_.find(iter->second);
+	subscriptions_.erase(iter);
+	if (channel == channels_.end()) return;
+	auto & entries = channel->second;
+	auto pred = [&] (const entry & e) noexcept {	return e.id == s;	};
+	if (&entries == dispatching_) {
+		auto e = std::find_if(entries.begin(), entries.end(), pred);
+		if (e != entries.end()) {
+			e->id = 0;
+			removed_ = true;
+			return;
+		}
+		e = std::find_if(added_.begin(), added_.end(), pred);
+		if (e != added_.end()) added_.erase(e);
+		return;
+	}
+	auto e = std::find_if(entries.begin(), entries.end(), pred);
+	if (e != entries.end()) entries.erase(e);
+	if (entries.empty()) channels_.erase(channel);
+}
+
+void notification_dispatcher::stop () noexcept {
+	stopped_ = true;
+	//	If async_run is between waits (i.e. a subscriber
+	//	is being invoked) there is nothing to cancel
+	if (!conn_.has_socket()) return;
+	boost::system::error_code ec;
+	conn_.cancel(ec);
+}
+
+bool notification_dispatcher::stopped () const noexcept {
+	return stopped_;
+}
+
+std::size_t notification_dispatcher::subscribers (const std::string & channel) const {
+	auto iter = channels_.find(channel);
+	if (iter == channels_.end()) return 0;
+	std::size_t retr = 0;
+	for (auto && e : iter->second) if (e.id != 0) ++retr;
+	if (&iter->second == dispatching_) retr += added_.size();
+	return retr;
+}
+
+void notification_dispatcher::end_dispatch (const char * channel) {
+	assert(dispatching_);
+	auto & entries = *dispatching_;
+	dispatching_ = nullptr;
+	if (removed_) {
+		entries.erase(
+			std::remove_if(entries.begin(), entries.end(), [] (const entry & e) noexcept {	return e.id == 0;	}),
+			entries.end()
+		);
+		removed_ = false;
+	}
+	if (!added_.empty()) {
+		auto added = std::move(added_);
+		added_.clear();
+		entries.reserve(entries.size() + added.size());
+		for (auto && e : added) entries.push_back(std::move(e));
+	}
+	if (entries.empty()) channels_.erase(channel);
+}
+
+std::size_t notification_dispatcher::dispatch (notification n) {
+	assert(n);
+	assert(!dispatching_);
+	auto iter = channels_.find(n.channel());
+	if (iter == channels_.end()) return 0;
+	std::shared_ptr<const notification> ptr(std::make_shared<notification>(std::move(n)));
+	auto & entries = iter->second;
+	dispatching_ = &entries;
+	std::size_t retr = 0;
+	//	Subscribers added during dispatch are placed
+	//	in added_ so neither the size nor the location
+	//	of the entries changes
+	auto size = entries.size();
+	try {
+		for (std::size_t i = 0; i < size; ++i) {
+			if (entries[i].id == 0) continue;
+			entries[i].function(ptr);
+			++retr;
+		}
+	} catch (...) {
+		end_dispatch(ptr->channel());
+		throw;
+	}
+	end_dispatch(ptr->channel());
+	return retr;
+}
+
+}
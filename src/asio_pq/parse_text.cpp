@@ -0,0 +1,671 @@
+#include <asio_pq/parse_text.hpp>
+
+#include <asio_pq/detail/timestamp.hpp>
+#include <asio_pq/error.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ASIO_PQ_HAS_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define ASIO_PQ_TARGET(isa)
+#else
+#define ASIO_PQ_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace asio_pq {
+
+namespace {
+
+simd_level detect_simd_level () noexcept {
+	#ifdef ASIO_PQ_HAS_X86_SIMD
+	#ifdef _MSC_VER
+	int info [4];
+	__cpuid(info, 0);
+	int max = info[0];
+	__cpuid(info, 1);
+	bool sse42 = (info[2] & (1 << 20)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if ((max >= 7) && osxsave && avx && ((_xgetbv(0) & 6) == 6)) {
+		__cpuidex(info, 7, 0);
+		if ((info[1] & (1 << 5)) != 0) return simd_level::avx2;
+	}
+	if (sse42) return simd_level::sse42;
+	#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return simd_level::avx2;
+	if (__builtin_cpu_supports("sse4.2")) return simd_level::sse42;
+	#endif
+	#endif
+	return simd_level::scalar;
+}
+
+//	An integer split into its sign and digits
+class integer_text {
+public:
+	bool negative;
+	const char * digits;
+	std::size_t count;
+};
+
+bool split_integer (const char * p, std::size_t n, integer_text & i) noexcept {
+	i.negative = false;
+	if ((n != 0) && ((*p == '-') || (*p == '+'))) {
+		i.negative = *p == '-';
+		++p;
+		--n;
+	}
+	i.digits = p;
+	i.count = n;
+	//	Any more than 19 digits may not fit
+	//	in 64 bits
+	return (n != 0) && (n <= 19);
+}
+
+bool scalar_digits (const char * p, std::size_t n, std::uint64_t & out) noexcept {
+	std::uint64_t value = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		unsigned digit = unsigned(static_cast<unsigned char>(p[i])) - unsigned('0');
+		if (digit > 9) return false;
+		value = (value * 10U) + digit;
+	}
+	out = value;
+	return true;
+}
+
+template <typename T>
+bool finish_integer (const integer_text & i, std::uint64_t magnitude, T & out) noexcept {
+	using unsigned_type = std::make_unsigned_t<T>;
+	auto max = std::uint64_t(unsigned_type(std::numeric_limits<T>::max()));
+	if (i.negative) {
+		if (magnitude > (max + 1U)) return false;
+		out = T(unsigned_type(0U - magnitude));
+		return true;
+	}
+	if (magnitude > max) return false;
+	out = T(magnitude);
+	return true;
+}
+
+template <typename T>
+bool parse_integer_scalar (const char * p, std::size_t n, T & out) noexcept {
+	integer_text i;
+	std::uint64_t magnitude;
+	return split_integer(p, n, i) &&
+		scalar_digits(i.digits, i.count, magnitude) &&
+		finish_integer(i, magnitude, out);
+}
+
+#ifdef ASIO_PQ_HAS_X86_SIMD
+
+//	Loading sixteen bytes from window + n yields a
+//	shuffle mask which moves the first n bytes to the
+//	end of a vector and zeroes the rest
+alignas(16) const signed char shift_window [32] = {
+	-128, -128, -128, -128, -128, -128, -128, -128,
+	-128, -128, -128, -128, -128, -128, -128, -128,
+	0, 1, 2, 3, 4, 5, 6, 7,
+	8, 9, 10, 11, 12, 13, 14, 15
+};
+
+ASIO_PQ_TARGET("sse4.2")
+inline __m128i load_text (const char * p, std::size_t n) noexcept {
+	//	Values within a PGresult are followed by at least
+	//	a NUL terminator and usually other values, and
+	//	the bytes beyond the value are discarded, so
+	//	reading past the end is harmless unless it crosses
+	//	into a page which may not be mapped
+	if ((reinterpret_cast<std::uintptr_t>(p) & 4095U) <= (4096U - 16U)) {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	}
+	alignas(16) char buffer [16] = {};
+	std::memcpy(buffer, p, n);
+	return _mm_load_si128(reinterpret_cast<const __m128i *>(buffer));
+}
+
+//	Validates up to sixteen digits and converts them
+//	to sixteen single digit values, most significant
+//	first, with leading zeroes
+ASIO_PQ_TARGET("sse4.2")
+inline bool prepare_digits (const char * p, std::size_t n, __m128i & out) noexcept {
+	__m128i digits = _mm_sub_epi8(load_text(p, n), _mm_set1_epi8('0'));
+	__m128i nine = _mm_set1_epi8(9);
+	__m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(digits, nine), digits);
+	unsigned mask = unsigned(_mm_movemask_epi8(valid));
+	unsigned required = (n == 16) ? 0xFFFFU : ((1U << n) - 1U);
+	if ((mask & required) != required) return false;
+	out = _mm_shuffle_epi8(
+		digits,
+		_mm_loadu_si128(reinterpret_cast<const __m128i *>(shift_window + n))
+	);
+	return true;
+}
+
+//	Multiplies adjacent lanes and adds them to form
+//	eight two digit values, then four four digit values,
+//	then two eight digit values
+ASIO_PQ_TARGET("sse4.2")
+inline std::uint64_t combine_digits (__m128i digits) noexcept {
+	__m128i pairs = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+	__m128i quads = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+	__m128i packed = _mm_packus_epi32(quads, quads);
+	__m128i octets = _mm_madd_epi16(packed, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+	auto high = std::uint64_t(std::uint32_t(_mm_cvtsi128_si32(octets)));
+	auto low = std::uint64_t(std::uint32_t(_mm_extract_epi32(octets, 1)));
+	return (high * 100000000U) + low;
+}
+
+ASIO_PQ_TARGET("sse4.2")
+bool sse42_digits (const char * p, std::size_t n, std::uint64_t & out) noexcept {
+	if (n > 16) return scalar_digits(p, n, out);
+	__m128i digits;
+	if (!prepare_digits(p, n, digits)) return false;
+	out = combine_digits(digits);
+	return true;
+}
+
+template <typename T>
+ASIO_PQ_TARGET("sse4.2")
+bool parse_integer_sse42 (const char * p, std::size_t n, T & out) noexcept {
+	integer_text i;
+	std::uint64_t magnitude;
+	return split_integer(p, n, i) &&
+		sse42_digits(i.digits, i.count, magnitude) &&
+		finish_integer(i, magnitude, out);
+}
+
+//	As combine_digits but for two values at once
+ASIO_PQ_TARGET("avx2")
+inline void combine_digits (__m128i a, __m128i b, std::uint64_t & out_a, std::uint64_t & out_b) noexcept {
+	__m256i digits = _mm256_inserti128_si256(_mm256_castsi128_si256(a), b, 1);
+	__m256i pairs = _mm256_maddubs_epi16(digits, _mm256_set1_epi16(0x010A));
+	__m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00010064));
+	__m256i packed = _mm256_packus_epi32(quads, quads);
+	__m256i octets = _mm256_madd_epi16(packed, _mm256_set1_epi32(0x00012710));
+	auto high_a = std::uint64_t(std::uint32_t(_mm256_extract_epi32(octets, 0)));
+	auto low_a = std::uint64_t(std::uint32_t(_mm256_extract_epi32(octets, 1)));
+	auto high_b = std::uint64_t(std::uint32_t(_mm256_extract_epi32(octets, 4)));
+	auto low_b = std::uint64_t(std::uint32_t(_mm256_extract_epi32(octets, 5)));
+	out_a = (high_a * 100000000U) + low_a;
+	out_b = (high_b * 100000000U) + low_b;
+}
+
+#endif
+
+//	Values with few enough significant digits and a
+//	small enough exponent are exactly representable
+//	and so may be computed with a single correctly
+//	rounded multiplication or division
+template <typename F>
+class float_limits;
+template <>
+class float_limits<double> {
+public:
+	static constexpr std::uint64_t max_mantissa = std::uint64_t(1) << 53U;
+	static constexpr int max_exponent = 22;
+	static double fallback (const char * p, char ** end) noexcept {
+		return std::strtod(p, end);
+	}
+};
+template <>
+class float_limits<float> {
+public:
+	static constexpr std::uint64_t max_mantissa = std::uint64_t(1) << 24U;
+	static constexpr int max_exponent = 10;
+	static float fallback (const char * p, char ** end) noexcept {
+		return std::strtof(p, end);
+	}
+};
+
+bool equals (const char * p, std::size_t n, const char * str) noexcept {
+	std::size_t length = std::strlen(str);
+	return (n == length) && (std::memcmp(p, str, n) == 0);
+}
+
+template <typename F>
+bool parse_float (const char * p, std::size_t n, F & out) noexcept {
+	using limits = float_limits<F>;
+	if (n == 0) return false;
+	if (equals(p, n, "NaN")) {
+		out = std::numeric_limits<F>::quiet_NaN();
+		return true;
+	}
+	if (equals(p, n, "Infinity")) {
+		out = std::numeric_limits<F>::infinity();
+		return true;
+	}
+	if (equals(p, n, "-Infinity")) {
+		out = -std::numeric_limits<F>::infinity();
+		return true;
+	}
+	const char * begin = p;
+	const char * end = p + n;
+	bool negative = false;
+	if ((p != end) && ((*p == '-') || (*p == '+'))) {
+		negative = *p == '-';
+		++p;
+	}
+	std::uint64_t mantissa = 0;
+	std::size_t significant = 0;
+	std::size_t digits = 0;
+	int exponent = 0;
+	bool point = false;
+	for (; p != end; ++p) {
+		if ((*p == '.') && !point) {
+			point = true;
+			continue;
+		}
+		unsigned digit = unsigned(static_cast<unsigned char>(*p)) - unsigned('0');
+		if (digit > 9) break;
+		++digits;
+		if (point) --exponent;
+		if ((mantissa == 0) && (digit == 0)) continue;
+		if (++significant > 19) break;
+		mantissa = (mantissa * 10U) + digit;
+	}
+	bool fast = (digits != 0) && (significant <= 19);
+	if (fast && (p != end) && ((*p == 'e') || (*p == 'E'))) {
+		++p;
+		bool negative_exponent = false;
+		if ((p != end) && ((*p == '-') || (*p == '+'))) {
+			negative_exponent = *p == '-';
+			++p;
+		}
+		int e = 0;
+		const char * exponent_begin = p;
+		for (; (p != end) && (*p >= '0') && (*p <= '9') && (e < 10000); ++p) e = (e * 10) + (*p - '0');
+		if (p == exponent_begin) return false;
+		exponent += negative_exponent ? -e : e;
+	}
+	fast = fast && (p == end) &&
+		(mantissa <= limits::max_mantissa) &&
+		(exponent >= -limits::max_exponent) &&
+		(exponent <= limits::max_exponent);
+	if (fast) {
+		static const F powers [] = {
+			F(1e0), F(1e1), F(1e2), F(1e3), F(1e4), F(1e5), F(1e6), F(1e7),
+			F(1e8), F(1e9), F(1e10), F(1e11), F(1e12), F(1e13), F(1e14), F(1e15),
+			F(1e16), F(1e17), F(1e18), F(1e19), F(1e20), F(1e21), F(1e22)
+		};
+		F value = F(mantissa);
+		if (exponent < 0) {
+			value /= powers[-exponent];
+		} else {
+			value *= powers[exponent];
+		}
+		out = negative ? -value : value;
+		return true;
+	}
+	//	Values in text format are NUL terminated so the
+	//	C library may be used for the general case
+	char * parsed;
+	out = limits::fallback(begin, &parsed);
+	return parsed == end;
+}
+
+bool parse_bool (const char * p, std::size_t n, bool & out) noexcept {
+	if (n != 1) return false;
+	if (*p == 't') {
+		out = true;
+		return true;
+	}
+	if (*p == 'f') {
+		out = false;
+		return true;
+	}
+	return false;
+}
+
+bool parse_fixed (const char *& p, const char * end, std::size_t n, int & out) noexcept {
+	if (std::size_t(end - p) < n) return false;
+	int value = 0;
+	for (std::size_t i = 0; i < n; ++i, ++p) {
+		unsigned digit = unsigned(static_cast<unsigned char>(*p)) - unsigned('0');
+		if (digit > 9) return false;
+		value = (value * 10) + int(digit);
+	}
+	out = value;
+	return true;
+}
+
+bool expect (const char *& p, const char * end, char c) noexcept {
+	if ((p == end) || (*p != c)) return false;
+	++p;
+	return true;
+}
+
+//	Days since the Unix epoch of a date in the
+//	proleptic Gregorian calendar
+std::int64_t days_from_civil (std::int64_t y, int m, int d) noexcept {
+	y -= (m <= 2) ? 1 : 0;
+	std::int64_t era = ((y >= 0) ? y : (y - 399)) / 400;
+	auto yoe = std::int64_t(y - (era * 400));
+	std::int64_t doy = (((153 * (m + ((m > 2) ? -3 : 9))) + 2) / 5) + d - 1;
+	std::int64_t doe = (yoe * 365) + (yoe / 4) - (yoe / 100) + doy;
+	return (era * 146097) + doe - 719468;
+}
+
+bool parse_timestamp (const char * p, std::size_t n, std::chrono::system_clock::time_point & out) noexcept {
+	using time_point = std::chrono::system_clock::time_point;
+	if (equals(p, n, "infinity")) {
+		out = time_point::max();
+		return true;
+	}
+	if (equals(p, n, "-infinity")) {
+		out = time_point::min();
+		return true;
+	}
+	//	YYYY-MM-DD HH:MM:SS[.ffffff][+HH[:MM[:SS]]][ BC]
+	const char * end = p + n;
+	std::int64_t year = 0;
+	const char * year_begin = p;
+	for (; (p != end) && (*p >= '0') && (*p <= '9') && ((p - year_begin) < 9); ++p) year = (year * 10) + (*p - '0');
+	if ((p - year_begin) < 4) return false;
+	int month;
+	int day;
+	int hour;
+	int minute;
+	int second;
+	if (!(
+		expect(p, end, '-') &&
+		parse_fixed(p, end, 2, month) &&
+		expect(p, end, '-') &&
+		parse_fixed(p, end, 2, day) &&
+		expect(p, end, ' ') &&
+		parse_fixed(p, end, 2, hour) &&
+		expect(p, end, ':') &&
+		parse_fixed(p, end, 2, minute) &&
+		expect(p, end, ':') &&
+		parse_fixed(p, end, 2, second)
+	)) return false;
+	if ((month < 1) || (month > 12) || (day < 1) || (day > 31) || (hour > 24) || (minute > 59) || (second > 60)) return false;
+	std::int64_t micros = 0;
+	if ((p != end) && (*p == '.')) {
+		++p;
+		int count = 0;
+		for (; (p != end) && (*p >= '0') && (*p <= '9'); ++p, ++count) {
+			if (count < 6) micros = (micros * 10) + (*p - '0');
+		}
+		if (count == 0) return false;
+		for (; count < 6; ++count) micros *= 10;
+	}
+	std::int64_t offset = 0;
+	if ((p != end) && ((*p == '+') || (*p == '-'))) {
+		bool negative = *p == '-';
+		++p;
+		int hours;
+		int minutes = 0;
+		int seconds = 0;
+		if (!parse_fixed(p, end, 2, hours)) return false;
+		if ((p != end) && (*p == ':')) {
+			++p;
+			if (!parse_fixed(p, end, 2, minutes)) return false;
+			if ((p != end) && (*p == ':')) {
+				++p;
+				if (!parse_fixed(p, end, 2, seconds)) return false;
+			}
+		}
+		offset = (std::int64_t(hours) * 3600) + (minutes * 60) + seconds;
+		if (negative) offset = -offset;
+	}
+	if (equals(p, std::size_t(end - p), " BC")) {
+		//	There is no year zero: 1 BC is astronomical
+		//	year zero
+		year = 1 - year;
+		p = end;
+	}
+	if (p != end) return false;
+	std::int64_t seconds = (days_from_civil(year, month, day) * 86400) +
+		(std::int64_t(hour) * 3600) +
+		(minute * 60) +
+		second -
+		offset;
+	//	Values outside the range of the time_point
+	//	are rejected before they can overflow
+	if (
+		(seconds > (detail::max_timestamp_micros / 1000000)) ||
+		(seconds < (detail::min_timestamp_micros / 1000000))
+	) return false;
+	std::int64_t us = seconds * 1000000;
+	if (us > (detail::max_timestamp_micros - micros)) return false;
+	return detail::from_unix_micros(us + micros, out);
+}
+
+bool check_text_column (const PGresult * r, int column, boost::system::error_code & ec) noexcept {
+	ec.clear();
+	if ((column < 0) || (column >= PQnfields(r)) || (PQfformat(r, column) != 0)) {
+		ec = make_error_code(error::type_mismatch);
+		return false;
+	}
+	return true;
+}
+
+void set_valid (std::uint8_t * validity, int row) noexcept {
+	if (validity) validity[row / 8] |= std::uint8_t(1U << unsigned(row % 8));
+}
+
+//	Handles null values and validity and invokes
+//	a function object to parse each other value
+template <typename T, typename Parse>
+void parse_column (
+	const PGresult * r,
+	int column,
+	T * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	Parse parse
+) {
+	if (!check_text_column(r, column, ec)) return;
+	int rows = PQntuples(r);
+	if (validity) std::memset(validity, 0, std::size_t((rows + 7) / 8));
+	for (int i = 0; i < rows; ++i) {
+		if (PQgetisnull(r, i, column)) {
+			if (!validity) {
+				ec = make_error_code(error::unexpected_null);
+				return;
+			}
+			out[i] = T{};
+			continue;
+		}
+		set_valid(validity, i);
+		if (!parse(PQgetvalue(r, i, column), std::size_t(PQgetlength(r, i, column)), out[i])) {
+			ec = make_error_code(error::decode_failed);
+			return;
+		}
+	}
+}
+
+#ifdef ASIO_PQ_HAS_X86_SIMD
+
+//	Parses two values at a time where both are
+//	non-null and short enough, combining their
+//	digits in a single 256 bit vector
+template <typename T>
+ASIO_PQ_TARGET("avx2")
+void parse_integer_column_avx2 (
+	const PGresult * r,
+	int column,
+	T * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec
+) {
+	if (!check_text_column(r, column, ec)) return;
+	int rows = PQntuples(r);
+	if (validity) std::memset(validity, 0, std::size_t((rows + 7) / 8));
+	auto single = [&] (int i) {
+		if (PQgetisnull(r, i, column)) {
+			if (!validity) {
+				ec = make_error_code(error::unexpected_null);
+				return false;
+			}
+			out[i] = T{};
+			return true;
+		}
+		set_valid(validity, i);
+		if (!parse_integer_sse42(PQgetvalue(r, i, column), std::size_t(PQgetlength(r, i, column)), out[i])) {
+			ec = make_error_code(error::decode_failed);
+			return false;
+		}
+		return true;
+	};
+	int i = 0;
+	for (; (i + 1) < rows; i += 2) {
+		integer_text a;
+		integer_text b;
+		__m128i digits_a;
+		__m128i digits_b;
+		bool paired = !PQgetisnull(r, i, column) &&
+			!PQgetisnull(r, i + 1, column) &&
+			split_integer(PQgetvalue(r, i, column), std::size_t(PQgetlength(r, i, column)), a) &&
+			split_integer(PQgetvalue(r, i + 1, column), std::size_t(PQgetlength(r, i + 1, column)), b) &&
+			(a.count <= 16) &&
+			(b.count <= 16) &&
+			prepare_digits(a.digits, a.count, digits_a) &&
+			prepare_digits(b.digits, b.count, digits_b);
+		if (!paired) {
+			if (!(single(i) && single(i + 1))) return;
+			continue;
+		}
+		std::uint64_t magnitude_a;
+		std::uint64_t magnitude_b;
+		combine_digits(digits_a, digits_b, magnitude_a, magnitude_b);
+		set_valid(validity, i);
+		set_valid(validity, i + 1);
+		if (!(finish_integer(a, magnitude_a, out[i]) && finish_integer(b, magnitude_b, out[i + 1]))) {
+			ec = make_error_code(error::decode_failed);
+			return;
+		}
+	}
+	if (i < rows) single(i);
+}
+
+#endif
+
+template <typename T>
+void parse_integer_column (
+	const PGresult * r,
+	int column,
+	T * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level
+) {
+	if (level > supported_simd_level()) level = supported_simd_level();
+	#ifdef ASIO_PQ_HAS_X86_SIMD
+	switch (level) {
+	case simd_level::avx2:
+		parse_integer_column_avx2(r, column, out, validity, ec);
+		return;
+	case simd_level::sse42:
+		parse_column(r, column, out, validity, ec, [] (const char * p, std::size_t n, T & value) noexcept {
+			return parse_integer_sse42(p, n, value);
+		});
+		return;
+	case simd_level::scalar:
+	default:
+		break;
+	}
+	#else
+	(void)level;
+	#endif
+	parse_column(r, column, out, validity, ec, [] (const char * p, std::size_t n, T & value) noexcept {
+		return parse_integer_scalar(p, n, value);
+	});
+}
+
+}
+
+simd_level supported_simd_level () noexcept {
+	static const simd_level level = detect_simd_level();
+	return level;
+}
+
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	std::int16_t * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level
+) {
+	parse_integer_column(r, column, out, validity, ec, level);
+}
+
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	std::int32_t * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level
+) {
+	parse_integer_column(r, column, out, validity, ec, level);
+}
+
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	std::int64_t * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level level
+) {
+	parse_integer_column(r, column, out, validity, ec, level);
+}
+
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	float * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level
+) {
+	parse_column(r, column, out, validity, ec, parse_float<float>);
+}
+
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	double * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level
+) {
+	parse_column(r, column, out, validity, ec, parse_float<double>);
+}
+
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	bool * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level
+) {
+	parse_column(r, column, out, validity, ec, parse_bool);
+}
+
+void parse_text_column (
+	const PGresult * r,
+	int column,
+	std::chrono::system_clock::time_point * out,
+	std::uint8_t * validity,
+	boost::system::error_code & ec,
+	simd_level
+) {
+	parse_column(r, column, out, validity, ec, parse_timestamp);
+}
+
+}
@@ -0,0 +1,173 @@
+#include <asio_pq/pipeline.hpp>
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+#include <boost/optional.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+void pipeline::copy_values (
+	entry & cmd,
+	int n_params,
+	const char * const * values,
+	const int * lengths,
+	const int * formats
+) {
+	assert(n_params >= 0);
+	auto n = std::size_t(n_params);
+	cmd.values.reserve(n);
+	cmd.formats.reserve(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		int format = formats ? formats[i] : 0;
+		cmd.formats.push_back(format);
+		if (!(values && values[i])) {
+			cmd.values.emplace_back();
+			continue;
+		}
+		//	Lengths are ignored for text format
+		//	parameters which are instead null
+		//	terminated
+		std::size_t length = (format == 0) ? std::strlen(values[i]) : std::size_t(lengths[i]);
+		cmd.values.emplace_back(std::string(values[i], length));
+	}
+}
+
+void pipeline::query (std::string command, int result_format) {
+	query(std::move(command), 0, nullptr, nullptr, nullptr, nullptr, result_format);
+}
+
+void pipeline::query (
+	std::string command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format
+) {
+	entry cmd;
+	cmd.type = command_type::query;
+	cmd.text = std::move(command);
+	if (param_types) cmd.types.assign(param_types, param_types + n_params);
+	copy_values(cmd, n_params, param_values, param_lengths, param_formats);
+	cmd.result_format = result_format;
+	commands_.push_back(std::move(cmd));
+}
+
+void pipeline::prepare (
+	std::string stmt_name,
+	std::string query,
+	int n_params,
+	const Oid * param_types
+) {
+	entry cmd;
+	cmd.type = command_type::prepare;
+	cmd.name = std::move(stmt_name);
+	cmd.text = std::move(query);
+	if (param_types) cmd.types.assign(param_types, param_types + n_params);
+	cmd.result_format = 0;
+	commands_.push_back(std::move(cmd));
+}
+
+void pipeline::query_prepared (
+	std::string stmt_name,
+	int n_params,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format
+) {
+	entry cmd;
+	cmd.type = command_type::query_prepared;
+	cmd.name = std::move(stmt_name);
+	copy_values(cmd, n_params, param_values, param_lengths, param_formats);
+	cmd.result_format = result_format;
+	commands_.push_back(std::move(cmd));
+}
+
+void pipeline::describe_prepared (std::string stmt_name) {
+	entry cmd;
+	cmd.type = command_type::describe_prepared;
+	cmd.name = std::move(stmt_name);
+	cmd.result_format = 0;
+	commands_.push_back(std::move(cmd));
+}
+
+std::size_t pipeline::size () const noexcept {
+	return commands_.size();
+}
+
+bool pipeline::empty () const noexcept {
+	return commands_.empty();
+}
+
+void pipeline::clear () noexcept {
+	commands_.clear();
+}
+
+std::size_t pipeline::send (PGconn * conn) const {
+	std::vector<const char *> values;
+	std::vector<int> lengths;
+	std::size_t retr = 0;
+	for (auto && cmd : commands_) {
+		values.clear();
+		lengths.clear();
+		for (auto && value : cmd.values) {
+			values.push_back(value ? value->data() : nullptr);
+			lengths.push_back(value ? int(value->size()) : 0);
+		}
+		int n_values = int(values.size());
+		int result = 0;
+		switch (cmd.type) {
+		case command_type::query:
+			result = PQsendQueryParams(
+				conn,
+				cmd.text.c_str(),
+				n_values,
+				cmd.types.empty() ? nullptr : cmd.types.data(),
+				values.data(),
+				lengths.data(),
+				cmd.formats.data(),
+				cmd.result_format
+			);
+			break;
+		case command_type::prepare:
+			result = PQsendPrepare(
+				conn,
+				cmd.name.c_str(),
+				cmd.text.c_str(),
+				int(cmd.types.size()),
+				cmd.types.empty() ? nullptr : cmd.types.data()
+			);
+			break;
+		case command_type::query_prepared:
+			result = PQsendQueryPrepared(
+				conn,
+				cmd.name.c_str(),
+				n_values,
+				values.data(),
+				lengths.data(),
+				cmd.formats.data(),
+				cmd.result_format
+			);
+			break;
+		case command_type::describe_prepared:
+			result = PQsendDescribePrepared(conn, cmd.name.c_str());
+			break;
+		}
+		if (result == 0) break;
+		++retr;
+	}
+	return retr;
+}
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+#include <asio_pq/pool.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+namespace asio_pq {
+
+namespace {
+
+//	PQstatus only changes once libpq notices the
+//	connection has failed so any input is consumed
+//	first (which does not block since connections
+//	in the pool are non-blocking)
+bool usable (connection & conn) noexcept {
+	return
+		conn &&
+		conn.has_socket() &&
+		(PQconsumeInput(conn) == 1) &&
+		(PQstatus(conn) == CONNECTION_OK) &&
+		#ifdef LIBPQ_HAS_PIPELINING
+		(PQpipelineStatus(conn) == PQ_PIPELINE_OFF) &&
+		#endif
+		(PQtransactionStatus(conn) == PQTRANS_IDLE);
+}
+
+}
+
+lease::lease () noexcept : pool_(nullptr) {	}
+
+lease::lease (lease && other) noexcept
+	:	pool_(other.pool_),
+		conn_(std::move(other.conn_))
+{
+	other.pool_ = nullptr;
+	other.conn_ = boost::none;
+}
+
+lease & lease::operator = (lease && rhs) noexcept {
+	reset();
+	using std::swap;
+	swap(pool_, rhs.pool_);
+	swap(conn_, rhs.conn_);
+	return *this;
+}
+
+lease::~lease () noexcept {
+	reset();
+}
+
+void lease::reset () noexcept {
+	if (!conn_) return;
+	assert(pool_);
+	connection conn(std::move(*conn_));
+	conn_ = boost::none;
+	pool_->release(std::move(conn));
+	pool_ = nullptr;
+}
+
+connection & lease::get () noexcept {
+	assert(conn_);
+	return *conn_;
+}
+
+connection & lease::operator * () noexcept {
+	return get();
+}
+
+connection * lease::operator -> () noexcept {
+	return &get();
+}
+
+lease::operator bool () const noexcept {
+	return bool(conn_);
+}
+
+lease::lease (pool & p, connection conn) noexcept
+	:	pool_(&p),
+		conn_(std::move(conn))
+{	}
+
+namespace detail {
+
+pool_waiter_base::~pool_waiter_base () noexcept {	}
+
+}
+
+pool::connect_handler::connect_handler (pool & self, list_type::iterator iter) noexcept
+	:	self_(&self),
+		iter_(iter)
+{	}
+
+void pool::connect_handler::operator () (boost::system::error_code ec) {
+	self_->connected(iter_, ec);
+}
+
+std::size_t pool::total () const noexcept {
+	return idle_.size() + connecting_.size() + leased_;
+}
+
+void pool::replenish (bool fill) {
+	while (
+		(connecting_.size() < settings_.max_connecting) &&
+		(total() < settings_.max_size) &&
+		((waiters_.size() > connecting_.size()) || (fill && (total() < settings_.min_size)))
+	) {
+		connecting_.push_back(factory_(ios_));
+		auto iter = connecting_.end();
+		--iter;
+		async_connect(*iter, connect_handler(*this, iter));
+	}
+}
+
+void pool::connected (list_type::iterator iter, boost::system::error_code ec) {
+	connection conn(std::move(*iter));
+	connecting_.erase(iter);
+	if (!ec && (PQsetnonblocking(conn, 1) != 0)) ec = make_error_code(error::set_nonblocking_failed);
+	if (ec) {
+		//	Only as many attempts as there are waiters
+		//	are retried so a server which is down does
+		//	not cause connection attempts to spin
+		if (!waiters_.empty()) {
+			auto waiter = std::move(waiters_.front());
+			waiters_.pop_front();
+			waiter->complete(ios_, ec, lease{});
+		}
+		replenish(false);
+		return;
+	}
+	put(std::move(conn));
+	replenish(true);
+}
+
+void pool::put (connection conn) {
+	if (waiters_.empty()) {
+		idle_.push_back(std::move(conn));
+		return;
+	}
+	auto waiter = std::move(waiters_.front());
+	waiters_.pop_front();
+	++leased_;
+	waiter->complete(ios_, boost::system::error_code{}, lease(*this, std::move(conn)));
+}
+
+void pool::release (connection conn) noexcept {
+	assert(leased_ != 0);
+	--leased_;
+	//	This is invoked from the destructor of lease
+	//	so failures (to post a completion handler or
+	//	to begin a connection attempt) cannot be
+	//	reported and are dropped
+	try {
+		if (usable(conn)) {
+			put(std::move(conn));
+			return;
+		}
+		replenish(true);
+	} catch (...) {	}
+}
+
+boost::optional<connection> pool::take () {
+	//	Connections which have become unusable while idle
+	//	are discarded, the caller replenishes the pool
+	while (!idle_.empty()) {
+		connection conn(std::move(idle_.back()));
+		idle_.pop_back();
+		if (usable(conn)) return boost::optional<connection>(std::move(conn));
+	}
+	return boost::none;
+}
+
+pool::pool (boost::asio::io_service & ios, factory_type factory, pool_settings settings)
+	:	ios_(ios),
+		factory_(std::move(factory)),
+		settings_(settings),
+		leased_(0)
+{
+	assert(factory_);
+	assert(settings_.max_size != 0);
+	assert(settings_.max_connecting != 0);
+	idle_.reserve(settings_.max_size);
+	replenish(true);
+}
+
+pool::pool (boost::asio::io_service & ios, std::string conninfo, pool_settings settings)
+	:	pool(
+			ios,
+			[conninfo = std::move(conninfo)] (boost::asio::io_service & ios) {
+				return connection(ios, conninfo.c_str());
+			},
+			settings
+		)
+{	}
+
+boost::asio::io_service & pool::get_io_service () const noexcept {
+	return ios_;
+}
+
+std::size_t pool::idle () const noexcept {
+	return idle_.size();
+}
+
+std::size_t pool::leased () const noexcept {
+	return leased_;
+}
+
+std::size_t pool::connecting () const noexcept {
+	return connecting_.size();
+}
+
+std::size_t pool::waiting () const noexcept {
+	return waiters_.size();
+}
+
+}
@@ -0,0 +1,222 @@
+#include <asio_pq/result_cache.hpp>
+
+#include <asio_pq/connection.hpp>
+#include <asio_pq/notification.hpp>
+#include <asio_pq/notification_dispatcher.hpp>
+#include <asio_pq/result.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+namespace {
+
+std::size_t result_bytes (const result & r) noexcept {
+#ifdef LIBPQ_HAS_PIPELINING
+	//	PQresultMemorySize is available from libpq 12
+	//	onward and pipelining from 14 onward
+	return PQresultMemorySize(r);
+#else
+	std::size_t retr = sizeof(PGresult *);
+	int rows = PQntuples(r);
+	int columns = PQnfields(r);
+	for (int row = 0; row < rows; ++row) {
+		for (int column = 0; column < columns; ++column) {
+			retr += std::size_t(PQgetlength(r, row, column)) + 1 + sizeof(void *);
+		}
+	}
+	return retr;
+#endif
+}
+
+void append_integer (std::string & str, std::int32_t i) {
+	char buffer [sizeof(i)];
+	std::memcpy(buffer, &i, sizeof(i));
+	str.append(buffer, sizeof(buffer));
+}
+
+}
+
+void result_cache::erase (list_type::iterator iter) {
+	for (auto && tag : iter->tags) {
+		auto t = tags_.find(tag);
+		if (t == tags_.end()) continue;
+		auto & entries = t->second;
+		entries.erase(std::remove(entries.begin(), entries.end(), iter), entries.end());
+		if (entries.empty()) tags_.erase(t);
+	}
+	bytes_ -= iter->bytes;
+	map_.erase(iter->key);
+	lru_.erase(iter);
+}
+
+result_cache::result_cache (result_cache_settings settings)
+	:	settings_(settings),
+		bytes_(0),
+		hits_(0),
+		misses_(0)
+{	}
+
+std::string result_cache::make_key (
+	const std::string & command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format
+) {
+	std::string retr(command);
+	//	The command may not contain a null character so
+	//	this unambiguously separates it from what follows
+	retr.push_back('\0');
+	retr.push_back(char(result_format));
+	append_integer(retr, n_params);
+	for (int i = 0; i < n_params; ++i) {
+		append_integer(retr, param_types ? std::int32_t(param_types[i]) : 0);
+		bool binary = param_formats && (param_formats[i] != 0);
+		retr.push_back(char(binary));
+		const char * value = param_values ? param_values[i] : nullptr;
+		if (!value) {
+			append_integer(retr, -1);
+			continue;
+		}
+		//	PQsendQueryParams ignores the lengths of
+		//	text parameters
+		std::size_t length = binary ? std::size_t(param_lengths[i]) : std::strlen(value);
+		append_integer(retr, std::int32_t(length));
+		retr.append(value, length);
+	}
+	return retr;
+}
+
+std::string result_cache::make_key (
+	const connection & conn,
+	const std::string & command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format
+) {
+	std::string retr;
+	for (const char * str : {PQhost(conn), PQport(conn), PQdb(conn), PQuser(conn)}) {
+		if (str) retr.append(str);
+		retr.push_back('\0');
+	}
+	retr.append(make_key(
+		command,
+		n_params,
+		param_types,
+		param_values,
+		param_lengths,
+		param_formats,
+		result_format
+	));
+	return retr;
+}
+
+result_cache::value_type result_cache::find (const std::string & key, clock_type::time_point now) {
+	auto iter = map_.find(key);
+	if (iter == map_.end()) {
+		++misses_;
+		return value_type{};
+	}
+	auto e = iter->second;
+	if (now >= e->expires) {
+		erase(e);
+		++misses_;
+		return value_type{};
+	}
+	lru_.splice(lru_.begin(), lru_, e);
+	++hits_;
+	return e->value;
+}
+
+bool result_cache::insert (
+	std::string key,
+	value_type value,
+	std::vector<std::string> tags,
+	clock_type::time_point now
+) {
+	assert(value);
+	//	invalidate erases each entry once per occurrence
+	//	of the tag
+	std::sort(tags.begin(), tags.end());
+	tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+	auto existing = map_.find(key);
+	if (existing != map_.end()) erase(existing->second);
+	auto bytes = result_bytes(*value) + key.size();
+	if (bytes > settings_.max_bytes) return false;
+	while ((settings_.max_bytes - bytes_) < bytes) {
+		assert(!lru_.empty());
+		erase(std::prev(lru_.end()));
+	}
+	lru_.push_front(entry{std::move(key), std::move(value), bytes, now + settings_.ttl, std::move(tags)});
+	auto iter = lru_.begin();
+	bytes_ += bytes;
+	try {
+		map_.emplace(iter->key, iter);
+		for (auto && tag : iter->tags) tags_[tag].push_back(iter);
+	} catch (...) {
+		erase(iter);
+		throw;
+	}
+	return true;
+}
+
+std::size_t result_cache::invalidate (const std::string & tag) {
+	auto t = tags_.find(tag);
+	if (t == tags_.end()) return 0;
+	auto entries = std::move(t->second);
+	tags_.erase(t);
+	for (auto && iter : entries) erase(iter);
+	return entries.size();
+}
+
+void result_cache::clear () noexcept {
+	map_.clear();
+	tags_.clear();
+	lru_.clear();
+	bytes_ = 0;
+}
+
+notification_dispatcher::subscription result_cache::listen (notification_dispatcher & dispatcher, std::string channel) {
+	return dispatcher.subscribe(std::move(channel), [this] (const auto & n) {
+		const char * payload = n->payload();
+		if (*payload == '\0') {
+			clear();
+			return;
+		}
+		invalidate(payload);
+	});
+}
+
+std::size_t result_cache::size () const noexcept {
+	return lru_.size();
+}
+
+std::size_t result_cache::bytes () const noexcept {
+	return bytes_;
+}
+
+std::size_t result_cache::hits () const noexcept {
+	return hits_;
+}
+
+std::size_t result_cache::misses () const noexcept {
+	return misses_;
+}
+
+}
@@ -0,0 +1,136 @@
+#include <asio_pq/statement_cache.hpp>
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+#include <asio_pq/result.hpp>
+#include <libpq-fe.h>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+namespace {
+
+std::atomic<unsigned long long> instances(0);
+
+}
+
+statement_cache::statement_cache (std::size_t capacity, std::size_t promote_after)
+	:	capacity_(capacity),
+		promote_after_(promote_after),
+		id_(instances.fetch_add(1, std::memory_order_relaxed)),
+		next_(0)
+{
+	assert(capacity_ != 0);
+	map_.reserve(capacity_);
+}
+
+const statement_cache::entry * statement_cache::find (const std::string & command) const {
+	auto iter = map_.find(command);
+	if (iter == map_.end()) return nullptr;
+	return &*iter->second;
+}
+
+std::size_t statement_cache::size () const noexcept {
+	return lru_.size();
+}
+
+std::size_t statement_cache::capacity () const noexcept {
+	return capacity_;
+}
+
+std::size_t statement_cache::pending_deallocations () const noexcept {
+	return deallocate_.size();
+}
+
+void statement_cache::clear () noexcept {
+	map_.clear();
+	lru_.clear();
+	deallocate_.clear();
+}
+
+statement_cache::entry & statement_cache::use (const std::string & command) {
+	auto iter = map_.find(command);
+	if (iter != map_.end()) {
+		lru_.splice(lru_.begin(), lru_, iter->second);
+		auto & e = lru_.front();
+		++e.uses;
+		return e;
+	}
+	if (lru_.size() == capacity_) {
+		auto & victim = lru_.back();
+		if (!victim.name.empty()) deallocate_.push_back(std::move(victim.name));
+		map_.erase(victim.command);
+		lru_.pop_back();
+	}
+	lru_.emplace_front();
+	auto & e = lru_.front();
+	e.command = command;
+	e.uses = 1;
+	e.failed = false;
+	map_.emplace(command, lru_.begin());
+	return e;
+}
+
+bool statement_cache::should_promote (const entry & e) const noexcept {
+	return e.name.empty() && !e.failed && (promote_after_ != 0) && (e.uses >= promote_after_);
+}
+
+std::string statement_cache::make_name () {
+	std::string retr("asio_pq_");
+	retr += std::to_string(id_);
+	retr += '_';
+	retr += std::to_string(next_++);
+	return retr;
+}
+
+void statement_cache::prepared (const std::string & command, std::string name, result description) {
+	auto iter = map_.find(command);
+	//	The command may have been evicted while
+	//	it was being prepared in which case the
+	//	statement must be deallocated
+	if (iter == map_.end()) {
+		deallocate_.push_back(std::move(name));
+		return;
+	}
+	auto & e = *iter->second;
+	e.name = std::move(name);
+	e.description = std::move(description);
+}
+
+void statement_cache::prepare_failed (const std::string & command) {
+	auto iter = map_.find(command);
+	if (iter != map_.end()) iter->second->failed = true;
+}
+
+std::vector<std::string> statement_cache::take_deallocations () {
+	std::vector<std::string> retr;
+	using std::swap;
+	swap(retr, deallocate_);
+	return retr;
+}
+
+void statement_cache::deallocate (std::string name) {
+	deallocate_.push_back(std::move(name));
+}
+
+namespace detail {
+
+bool should_retry_deallocate (const result & r) noexcept {
+	if (PQresultStatus(r) == PGRES_COMMAND_OK) return false;
+	//	invalid_sql_statement_name: The statement
+	//	does not exist so retrying cannot succeed
+	const char * state = PQresultErrorField(r, PG_DIAG_SQLSTATE);
+	return !(state && (std::strcmp(state, "26000") == 0));
+}
+
+}
+
+}
+
+#endif
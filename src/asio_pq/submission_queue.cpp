@@ -0,0 +1,323 @@
+#include <asio_pq/submission_queue.hpp>
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+#include <asio_pq/connection.hpp>
+#include <asio_pq/detail/handler_memory.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/get_result.hpp>
+#include <asio_pq/pipeline.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace asio_pq {
+
+class submission_queue::submission {
+public:
+	submission * next;
+	pipeline command;
+	//	Empty once the callback has been invoked
+	callback_type callback;
+	void complete (boost::system::error_code ec, result r) {
+		if (!callback) return;
+		auto c = std::move(callback);
+		callback = nullptr;
+		c(ec, std::move(r));
+	}
+};
+
+class submission_queue::state : public std::enable_shared_from_this<state> {
+private:
+	using pointer = std::unique_ptr<submission>;
+	connection & conn_;
+	std::size_t max_batch_;
+	//	Producers push onto the head of this intrusive
+	//	stack, the consumer takes the entire stack at
+	//	once
+	std::atomic<submission *> head_;
+	//	Everything below is only accessed on the thread
+	//	running the io_service
+	std::deque<pointer> pending_;
+	//	The batch in flight: The submissions before sent_
+	//	were sent to the server and those before index_
+	//	have completed
+	std::vector<pointer> batch_;
+	std::size_t sent_;
+	std::size_t index_;
+	//	The last result of the submission at index_
+	result last_;
+	bool running_;
+	bool closed_;
+	//	Once set every submission fails with this
+	boost::system::error_code error_code_;
+	std::size_t batches_;
+	void take ();
+	void abort () noexcept;
+	void fail (std::vector<pointer>::iterator begin, boost::system::error_code ec);
+	void begin ();
+	void get_result ();
+	void end ();
+	void on_result (boost::system::error_code ec, result r);
+public:
+	state (connection & conn, std::size_t max_batch) noexcept
+		:	conn_(conn),
+			max_batch_(max_batch),
+			head_(nullptr),
+			sent_(0),
+			index_(0),
+			running_(false),
+			closed_(false),
+			batches_(0)
+	{	}
+	~state () noexcept {
+		auto s = head_.exchange(nullptr, std::memory_order_acquire);
+		while (s) {
+			pointer p(s);
+			s = s->next;
+		}
+	}
+	connection & get_connection () const noexcept {
+		return conn_;
+	}
+	std::size_t batches () const noexcept {
+		return batches_;
+	}
+	void push (pointer s);
+	void drain ();
+	void next ();
+	void close () noexcept;
+};
+
+void submission_queue::state::push (pointer s) {
+	assert(s->callback);
+	auto head = head_.load(std::memory_order_relaxed);
+	do s->next = head;
+	while (!head_.compare_exchange_weak(
+		head,
+		s.get(),
+		std::memory_order_release,
+		std::memory_order_relaxed
+	));
+	s.release();
+	//	Only the submission which finds the stack empty
+	//	needs to wake the consumer since the consumer
+	//	takes everything which was pushed after it
+	if (head) return;
+	auto self = shared_from_this();
+	conn_.get_io_service().post(detail::make_recycling_handler(
+		[self] () {	self->drain();	},
+		conn_.memory()
+	));
+}
+
+void submission_queue::state::take () {
+	auto s = head_.exchange(nullptr, std::memory_order_acquire);
+	//	The stack is in LIFO order
+	auto first = pending_.size();
+	while (s) {
+		auto next = s->next;
+		pending_.emplace_back(s);
+		s = next;
+	}
+	std::reverse(pending_.begin() + first, pending_.end());
+}
+
+void submission_queue::state::drain () {
+	take();
+	//	Submissions made by callbacks invoked when
+	//	the queue was destroyed
+	if (closed_) {
+		abort();
+		return;
+	}
+	next();
+}
+
+void submission_queue::state::abort () noexcept {
+	auto ec = make_error_code(boost::asio::error::operation_aborted);
+	for (auto && s : pending_) s->complete(ec, result{});
+	pending_.clear();
+}
+
+void submission_queue::state::fail (std::vector<pointer>::iterator begin, boost::system::error_code ec) {
+	for (; begin != batch_.end(); ++begin) (*begin)->complete(ec, result{});
+}
+
+void submission_queue::state::next () {
+	while (!(running_ || closed_ || pending_.empty())) begin();
+}
+
+void submission_queue::state::begin () {
+	assert(batch_.empty());
+	auto n = std::min(pending_.size(), max_batch_);
+	batch_.reserve(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		batch_.push_back(std::move(pending_.front()));
+		pending_.pop_front();
+	}
+	sent_ = 0;
+	index_ = 0;
+	if (!error_code_ && (PQenterPipelineMode(conn_) == 0)) error_code_ = make_error_code(error::send_failed);
+	if (error_code_) {
+		fail(batch_.begin(), error_code_);
+		batch_.clear();
+		return;
+	}
+	//	Each command is followed by its own synchronization
+	//	point so that each runs in its own implicit transaction
+	for (auto && s : batch_) {
+		if (s->command.send(conn_) != s->command.size()) break;
+		#ifdef LIBPQ_HAS_SEND_PIPELINE_SYNC
+		bool last = (&s == &batch_.back());
+		int result = last ? PQpipelineSync(conn_) : PQsendPipelineSync(conn_);
+		#else
+		int result = PQpipelineSync(conn_);
+		#endif
+		if (result == 0) {
+			//	The command was queued without a synchronization
+			//	point so the connection cannot be used further
+			error_code_ = make_error_code(error::send_failed);
+			break;
+		}
+		++sent_;
+	}
+	if (sent_ != batch_.size()) {
+		fail(batch_.begin() + sent_, make_error_code(error::send_failed));
+		//	The synchronization points which were queued may
+		//	not have been flushed
+		if (PQflush(conn_) < 0) error_code_ = make_error_code(error::send_failed);
+	}
+	if (sent_ == 0) {
+		PQexitPipelineMode(conn_);
+		batch_.clear();
+		return;
+	}
+	running_ = true;
+	++batches_;
+	get_result();
+}
+
+void submission_queue::state::get_result () {
+	auto self = shared_from_this();
+	async_get_result(conn_, [self] (auto ec, auto r) {	self->on_result(ec, std::move(r));	});
+}
+
+void submission_queue::state::end () {
+	PQexitPipelineMode(conn_);
+	batch_.clear();
+	last_ = result{};
+	running_ = false;
+	next();
+}
+
+void submission_queue::state::on_result (boost::system::error_code ec, result r) {
+	assert(running_);
+	if (ec) {
+		error_code_ = ec;
+		fail(batch_.begin() + index_, ec);
+		end();
+		return;
+	}
+	//	Each command's results are terminated by a null
+	//	PGresult * which is followed by the result of its
+	//	synchronization point
+	if (!r) {
+		get_result();
+		return;
+	}
+	if (PQresultStatus(r) == PGRES_PIPELINE_SYNC) {
+		auto & s = *batch_[index_];
+		++index_;
+		s.complete(boost::system::error_code{}, std::move(last_));
+		last_ = result{};
+		if (index_ == sent_) {
+			end();
+			return;
+		}
+		get_result();
+		return;
+	}
+	//	If a command yields more than one result (i.e. in
+	//	single row mode) only the last is retained
+	last_ = std::move(r);
+	get_result();
+}
+
+void submission_queue::state::close () noexcept {
+	closed_ = true;
+	take();
+	//	The batch in flight (if any) continues so that
+	//	its results are drained from the connection but
+	//	its callbacks are invoked now
+	if (running_) fail(batch_.begin() + index_, make_error_code(boost::asio::error::operation_aborted));
+	abort();
+}
+
+submission_queue::submission_queue (connection & conn, std::size_t max_batch)
+	:	state_(std::make_shared<state>(conn, max_batch))
+{
+	assert(max_batch != 0);
+}
+
+submission_queue::~submission_queue () noexcept {
+	state_->close();
+}
+
+boost::asio::io_service & submission_queue::get_io_service () const noexcept {
+	return state_->get_connection().get_io_service();
+}
+
+connection & submission_queue::get_connection () const noexcept {
+	return state_->get_connection();
+}
+
+void submission_queue::submit (std::string command, callback_type callback) {
+	std::unique_ptr<submission> s(new submission);
+	s->command.query(std::move(command));
+	s->callback = std::move(callback);
+	state_->push(std::move(s));
+}
+
+void submission_queue::submit (
+	std::string command,
+	int n_params,
+	const Oid * param_types,
+	const char * const * param_values,
+	const int * param_lengths,
+	const int * param_formats,
+	int result_format,
+	callback_type callback
+) {
+	std::unique_ptr<submission> s(new submission);
+	s->command.query(
+		std::move(command),
+		n_params,
+		param_types,
+		param_values,
+		param_lengths,
+		param_formats,
+		result_format
+	);
+	s->callback = std::move(callback);
+	state_->push(std::move(s));
+}
+
+std::size_t submission_queue::batches () const noexcept {
+	return state_->batches();
+}
+
+}
+
+#endif
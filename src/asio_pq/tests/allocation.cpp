@@ -0,0 +1,210 @@
+#include <asio_pq/get_result.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/detail/handler_memory.hpp>
+#include <asio_pq/detail/op.hpp>
+#include <asio_pq/detail/socket.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <catch.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+//	Counts the blocks a detail::handler_memory could
+//	not serve from its cache
+class counting_upstream final : public detail::handler_memory::upstream {
+public:
+	counting_upstream () noexcept
+		:	allocations(0)
+	{	}
+	std::atomic<std::size_t> allocations;
+	virtual void * allocate (std::size_t size) override {
+		++allocations;
+		return ::operator new(size);
+	}
+	virtual void deallocate (void * ptr, std::size_t) noexcept override {
+		::operator delete(ptr);
+	}
+};
+
+SCENARIO("Handlers wrapped via detail::make_recycling_handler do not allocate in the steady state", "[asio_pq][handler_memory]") {
+	GIVEN("A boost::asio::io_service, a strand, and a detail::handler_memory") {
+		boost::asio::io_service ios;
+		boost::asio::io_service::strand strand(ios);
+		counting_upstream upstream;
+		detail::handler_memory memory(upstream);
+		std::size_t invoked = 0;
+		auto round_trip = [&] () {
+			strand.post(detail::make_recycling_handler([&] () {	++invoked;	}, memory));
+			ios.post(detail::make_recycling_handler([&] () {	++invoked;	}, memory));
+			ios.run();
+			ios.reset();
+		};
+		WHEN("Handlers are repeatedly posted") {
+			round_trip();
+			round_trip();
+			auto before = upstream.allocations.load();
+			for (int i = 0; i < 100; ++i) round_trip();
+			auto after = upstream.allocations.load();
+			THEN("Nothing is allocated once the memory has been warmed up") {
+				CHECK(invoked == 204);
+				CHECK(after == before);
+			}
+		}
+		#ifdef ASIO_PQ_HAS_BORROWED_DESCRIPTOR
+		WHEN("Readiness is repeatedly awaited") {
+			int fds [2];
+			REQUIRE(::pipe(fds) == 0);
+			{
+				detail::borrowed_descriptor descriptor(ios);
+				boost::system::error_code ec;
+				descriptor.assign(fds[0], ec);
+				REQUIRE_FALSE(ec);
+				REQUIRE(::write(fds[1], "x", 1) == 1);
+				auto wait = [&] () {
+					detail::async_readable(
+						descriptor,
+						strand.wrap(
+							detail::make_recycling_handler([&] (auto ec) {	if (!ec) ++invoked;	}, memory)
+						)
+					);
+					ios.run();
+					ios.reset();
+				};
+				wait();
+				wait();
+				auto before = upstream.allocations.load();
+				for (int i = 0; i < 100; ++i) wait();
+				auto after = upstream.allocations.load();
+				THEN("Nothing is allocated once the memory has been warmed up") {
+					CHECK(invoked == 102);
+					CHECK(after == before);
+				}
+			}
+			::close(fds[0]);
+			::close(fds[1]);
+		}
+		WHEN("Readiness is repeatedly awaited by a handler which wraps a handler wrapped by the strand") {
+			//	The strand dispatches the completion in a handler
+			//	which allocates via the recycling_handler but
+			//	deallocates via the handler the strand wraps
+			int fds [2];
+			REQUIRE(::pipe(fds) == 0);
+			{
+				detail::borrowed_descriptor descriptor(ios);
+				boost::system::error_code ec;
+				descriptor.assign(fds[0], ec);
+				REQUIRE_FALSE(ec);
+				REQUIRE(::write(fds[1], "x", 1) == 1);
+				for (int i = 0; i < 100; ++i) {
+					detail::async_readable(
+						descriptor,
+						detail::make_recycling_handler(
+							strand.wrap([&] (auto ec) {	if (!ec) ++invoked;	}),
+							memory
+						)
+					);
+					ios.run();
+					ios.reset();
+				}
+				THEN("Every handler is invoked") {
+					CHECK(invoked == 100);
+				}
+			}
+			::close(fds[0]);
+			::close(fds[1]);
+		}
+		#endif
+	}
+}
+
+SCENARIO("async_get_result does not allocate in the steady state", "[asio_pq][async_get_result][handler_memory]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		counting_upstream upstream;
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		conn.memory() = detail::handler_memory(upstream);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		std::size_t failures = 0;
+		std::size_t results = 0;
+		auto round_trip = [&] () {
+			if (PQsendQuery(conn, "SELECT 1") != 1) {
+				++failures;
+				return;
+			}
+			for (;;) {
+				result r;
+				boost::system::error_code ec;
+				async_get_result(conn, [&] (auto e, auto inner) {
+					ec = e;
+					r = std::move(inner);
+				});
+				ios.run();
+				ios.reset();
+				if (ec) {
+					++failures;
+					return;
+				}
+				if (!r) break;
+				++results;
+			}
+		};
+		WHEN("Commands are repeatedly sent and their results retrieved via async_get_result") {
+			//	Whether a result is already available when
+			//	async_get_result is invoked depends on timing
+			//	so warm up both the immediate and waiting paths
+			for (int i = 0; i < 100; ++i) round_trip();
+			auto before = upstream.allocations.load();
+			for (int i = 0; i < 100; ++i) round_trip();
+			auto after = upstream.allocations.load();
+			THEN("Nothing is allocated once the connection's memory has been warmed up") {
+				INFO("PQerrorMessage: " << PQerrorMessage(conn));
+				REQUIRE(failures == 0);
+				CHECK(results == 200);
+				CHECK(after == before);
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,150 @@
+#include <asio_pq/awaitable.hpp>
+
+#ifdef ASIO_PQ_HAS_COROUTINES
+
+#include <asio_pq/connection.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <libpq-fe.h>
+#include <chrono>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+const char * keywords [] = {
+	"host",
+	"port",
+	"user",
+	"password",
+	"dbname",
+	nullptr
+};
+const char * values [] = {
+	ASIO_PQ_TEST_HOST,
+	ASIO_PQ_TEST_PORT,
+	ASIO_PQ_TEST_USER,
+	ASIO_PQ_TEST_PASSWORD,
+	ASIO_PQ_TEST_DBNAME,
+	nullptr
+};
+
+//	A coroutine which starts immediately and is not
+//	awaited, exceptions are stored to be rethrown by
+//	the test
+class task {
+public:
+	class promise_type {
+	public:
+		task get_return_object () noexcept {
+			return task{};
+		}
+		std::suspend_never initial_suspend () noexcept {
+			return {};
+		}
+		std::suspend_never final_suspend () noexcept {
+			return {};
+		}
+		void return_void () noexcept {	}
+		void unhandled_exception () noexcept {
+			exception = std::current_exception();
+		}
+	};
+	static std::exception_ptr exception;
+};
+std::exception_ptr task::exception;
+
+task connect_and_exec (connection & conn, std::vector<result> & results, bool & done) {
+	co_await async_connect(conn, std::chrono::minutes(1), use_awaitable);
+	results = co_await async_exec(conn, "SELECT 1;", use_awaitable);
+	done = true;
+}
+
+task get_results (connection & conn, int & results, bool & done) {
+	co_await async_connect(conn, use_awaitable);
+	if (PQsendQuery(conn, "SELECT 1;") != 1) throw std::runtime_error("PQsendQuery failed");
+	//	The result arrives together with ReadyForQuery so
+	//	the null result which follows is obtained without
+	//	suspending
+	for (;;) {
+		auto r = co_await async_get_result(conn, use_awaitable);
+		if (!r) break;
+		++results;
+	}
+	done = true;
+}
+
+task time_out (connection & conn, boost::system::error_code & ec, bool & done) {
+	co_await async_connect(conn, use_awaitable);
+	if (PQsendQuery(conn, "SELECT pg_sleep(10);") != 1) throw std::runtime_error("PQsendQuery failed");
+	try {
+		co_await async_get_result(conn, std::chrono::milliseconds(100), use_awaitable);
+	} catch (const boost::system::system_error & ex) {
+		ec = ex.code();
+	}
+	for (;;) {
+		auto r = co_await async_get_result(conn, use_awaitable);
+		if (!r) break;
+	}
+	done = true;
+}
+
+SCENARIO("Operations may be awaited from a coroutine", "[asio_pq][use_awaitable]") {
+	GIVEN("A boost::asio::io_service and a connection handle") {
+		boost::asio::io_service ios;
+		connection conn(ios, keywords, values, false);
+		task::exception = nullptr;
+		bool done = false;
+		WHEN("async_connect and async_exec are awaited") {
+			std::vector<result> results;
+			connect_and_exec(conn, results, done);
+			CHECK_FALSE(done);
+			ios.run();
+			if (task::exception) std::rethrow_exception(task::exception);
+			THEN("They succeed") {
+				CHECK(done);
+				REQUIRE(results.size() == 1U);
+				CHECK(PQresultStatus(results.front()) == PGRES_TUPLES_OK);
+				REQUIRE(PQntuples(results.front()) == 1);
+				CHECK(std::strcmp(PQgetvalue(results.front(), 0, 0), "1") == 0);
+			}
+		}
+		WHEN("async_get_result is awaited until there are no more results") {
+			int results = 0;
+			get_results(conn, results, done);
+			ios.run();
+			if (task::exception) std::rethrow_exception(task::exception);
+			THEN("All results are obtained") {
+				CHECK(done);
+				CHECK(results == 1);
+			}
+		}
+		WHEN("An awaited operation fails") {
+			boost::system::error_code ec;
+			time_out(conn, ec, done);
+			ios.run();
+			if (task::exception) std::rethrow_exception(task::exception);
+			THEN("boost::system::system_error is thrown") {
+				CHECK(done);
+				CHECK(ec == make_error_code(error::timed_out));
+			}
+		}
+	}
+}
+
+}
+}
+}
+
+#endif
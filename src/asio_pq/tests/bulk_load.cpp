@@ -0,0 +1,148 @@
+#include <asio_pq/bulk_load.hpp>
+
+#include <asio_pq/exec.hpp>
+#include <asio_pq/pool.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+const char * conninfo =
+	"host='" ASIO_PQ_TEST_HOST "'"
+	" port='" ASIO_PQ_TEST_PORT "'"
+	" user='" ASIO_PQ_TEST_USER "'"
+	" password='" ASIO_PQ_TEST_PASSWORD "'"
+	" dbname='" ASIO_PQ_TEST_DBNAME "'";
+
+SCENARIO("Rows may be loaded over several connections via async_bulk_load", "[asio_pq][async_bulk_load]") {
+	GIVEN("A boost::asio::io_service, a pool, and a staging table") {
+		boost::asio::io_service ios;
+		pool p(ios, conninfo);
+		lease l;
+		p.async_acquire([&] (auto ec, auto inner) {
+			REQUIRE_FALSE(ec);
+			l = std::move(inner);
+		});
+		ios.run();
+		ios.reset();
+		REQUIRE(l);
+		auto future = async_exec(
+			*l,
+			"DROP TABLE IF EXISTS \"async_bulk_load_test\";"
+			"DROP TABLE IF EXISTS \"async_bulk_load_test_staging\";"
+			"CREATE TABLE \"async_bulk_load_test\" (\"id\" BIGINT PRIMARY KEY, \"name\" TEXT);"
+			"CREATE UNLOGGED TABLE \"async_bulk_load_test_staging\" (\"id\" BIGINT, \"name\" TEXT);",
+			boost::asio::use_future
+		);
+		ios.run();
+		ios.reset();
+		future.get();
+		l.reset();
+		std::vector<std::tuple<std::int64_t, std::string>> rows;
+		for (std::int64_t i = 0; i < 10000; ++i) rows.emplace_back(i, "row " + std::to_string(i));
+		bulk_load_settings settings;
+		settings.command = "COPY \"async_bulk_load_test_staging\" FROM STDIN (FORMAT binary)";
+		settings.streams = 3;
+		settings.merge =
+			"INSERT INTO \"async_bulk_load_test\" SELECT * FROM \"async_bulk_load_test_staging\" "
+			"ON CONFLICT (\"id\") DO UPDATE SET \"name\" = EXCLUDED.\"name\";"
+			"SELECT COUNT(*) FROM \"async_bulk_load_test\"";
+		std::size_t reports = 0;
+		settings.progress = [&] (const bulk_load_progress &) {	++reports;	};
+		WHEN("async_bulk_load is invoked") {
+			boost::system::error_code ec;
+			bulk_load_progress progress;
+			result r;
+			bool invoked = false;
+			async_bulk_load(
+				p,
+				std::move(settings),
+				make_range_source(rows.begin(), rows.end(), 500),
+				[&] (auto e, auto pr, auto inner) {
+					invoked = true;
+					ec = e;
+					progress = pr;
+					r = std::move(inner);
+				}
+			);
+			ios.run();
+			THEN("The operation succeeds") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQresultErrorMessage: " << (r ? PQresultErrorMessage(r) : ""));
+				REQUIRE_FALSE(ec);
+				AND_THEN("All rows are sent in chunks") {
+					CHECK(progress.rows == 10000);
+					CHECK(progress.chunks >= 20);
+					CHECK(reports == progress.chunks);
+				}
+				AND_THEN("The merge is performed") {
+					REQUIRE(PQntuples(r) == 1);
+					CHECK(std::strcmp(PQgetvalue(r, 0, 0), "10000") == 0);
+				}
+			}
+		}
+		WHEN("async_bulk_load is invoked with rows the table does not accept") {
+			std::vector<std::tuple<std::int64_t, std::int64_t, std::int64_t>> bad{std::make_tuple(1, 2, 3)};
+			boost::system::error_code ec;
+			result r;
+			async_bulk_load(
+				p,
+				std::move(settings),
+				make_range_source(bad.begin(), bad.end(), 1),
+				[&] (auto e, auto, auto inner) {
+					ec = e;
+					r = std::move(inner);
+				}
+			);
+			ios.run();
+			THEN("The operation fails") {
+				CHECK(ec == make_error_code(error::copy_failed));
+				CHECK(PQresultStatus(r) == PGRES_FATAL_ERROR);
+			}
+		}
+		WHEN("async_bulk_load is invoked with zero streams") {
+			settings.streams = 0;
+			boost::system::error_code ec;
+			bool invoked = false;
+			async_bulk_load(
+				p,
+				std::move(settings),
+				make_range_source(rows.begin(), rows.end(), 500),
+				[&] (auto e, auto, auto) {
+					invoked = true;
+					ec = e;
+				}
+			);
+			THEN("The completion handler is not invoked from within the initiating function") {
+				CHECK_FALSE(invoked);
+			}
+			AND_WHEN("boost::asio::io_service::run is invoked") {
+				ios.run();
+				THEN("The operation fails with boost::asio::error::invalid_argument") {
+					CHECK(invoked);
+					CHECK(ec == make_error_code(boost::asio::error::invalid_argument));
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,82 @@
+#include <asio_pq/cancel_query.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/get_result.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cassert>
+#include <cstring>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+const char * keywords [] = {
+	"host",
+	"port",
+	"user",
+	"password",
+	"dbname",
+	nullptr
+};
+const char * values [] = {
+	ASIO_PQ_TEST_HOST,
+	ASIO_PQ_TEST_PORT,
+	ASIO_PQ_TEST_USER,
+	ASIO_PQ_TEST_PASSWORD,
+	ASIO_PQ_TEST_DBNAME,
+	nullptr
+};
+
+SCENARIO("Commands may be cancelled without abandoning the connection", "[asio_pq][async_cancel_query]") {
+	GIVEN("A boost::asio::io_service and connected connection handle") {
+		boost::asio::io_service ios;
+		connection conn(ios, keywords, values, false);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		future.get();
+		ios.reset();
+		WHEN("A long running command is sent and async_cancel_query is invoked") {
+			REQUIRE(PQsendQuery(conn, "SELECT pg_sleep(10);") == 1);
+			boost::system::error_code ec;
+			bool invoked = false;
+			async_cancel_query(conn, [&] (auto e) noexcept {
+				assert(!invoked);
+				invoked = true;
+				ec = e;
+			});
+			CHECK_FALSE(invoked);
+			ios.run();
+			ios.reset();
+			THEN("The operation succeeds") {
+				CHECK(invoked);
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+			}
+			AND_WHEN("Another command is sent on the same connection") {
+				REQUIRE(PQsendQuery(conn, "SELECT 1;") == 1);
+				auto future = async_get_result(conn, boost::asio::use_future);
+				ios.run();
+				auto r = future.get();
+				THEN("It succeeds") {
+					REQUIRE(r);
+					CHECK(PQresultStatus(r) == PGRES_TUPLES_OK);
+					REQUIRE(PQntuples(r) == 1);
+					REQUIRE(PQnfields(r) == 1);
+					CHECK(std::strcmp(PQgetvalue(r, 0, 0), "1") == 0);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,190 @@
+#include <asio_pq/columnar.hpp>
+
+#include <asio_pq/error.hpp>
+#include <asio_pq/oid.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+class field {
+public:
+	const char * name;
+	Oid type;
+	int format;
+};
+
+class value {
+public:
+	bool null;
+	std::string bytes;
+};
+
+//	Creates a result without a server
+result make_result (const std::vector<field> & fields, const std::vector<std::vector<value>> & rows) {
+	result r(PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK));
+	REQUIRE(r);
+	std::vector<PGresAttDesc> descs;
+	for (auto && f : fields) {
+		PGresAttDesc desc{};
+		desc.name = const_cast<char *>(f.name);
+		desc.typid = f.type;
+		desc.format = f.format;
+		desc.typlen = -1;
+		desc.atttypmod = -1;
+		descs.push_back(desc);
+	}
+	REQUIRE(PQsetResultAttrs(r, int(descs.size()), descs.data()) != 0);
+	for (std::size_t i = 0; i < rows.size(); ++i) {
+		for (std::size_t j = 0; j < rows[i].size(); ++j) {
+			auto && v = rows[i][j];
+			REQUIRE(PQsetvalue(
+				r,
+				int(i),
+				int(j),
+				v.null ? nullptr : const_cast<char *>(v.bytes.data()),
+				v.null ? -1 : int(v.bytes.size())
+			) != 0);
+		}
+	}
+	return r;
+}
+
+template <typename T>
+T value_at (const column & c, std::size_t i) {
+	T retr;
+	std::memcpy(&retr, c.values.data() + (i * sizeof(T)), sizeof(T));
+	return retr;
+}
+
+bool bit_at (const aligned_vector<std::uint8_t> & bitmap, std::size_t i) {
+	return (bitmap[i / 8] & (1U << (i % 8))) != 0;
+}
+
+const std::vector<field> fields{
+	{"id", oid::int4, 1},
+	{"name", oid::text, 1},
+	{"flag", oid::boolean, 1},
+	{"note", oid::int8, 0}
+};
+
+SCENARIO("Results may be converted to the Arrow columnar layout", "[asio_pq][columnar_builder]") {
+	GIVEN("A columnar_builder and two results with the same columns") {
+		columnar_builder builder;
+		auto first = make_result(fields, {
+			{{false, std::string("\0\0\0\x01", 4)}, {false, "foo"}, {false, std::string("\x01", 1)}, {false, "10"}},
+			{{true, ""}, {true, ""}, {false, std::string("\0", 1)}, {true, ""}}
+		});
+		auto second = make_result(fields, {
+			{{false, std::string("\0\0\0\x03", 4)}, {false, "quux"}, {true, ""}, {false, "30"}}
+		});
+		WHEN("The results are appended") {
+			builder.append(first);
+			builder.append(second);
+			THEN("All rows are present") {
+				CHECK(builder.size() == 3);
+				auto && cs = builder.columns();
+				REQUIRE(cs.size() == 4);
+				for (auto && c : cs) CHECK(c.length == 3);
+				AND_THEN("Fixed size columns are correct") {
+					auto && c = cs[0];
+					CHECK(c.name == "id");
+					CHECK(c.type == column_type::int32);
+					CHECK(c.null_count == 1);
+					CHECK(bit_at(c.validity, 0));
+					CHECK_FALSE(bit_at(c.validity, 1));
+					CHECK(bit_at(c.validity, 2));
+					REQUIRE(c.values.size() == 12);
+					CHECK(value_at<std::int32_t>(c, 0) == 1);
+					CHECK(value_at<std::int32_t>(c, 1) == 0);
+					CHECK(value_at<std::int32_t>(c, 2) == 3);
+					CHECK(c.offsets.empty());
+				}
+				AND_THEN("Variable length columns are correct") {
+					auto && c = cs[1];
+					CHECK(c.type == column_type::utf8);
+					CHECK(c.null_count == 1);
+					REQUIRE(c.offsets.size() == 4);
+					CHECK(c.offsets[0] == 0);
+					CHECK(c.offsets[1] == 3);
+					CHECK(c.offsets[2] == 3);
+					CHECK(c.offsets[3] == 7);
+					CHECK(std::string(c.values.begin(), c.values.end()) == "fooquux");
+				}
+				AND_THEN("Boolean columns are bit packed") {
+					auto && c = cs[2];
+					CHECK(c.type == column_type::boolean);
+					CHECK(c.null_count == 1);
+					REQUIRE(c.values.size() == 1);
+					CHECK(bit_at(c.values, 0));
+					CHECK_FALSE(bit_at(c.values, 1));
+					CHECK_FALSE(bit_at(c.validity, 2));
+				}
+				AND_THEN("Text format columns are UTF-8") {
+					auto && c = cs[3];
+					CHECK(c.type == column_type::utf8);
+					CHECK(std::string(c.values.begin(), c.values.end()) == "1030");
+				}
+				AND_THEN("Buffers are aligned") {
+					for (auto && c : cs) {
+						CHECK((reinterpret_cast<std::uintptr_t>(c.values.data()) % 64) == 0);
+						CHECK((reinterpret_cast<std::uintptr_t>(c.validity.data()) % 64) == 0);
+					}
+				}
+			}
+			AND_WHEN("The columns are retrieved via finish") {
+				auto cs = builder.finish();
+				THEN("The builder is reset") {
+					CHECK(cs.size() == 4);
+					CHECK(builder.size() == 0);
+					CHECK(builder.columns().empty());
+				}
+			}
+		}
+	}
+	GIVEN("A columnar_builder to which a result has been appended") {
+		columnar_builder builder;
+		builder.append(make_result(fields, {
+			{{false, std::string("\0\0\0\x01", 4)}, {false, "foo"}, {false, std::string("\x01", 1)}, {false, "10"}}
+		}));
+		WHEN("A result with different columns is appended") {
+			boost::system::error_code ec;
+			builder.append(make_result({{"id", oid::int8, 1}}, {}), ec);
+			THEN("The operation fails") {
+				CHECK(ec == make_error_code(error::type_mismatch));
+			}
+		}
+		WHEN("A result with a malformed value is appended") {
+			boost::system::error_code ec;
+			builder.append(make_result(fields, {
+				{{false, std::string("\0\0\0\x02", 4)}, {false, "bar"}, {false, std::string("\x01", 1)}, {false, "20"}},
+				{{false, std::string("\0\0\x03", 3)}, {false, "baz"}, {false, std::string("\x01", 1)}, {false, "30"}}
+			}), ec);
+			THEN("The operation fails") {
+				CHECK(ec == make_error_code(error::decode_failed));
+				AND_THEN("The builder is unchanged") {
+					CHECK(builder.size() == 1);
+					for (auto && c : builder.columns()) {
+						CHECK(c.length == 1);
+						CHECK(c.validity.size() == 1);
+					}
+					CHECK(builder.columns()[0].values.size() == 4);
+					CHECK(builder.columns()[1].offsets.size() == 2);
+					CHECK(builder.columns()[1].values.size() == 3);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
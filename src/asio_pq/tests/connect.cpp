@@ -1,9 +1,14 @@
 #include <asio_pq/connect.hpp>
 
 #include <asio_pq/connection.hpp>
+#include <asio_pq/error.hpp>
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/ip/tcp.hpp>
 #include <boost/system/error_code.hpp>
 #include <libpq-fe.h>
+#include <chrono>
+#include <string>
 #include <utility>
 #include <catch.hpp>
 
@@ -94,6 +99,37 @@ SCENARIO("async_connect may be used to asynchronously connect to a PostgreSQL se
 				}
 			}
 		}
+		WHEN("A call to async_connect is made with a connection info string which lists an invalid host before a valid one") {
+			boost::system::error_code ec;
+			bool invoked = false;
+			connection handle(
+				ios,
+				"host='" ASIO_PQ_TEST_BAD_HOST "," ASIO_PQ_TEST_HOST "'"
+				" port='" ASIO_PQ_TEST_BAD_PORT "," ASIO_PQ_TEST_PORT "'"
+				" user='" ASIO_PQ_TEST_USER "'"
+				" password='" ASIO_PQ_TEST_PASSWORD "'"
+				" dbname='" ASIO_PQ_TEST_DBNAME "'"
+			);
+			async_connect(
+				handle,
+				[&] (boost::system::error_code inner) noexcept {
+					invoked = true;
+					ec = inner;
+				}
+			);
+			ios.run();
+			THEN("The operation follows libpq to the socket for the valid host and does not fail") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQerrorMessage: " << PQerrorMessage(handle));
+				CHECK_FALSE(ec);
+				REQUIRE(handle.has_socket());
+				#ifdef ASIO_PQ_HAS_BORROWED_DESCRIPTOR
+				int registered = handle.socket([] (auto & socket) {	return int(socket.native_handle());	});
+				CHECK(registered == PQsocket(handle));
+				#endif
+			}
+		}
 		WHEN("A call to async_connect is made with an invalid connection info string") {
 			boost::system::error_code ec;
 			bool invoked = false;
@@ -220,6 +256,70 @@ SCENARIO("async_connect may be used to asynchronously connect to a PostgreSQL se
 	}
 }
 
+SCENARIO("async_connect may be given a deadline or timeout", "[asio_pq][async_connect][timeout]") {
+	GIVEN("A boost::asio::io_service") {
+		boost::asio::io_service ios;
+		WHEN("A call to async_connect is made with a timeout against a server which never responds") {
+			//	Accepts the connection but never
+			//	completes the handshake
+			boost::asio::ip::tcp::acceptor acceptor(
+				ios,
+				boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)
+			);
+			auto port = std::to_string(acceptor.local_endpoint().port());
+			const char * keywords [] = {"host", "port", "sslmode", "gssencmode", nullptr};
+			const char * values [] = {"127.0.0.1", port.c_str(), "disable", "disable", nullptr};
+			connection handle(ios, keywords, values, false);
+			boost::system::error_code ec;
+			bool invoked = false;
+			async_connect(
+				handle,
+				std::chrono::milliseconds(100),
+				[&] (boost::system::error_code inner) noexcept {
+					invoked = true;
+					ec = inner;
+				}
+			);
+			ios.run();
+			THEN("The operation times out") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				CHECK(ec == make_error_code(error::timed_out));
+			}
+		}
+		WHEN("A call to async_connect is made with a generous timeout and valid parameters") {
+			const char * values [] = {
+				ASIO_PQ_TEST_HOST,
+				ASIO_PQ_TEST_PORT,
+				ASIO_PQ_TEST_USER,
+				ASIO_PQ_TEST_PASSWORD,
+				ASIO_PQ_TEST_DBNAME,
+				nullptr
+			};
+			connection handle(ios, keywords, values, false);
+			boost::system::error_code ec;
+			bool invoked = false;
+			auto begin = std::chrono::steady_clock::now();
+			async_connect(
+				handle,
+				std::chrono::minutes(1),
+				[&] (boost::system::error_code inner) noexcept {
+					invoked = true;
+					ec = inner;
+				}
+			);
+			ios.run();
+			THEN("The operation does not fail and does not wait for the timeout") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQerrorMessage: " << PQerrorMessage(handle));
+				CHECK_FALSE(ec);
+				CHECK((std::chrono::steady_clock::now() - begin) < std::chrono::minutes(1));
+			}
+		}
+	}
+}
+
 #ifndef _WIN32
 SCENARIO("async_connect may be used to asynchronously connect to a PostgreSQL server via Unix domain socket", "[asio_pq][async_connect][unix_domain_socket]") {
 	GIVEN("A boost::asio::io_service") {
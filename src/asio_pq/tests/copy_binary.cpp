@@ -0,0 +1,62 @@
+#include <asio_pq/copy_binary.hpp>
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <catch.hpp>
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+SCENARIO("Rows may be encoded in the binary COPY format via copy_binary_writer", "[asio_pq][copy_binary_writer]") {
+	GIVEN("A copy_binary_writer") {
+		std::string str;
+		copy_binary_writer writer(str);
+		WHEN("The header is appended") {
+			writer.header();
+			THEN("The signature, flags, and header extension length are appended") {
+				std::string expected("PGCOPY\n\377\r\n\0", 11);
+				expected.append(8, '\0');
+				CHECK(str == expected);
+				CHECK(writer.size() == 19);
+			}
+		}
+		WHEN("The trailer is appended") {
+			writer.trailer();
+			THEN("A field count of -1 is appended") {
+				CHECK(str == std::string("\377\377", 2));
+			}
+		}
+		WHEN("A row is appended") {
+			writer.row(std::int32_t(1), "ab", boost::optional<std::int16_t>{});
+			THEN("The field count is followed by the length and bytes of each field") {
+				std::string expected(
+					"\0\3"
+					"\0\0\0\4" "\0\0\0\1"
+					"\0\0\0\2" "ab"
+					"\377\377\377\377",
+					2 + 8 + 6 + 4
+				);
+				CHECK(str == expected);
+			}
+		}
+		WHEN("A row is appended from a std::tuple") {
+			writer.row(std::make_tuple(std::int64_t(2), true));
+			THEN("Each element is a field") {
+				std::string expected(
+					"\0\2"
+					"\0\0\0\10" "\0\0\0\0\0\0\0\2"
+					"\0\0\0\1" "\1",
+					2 + 12 + 5
+				);
+				CHECK(str == expected);
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,161 @@
+#include <asio_pq/copy_in.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/exec.hpp>
+#include <asio_pq/get_result.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+SCENARIO("Data may be sent to the server via async_copy_in and copy_in_stream", "[asio_pq][async_copy_in]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		auto exec_future = async_exec(
+			conn,
+			"DROP TABLE IF EXISTS \"async_copy_in_test\";"
+			"CREATE TABLE \"async_copy_in_test\" (\"num\" INT, \"str\" TEXT);",
+			boost::asio::use_future
+		);
+		ios.run();
+		ios.reset();
+		exec_future.get();
+		WHEN("async_copy_in is invoked with a COPY FROM STDIN command") {
+			boost::system::error_code ec;
+			result r;
+			async_copy_in(conn, "COPY \"async_copy_in_test\" FROM STDIN", [&] (auto e, auto inner) {
+				ec = e;
+				r = std::move(inner);
+			});
+			ios.run();
+			ios.reset();
+			THEN("The operation succeeds") {
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQerrorMessage: " << PQerrorMessage(conn));
+				REQUIRE_FALSE(ec);
+				CHECK(PQresultStatus(r) == PGRES_COPY_IN);
+			}
+			AND_WHEN("A buffer sequence is written and the COPY is ended") {
+				REQUIRE_FALSE(ec);
+				copy_in_stream stream(conn);
+				const char first [] = "1\tfoo\n";
+				const char second [] = "2\tbar\n3\t";
+				const char third [] = "baz\n";
+				std::vector<boost::asio::const_buffer> buffers{
+					boost::asio::buffer(first, std::strlen(first)),
+					boost::asio::buffer(second, std::strlen(second)),
+					boost::asio::buffer(third, std::strlen(third))
+				};
+				boost::system::error_code write_ec;
+				std::size_t bytes = 0;
+				stream.async_write_some(buffers, [&] (auto e, auto n) {
+					write_ec = e;
+					bytes = n;
+				});
+				ios.run();
+				ios.reset();
+				boost::system::error_code end_ec;
+				result end;
+				stream.async_end([&] (auto e, auto inner) {
+					end_ec = e;
+					end = std::move(inner);
+				});
+				ios.run();
+				ios.reset();
+				THEN("All bytes are written") {
+					INFO("boost::system::error_code::message: " << write_ec.message());
+					REQUIRE_FALSE(write_ec);
+					CHECK(bytes == (std::strlen(first) + std::strlen(second) + std::strlen(third)));
+				}
+				THEN("The COPY succeeds") {
+					INFO("boost::system::error_code::message: " << end_ec.message());
+					INFO("PQerrorMessage: " << PQerrorMessage(conn));
+					REQUIRE_FALSE(end_ec);
+					CHECK(PQresultStatus(end) == PGRES_COMMAND_OK);
+					CHECK(std::strcmp(PQcmdTuples(end), "3") == 0);
+				}
+				THEN("The rows are in the table") {
+					auto rs = async_exec(conn, "SELECT \"str\" FROM \"async_copy_in_test\" ORDER BY \"num\"", boost::asio::use_future);
+					ios.run();
+					auto results = rs.get();
+					REQUIRE(results.size() == 1);
+					REQUIRE(PQntuples(results[0]) == 3);
+					CHECK(std::strcmp(PQgetvalue(results[0], 0, 0), "foo") == 0);
+					CHECK(std::strcmp(PQgetvalue(results[0], 1, 0), "bar") == 0);
+					CHECK(std::strcmp(PQgetvalue(results[0], 2, 0), "baz") == 0);
+				}
+			}
+			AND_WHEN("The COPY is aborted") {
+				REQUIRE_FALSE(ec);
+				copy_in_stream stream(conn);
+				boost::system::error_code abort_ec;
+				result end;
+				stream.async_abort("aborted", [&] (auto e, auto inner) {
+					abort_ec = e;
+					end = std::move(inner);
+				});
+				ios.run();
+				THEN("The command fails") {
+					INFO("boost::system::error_code::message: " << abort_ec.message());
+					REQUIRE_FALSE(abort_ec);
+					CHECK(PQresultStatus(end) == PGRES_FATAL_ERROR);
+				}
+			}
+		}
+		WHEN("async_copy_in is invoked with a command which fails") {
+			boost::system::error_code ec;
+			result r;
+			async_copy_in(conn, "COPY \"async_copy_in_test_does_not_exist\" FROM STDIN", [&] (auto e, auto inner) {
+				ec = e;
+				r = std::move(inner);
+			});
+			ios.run();
+			THEN("The operation fails") {
+				CHECK(ec == make_error_code(error::copy_failed));
+				CHECK(PQresultStatus(r) == PGRES_FATAL_ERROR);
+			}
+		}
+	}
+}
+
+}
+}
+}
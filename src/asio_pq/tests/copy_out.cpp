@@ -0,0 +1,184 @@
+#include <asio_pq/copy_out.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/copy_data.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+SCENARIO("asio_pq::copy_data objects manage buffers allocated by libpq", "[asio_pq][copy_data]") {
+	GIVEN("A copy_data which manages a buffer") {
+		//	PQfreemem is free on all platforms other
+		//	than Windows
+		auto ptr = static_cast<char *>(std::malloc(4));
+		REQUIRE(ptr);
+		std::memcpy(ptr, "abcd", 4);
+		copy_data data(ptr, 4);
+		THEN("It views the entire buffer") {
+			REQUIRE(data);
+			CHECK(data.data() == ptr);
+			CHECK(data.size() == 4);
+			CHECK(boost::asio::buffer_size(data.buffer()) == 4);
+		}
+		WHEN("Bytes are consumed") {
+			data.consume(3);
+			THEN("The view is narrowed") {
+				CHECK(data);
+				REQUIRE(data.size() == 1);
+				CHECK(*data.data() == 'd');
+			}
+		}
+		WHEN("It is moved from") {
+			copy_data other(std::move(data));
+			THEN("Ownership is transferred") {
+				CHECK_FALSE(data);
+				CHECK(data.size() == 0);
+				CHECK(other);
+				CHECK(other.data() == ptr);
+				CHECK(other.size() == 4);
+			}
+		}
+		WHEN("The buffer is released") {
+			char * released = data.release();
+			THEN("Ownership is surrendered") {
+				CHECK(released == ptr);
+				CHECK_FALSE(data);
+				CHECK(data.size() == 0);
+			}
+			PQfreemem(released);
+		}
+	}
+}
+
+SCENARIO("Data may be received from the server via async_copy_out and copy_out_stream", "[asio_pq][async_copy_out]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		const char * command = "COPY (SELECT * FROM generate_series(1, 1000)) TO STDOUT";
+		std::string expected;
+		for (int i = 1; i <= 1000; ++i) {
+			expected += std::to_string(i);
+			expected += '\n';
+		}
+		boost::system::error_code ec;
+		result r;
+		async_copy_out(conn, command, [&] (auto e, auto inner) {
+			ec = e;
+			r = std::move(inner);
+		});
+		ios.run();
+		ios.reset();
+		INFO("boost::system::error_code::message: " << ec.message());
+		INFO("PQerrorMessage: " << PQerrorMessage(conn));
+		REQUIRE_FALSE(ec);
+		REQUIRE(PQresultStatus(r) == PGRES_COPY_OUT);
+		copy_out_stream stream(conn);
+		WHEN("All data is read via async_read_chunk") {
+			std::string str;
+			std::size_t chunks = 0;
+			for (;;) {
+				boost::system::error_code read_ec;
+				copy_data chunk;
+				stream.async_read_chunk([&] (auto e, auto inner) {
+					read_ec = e;
+					chunk = std::move(inner);
+				});
+				ios.run();
+				ios.reset();
+				if (read_ec == boost::asio::error::eof) break;
+				INFO("boost::system::error_code::message: " << read_ec.message());
+				REQUIRE_FALSE(read_ec);
+				REQUIRE(chunk);
+				str.append(chunk.data(), chunk.size());
+				++chunks;
+			}
+			THEN("Each row is a chunk") {
+				CHECK(chunks == 1000);
+				CHECK(str == expected);
+			}
+			AND_WHEN("async_end is invoked") {
+				boost::system::error_code end_ec;
+				result end;
+				stream.async_end([&] (auto e, auto inner) {
+					end_ec = e;
+					end = std::move(inner);
+				});
+				ios.run();
+				THEN("The command succeeded") {
+					INFO("boost::system::error_code::message: " << end_ec.message());
+					REQUIRE_FALSE(end_ec);
+					CHECK(PQresultStatus(end) == PGRES_COMMAND_OK);
+				}
+			}
+		}
+		WHEN("All data is read via async_read_some") {
+			std::string str;
+			std::size_t reads = 0;
+			char buffer [4096];
+			for (;;) {
+				boost::system::error_code read_ec;
+				std::size_t bytes = 0;
+				stream.async_read_some(boost::asio::buffer(buffer), [&] (auto e, auto n) {
+					read_ec = e;
+					bytes = n;
+				});
+				ios.run();
+				ios.reset();
+				if (read_ec == boost::asio::error::eof) break;
+				INFO("boost::system::error_code::message: " << read_ec.message());
+				REQUIRE_FALSE(read_ec);
+				REQUIRE(bytes != 0);
+				str.append(buffer, bytes);
+				++reads;
+			}
+			THEN("All data is read and chunks are coalesced") {
+				CHECK(str == expected);
+				CHECK(reads < 1000);
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,277 @@
+#include <asio_pq/decode.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/exec.hpp>
+#include <asio_pq/oid.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <libpq-fe.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ratio>
+#include <string>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+//	Creates a result with a single row and a single
+//	column in binary format without a server
+result make_result (Oid type, const std::string & value, bool null = false) {
+	result r(PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK));
+	REQUIRE(r);
+	char name [] = "value";
+	PGresAttDesc desc{};
+	desc.name = name;
+	desc.format = 1;
+	desc.typid = type;
+	desc.typlen = -1;
+	desc.atttypmod = -1;
+	REQUIRE(PQsetResultAttrs(r, 1, &desc) != 0);
+	if (null) {
+		REQUIRE(PQsetvalue(r, 0, 0, nullptr, -1) != 0);
+	} else {
+		REQUIRE(PQsetvalue(r, 0, 0, const_cast<char *>(value.data()), int(value.size())) != 0);
+	}
+	return r;
+}
+
+SCENARIO("Fields in binary format may be decoded", "[asio_pq][decode]") {
+	GIVEN("An int4 field") {
+		auto r = make_result(oid::int4, std::string("\xFF\xFF\xFF\xFE", 4));
+		THEN("It may be decoded as a 32 or 64 bit integer") {
+			CHECK(get_field<std::int32_t>(r, 0, 0) == -2);
+			CHECK(get_field<std::int64_t>(r, 0, 0) == -2);
+		}
+		THEN("It may not be decoded as a 16 bit integer") {
+			boost::system::error_code ec;
+			get_field<std::int16_t>(r, 0, 0, ec);
+			CHECK(ec == make_error_code(error::type_mismatch));
+		}
+		THEN("It may not be decoded as a string") {
+			CHECK_THROWS_AS(get_field<std::string>(r, 0, 0), boost::system::system_error);
+		}
+	}
+	GIVEN("A float8 field") {
+		auto r = make_result(oid::float8, std::string("\x3F\xF8\0\0\0\0\0\0", 8));
+		THEN("It may be decoded") {
+			CHECK(get_field<double>(r, 0, 0) == 1.5);
+		}
+	}
+	GIVEN("A bool field") {
+		auto r = make_result(oid::boolean, std::string("\x01", 1));
+		THEN("It may be decoded") {
+			CHECK(get_field<bool>(r, 0, 0));
+		}
+	}
+	GIVEN("A bytea field") {
+		auto r = make_result(oid::bytea, std::string("\0\x01\x02", 3));
+		THEN("It may be decoded as a view of the result") {
+			auto buffer = get_field<boost::asio::const_buffer>(r, 0, 0);
+			CHECK(boost::asio::buffer_cast<const char *>(buffer) == PQgetvalue(r, 0, 0));
+			CHECK(boost::asio::buffer_size(buffer) == 3);
+		}
+	}
+	GIVEN("A jsonb field") {
+		auto r = make_result(oid::jsonb, std::string("\x01{}", 3));
+		THEN("It may be decoded as text") {
+			CHECK(get_field<boost::string_ref>(r, 0, 0) == "{}");
+			CHECK(get_field<std::string>(r, 0, 0) == "{}");
+		}
+	}
+	GIVEN("A numeric field") {
+		//	-1234.5600: Two digits (1234 and 5600), weight
+		//	zero, negative, four digits after the point
+		auto r = make_result(
+			oid::numeric,
+			std::string("\0\x02" "\0\0" "\x40\0" "\0\x04" "\x04\xD2" "\x15\xE0", 12)
+		);
+		THEN("It may be decoded exactly as a string") {
+			CHECK(get_field<std::string>(r, 0, 0) == "-1234.5600");
+		}
+		THEN("It may be decoded approximately as a double") {
+			CHECK(std::abs(get_field<double>(r, 0, 0) + 1234.56) < 0.0001);
+		}
+	}
+	GIVEN("A small numeric field") {
+		//	0.05: One digit (500), weight -1, scale two
+		auto r = make_result(oid::numeric, std::string("\0\x01" "\xFF\xFF" "\0\0" "\0\x02" "\x01\xF4", 10));
+		THEN("It may be decoded exactly as a string") {
+			CHECK(get_field<std::string>(r, 0, 0) == "0.05");
+		}
+	}
+	GIVEN("A timestamptz field") {
+		//	One second after the PostgreSQL epoch
+		auto r = make_result(oid::timestamptz, std::string("\0\0\0\0\0\x0F\x42\x40", 8));
+		THEN("It may be decoded") {
+			auto tp = get_field<std::chrono::system_clock::time_point>(r, 0, 0);
+			CHECK(std::chrono::duration_cast<std::chrono::seconds>(tp.time_since_epoch()).count() == 946684801);
+		}
+	}
+	GIVEN("A timestamptz field containing infinity") {
+		auto r = make_result(oid::timestamptz, std::string("\x7F\xFF\xFF\xFF\xFF\xFF\xFF\xFF", 8));
+		THEN("It is decoded as the maximum value") {
+			CHECK(get_field<std::chrono::system_clock::time_point>(r, 0, 0) == std::chrono::system_clock::time_point::max());
+		}
+	}
+	GIVEN("A timestamptz field containing -infinity") {
+		auto r = make_result(oid::timestamptz, std::string("\x80\0\0\0\0\0\0\0", 8));
+		THEN("It is decoded as the minimum value") {
+			CHECK(get_field<std::chrono::system_clock::time_point>(r, 0, 0) == std::chrono::system_clock::time_point::min());
+		}
+	}
+	GIVEN("A timestamptz field containing 2200-01-01 00:00:00 UTC") {
+		auto r = make_result(oid::timestamptz, std::string("\0\x16\x6C\x37\x25\xC0\x60\0", 8));
+		THEN("It may be decoded") {
+			auto tp = get_field<std::chrono::system_clock::time_point>(r, 0, 0);
+			CHECK(std::chrono::duration_cast<std::chrono::seconds>(tp.time_since_epoch()).count() == 7258118400LL);
+		}
+	}
+	GIVEN("A timestamptz field containing 9999-12-31 00:00:00 UTC") {
+		auto r = make_result(oid::timestamptz, std::string("\x03\x80\xE6\xF7\x73\x64\x20\0", 8));
+		boost::system::error_code ec;
+		auto tp = get_field<std::chrono::system_clock::time_point>(r, 0, 0, ec);
+		if (std::ratio_less<std::chrono::system_clock::period, std::micro>::value) {
+			THEN("Decoding fails as std::chrono::system_clock::time_point cannot represent it") {
+				CHECK(ec == make_error_code(error::decode_failed));
+			}
+		} else {
+			THEN("It may be decoded") {
+				REQUIRE_FALSE(ec);
+				CHECK(std::chrono::duration_cast<std::chrono::seconds>(tp.time_since_epoch()).count() == 253402214400LL);
+			}
+		}
+	}
+	GIVEN("A uuid field") {
+		std::string bytes("\x01\x23\x45\x67\x89\xAB\xCD\xEF\x01\x23\x45\x67\x89\xAB\xCD\xEF", 16);
+		auto r = make_result(oid::uuid, bytes);
+		THEN("It may be decoded") {
+			auto u = get_field<boost::uuids::uuid>(r, 0, 0);
+			CHECK(std::string(reinterpret_cast<const char *>(u.data), 16) == bytes);
+		}
+	}
+	GIVEN("A null field") {
+		auto r = make_result(oid::int8, std::string(), true);
+		THEN("It may be decoded as a boost::optional") {
+			CHECK_FALSE(static_cast<bool>(get_field<boost::optional<std::int64_t>>(r, 0, 0)));
+		}
+		THEN("It may not be decoded as a non-optional type") {
+			boost::system::error_code ec;
+			get_field<std::int64_t>(r, 0, 0, ec);
+			CHECK(ec == make_error_code(error::unexpected_null));
+		}
+	}
+	GIVEN("An int4[] field containing a null") {
+		auto r = make_result(
+			oid::int4_array,
+			std::string(
+				"\0\0\0\x01" "\0\0\0\x01" "\0\0\0\x17"
+				"\0\0\0\x02" "\0\0\0\x01"
+				"\0\0\0\x04" "\0\0\0\x05"
+				"\xFF\xFF\xFF\xFF",
+				32
+			)
+		);
+		THEN("It may be decoded as a std::vector of boost::optional") {
+			auto vec = get_field<std::vector<boost::optional<std::int32_t>>>(r, 0, 0);
+			REQUIRE(vec.size() == 2);
+			REQUIRE(static_cast<bool>(vec[0]));
+			CHECK(*vec[0] == 5);
+			CHECK_FALSE(static_cast<bool>(vec[1]));
+		}
+		THEN("It may not be decoded as a std::vector of a non-optional type") {
+			boost::system::error_code ec;
+			get_field<std::vector<std::int32_t>>(r, 0, 0, ec);
+			CHECK(ec == make_error_code(error::unexpected_null));
+		}
+	}
+	GIVEN("A truncated int8 field") {
+		auto r = make_result(oid::int8, std::string("\0\0\0", 3));
+		THEN("Decoding it fails") {
+			boost::system::error_code ec;
+			get_field<std::int64_t>(r, 0, 0, ec);
+			CHECK(ec == make_error_code(error::decode_failed));
+		}
+	}
+}
+
+SCENARIO("Results retrieved in binary format may be decoded", "[asio_pq][decode][async_exec_params]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		WHEN("A command is executed with a result format of one") {
+			boost::system::error_code ec;
+			std::vector<result> rs;
+			async_exec_params(
+				conn,
+				"SELECT 1::INT8, 'abc'::TEXT, '\\x0001'::BYTEA, 12.34::NUMERIC, ARRAY[1, NULL]::INT4[]",
+				0,
+				nullptr,
+				nullptr,
+				nullptr,
+				nullptr,
+				1,
+				[&] (auto e, auto inner) {
+					ec = e;
+					rs = std::move(inner);
+				}
+			);
+			ios.run();
+			REQUIRE_FALSE(ec);
+			REQUIRE(rs.size() == 1);
+			REQUIRE(PQresultStatus(rs[0]) == PGRES_TUPLES_OK);
+			THEN("Each field may be decoded") {
+				CHECK(get_field<std::int64_t>(rs[0], 0, 0) == 1);
+				CHECK(get_field<boost::string_ref>(rs[0], 0, 1) == "abc");
+				CHECK(boost::asio::buffer_size(get_field<boost::asio::const_buffer>(rs[0], 0, 2)) == 2);
+				CHECK(get_field<std::string>(rs[0], 0, 3) == "12.34");
+				auto vec = get_field<std::vector<boost::optional<std::int32_t>>>(rs[0], 0, 4);
+				REQUIRE(vec.size() == 2);
+				REQUIRE(static_cast<bool>(vec[0]));
+				CHECK(*vec[0] == 1);
+				CHECK_FALSE(static_cast<bool>(vec[1]));
+			}
+		}
+	}
+}
+
+}
+}
+}
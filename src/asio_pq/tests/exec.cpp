@@ -0,0 +1,204 @@
+#include <asio_pq/exec.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+SCENARIO("Commands may be executed and all results thereof retrieved via async_exec", "[asio_pq][async_exec]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		const char * command =
+			"DROP TABLE IF EXISTS \"async_exec_test\";"
+			"CREATE TABLE \"async_exec_test\" (\"num\" INT);"
+			"INSERT INTO \"async_exec_test\" VALUES (1), (2);"
+			"SELECT * FROM \"async_exec_test\";";
+		WHEN("async_exec is invoked") {
+			boost::system::error_code ec;
+			std::vector<result> rs;
+			bool invoked = false;
+			async_exec(conn, command, [&] (auto e, auto inner) {
+				invoked = true;
+				ec = e;
+				rs = std::move(inner);
+			});
+			ios.run();
+			THEN("The operation succeeds") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQerrorMessage: " << PQerrorMessage(conn));
+				REQUIRE_FALSE(ec);
+				AND_THEN("All results are retrieved") {
+					REQUIRE(rs.size() == 4);
+					CHECK(PQresultStatus(rs[0]) == PGRES_COMMAND_OK);
+					CHECK(PQresultStatus(rs[1]) == PGRES_COMMAND_OK);
+					CHECK(PQresultStatus(rs[2]) == PGRES_COMMAND_OK);
+					CHECK(PQresultStatus(rs[3]) == PGRES_TUPLES_OK);
+					CHECK(PQntuples(rs[3]) == 2);
+				}
+			}
+		}
+		WHEN("async_exec is invoked with a visitor") {
+			boost::system::error_code ec;
+			std::vector<ExecStatusType> statuses;
+			bool invoked = false;
+			async_exec(
+				conn,
+				command,
+				[&] (result r) {	statuses.push_back(PQresultStatus(r));	},
+				[&] (auto e) {
+					invoked = true;
+					ec = e;
+				}
+			);
+			ios.run();
+			THEN("The operation succeeds") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				REQUIRE_FALSE(ec);
+				AND_THEN("Each result is visited") {
+					REQUIRE(statuses.size() == 4);
+					CHECK(statuses[3] == PGRES_TUPLES_OK);
+				}
+			}
+		}
+		WHEN("async_exec_params is invoked") {
+			const char * params [] = {"5"};
+			boost::system::error_code ec;
+			std::vector<result> rs;
+			bool invoked = false;
+			async_exec_params(
+				conn,
+				"SELECT $1::INT + 1",
+				1,
+				nullptr,
+				params,
+				nullptr,
+				nullptr,
+				0,
+				[&] (auto e, auto inner) {
+					invoked = true;
+					ec = e;
+					rs = std::move(inner);
+				}
+			);
+			ios.run();
+			THEN("The operation succeeds") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				REQUIRE_FALSE(ec);
+				AND_THEN("The correct result is retrieved") {
+					REQUIRE(rs.size() == 1);
+					REQUIRE(PQntuples(rs[0]) == 1);
+					CHECK(std::strcmp(PQgetvalue(rs[0], 0, 0), "6") == 0);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("async_exec completes with an error rather than collecting the results of a COPY", "[asio_pq][async_exec]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		boost::system::error_code ec;
+		std::vector<result> rs;
+		bool invoked = false;
+		auto handler = [&] (auto e, auto inner) {
+			invoked = true;
+			ec = e;
+			rs = std::move(inner);
+		};
+		WHEN("async_exec is invoked with a COPY ... TO STDOUT command") {
+			async_exec(conn, "COPY (SELECT 1) TO STDOUT", handler);
+			ios.run();
+			THEN("The operation fails with asio_pq::error::unexpected_copy") {
+				REQUIRE(invoked);
+				CHECK(ec == make_error_code(error::unexpected_copy));
+				AND_THEN("The PGRES_COPY_OUT result is the last result retrieved") {
+					REQUIRE(rs.size() == 1);
+					CHECK(PQresultStatus(rs[0]) == PGRES_COPY_OUT);
+				}
+			}
+		}
+		WHEN("async_exec is invoked with a COPY ... FROM STDIN command") {
+			const char * command =
+				"DROP TABLE IF EXISTS \"async_exec_copy_test\";"
+				"CREATE TABLE \"async_exec_copy_test\" (\"num\" INT);"
+				"COPY \"async_exec_copy_test\" FROM STDIN;";
+			async_exec(conn, command, handler);
+			ios.run();
+			THEN("The operation fails with asio_pq::error::unexpected_copy") {
+				REQUIRE(invoked);
+				CHECK(ec == make_error_code(error::unexpected_copy));
+				AND_THEN("The PGRES_COPY_IN result is the last result retrieved") {
+					REQUIRE_FALSE(rs.empty());
+					CHECK(PQresultStatus(rs.back()) == PGRES_COPY_IN);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
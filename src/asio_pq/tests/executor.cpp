@@ -0,0 +1,270 @@
+#include <asio_pq/detail/executor.hpp>
+
+#ifdef ASIO_PQ_HAS_EXECUTORS
+
+#include <asio_pq/bulk_load.hpp>
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/exec.hpp>
+#include <asio_pq/get_result.hpp>
+#include <asio_pq/pool.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+const char * keywords [] = {
+	"host",
+	"port",
+	"user",
+	"password",
+	"dbname",
+	nullptr
+};
+const char * values [] = {
+	ASIO_PQ_TEST_HOST,
+	ASIO_PQ_TEST_PORT,
+	ASIO_PQ_TEST_USER,
+	ASIO_PQ_TEST_PASSWORD,
+	ASIO_PQ_TEST_DBNAME,
+	nullptr
+};
+
+class allocations {
+public:
+	allocations () noexcept
+		:	allocated(0),
+			outstanding(0)
+	{	}
+	std::size_t allocated;
+	std::size_t outstanding;
+};
+
+template <typename T>
+class counting_allocator {
+private:
+	template <typename>
+	friend class counting_allocator;
+	allocations * a_;
+public:
+	using value_type = T;
+	explicit counting_allocator (allocations & a) noexcept
+		:	a_(&a)
+	{	}
+	template <typename U>
+	counting_allocator (const counting_allocator<U> & other) noexcept
+		:	a_(other.a_)
+	{	}
+	T * allocate (std::size_t n) {
+		++a_->allocated;
+		++a_->outstanding;
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate (T * ptr, std::size_t n) noexcept {
+		--a_->outstanding;
+		std::allocator<T>().deallocate(ptr, n);
+	}
+	template <typename U>
+	bool operator == (const counting_allocator<U> & rhs) const noexcept {
+		return a_ == rhs.a_;
+	}
+	template <typename U>
+	bool operator != (const counting_allocator<U> & rhs) const noexcept {
+		return a_ != rhs.a_;
+	}
+};
+
+class counting_handler {
+private:
+	allocations * a_;
+	boost::system::error_code * ec_;
+public:
+	counting_handler (allocations & a, boost::system::error_code & ec) noexcept
+		:	a_(&a),
+			ec_(&ec)
+	{	}
+	using allocator_type = counting_allocator<void>;
+	allocator_type get_allocator () const noexcept {
+		return allocator_type(*a_);
+	}
+	void operator () (boost::system::error_code ec) {
+		*ec_ = ec;
+	}
+};
+
+SCENARIO("Completion handlers are invoked on their associated executor", "[asio_pq][executor]") {
+	GIVEN("A boost::asio::io_service, a strand, and a connection handle") {
+		boost::asio::io_service ios;
+		boost::asio::strand<boost::asio::io_service::executor_type> strand(ios.get_executor());
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		bool connected = false;
+		boost::system::error_code ec;
+		async_connect(conn, boost::asio::bind_executor(strand, [&] (auto e) {
+			CHECK(strand.running_in_this_thread());
+			ec = e;
+			connected = true;
+		}));
+		ios.run();
+		ios.reset();
+		REQUIRE(connected);
+		INFO(ec.message());
+		REQUIRE_FALSE(ec);
+		WHEN("async_exec is invoked with a handler bound to the strand") {
+			bool invoked = false;
+			std::vector<result> results;
+			async_exec(conn, "SELECT 1;", boost::asio::bind_executor(strand, [&] (auto e, auto rs) {
+				CHECK(strand.running_in_this_thread());
+				ec = e;
+				results = std::move(rs);
+				invoked = true;
+			}));
+			ios.run();
+			THEN("The handler is invoked on the strand") {
+				CHECK(invoked);
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+				CHECK(results.size() == 1U);
+			}
+		}
+		WHEN("async_get_result is invoked with a deadline and a handler bound to the strand") {
+			REQUIRE(PQsendQuery(conn, "SELECT 1;") == 1);
+			int results = 0;
+			bool done = false;
+			std::function<void (boost::system::error_code, result)> handler = [&] (auto e, auto r) {
+				CHECK(strand.running_in_this_thread());
+				ec = e;
+				if (e || !r) {
+					done = true;
+					return;
+				}
+				++results;
+				async_get_result(conn, std::chrono::minutes(1), boost::asio::bind_executor(strand, handler));
+			};
+			async_get_result(conn, std::chrono::minutes(1), boost::asio::bind_executor(strand, handler));
+			ios.run();
+			THEN("The handler is invoked on the strand") {
+				CHECK(done);
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+				CHECK(results == 1);
+			}
+		}
+	}
+}
+
+SCENARIO("Operations over a pool invoke completion handlers on their associated executor", "[asio_pq][executor]") {
+	GIVEN("A boost::asio::io_service, a strand, and a pool") {
+		boost::asio::io_service ios;
+		boost::asio::strand<boost::asio::io_service::executor_type> strand(ios.get_executor());
+		pool p(ios, [] (boost::asio::io_service & ios) {
+			return connection(ios, keywords, values, false);
+		});
+		WHEN("async_acquire is invoked with a handler bound to the strand") {
+			bool invoked = false;
+			boost::system::error_code ec;
+			lease l;
+			p.async_acquire(boost::asio::bind_executor(strand, [&] (auto e, auto inner) {
+				CHECK(strand.running_in_this_thread());
+				ec = e;
+				l = std::move(inner);
+				invoked = true;
+			}));
+			ios.run();
+			THEN("The handler is invoked on the strand") {
+				CHECK(invoked);
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+				CHECK(l);
+			}
+		}
+		WHEN("async_acquire is invoked with a handler bound to the strand while a connection is idle") {
+			lease idle;
+			p.async_acquire([&] (auto, auto inner) {	idle = std::move(inner);	});
+			ios.run();
+			ios.reset();
+			REQUIRE(idle);
+			idle.reset();
+			bool invoked = false;
+			boost::system::error_code ec;
+			lease l;
+			p.async_acquire(boost::asio::bind_executor(strand, [&] (auto e, auto inner) {
+				CHECK(strand.running_in_this_thread());
+				ec = e;
+				l = std::move(inner);
+				invoked = true;
+			}));
+			ios.run();
+			THEN("The handler is invoked on the strand") {
+				CHECK(invoked);
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+				CHECK(l);
+			}
+		}
+		WHEN("async_bulk_load is invoked with a handler bound to the strand") {
+			bulk_load_settings settings;
+			settings.streams = 0;
+			std::vector<int> rows;
+			bool invoked = false;
+			boost::system::error_code ec;
+			async_bulk_load(
+				p,
+				std::move(settings),
+				make_range_source(rows.begin(), rows.end(), 1),
+				boost::asio::bind_executor(strand, [&] (auto e, auto, auto) {
+					CHECK(strand.running_in_this_thread());
+					ec = e;
+					invoked = true;
+				})
+			);
+			ios.run();
+			THEN("The handler is invoked on the strand") {
+				CHECK(invoked);
+				CHECK(ec == make_error_code(boost::asio::error::invalid_argument));
+			}
+		}
+	}
+}
+
+SCENARIO("Memory is allocated through the associated allocator of completion handlers", "[asio_pq][executor]") {
+	GIVEN("A boost::asio::io_service and a connection handle") {
+		boost::asio::io_service ios;
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		WHEN("async_connect is invoked with a handler which has an associated allocator") {
+			allocations a;
+			boost::system::error_code ec = make_error_code(boost::system::errc::operation_in_progress);
+			async_connect(conn, counting_handler(a, ec));
+			ios.run();
+			THEN("Memory is obtained from and returned to that allocator") {
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+				CHECK(a.allocated != 0U);
+				CHECK(a.outstanding == 0U);
+			}
+		}
+	}
+}
+
+}
+}
+}
+
+#endif
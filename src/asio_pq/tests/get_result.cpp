@@ -2,11 +2,18 @@
 
 #include <asio_pq/connect.hpp>
 #include <asio_pq/connection.hpp>
+#include <asio_pq/error.hpp>
 #include <asio_pq/result.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
 #include <boost/system/system_error.hpp>
 #include <libpq-fe.h>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <catch.hpp>
@@ -92,6 +99,82 @@ SCENARIO("PGresult objects may be acquired asynchronously via async_get_result",
 				CHECK(PQntuples(rs[3]) == 2);
 			}
 		}
+		WHEN("PQsendQuery is used to submit a command too large to be sent at once and the result is obtained by async_get_result while several threads run the boost::asio::io_service") {
+			//	Padding the command with a comment means
+			//	PQflush must wait for write readiness while
+			//	the operation also waits for read readiness
+			std::string command("SELECT 1 /*");
+			command.append(std::size_t(16) * 1024 * 1024, ' ');
+			command += "*/";
+			REQUIRE(PQsendQuery(conn, command.c_str()) == 1);
+			std::vector<result> rs;
+			for (;;) {
+				boost::system::error_code ec;
+				result r;
+				async_get_result(conn, [&] (auto e, auto res) {
+					ec = e;
+					r = std::move(res);
+				});
+				std::vector<std::thread> threads;
+				for (int i = 0; i < 4; ++i) threads.emplace_back([&] () {	ios.run();	});
+				for (auto && t : threads) t.join();
+				ios.reset();
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQerrorMessage: " << PQerrorMessage(conn));
+				REQUIRE_FALSE(ec);
+				if (!r) break;
+				rs.push_back(std::move(r));
+			}
+			THEN("The correct result is retrieved") {
+				REQUIRE(rs.size() == 1);
+				CHECK(PQresultStatus(rs[0]) == PGRES_TUPLES_OK);
+				CHECK(PQntuples(rs[0]) == 1);
+			}
+		}
+		WHEN("PQsendQuery is used to submit a command which runs longer than the timeout given to async_get_result") {
+			REQUIRE(PQsendQuery(conn, "SELECT pg_sleep(10)") == 1);
+			boost::system::error_code ec;
+			result r;
+			async_get_result(conn, std::chrono::milliseconds(100), [&] (auto e, auto res) {
+				ec = e;
+				r = std::move(res);
+			});
+			ios.run();
+			ios.reset();
+			THEN("The operation times out and the command is cancelled") {
+				INFO("boost::system::error_code::message: " << ec.message());
+				CHECK(ec == make_error_code(error::timed_out));
+				REQUIRE(r);
+				CHECK(PQresultStatus(r) == PGRES_FATAL_ERROR);
+				const char * state = PQresultErrorField(r, PG_DIAG_SQLSTATE);
+				REQUIRE(state);
+				CHECK(std::strcmp(state, "57014") == 0);
+			}
+			AND_WHEN("The remaining results are retrieved and another command is submitted") {
+				for (;;) {
+					async_get_result(conn, [&] (auto e, auto res) {
+						ec = e;
+						r = std::move(res);
+					});
+					ios.run();
+					ios.reset();
+					REQUIRE_FALSE(ec);
+					if (!r) break;
+				}
+				REQUIRE(PQsendQuery(conn, "SELECT 1") == 1);
+				async_get_result(conn, std::chrono::minutes(1), [&] (auto e, auto res) {
+					ec = e;
+					r = std::move(res);
+				});
+				ios.run();
+				THEN("The connection remains usable") {
+					INFO("boost::system::error_code::message: " << ec.message());
+					INFO("PQerrorMessage: " << PQerrorMessage(conn));
+					REQUIRE_FALSE(ec);
+					CHECK(is_ok(r));
+				}
+			}
+		}
 		WHEN("PQsendQuery is used to submit an invalid command to the database and the result is obtained by async_get_result") {
 			REQUIRE(PQsendQuery(
 				conn,
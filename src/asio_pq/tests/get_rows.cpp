@@ -0,0 +1,105 @@
+#include <asio_pq/get_rows.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/get_result.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/system_error.hpp>
+#include <libpq-fe.h>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+SCENARIO("Rows may be retrieved in batches via async_get_rows", "[asio_pq][async_get_rows]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		WHEN("A query is sent, row-by-row mode is entered, and rows are retrieved by async_get_rows") {
+			REQUIRE(PQsendQuery(conn, "SELECT * FROM generate_series(1, 10)") == 1);
+			set_row_mode(conn);
+			std::size_t rows = 0;
+			std::size_t batches = 0;
+			result last;
+			for (;;) {
+				std::vector<result> batch;
+				bool invoked = false;
+				async_get_rows(conn, 4, [&] (auto ec, auto rs) {
+					invoked = true;
+					if (ec) {
+						INFO("boost::system::error_code::message: " << ec.message());
+						INFO("PQerrorMessage: " << PQerrorMessage(conn));
+						throw boost::system::system_error(ec);
+					}
+					batch = std::move(rs);
+				});
+				ios.run();
+				ios.reset();
+				REQUIRE(invoked);
+				REQUIRE_FALSE(batch.empty());
+				REQUIRE(batch.size() <= 4);
+				++batches;
+				for (auto && r : batch) rows += std::size_t(PQntuples(r));
+				if (PQresultStatus(batch.back()) != PGRES_SINGLE_TUPLE) {
+					last = std::move(batch.back());
+					break;
+				}
+			}
+			THEN("All rows are retrieved in bounded batches") {
+				CHECK(rows == 10);
+				CHECK(batches >= 3);
+				AND_THEN("The final result indicates success") {
+					CHECK(PQresultStatus(last) == PGRES_TUPLES_OK);
+				}
+			}
+			AND_WHEN("async_get_result is invoked") {
+				result r;
+				bool invoked = false;
+				async_get_result(conn, [&] (auto ec, auto inner) {
+					invoked = true;
+					if (ec) throw boost::system::system_error(ec);
+					r = std::move(inner);
+				});
+				ios.run();
+				THEN("There are no further results") {
+					REQUIRE(invoked);
+					CHECK_FALSE(r);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,224 @@
+#include <asio_pq/notification_dispatcher.hpp>
+#include <asio_pq/wait_notification.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/exec.hpp>
+#include <asio_pq/notification.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+//	Lays out a PGnotify the way libpq does: A single
+//	allocation (freed by PQfreemem) which contains the
+//	strings
+static notification make_notification (const char * channel, const char * payload, int pid = 1) {
+	auto c = std::strlen(channel) + 1;
+	auto p = std::strlen(payload) + 1;
+	auto ptr = static_cast<char *>(std::malloc(sizeof(PGnotify) + c + p));
+	REQUIRE(ptr);
+	auto n = reinterpret_cast<PGnotify *>(ptr);
+	n->relname = ptr + sizeof(PGnotify);
+	n->extra = n->relname + c;
+	n->be_pid = pid;
+	n->next = nullptr;
+	std::memcpy(n->relname, channel, c);
+	std::memcpy(n->extra, payload, p);
+	return notification(n);
+}
+
+SCENARIO("asio_pq::notification_dispatcher objects fan notifications out to subscribers", "[asio_pq][notification_dispatcher]") {
+	GIVEN("A notification_dispatcher with subscribers on two channels") {
+		boost::asio::io_service ios;
+		connection conn(ios, static_cast<PGconn *>(nullptr));
+		notification_dispatcher dispatcher(conn);
+		std::vector<std::shared_ptr<const notification>> a;
+		std::vector<std::shared_ptr<const notification>> b;
+		std::vector<std::shared_ptr<const notification>> c;
+		auto sa = dispatcher.subscribe("foo", [&] (const auto & n) {	a.push_back(n);	});
+		dispatcher.subscribe("foo", [&] (const auto & n) {	b.push_back(n);	});
+		dispatcher.subscribe("bar", [&] (const auto & n) {	c.push_back(n);	});
+		CHECK(dispatcher.subscribers("foo") == 2);
+		CHECK(dispatcher.subscribers("bar") == 1);
+		CHECK(dispatcher.subscribers("baz") == 0);
+		WHEN("A notification is dispatched") {
+			auto num = dispatcher.dispatch(make_notification("foo", "hello", 5));
+			THEN("Each subscriber to its channel receives the same object") {
+				CHECK(num == 2);
+				REQUIRE(a.size() == 1);
+				REQUIRE(b.size() == 1);
+				CHECK(c.empty());
+				CHECK(a.front() == b.front());
+				CHECK(std::string(a.front()->channel()) == "foo");
+				CHECK(std::string(a.front()->payload()) == "hello");
+				CHECK(a.front()->pid() == 5);
+			}
+		}
+		WHEN("A notification on a channel without subscribers is dispatched") {
+			auto num = dispatcher.dispatch(make_notification("baz", ""));
+			THEN("It is discarded") {
+				CHECK(num == 0);
+				CHECK(a.empty());
+				CHECK(b.empty());
+				CHECK(c.empty());
+			}
+		}
+		WHEN("A subscriber is removed") {
+			dispatcher.unsubscribe(sa);
+			dispatcher.unsubscribe(sa);
+			auto num = dispatcher.dispatch(make_notification("foo", ""));
+			THEN("It no longer receives notifications") {
+				CHECK(num == 1);
+				CHECK(a.empty());
+				CHECK(b.size() == 1);
+				CHECK(dispatcher.subscribers("foo") == 1);
+			}
+		}
+		WHEN("Subscribers subscribe and unsubscribe during dispatch") {
+			std::size_t once = 0;
+			std::size_t added = 0;
+			notification_dispatcher::subscription so = 0;
+			so = dispatcher.subscribe("foo", [&] (const auto &) {
+				++once;
+				dispatcher.unsubscribe(so);
+				dispatcher.subscribe("foo", [&] (const auto &) {	++added;	});
+			});
+			auto first = dispatcher.dispatch(make_notification("foo", ""));
+			auto second = dispatcher.dispatch(make_notification("foo", ""));
+			THEN("Removals take effect immediately and additions take effect with the next notification") {
+				CHECK(first == 3);
+				CHECK(second == 3);
+				CHECK(once == 1);
+				CHECK(added == 1);
+				CHECK(a.size() == 2);
+				CHECK(dispatcher.subscribers("foo") == 3);
+			}
+		}
+		WHEN("The last subscriber to a channel unsubscribes during dispatch") {
+			notification_dispatcher::subscription sq = 0;
+			sq = dispatcher.subscribe("qux", [&] (const auto &) {	dispatcher.unsubscribe(sq);	});
+			auto num = dispatcher.dispatch(make_notification("qux", ""));
+			THEN("The channel has no subscribers") {
+				CHECK(num == 1);
+				CHECK(dispatcher.subscribers("qux") == 0);
+				CHECK(dispatcher.dispatch(make_notification("qux", "")) == 0);
+			}
+		}
+	}
+}
+
+SCENARIO("Notifications may be received via async_wait_notification", "[asio_pq][async_wait_notification]") {
+	GIVEN("A boost::asio::io_service and two asio_pq::connection objects which manage connection handles") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection listener(ios, keywords, values, false);
+		REQUIRE(listener);
+		connection notifier(ios, keywords, values, false);
+		REQUIRE(notifier);
+		auto a = async_connect(listener, boost::asio::use_future);
+		auto b = async_connect(notifier, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		a.get();
+		b.get();
+		REQUIRE(PQsetnonblocking(listener, 1) == 0);
+		REQUIRE(PQsetnonblocking(notifier, 1) == 0);
+		boost::system::error_code ec;
+		async_exec(listener, "LISTEN \"asio_pq_notification_test\"", [&] (auto e, auto) {	ec = e;	});
+		ios.run();
+		ios.reset();
+		INFO("PQerrorMessage: " << PQerrorMessage(listener));
+		REQUIRE_FALSE(ec);
+		WHEN("async_wait_notification is pending and notifications are sent on another connection") {
+			std::vector<notification> ns;
+			async_wait_notification(listener, [&] (auto e, auto inner) {
+				ec = e;
+				ns = std::move(inner);
+			});
+			async_exec(
+				notifier,
+				"SELECT pg_notify('asio_pq_notification_test', 'a');"
+				"SELECT pg_notify('asio_pq_notification_test', 'b')",
+				[&] (auto e, auto) {	REQUIRE_FALSE(e);	}
+			);
+			ios.run();
+			ios.reset();
+			if (ns.size() == 1) {
+				//	The second notification is in a separate
+				//	transaction and may arrive separately
+				std::vector<notification> more;
+				async_wait_notification(listener, [&] (auto e, auto inner) {
+					ec = e;
+					more = std::move(inner);
+				});
+				ios.run();
+				for (auto && n : more) ns.push_back(std::move(n));
+			}
+			THEN("They are received in order") {
+				INFO("boost::system::error_code::message: " << ec.message());
+				REQUIRE_FALSE(ec);
+				REQUIRE(ns.size() == 2);
+				CHECK(std::string(ns[0].channel()) == "asio_pq_notification_test");
+				CHECK(std::string(ns[0].payload()) == "a");
+				CHECK(std::string(ns[1].payload()) == "b");
+				CHECK(ns[0].pid() == PQbackendPID(notifier));
+			}
+		}
+		WHEN("A notification_dispatcher runs on the listening connection") {
+			notification_dispatcher dispatcher(listener);
+			std::vector<std::shared_ptr<const notification>> received;
+			dispatcher.subscribe("asio_pq_notification_test", [&] (const auto & n) {
+				received.push_back(n);
+				dispatcher.stop();
+			});
+			dispatcher.async_run([&] (auto e) {	ec = e;	});
+			async_exec(
+				notifier,
+				"NOTIFY \"asio_pq_notification_test\", 'c'",
+				[&] (auto e, auto) {	REQUIRE_FALSE(e);	}
+			);
+			ios.run();
+			THEN("Subscribers receive notifications until the operation is stopped") {
+				CHECK(ec == boost::asio::error::operation_aborted);
+				REQUIRE(received.size() == 1);
+				CHECK(std::string(received.front()->payload()) == "c");
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,168 @@
+#include <asio_pq/parallel_export.hpp>
+
+#include <asio_pq/copy_data.hpp>
+#include <asio_pq/error.hpp>
+#include <asio_pq/exec.hpp>
+#include <asio_pq/pool.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+const char * conninfo =
+	"host='" ASIO_PQ_TEST_HOST "'"
+	" port='" ASIO_PQ_TEST_PORT "'"
+	" user='" ASIO_PQ_TEST_USER "'"
+	" password='" ASIO_PQ_TEST_PASSWORD "'"
+	" dbname='" ASIO_PQ_TEST_DBNAME "'";
+
+SCENARIO("Tables may be exported over several connections via async_parallel_export", "[asio_pq][async_parallel_export]") {
+	GIVEN("A boost::asio::io_service, a pool, and a table") {
+		boost::asio::io_service ios;
+		pool p(ios, conninfo);
+		lease l;
+		p.async_acquire([&] (auto ec, auto inner) {
+			REQUIRE_FALSE(ec);
+			l = std::move(inner);
+		});
+		ios.run();
+		ios.reset();
+		REQUIRE(l);
+		auto future = async_exec(
+			*l,
+			"DROP TABLE IF EXISTS \"async_parallel_export_test\";"
+			"CREATE TABLE \"async_parallel_export_test\" (\"id\" INT, \"pad\" TEXT);"
+			"INSERT INTO \"async_parallel_export_test\" "
+			"SELECT i, repeat('x', 100) FROM generate_series(1, 10000) AS i;",
+			boost::asio::use_future
+		);
+		ios.run();
+		ios.reset();
+		future.get();
+		l.reset();
+		parallel_export_settings settings;
+		settings.table = "async_parallel_export_test";
+		settings.columns = {"id"};
+		settings.workers = 3;
+		std::map<std::size_t, std::string> partitions;
+		auto sink = [&] (std::size_t partition, copy_data chunk) {
+			partitions[partition].append(chunk.data(), chunk.size());
+		};
+		auto check = [&] () {
+			std::vector<int> ids;
+			for (auto && pair : partitions) {
+				std::istringstream ss(pair.second);
+				int id;
+				while (ss >> id) ids.push_back(id);
+			}
+			std::sort(ids.begin(), ids.end());
+			REQUIRE(ids.size() == 10000);
+			for (std::size_t i = 0; i < ids.size(); ++i) REQUIRE(ids[i] == int(i + 1));
+		};
+		WHEN("async_parallel_export is invoked") {
+			settings.partitions = 8;
+			boost::system::error_code ec;
+			parallel_export_progress progress;
+			result r;
+			async_parallel_export(p, std::move(settings), sink, [&] (auto e, auto pr, auto inner) {
+				ec = e;
+				progress = pr;
+				r = std::move(inner);
+			});
+			ios.run();
+			THEN("The operation succeeds") {
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQresultErrorMessage: " << (r ? PQresultErrorMessage(r) : ""));
+				REQUIRE_FALSE(ec);
+				AND_THEN("Each row is exported exactly once") {
+					CHECK(progress.rows == 10000);
+					CHECK(progress.partitions == 8);
+					CHECK(progress.chunks == 10000);
+					check();
+				}
+			}
+		}
+		WHEN("async_parallel_export is invoked with key ranges") {
+			settings.predicates = {
+				"\"id\" <= 5000",
+				"\"id\" > 5000"
+			};
+			boost::system::error_code ec;
+			parallel_export_progress progress;
+			async_parallel_export(p, std::move(settings), sink, [&] (auto e, auto pr, auto) {
+				ec = e;
+				progress = pr;
+			});
+			ios.run();
+			THEN("The operation succeeds") {
+				INFO("boost::system::error_code::message: " << ec.message());
+				REQUIRE_FALSE(ec);
+				CHECK(progress.partitions == 2);
+				check();
+			}
+		}
+		WHEN("async_parallel_export is invoked with a schema and options") {
+			settings.schema = "public";
+			settings.options = {{"format", "text"}, {"null", "NULL"}};
+			boost::system::error_code ec;
+			async_parallel_export(p, std::move(settings), sink, [&] (auto e, auto, auto) {
+				ec = e;
+			});
+			ios.run();
+			THEN("The operation succeeds") {
+				INFO("boost::system::error_code::message: " << ec.message());
+				REQUIRE_FALSE(ec);
+				check();
+			}
+		}
+		WHEN("async_parallel_export is invoked with a name which must be quoted") {
+			settings.table = "async_parallel_export_test\" WHERE FALSE --";
+			boost::system::error_code ec;
+			result r;
+			async_parallel_export(p, std::move(settings), sink, [&] (auto e, auto, auto inner) {
+				ec = e;
+				r = std::move(inner);
+			});
+			ios.run();
+			THEN("The name is not interpreted as SQL") {
+				CHECK(ec == make_error_code(error::command_failed));
+				CHECK(partitions.empty());
+			}
+		}
+		WHEN("async_parallel_export is invoked without a table") {
+			settings.table.clear();
+			boost::system::error_code ec;
+			bool invoked = false;
+			async_parallel_export(p, std::move(settings), sink, [&] (auto e, auto, auto) {
+				invoked = true;
+				ec = e;
+			});
+			CHECK_FALSE(invoked);
+			ios.run();
+			THEN("The operation fails with boost::asio::error::invalid_argument") {
+				CHECK(invoked);
+				CHECK(ec == make_error_code(boost::asio::error::invalid_argument));
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,195 @@
+#include <asio_pq/params.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/oid.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <libpq-fe.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+//	Parameters which would refer to a temporary
+//	std::string cannot be encoded
+static_assert(std::is_constructible<params<std::string>, std::string &>::value, "");
+static_assert(!std::is_constructible<params<std::string>, std::string>::value, "");
+static_assert(!std::is_constructible<params<std::string>, const char *>::value, "");
+static_assert(!std::is_constructible<params<boost::optional<std::string>>, std::string &>::value, "");
+static_assert(std::is_constructible<params<boost::string_ref>, std::string &>::value, "");
+static_assert(!std::is_constructible<params<boost::string_ref>, std::string>::value, "");
+static_assert(std::is_constructible<params<std::vector<std::string>>, std::vector<std::string>>::value, "");
+static_assert(std::is_constructible<params<std::int64_t, const char *>, int, const char (&) [4]>::value, "");
+
+std::string bytes (const char * ptr, int length) {
+	REQUIRE(ptr);
+	REQUIRE(length >= 0);
+	return std::string(ptr, std::size_t(length));
+}
+
+SCENARIO("Parameters are encoded in binary format according to their C++ types", "[asio_pq][params]") {
+	GIVEN("Parameters of fixed size types") {
+		auto p = make_params(std::int16_t(-2), std::int32_t(1), std::int64_t(2), 1.5f, true);
+		const char * values [5];
+		p.values(values);
+		THEN("The number of parameters is correct") {
+			CHECK(p.size() == 5);
+		}
+		THEN("The types are correct") {
+			CHECK(p.types()[0] == oid::int2);
+			CHECK(p.types()[1] == oid::int4);
+			CHECK(p.types()[2] == oid::int8);
+			CHECK(p.types()[3] == oid::float4);
+			CHECK(p.types()[4] == oid::boolean);
+		}
+		THEN("All parameters are in binary format") {
+			for (std::size_t i = 0; i < p.size(); ++i) CHECK(p.formats()[i] == 1);
+		}
+		THEN("The values are encoded big endian") {
+			CHECK(bytes(values[0], p.lengths()[0]) == std::string("\xFF\xFE", 2));
+			CHECK(bytes(values[1], p.lengths()[1]) == std::string("\0\0\0\x01", 4));
+			CHECK(bytes(values[2], p.lengths()[2]) == std::string("\0\0\0\0\0\0\0\x02", 8));
+			CHECK(bytes(values[3], p.lengths()[3]) == std::string("\x3F\xC0\0\0", 4));
+			CHECK(bytes(values[4], p.lengths()[4]) == std::string("\x01", 1));
+		}
+	}
+	GIVEN("Parameters of variable size types") {
+		std::string str("hello");
+		const char buffer [] = {'\0', '\x01'};
+		auto p = make_params(str, "world", boost::asio::const_buffer(buffer, sizeof(buffer)));
+		const char * values [3];
+		p.values(values);
+		THEN("The types are correct") {
+			CHECK(p.types()[0] == oid::text);
+			CHECK(p.types()[1] == oid::text);
+			CHECK(p.types()[2] == oid::bytea);
+		}
+		THEN("The values refer to the caller's memory") {
+			CHECK(values[0] == str.data());
+			CHECK(p.lengths()[0] == 5);
+			CHECK(bytes(values[1], p.lengths()[1]) == "world");
+			CHECK(values[2] == buffer);
+			CHECK(p.lengths()[2] == 2);
+		}
+	}
+	GIVEN("Null parameters") {
+		auto p = make_params(boost::optional<double>{}, nullptr, boost::optional<std::int32_t>(7));
+		const char * values [3];
+		p.values(values);
+		THEN("The types are correct") {
+			CHECK(p.types()[0] == oid::float8);
+			CHECK(p.types()[1] == oid::unspecified);
+			CHECK(p.types()[2] == oid::int4);
+		}
+		THEN("Null values are represented by null pointers") {
+			CHECK_FALSE(values[0]);
+			CHECK(p.lengths()[0] == -1);
+			CHECK_FALSE(values[1]);
+			CHECK(p.lengths()[1] == -1);
+			CHECK(bytes(values[2], p.lengths()[2]) == std::string("\0\0\0\x07", 4));
+		}
+	}
+	GIVEN("An array parameter") {
+		std::vector<boost::optional<std::int16_t>> vec{std::int16_t(1), boost::none};
+		auto p = make_params(vec);
+		const char * values [1];
+		p.values(values);
+		THEN("The type is the corresponding array type") {
+			CHECK(p.types()[0] == oid::int2_array);
+		}
+		THEN("The value is encoded as a one dimensional array") {
+			std::string expected(
+				"\0\0\0\x01"	//	Dimensions
+				"\0\0\0\x01"	//	Has nulls
+				"\0\0\0\x15"	//	Element type (int2)
+				"\0\0\0\x02"	//	Size
+				"\0\0\0\x01"	//	Lower bound
+				"\0\0\0\x02" "\0\x01"
+				"\xFF\xFF\xFF\xFF",
+				30
+			);
+			CHECK(bytes(values[0], p.lengths()[0]) == expected);
+		}
+	}
+}
+
+SCENARIO("Commands may be executed with parameters encoded at compile time via async_exec_params", "[asio_pq][async_exec_params][params]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		WHEN("async_exec_params is invoked with typed parameters") {
+			boost::system::error_code ec;
+			std::vector<result> rs;
+			bool invoked = false;
+			std::string str("abc");
+			auto p = make_params(std::int64_t(40), std::int32_t(2), str, std::vector<std::int32_t>{1, 2, 3});
+			async_exec_params(
+				conn,
+				"SELECT $1 + $2, $3 || 'def', array_length($4, 1)",
+				p,
+				0,
+				[&] (auto e, auto inner) {
+					invoked = true;
+					ec = e;
+					rs = std::move(inner);
+				}
+			);
+			ios.run();
+			THEN("The operation succeeds") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQerrorMessage: " << PQerrorMessage(conn));
+				REQUIRE_FALSE(ec);
+				AND_THEN("The server decodes the parameters correctly") {
+					REQUIRE(rs.size() == 1);
+					REQUIRE(PQresultStatus(rs[0]) == PGRES_TUPLES_OK);
+					REQUIRE(PQntuples(rs[0]) == 1);
+					CHECK(std::strcmp(PQgetvalue(rs[0], 0, 0), "42") == 0);
+					CHECK(std::strcmp(PQgetvalue(rs[0], 0, 1), "abcdef") == 0);
+					CHECK(std::strcmp(PQgetvalue(rs[0], 0, 2), "3") == 0);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
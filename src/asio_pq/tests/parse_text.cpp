@@ -0,0 +1,256 @@
+#include <asio_pq/parse_text.hpp>
+
+#include <asio_pq/error.hpp>
+#include <asio_pq/oid.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <string>
+#include <vector>
+#include <catch.hpp>
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+//	Creates a result with a single column in text
+//	format without a server, null pointers represent
+//	null values
+result make_result (Oid type, const std::vector<const char *> & values) {
+	result r(PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK));
+	REQUIRE(r);
+	char name [] = "value";
+	PGresAttDesc desc{};
+	desc.name = name;
+	desc.typid = type;
+	desc.typlen = -1;
+	desc.atttypmod = -1;
+	REQUIRE(PQsetResultAttrs(r, 1, &desc) != 0);
+	for (std::size_t i = 0; i < values.size(); ++i) {
+		auto v = values[i];
+		REQUIRE(PQsetvalue(r, int(i), 0, const_cast<char *>(v), v ? int(std::strlen(v)) : -1) != 0);
+	}
+	return r;
+}
+
+const simd_level levels [] = {simd_level::scalar, simd_level::sse42, simd_level::avx2};
+
+SCENARIO("Integer columns in text format may be parsed", "[asio_pq][parse_text_column]") {
+	for (auto level : levels) {
+		GIVEN("A result containing int8 values and simd_level " << int(level)) {
+			std::vector<const char *> values{
+				"0",
+				"-1",
+				"12345678",
+				nullptr,
+				"9223372036854775807",
+				"-9223372036854775808",
+				"1234567890123456",
+				"-42",
+				"7"
+			};
+			auto r = make_result(oid::int8, values);
+			WHEN("The column is parsed as std::int64_t") {
+				std::vector<std::int64_t> out(values.size());
+				std::uint8_t validity [2];
+				boost::system::error_code ec;
+				parse_text_column(r, 0, out.data(), validity, ec, level);
+				THEN("The operation succeeds") {
+					INFO(ec.message());
+					REQUIRE_FALSE(ec);
+					CHECK(out[0] == 0);
+					CHECK(out[1] == -1);
+					CHECK(out[2] == 12345678);
+					CHECK(out[3] == 0);
+					CHECK(out[4] == std::numeric_limits<std::int64_t>::max());
+					CHECK(out[5] == std::numeric_limits<std::int64_t>::min());
+					CHECK(out[6] == 1234567890123456);
+					CHECK(out[7] == -42);
+					CHECK(out[8] == 7);
+					CHECK(validity[0] == 0xF7);
+					CHECK(validity[1] == 0x01);
+				}
+			}
+			WHEN("The column is parsed as std::int32_t") {
+				std::vector<std::int32_t> out(values.size());
+				std::uint8_t validity [2];
+				boost::system::error_code ec;
+				parse_text_column(r, 0, out.data(), validity, ec, level);
+				THEN("The operation fails because values are out of range") {
+					CHECK(ec == make_error_code(error::decode_failed));
+				}
+			}
+			WHEN("The column is parsed without a validity bitmap") {
+				std::vector<std::int64_t> out(values.size());
+				boost::system::error_code ec;
+				parse_text_column(r, 0, out.data(), nullptr, ec, level);
+				THEN("The operation fails because there is a null value") {
+					CHECK(ec == make_error_code(error::unexpected_null));
+				}
+			}
+		}
+		GIVEN("A result containing malformed integers and simd_level " << int(level)) {
+			const char * malformed [] = {"", "-", "12a4", "1.5", "99999999999999999999", "1 "};
+			for (auto m : malformed) {
+				auto r = make_result(oid::int4, {"1", m});
+				std::int32_t out [2];
+				boost::system::error_code ec;
+				parse_text_column(r, 0, out, nullptr, ec, level);
+				INFO("Value: \"" << m << "\"");
+				CHECK(ec == make_error_code(error::decode_failed));
+			}
+		}
+		GIVEN("A result containing int2 values at the limits of the range and simd_level " << int(level)) {
+			auto r = make_result(oid::int2, {"32767", "-32768"});
+			std::int16_t out [2];
+			boost::system::error_code ec;
+			parse_text_column(r, 0, out, nullptr, ec, level);
+			REQUIRE_FALSE(ec);
+			CHECK(out[0] == 32767);
+			CHECK(out[1] == -32768);
+		}
+	}
+}
+
+SCENARIO("Floating point columns in text format may be parsed", "[asio_pq][parse_text_column]") {
+	GIVEN("A result containing float8 values") {
+		auto r = make_result(oid::float8, {"1.5", "-0.25", "1e+100", "1.2345678901234567e-300", "NaN", "-Infinity", "0.1", "123456789012345678901"});
+		double out [8];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, nullptr, ec);
+		THEN("The values are parsed exactly") {
+			REQUIRE_FALSE(ec);
+			CHECK(out[0] == 1.5);
+			CHECK(out[1] == -0.25);
+			CHECK(out[2] == 1e100);
+			CHECK(out[3] == 1.2345678901234567e-300);
+			CHECK(std::isnan(out[4]));
+			CHECK(out[5] == -std::numeric_limits<double>::infinity());
+			CHECK(out[6] == 0.1);
+			CHECK(out[7] == 123456789012345678901.0);
+		}
+	}
+	GIVEN("A result containing float4 values") {
+		auto r = make_result(oid::float4, {"0.1", "3.4028235e+38"});
+		float out [2];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, nullptr, ec);
+		THEN("The values are parsed exactly") {
+			REQUIRE_FALSE(ec);
+			CHECK(out[0] == 0.1f);
+			CHECK(out[1] == std::numeric_limits<float>::max());
+		}
+	}
+	GIVEN("A result containing a malformed float8 value") {
+		auto r = make_result(oid::float8, {"1.5x"});
+		double out [1];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, nullptr, ec);
+		CHECK(ec == make_error_code(error::decode_failed));
+	}
+}
+
+SCENARIO("Boolean columns in text format may be parsed", "[asio_pq][parse_text_column]") {
+	GIVEN("A result containing bool values") {
+		auto r = make_result(oid::boolean, {"t", "f", nullptr});
+		bool out [3];
+		std::uint8_t validity [1];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, validity, ec);
+		REQUIRE_FALSE(ec);
+		CHECK(out[0]);
+		CHECK_FALSE(out[1]);
+		CHECK(validity[0] == 0x03);
+	}
+}
+
+SCENARIO("Timestamp columns in text format may be parsed", "[asio_pq][parse_text_column]") {
+	GIVEN("A result containing timestamptz values") {
+		auto r = make_result(oid::timestamptz, {
+			"1970-01-01 00:00:00+00",
+			"2000-01-01 00:00:01.5+00",
+			"2024-02-29 12:34:56.123456-05:30",
+			"1969-12-31 23:59:59",
+			"infinity"
+		});
+		std::chrono::system_clock::time_point out [5];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, nullptr, ec);
+		THEN("The values are parsed") {
+			REQUIRE_FALSE(ec);
+			auto micros = [] (std::chrono::system_clock::time_point tp) {
+				return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+			};
+			CHECK(micros(out[0]) == 0);
+			CHECK(micros(out[1]) == 946684801500000LL);
+			CHECK(micros(out[2]) == (1709210096LL + 19800LL) * 1000000LL + 123456LL);
+			CHECK(micros(out[3]) == -1000000LL);
+			CHECK(out[4] == std::chrono::system_clock::time_point::max());
+		}
+	}
+	GIVEN("A result containing a timestamp after 2200") {
+		auto r = make_result(oid::timestamptz, {"2200-01-01 00:00:00+00"});
+		std::chrono::system_clock::time_point out [1];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, nullptr, ec);
+		THEN("The value is parsed") {
+			REQUIRE_FALSE(ec);
+			CHECK(std::chrono::duration_cast<std::chrono::seconds>(out[0].time_since_epoch()).count() == 7258118400LL);
+		}
+	}
+	GIVEN("A result containing 9999-12-31 00:00:00") {
+		auto r = make_result(oid::timestamp, {"9999-12-31 00:00:00"});
+		std::chrono::system_clock::time_point out [1];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, nullptr, ec);
+		if (std::ratio_less<std::chrono::system_clock::period, std::micro>::value) {
+			THEN("Parsing fails as std::chrono::system_clock::time_point cannot represent it") {
+				CHECK(ec == make_error_code(error::decode_failed));
+			}
+		} else {
+			THEN("The value is parsed") {
+				REQUIRE_FALSE(ec);
+				CHECK(std::chrono::duration_cast<std::chrono::seconds>(out[0].time_since_epoch()).count() == 253402214400LL);
+			}
+		}
+	}
+	GIVEN("A result containing a timestamp whose year has nine digits") {
+		auto r = make_result(oid::timestamp, {"999999999-12-31 23:59:59"});
+		std::chrono::system_clock::time_point out [1];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, nullptr, ec);
+		THEN("Parsing fails") {
+			CHECK(ec == make_error_code(error::decode_failed));
+		}
+	}
+	GIVEN("A result containing a timestamp in a format other than ISO") {
+		auto r = make_result(oid::timestamp, {"Thu Jan 01 00:00:00 1970"});
+		std::chrono::system_clock::time_point out [1];
+		boost::system::error_code ec;
+		parse_text_column(r, 0, out, nullptr, ec);
+		CHECK(ec == make_error_code(error::decode_failed));
+	}
+}
+
+SCENARIO("Only columns in text format may be parsed", "[asio_pq][parse_text_column]") {
+	GIVEN("A result") {
+		auto r = make_result(oid::int4, {"1"});
+		std::int32_t out [1];
+		boost::system::error_code ec;
+		WHEN("A column which does not exist is parsed") {
+			parse_text_column(r, 1, out, nullptr, ec);
+			THEN("The operation fails") {
+				CHECK(ec == make_error_code(error::type_mismatch));
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,143 @@
+#include <asio_pq/pipeline.hpp>
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+#include <asio_pq/cancel.hpp>
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+SCENARIO("Commands may be sent in a single batch via async_pipeline", "[asio_pq][async_pipeline]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		WHEN("A pipeline of valid commands is submitted via async_pipeline") {
+			pipeline p;
+			p.query("CREATE TEMPORARY TABLE \"async_pipeline_test\" (\"num\" INT)");
+			const char * one [] = {"1"};
+			p.query("INSERT INTO \"async_pipeline_test\" VALUES ($1)", 1, nullptr, one, nullptr, nullptr, 0);
+			p.prepare("async_pipeline_test_insert", "INSERT INTO \"async_pipeline_test\" VALUES ($1)");
+			const char * two [] = {"2"};
+			p.query_prepared("async_pipeline_test_insert", 1, two, nullptr, nullptr, 0);
+			p.query("SELECT \"num\" FROM \"async_pipeline_test\" ORDER BY \"num\"");
+			boost::system::error_code ec;
+			std::vector<result> rs;
+			bool invoked = false;
+			async_pipeline(conn, p, [&] (auto e, auto inner) {
+				invoked = true;
+				ec = e;
+				rs = std::move(inner);
+			});
+			ios.run();
+			THEN("The operation succeeds") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				INFO("PQerrorMessage: " << PQerrorMessage(conn));
+				REQUIRE_FALSE(ec);
+				AND_THEN("The result of each command is retrieved in order") {
+					REQUIRE(rs.size() == 5);
+					CHECK(PQresultStatus(rs[0]) == PGRES_COMMAND_OK);
+					CHECK(PQresultStatus(rs[1]) == PGRES_COMMAND_OK);
+					CHECK(PQresultStatus(rs[2]) == PGRES_COMMAND_OK);
+					CHECK(PQresultStatus(rs[3]) == PGRES_COMMAND_OK);
+					REQUIRE(PQresultStatus(rs[4]) == PGRES_TUPLES_OK);
+					REQUIRE(PQntuples(rs[4]) == 2);
+					CHECK(std::strcmp(PQgetvalue(rs[4], 0, 0), "1") == 0);
+					CHECK(std::strcmp(PQgetvalue(rs[4], 1, 0), "2") == 0);
+				}
+				AND_THEN("The connection has left pipeline mode") {
+					CHECK(PQpipelineStatus(conn) == PQ_PIPELINE_OFF);
+				}
+			}
+		}
+		WHEN("A pipeline containing an invalid command is submitted via async_pipeline") {
+			pipeline p;
+			p.query("SELECT 1");
+			p.query("DELETE TABLE IF EXISTS \"async_pipeline_test\"");
+			p.query("SELECT 2");
+			boost::system::error_code ec;
+			std::vector<result> rs;
+			bool invoked = false;
+			async_pipeline(conn, p, [&] (auto e, auto inner) {
+				invoked = true;
+				ec = e;
+				rs = std::move(inner);
+			});
+			ios.run();
+			THEN("The operation succeeds") {
+				REQUIRE(invoked);
+				INFO("boost::system::error_code::message: " << ec.message());
+				REQUIRE_FALSE(ec);
+				AND_THEN("Commands after the invalid command are aborted") {
+					REQUIRE(rs.size() == 3);
+					CHECK(PQresultStatus(rs[0]) == PGRES_TUPLES_OK);
+					CHECK(PQresultStatus(rs[1]) == PGRES_FATAL_ERROR);
+					CHECK(PQresultStatus(rs[2]) == PGRES_PIPELINE_ABORTED);
+				}
+			}
+		}
+		WHEN("A pipeline is submitted via async_pipeline and cancelled") {
+			pipeline p;
+			p.query("SELECT 1");
+			p.query("SELECT 2");
+			boost::system::error_code ec;
+			bool invoked = false;
+			async_pipeline(conn, p, [&] (auto e, auto) {
+				invoked = true;
+				ec = e;
+			});
+			cancel(conn);
+			ios.run();
+			THEN("The operation fails with boost::asio::error::operation_aborted") {
+				REQUIRE(invoked);
+				CHECK(ec == make_error_code(boost::asio::error::operation_aborted));
+				AND_THEN("The connection is left in pipeline mode") {
+					CHECK(PQpipelineStatus(conn) != PQ_PIPELINE_OFF);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include <asio_pq/pool.hpp>
+
+#include <asio_pq/connection.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <sys/socket.h>
+#include <utility>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+const char * conninfo =
+	"host='" ASIO_PQ_TEST_HOST "'"
+	" port='" ASIO_PQ_TEST_PORT "'"
+	" user='" ASIO_PQ_TEST_USER "'"
+	" password='" ASIO_PQ_TEST_PASSWORD "'"
+	" dbname='" ASIO_PQ_TEST_DBNAME "'";
+
+SCENARIO("Connections may be acquired from a pool", "[asio_pq][pool]") {
+	GIVEN("A boost::asio::io_service and a pool with a maximum size of one") {
+		boost::asio::io_service ios;
+		pool_settings settings;
+		settings.max_size = 1;
+		pool p(ios, conninfo, settings);
+		WHEN("async_acquire is invoked") {
+			boost::system::error_code ec;
+			lease l;
+			bool invoked = false;
+			p.async_acquire([&] (auto e, auto inner) {
+				invoked = true;
+				ec = e;
+				l = std::move(inner);
+			});
+			THEN("The operation does not complete") {
+				CHECK_FALSE(invoked);
+			}
+			AND_WHEN("boost::asio::io_service::run is called") {
+				ios.run();
+				ios.reset();
+				THEN("The operation completes successfully") {
+					REQUIRE(invoked);
+					INFO("boost::system::error_code::message: " << ec.message());
+					REQUIRE_FALSE(ec);
+					REQUIRE(l);
+					AND_THEN("The connection is connected and non-blocking") {
+						CHECK(PQstatus(*l) == CONNECTION_OK);
+						CHECK(PQisnonblocking(*l) == 1);
+						CHECK(p.leased() == 1);
+						CHECK(p.idle() == 0);
+					}
+				}
+				AND_WHEN("async_acquire is invoked again") {
+					PGconn * handle = *l;
+					lease other;
+					bool other_invoked = false;
+					p.async_acquire([&] (auto e, auto inner) {
+						other_invoked = true;
+						ec = e;
+						other = std::move(inner);
+					});
+					ios.run();
+					ios.reset();
+					THEN("The operation waits for the lease to be released") {
+						CHECK_FALSE(other_invoked);
+						CHECK(p.waiting() == 1);
+						CHECK(p.connecting() == 0);
+					}
+					AND_WHEN("The lease is released") {
+						l.reset();
+						ios.run();
+						THEN("The same connection is reused") {
+							REQUIRE(other_invoked);
+							REQUIRE_FALSE(ec);
+							REQUIRE(other);
+							CHECK(other->get() == handle);
+							CHECK(p.waiting() == 0);
+						}
+					}
+				}
+				AND_WHEN("The lease is released") {
+					l.reset();
+					THEN("The connection becomes idle") {
+						CHECK(p.leased() == 0);
+						CHECK(p.idle() == 1);
+					}
+				}
+				AND_WHEN("The lease is released and the connection is closed while idle") {
+					int socket = PQsocket(*l);
+					l.reset();
+					REQUIRE(p.idle() == 1);
+					REQUIRE(::shutdown(socket, SHUT_RDWR) == 0);
+					bool other_invoked = false;
+					p.async_acquire([&] (auto e, auto inner) {
+						other_invoked = true;
+						ec = e;
+						l = std::move(inner);
+					});
+					THEN("The closed connection is discarded") {
+						CHECK(p.idle() == 0);
+						CHECK(p.connecting() == 1);
+						AND_WHEN("boost::asio::io_service::run is called") {
+							ios.run();
+							THEN("A new connection is acquired") {
+								REQUIRE(other_invoked);
+								INFO("boost::system::error_code::message: " << ec.message());
+								REQUIRE_FALSE(ec);
+								REQUIRE(l);
+								CHECK(PQstatus(*l) == CONNECTION_OK);
+								CHECK(p.leased() == 1);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	GIVEN("A boost::asio::io_service and a pool with a minimum size of two") {
+		boost::asio::io_service ios;
+		pool_settings settings;
+		settings.min_size = 2;
+		pool p(ios, conninfo, settings);
+		WHEN("boost::asio::io_service::run is called") {
+			ios.run();
+			THEN("Two idle connections are established") {
+				CHECK(p.idle() == 2);
+				CHECK(p.connecting() == 0);
+			}
+		}
+	}
+	GIVEN("A boost::asio::io_service and a pool which creates connections with invalid information") {
+		boost::asio::io_service ios;
+		pool p(
+			ios,
+			"host='" ASIO_PQ_TEST_BAD_HOST "'"
+			" port='" ASIO_PQ_TEST_BAD_PORT "'"
+			" user='" ASIO_PQ_TEST_BAD_USER "'"
+			" password='" ASIO_PQ_TEST_BAD_PASSWORD "'"
+			" dbname='" ASIO_PQ_TEST_BAD_DBNAME "'"
+		);
+		WHEN("async_acquire is invoked") {
+			boost::system::error_code ec;
+			lease l;
+			bool invoked = false;
+			p.async_acquire([&] (auto e, auto inner) {
+				invoked = true;
+				ec = e;
+				l = std::move(inner);
+			});
+			ios.run();
+			THEN("The operation fails") {
+				REQUIRE(invoked);
+				CHECK(ec);
+				CHECK_FALSE(l);
+				CHECK(p.connecting() == 0);
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,256 @@
+#include <asio_pq/result_cache.hpp>
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/exec.hpp>
+#include <asio_pq/notification.hpp>
+#include <asio_pq/notification_dispatcher.hpp>
+#include <asio_pq/params.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+static result_cache::value_type make_value () {
+	auto retr = std::make_shared<const result>(PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK));
+	REQUIRE(*retr);
+	return retr;
+}
+
+static std::string make_key (const char * command, const char * param) {
+	const char * values [] = {param};
+	return result_cache::make_key(command, 1, nullptr, values, nullptr, nullptr, 0);
+}
+
+static notification make_notification (const char * channel, const char * payload) {
+	auto c = std::strlen(channel) + 1;
+	auto p = std::strlen(payload) + 1;
+	auto ptr = static_cast<char *>(std::malloc(sizeof(PGnotify) + c + p));
+	REQUIRE(ptr);
+	auto n = reinterpret_cast<PGnotify *>(ptr);
+	n->relname = ptr + sizeof(PGnotify);
+	n->extra = n->relname + c;
+	n->be_pid = 1;
+	n->next = nullptr;
+	std::memcpy(n->relname, channel, c);
+	std::memcpy(n->extra, payload, p);
+	return notification(n);
+}
+
+SCENARIO("asio_pq::result_cache::make_key distinguishes commands and parameters", "[asio_pq][result_cache]") {
+	GIVEN("Keys for various commands and parameters") {
+		auto a = make_key("SELECT $1", "1");
+		auto b = make_key("SELECT $1", "2");
+		auto c = make_key("SELECT $2", "1");
+		auto d = make_key("SELECT $1", nullptr);
+		auto e = make_key("SELECT $1", "");
+		THEN("They are equal if and only if the command and parameters are") {
+			CHECK(a == make_key("SELECT $1", "1"));
+			CHECK(a != b);
+			CHECK(a != c);
+			CHECK(d != e);
+		}
+	}
+}
+
+SCENARIO("asio_pq::result_cache objects cache results subject to a TTL, a memory cap, and tags", "[asio_pq][result_cache]") {
+	GIVEN("A result_cache") {
+		result_cache_settings settings;
+		settings.ttl = std::chrono::seconds(10);
+		result_cache cache(settings);
+		auto now = result_cache::clock_type::now();
+		auto value = make_value();
+		REQUIRE(cache.insert("a", value, {"foo", "bar"}, now));
+		REQUIRE(cache.insert("b", make_value(), {"foo"}, now));
+		REQUIRE(cache.insert("c", make_value(), {}, now));
+		CHECK(cache.size() == 3);
+		CHECK(cache.bytes() != 0);
+		WHEN("An entry is found") {
+			auto found = cache.find("a", now);
+			THEN("The same result is returned") {
+				CHECK(found == value);
+				CHECK(cache.hits() == 1);
+				CHECK(cache.misses() == 0);
+			}
+		}
+		WHEN("An entry has expired") {
+			auto found = cache.find("a", now + std::chrono::seconds(10));
+			THEN("It is removed") {
+				CHECK_FALSE(found);
+				CHECK(cache.misses() == 1);
+				CHECK(cache.size() == 2);
+			}
+		}
+		WHEN("A tag is invalidated") {
+			auto num = cache.invalidate("foo");
+			THEN("Every entry with that tag is removed") {
+				CHECK(num == 2);
+				CHECK(cache.size() == 1);
+				CHECK_FALSE(cache.find("a", now));
+				CHECK_FALSE(cache.find("b", now));
+				CHECK(cache.find("c", now));
+				CHECK(cache.invalidate("bar") == 0);
+			}
+		}
+		WHEN("An entry is added with the same tag more than once") {
+			REQUIRE(cache.insert("d", make_value(), {"baz", "baz"}, now));
+			auto num = cache.invalidate("baz");
+			THEN("It is removed once") {
+				CHECK(num == 1);
+				CHECK(cache.size() == 3);
+				CHECK_FALSE(cache.find("d", now));
+			}
+		}
+		WHEN("The cache listens to a channel and notifications arrive") {
+			boost::asio::io_service ios;
+			connection conn(ios, static_cast<PGconn *>(nullptr));
+			notification_dispatcher dispatcher(conn);
+			cache.listen(dispatcher, "invalidate");
+			dispatcher.dispatch(make_notification("invalidate", "bar"));
+			THEN("The payload is the tag which is invalidated") {
+				CHECK(cache.size() == 2);
+				CHECK_FALSE(cache.find("a", now));
+			}
+			AND_WHEN("A notification without a payload arrives") {
+				dispatcher.dispatch(make_notification("invalidate", ""));
+				THEN("Every entry is removed") {
+					CHECK(cache.size() == 0);
+					CHECK(cache.bytes() == 0);
+				}
+			}
+		}
+	}
+	GIVEN("A result_cache with room for two entries") {
+		result_cache probe;
+		REQUIRE(probe.insert("a", make_value(), {}));
+		result_cache_settings settings;
+		settings.max_bytes = probe.bytes() * 2;
+		result_cache cache(settings);
+		REQUIRE(cache.insert("a", make_value(), {}));
+		REQUIRE(cache.insert("b", make_value(), {}));
+		WHEN("A third entry is added after the first is used") {
+			REQUIRE(cache.find("a"));
+			REQUIRE(cache.insert("c", make_value(), {}));
+			THEN("The least recently used entry is evicted") {
+				CHECK(cache.size() == 2);
+				CHECK(cache.bytes() <= settings.max_bytes);
+				CHECK(cache.find("a"));
+				CHECK_FALSE(cache.find("b"));
+				CHECK(cache.find("c"));
+			}
+		}
+		WHEN("An entry which is too large is added") {
+			auto added = cache.insert(std::string(settings.max_bytes, 'x'), make_value(), {});
+			THEN("It is not cached") {
+				CHECK_FALSE(added);
+				CHECK(cache.size() == 2);
+			}
+		}
+	}
+}
+
+SCENARIO("Results may be cached via async_exec_result_cached", "[asio_pq][async_exec_result_cached]") {
+	GIVEN("A boost::asio::io_service and an asio_pq::connection which manages a connection handle") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		result_cache cache;
+		WHEN("The same command is executed twice") {
+			boost::system::error_code ec;
+			result_cache::value_type first;
+			result_cache::value_type second;
+			auto p = make_params(std::int32_t(5));
+			async_exec_result_cached(conn, cache, "SELECT $1::int4 * 2", {"test"}, p, 0, [&] (auto e, auto v) {
+				ec = e;
+				first = std::move(v);
+			});
+			ios.run();
+			ios.reset();
+			INFO("PQerrorMessage: " << PQerrorMessage(conn));
+			REQUIRE_FALSE(ec);
+			async_exec_result_cached(conn, cache, "SELECT $1::int4 * 2", {"test"}, p, 0, [&] (auto e, auto v) {
+				ec = e;
+				second = std::move(v);
+			});
+			ios.run();
+			THEN("The second execution is served from the cache") {
+				REQUIRE_FALSE(ec);
+				REQUIRE(first);
+				REQUIRE(PQresultStatus(*first) == PGRES_TUPLES_OK);
+				CHECK(std::string(PQgetvalue(*first, 0, 0)) == "10");
+				CHECK(first == second);
+				CHECK(cache.hits() == 1);
+				CHECK(cache.misses() == 1);
+			}
+		}
+		WHEN("A data modifying command which returns rows is executed twice") {
+			boost::system::error_code ec;
+			async_exec(conn, "CREATE TEMPORARY TABLE \"result_cache_test\" (\"num\" INT)", [&] (auto e, auto) {	ec = e;	});
+			ios.run();
+			ios.reset();
+			INFO("PQerrorMessage: " << PQerrorMessage(conn));
+			REQUIRE_FALSE(ec);
+			std::vector<result_cache::value_type> values;
+			auto p = make_params(std::int32_t(5));
+			for (int i = 0; i < 2; ++i) {
+				async_exec_result_cached(conn, cache, "INSERT INTO \"result_cache_test\" VALUES ($1::int4) RETURNING \"num\"", {"test"}, p, 0, [&] (auto e, auto v) {
+					ec = e;
+					values.push_back(std::move(v));
+				});
+				ios.run();
+				ios.reset();
+				REQUIRE_FALSE(ec);
+			}
+			THEN("It is executed by the server both times") {
+				REQUIRE(values.size() == 2);
+				REQUIRE(values[0]);
+				REQUIRE(values[1]);
+				CHECK(PQresultStatus(*values[0]) == PGRES_TUPLES_OK);
+				CHECK(values[0] != values[1]);
+				CHECK(cache.size() == 0);
+				CHECK(cache.misses() == 2);
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,153 @@
+#include <asio_pq/result_view.hpp>
+
+#include <asio_pq/error.hpp>
+#include <asio_pq/oid.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <libpq-fe.h>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <catch.hpp>
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+//	Creates a result with columns "id" (int8), "name"
+//	(text), and "score" (float8) in binary format
+//	without a server
+result make_result () {
+	result r(PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK));
+	REQUIRE(r);
+	char id [] = "id";
+	char name [] = "name";
+	char score [] = "score";
+	PGresAttDesc desc [3] = {};
+	desc[0].name = id;
+	desc[0].typid = oid::int8;
+	desc[1].name = name;
+	desc[1].typid = oid::text;
+	desc[2].name = score;
+	desc[2].typid = oid::float8;
+	for (auto && d : desc) {
+		d.format = 1;
+		d.typlen = -1;
+		d.atttypmod = -1;
+	}
+	REQUIRE(PQsetResultAttrs(r, 3, desc) != 0);
+	std::string ids [] = {
+		std::string("\0\0\0\0\0\0\0\x01", 8),
+		std::string("\0\0\0\0\0\0\0\x02", 8)
+	};
+	std::string names [] = {"foo", "bar"};
+	std::string score_value("\x3F\xF8\0\0\0\0\0\0", 8);
+	for (int i = 0; i < 2; ++i) {
+		REQUIRE(PQsetvalue(r, i, 0, const_cast<char *>(ids[i].data()), 8) != 0);
+		REQUIRE(PQsetvalue(r, i, 1, const_cast<char *>(names[i].data()), int(names[i].size())) != 0);
+	}
+	REQUIRE(PQsetvalue(r, 0, 2, const_cast<char *>(score_value.data()), 8) != 0);
+	REQUIRE(PQsetvalue(r, 1, 2, nullptr, -1) != 0);
+	return r;
+}
+
+class person {
+public:
+	std::int64_t id;
+	std::string name;
+	boost::optional<double> score;
+};
+
+SCENARIO("Results may be accessed through typed views", "[asio_pq][result_view]") {
+	GIVEN("A result in binary format") {
+		auto r = make_result();
+		WHEN("A result_view whose types match by position is created") {
+			result_view<std::int64_t, boost::string_ref, boost::optional<double>> view(r);
+			THEN("It has the correct number of rows") {
+				CHECK(view.size() == 2);
+				CHECK_FALSE(view.empty());
+			}
+			THEN("Fields may be retrieved") {
+				CHECK(view[0].get<0>() == 1);
+				CHECK(view[0].get<1>() == "foo");
+				auto score = view[0].get<2>();
+				REQUIRE(static_cast<bool>(score));
+				CHECK(*score == 1.5);
+				CHECK(view[1].get<0>() == 2);
+				CHECK(view[1].get<1>() == "bar");
+				CHECK_FALSE(static_cast<bool>(view[1].get<2>()));
+			}
+			THEN("Rows may be iterated") {
+				std::vector<std::int64_t> ids;
+				for (auto && row : view) ids.push_back(row.get<0>());
+				REQUIRE(ids.size() == 2);
+				CHECK(ids[0] == 1);
+				CHECK(ids[1] == 2);
+			}
+			THEN("Rows may be decoded as tuples") {
+				auto t = view[1].as_tuple();
+				CHECK(std::get<0>(t) == 2);
+				CHECK(std::get<1>(t) == "bar");
+			}
+		}
+		WHEN("A result_view whose columns are specified by name is created") {
+			result_view<boost::optional<double>, std::int64_t, std::string> view(r, {"score", "id", "name"});
+			THEN("Columns are resolved") {
+				CHECK(view.column<0>() == 2);
+				CHECK(view.column<1>() == 0);
+				CHECK(view.column<2>() == 1);
+			}
+			THEN("Fields may be retrieved") {
+				CHECK(view[0].get<1>() == 1);
+				CHECK(view[0].get<2>() == "foo");
+			}
+		}
+		WHEN("A result_view is used to map rows to a struct") {
+			result_view<std::int64_t, std::string, boost::optional<double>> view(r, {"id", "name", "score"});
+			THEN("Rows may be decoded as the struct") {
+				auto p = view[0].as<person>();
+				CHECK(p.id == 1);
+				CHECK(p.name == "foo");
+				REQUIRE(static_cast<bool>(p.score));
+				CHECK(*p.score == 1.5);
+			}
+		}
+		WHEN("A result_view with too few types is created") {
+			boost::system::error_code ec;
+			result_view<std::int64_t, std::string> view(r, ec);
+			THEN("The operation fails") {
+				CHECK(ec == make_error_code(error::type_mismatch));
+				CHECK(view.empty());
+			}
+		}
+		WHEN("A result_view with an incompatible type is created") {
+			THEN("An exception is thrown") {
+				using type = result_view<std::int32_t, std::string, double>;
+				CHECK_THROWS_AS(type(r), boost::system::system_error);
+			}
+		}
+		WHEN("A result_view with a column which does not exist is created") {
+			boost::system::error_code ec;
+			result_view<std::int64_t> view(r, {"nonexistent"}, ec);
+			THEN("The operation fails") {
+				CHECK(ec == make_error_code(error::no_such_column));
+			}
+		}
+		WHEN("A null field is retrieved as a non-optional type") {
+			result_view<std::int64_t, std::string, double> view(r);
+			boost::system::error_code ec;
+			view[1].get<2>(ec);
+			THEN("The operation fails") {
+				CHECK(ec == make_error_code(error::unexpected_null));
+			}
+		}
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,148 @@
+#include <asio_pq/statement_cache.hpp>
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/system_error.hpp>
+#include <libpq-fe.h>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+SCENARIO("Commands may be executed through a statement_cache via async_exec_cached", "[asio_pq][statement_cache][async_exec_cached]") {
+	GIVEN("A boost::asio::io_service, an asio_pq::connection, and a statement_cache which promotes commands on their second execution") {
+		boost::asio::io_service ios;
+		const char * keywords [] = {
+			"host",
+			"port",
+			"user",
+			"password",
+			"dbname",
+			nullptr
+		};
+		const char * values [] = {
+			ASIO_PQ_TEST_HOST,
+			ASIO_PQ_TEST_PORT,
+			ASIO_PQ_TEST_USER,
+			ASIO_PQ_TEST_PASSWORD,
+			ASIO_PQ_TEST_DBNAME,
+			nullptr
+		};
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		statement_cache cache(1, 2);
+		auto exec = [&] (std::string command) {
+			const char * params [] = {"1"};
+			result r;
+			bool invoked = false;
+			async_exec_cached(conn, cache, std::move(command), 1, nullptr, params, nullptr, nullptr, 0, [&] (auto ec, auto inner) {
+				invoked = true;
+				if (ec) {
+					INFO("boost::system::error_code::message: " << ec.message());
+					INFO("PQerrorMessage: " << PQerrorMessage(conn));
+					throw boost::system::system_error(ec);
+				}
+				r = std::move(inner);
+			});
+			ios.run();
+			ios.reset();
+			REQUIRE(invoked);
+			REQUIRE(r);
+			REQUIRE(PQresultStatus(r) == PGRES_TUPLES_OK);
+			REQUIRE(PQntuples(r) == 1);
+			return std::string(PQgetvalue(r, 0, 0));
+		};
+		const std::string first("SELECT $1::INT + 1");
+		const std::string second("SELECT $1::INT + 2");
+		WHEN("A command is executed once") {
+			CHECK(exec(first) == "2");
+			THEN("It is cached but not prepared") {
+				auto e = cache.find(first);
+				REQUIRE(e);
+				CHECK(e->name.empty());
+				CHECK(e->uses == 1);
+			}
+			AND_WHEN("It is executed again") {
+				CHECK(exec(first) == "2");
+				THEN("It is prepared and described") {
+					auto e = cache.find(first);
+					REQUIRE(e);
+					CHECK_FALSE(e->name.empty());
+					REQUIRE(e->description);
+					CHECK(PQnparams(e->description) == 1);
+					CHECK(PQnfields(e->description) == 1);
+				}
+				AND_WHEN("Another command is executed") {
+					CHECK(exec(second) == "3");
+					THEN("The prepared statement is evicted and awaits deallocation") {
+						CHECK(cache.find(first) == nullptr);
+						CHECK(cache.pending_deallocations() == 1);
+					}
+					AND_WHEN("Another command is executed") {
+						CHECK(exec(second) == "3");
+						THEN("The deallocation is sent along with it") {
+							CHECK(cache.pending_deallocations() == 0);
+						}
+					}
+				}
+			}
+		}
+		WHEN("A command which cannot be prepared is executed twice") {
+			const std::string command("SELECT 'fail'");
+			auto fail = [&] () {
+				result r;
+				async_exec_cached(conn, cache, command, 0, nullptr, nullptr, nullptr, nullptr, 0, [&] (auto ec, auto inner) {
+					REQUIRE_FALSE(ec);
+					r = std::move(inner);
+				});
+				ios.run();
+				ios.reset();
+				REQUIRE(r);
+				CHECK(PQresultStatus(r) == PGRES_FATAL_ERROR);
+			};
+			fail();
+			fail();
+			THEN("The failure is remembered") {
+				auto e = cache.find(command);
+				REQUIRE(e);
+				CHECK(e->name.empty());
+				CHECK(e->failed);
+				CHECK_FALSE(cache.should_promote(*e));
+			}
+		}
+	}
+}
+
+SCENARIO("statement_cache objects name their prepared statements uniquely", "[asio_pq][statement_cache]") {
+	GIVEN("Two statement_cache objects") {
+		statement_cache a(1);
+		statement_cache b(1);
+		THEN("The names they generate do not collide") {
+			auto name = a.make_name();
+			CHECK(name != a.make_name());
+			CHECK(name != b.make_name());
+		}
+	}
+}
+
+}
+}
+}
+
+#endif
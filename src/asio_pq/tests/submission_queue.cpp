@@ -0,0 +1,203 @@
+#include <asio_pq/submission_queue.hpp>
+
+#ifdef ASIO_PQ_HAS_PIPELINE
+
+#include <asio_pq/connect.hpp>
+#include <asio_pq/connection.hpp>
+#include <asio_pq/result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/use_future.hpp>
+#include <boost/system/error_code.hpp>
+#include <libpq-fe.h>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+
+#include "config.hpp"
+
+namespace asio_pq {
+namespace tests {
+namespace {
+
+const char * keywords [] = {
+	"host",
+	"port",
+	"user",
+	"password",
+	"dbname",
+	nullptr
+};
+const char * values [] = {
+	ASIO_PQ_TEST_HOST,
+	ASIO_PQ_TEST_PORT,
+	ASIO_PQ_TEST_USER,
+	ASIO_PQ_TEST_PASSWORD,
+	ASIO_PQ_TEST_DBNAME,
+	nullptr
+};
+
+SCENARIO("Commands may be submitted from any thread via a submission_queue", "[asio_pq][submission_queue]") {
+	GIVEN("A boost::asio::io_service, a connection handle, and a submission_queue") {
+		boost::asio::io_service ios;
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		submission_queue queue(conn, 16);
+		WHEN("Commands are submitted concurrently from several threads") {
+			const std::size_t threads = 4;
+			const std::size_t per_thread = 50;
+			std::atomic<std::size_t> ok(0);
+			std::atomic<std::size_t> failed(0);
+			//	Keeps the io_service running while the
+			//	threads submit
+			auto work = std::make_unique<boost::asio::io_service::work>(ios);
+			std::vector<std::thread> ts;
+			for (std::size_t i = 0; i < threads; ++i) ts.emplace_back([&, i] () {
+				for (std::size_t j = 0; j < per_thread; ++j) {
+					auto text = std::to_string(i * per_thread + j);
+					const char * param [] = {text.c_str()};
+					queue.submit("SELECT $1::INT", 1, nullptr, param, nullptr, nullptr, 0, [&] (auto ec, auto r) {
+						if (ec || (PQresultStatus(r) != PGRES_TUPLES_OK)) ++failed;
+						else ++ok;
+						if ((ok + failed) == (threads * per_thread)) work.reset();
+					});
+				}
+			});
+			ios.run();
+			for (auto && t : ts) t.join();
+			THEN("Every callback is invoked successfully") {
+				CHECK(failed == 0U);
+				CHECK(ok == threads * per_thread);
+			}
+			THEN("The commands are sent in batches") {
+				CHECK(queue.batches() >= (threads * per_thread) / 16);
+				CHECK(queue.batches() <= threads * per_thread);
+			}
+			THEN("The connection may be used for further commands") {
+				bool invoked = false;
+				queue.submit("SELECT 1", [&] (auto ec, auto r) {
+					CHECK_FALSE(ec);
+					CHECK(PQresultStatus(r) == PGRES_TUPLES_OK);
+					invoked = true;
+				});
+				ios.reset();
+				ios.run();
+				CHECK(invoked);
+			}
+		}
+		WHEN("A command which fails is submitted between commands which succeed") {
+			std::vector<ExecStatusType> statuses;
+			boost::system::error_code ec;
+			auto callback = [&] (auto e, auto r) {
+				if (e) ec = e;
+				statuses.push_back(r ? PQresultStatus(r) : PGRES_EMPTY_QUERY);
+			};
+			queue.submit("SELECT 1", callback);
+			queue.submit("SELECT * FROM \"submission_queue_fail_test\"", callback);
+			queue.submit("SELECT 2", callback);
+			ios.run();
+			THEN("Only the failing command fails") {
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+				REQUIRE(statuses.size() == 3U);
+				CHECK(statuses[0] == PGRES_TUPLES_OK);
+				CHECK(statuses[1] == PGRES_FATAL_ERROR);
+				CHECK(statuses[2] == PGRES_TUPLES_OK);
+				CHECK(queue.batches() == 1U);
+			}
+		}
+		WHEN("A write which fails is submitted between writes which succeed") {
+			std::vector<ExecStatusType> statuses;
+			boost::system::error_code ec;
+			auto callback = [&] (auto e, auto r) {
+				if (e) ec = e;
+				statuses.push_back(r ? PQresultStatus(r) : PGRES_EMPTY_QUERY);
+			};
+			result rows;
+			queue.submit("CREATE TEMPORARY TABLE \"submission_queue_test\" (\"num\" INT)", callback);
+			queue.submit("INSERT INTO \"submission_queue_test\" VALUES (1)", callback);
+			queue.submit("INSERT INTO \"submission_queue_test\" VALUES ('fail')", callback);
+			queue.submit("INSERT INTO \"submission_queue_test\" VALUES (2)", callback);
+			queue.submit("SELECT \"num\" FROM \"submission_queue_test\" ORDER BY \"num\"", [&] (auto e, auto r) {
+				if (e) ec = e;
+				rows = std::move(r);
+			});
+			ios.run();
+			THEN("The failure does not roll back the other writes") {
+				INFO(ec.message());
+				CHECK_FALSE(ec);
+				REQUIRE(statuses.size() == 4U);
+				CHECK(statuses[0] == PGRES_COMMAND_OK);
+				CHECK(statuses[1] == PGRES_COMMAND_OK);
+				CHECK(statuses[2] == PGRES_FATAL_ERROR);
+				CHECK(statuses[3] == PGRES_COMMAND_OK);
+				REQUIRE(rows);
+				REQUIRE(PQresultStatus(rows) == PGRES_TUPLES_OK);
+				REQUIRE(PQntuples(rows) == 2);
+				CHECK(std::strcmp(PQgetvalue(rows, 0, 0), "1") == 0);
+				CHECK(std::strcmp(PQgetvalue(rows, 1, 0), "2") == 0);
+			}
+		}
+	}
+}
+
+SCENARIO("Destroying a submission_queue aborts outstanding commands", "[asio_pq][submission_queue]") {
+	GIVEN("A boost::asio::io_service and a connection handle") {
+		boost::asio::io_service ios;
+		connection conn(ios, keywords, values, false);
+		REQUIRE(conn);
+		auto future = async_connect(conn, boost::asio::use_future);
+		ios.run();
+		ios.reset();
+		future.get();
+		REQUIRE(PQsetnonblocking(conn, 1) == 0);
+		std::vector<boost::system::error_code> ecs;
+		auto callback = [&] (auto ec, auto) {	ecs.push_back(ec);	};
+		auto queue = std::make_unique<submission_queue>(conn);
+		queue->submit("SELECT 1", callback);
+		queue->submit("SELECT 2", callback);
+		WHEN("The submission_queue is destroyed before the commands are sent") {
+			queue.reset();
+			ios.run();
+			THEN("Every callback is invoked with boost::asio::error::operation_aborted") {
+				REQUIRE(ecs.size() == 2U);
+				CHECK(ecs[0] == boost::asio::error::operation_aborted);
+				CHECK(ecs[1] == boost::asio::error::operation_aborted);
+			}
+		}
+		WHEN("The submission_queue is destroyed while the commands are in flight") {
+			//	Sends the batch but does not wait for its results
+			REQUIRE(ios.poll_one() == 1U);
+			REQUIRE(ecs.empty());
+			queue.reset();
+			THEN("Every callback is invoked with boost::asio::error::operation_aborted") {
+				REQUIRE(ecs.size() == 2U);
+				CHECK(ecs[0] == boost::asio::error::operation_aborted);
+				CHECK(ecs[1] == boost::asio::error::operation_aborted);
+				AND_THEN("The results are drained so the connection remains usable") {
+					ios.run();
+					ios.reset();
+					CHECK(ecs.size() == 2U);
+					CHECK(PQpipelineStatus(conn) == PQ_PIPELINE_OFF);
+					CHECK(PQtransactionStatus(conn) == PQTRANS_IDLE);
+				}
+			}
+		}
+	}
+}
+
+}
+}
+}
+
+#endif